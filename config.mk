@@ -45,3 +45,7 @@ THIRDPARTY += nlohmann
 
 ## 编译配置
 CCFLAGS += -DENABLE_TRACE_RECORDER=1
+
+## 在以下热点模块中去掉 RECORD_SCOPE() 等记录器，以降低开启 trace 时的开销，如：
+## TRACE_RECORDER_DISABLED_MODULES += event network
+TRACE_RECORDER_DISABLED_MODULES +=
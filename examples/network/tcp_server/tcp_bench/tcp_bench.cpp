@@ -0,0 +1,173 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+/**
+ * 对比 TcpServer 在不同 Loop 数量下的吞吐：
+ * - 每秒建立的连接数：多个客户端线程不断地连接与断开
+ * - 每秒处理的请求数：多个客户端线程各用一个连接，不断地一问一答
+ */
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <tbox/network/tcp_server.h>
+#include <tbox/base/scope_exit.hpp>
+
+using namespace std;
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+
+namespace {
+
+int ConnectTo(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//! 发送 data 并读回同样长度的数据
+bool RoundTrip(int fd, const std::string &data)
+{
+    if (write(fd, data.data(), data.size()) != (ssize_t)data.size())
+        return false;
+
+    size_t recv_size = 0;
+    char buff[256];
+    while (recv_size < data.size()) {
+        ssize_t rsize = read(fd, buff, sizeof(buff));
+        if (rsize <= 0)
+            return false;
+        recv_size += rsize;
+    }
+    return true;
+}
+
+void PrintUsage(const char *prog)
+{
+    cout << "Usage: " << prog << " [port] [client_thread_num] [duration_ms]" << endl
+         << "Exp  : " << prog << " 22110 16 300" << endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    uint16_t port = (argc >= 2) ? atoi(argv[1]) : 22110;
+    int client_thread_num = (argc >= 3) ? atoi(argv[2]) : 16;
+    auto duration = std::chrono::milliseconds((argc >= 4) ? atoi(argv[3]) : 300);
+
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    for (int loop_num : { 1, 2, 4, 8, 16 }) {
+        TcpServer server(sp_loop);
+        if (!server.initialize(SockAddr::FromString("127.0.0.1:" + std::to_string(port)), 1024, loop_num)) {
+            cout << "initialize server fail, port:" << port << endl;
+            return 1;
+        }
+
+        server.setReceiveCallback(
+            [&server] (const TcpServer::ConnToken &client, Buffer &buff) {
+                server.send(client, buff.readableBegin(), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+        server.start();
+
+        std::atomic<bool> is_stop(false);
+        std::atomic<uint64_t> conn_count(0);
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < client_thread_num; ++i) {
+            threads.emplace_back(
+                [&] {
+                    while (!is_stop) {
+                        int fd = ConnectTo(port);
+                        if (fd < 0)
+                            break;
+                        //! 完成一次问答，确保连接已被服务端接受
+                        if (RoundTrip(fd, "x"))
+                            ++conn_count;
+                        close(fd);
+                    }
+                }
+            );
+        }
+        std::this_thread::sleep_for(duration);
+        is_stop = true;
+        for (auto &t : threads)
+            t.join();
+        threads.clear();
+
+        is_stop = false;
+        std::atomic<uint64_t> req_count(0);
+        for (int i = 0; i < client_thread_num; ++i) {
+            threads.emplace_back(
+                [&] {
+                    int fd = ConnectTo(port);
+                    if (fd < 0)
+                        return;
+                    std::string msg(64, 'a');
+                    while (!is_stop && RoundTrip(fd, msg))
+                        ++req_count;
+                    close(fd);
+                }
+            );
+        }
+        std::this_thread::sleep_for(duration);
+        is_stop = true;
+        for (auto &t : threads)
+            t.join();
+
+        server.cleanup();
+
+        auto ms = duration.count();
+        cout << "loops: " << loop_num
+             << ", conns: " << conn_count * 1000 / ms << " /s"
+             << ", requests: " << req_count * 1000 / ms << " /s" << endl;
+
+        ++port;
+    }
+
+    return 0;
+}
@@ -37,9 +37,11 @@ using namespace tbox::network;
 
 void PrintUsage(const char *prog)
 {
-    cout << "Usage: " << prog << " <ip:port|localpath>" << endl
+    cout << "Usage: " << prog << " <ip:port|localpath> [engine]" << endl
          << "Exp  : " << prog << " 127.0.0.1:12345" << endl
-         << "       " << prog << " /tmp/test.sock" << endl;
+         << "       " << prog << " /tmp/test.sock" << endl
+         << "       " << prog << " 127.0.0.1:12345 io_uring" << endl
+         << "engine: epoll(default), select, io_uring" << endl;
 }
 
 int main(int argc, char **argv)
@@ -53,11 +55,16 @@ int main(int argc, char **argv)
 
     SockAddr bind_addr = SockAddr::FromString(argv[1]);
 
-    Loop *sp_loop = Loop::New();
+    //! 可指定事件引擎，便于对比各引擎的吞吐量
+    Loop *sp_loop = (argc >= 3) ? Loop::New(argv[2]) : Loop::New();
+    if (sp_loop == nullptr) {
+        cout << "engine " << argv[2] << " is not supported" << endl;
+        return 0;
+    }
     SetScopeExitAction([sp_loop] { delete sp_loop; });
 
     TcpServer server(sp_loop);
-    server.initialize(bind_addr, 1);
+    server.initialize(bind_addr, 128);
     //! 当收到数据时，直接往client指定对象发回去
     server.setReceiveCallback(
         [&server] (const TcpServer::ConnToken &client, Buffer &buff) {
@@ -18,6 +18,10 @@
 LIB_BASENAME = libtbox_$(LIB_NAME)$(LIB_NAME_EXT)
 LIB_BUILD_DIR = $(BUILD_DIR)/$(PROJECT)
 
+ifneq ($(filter $(PROJECT),$(TRACE_RECORDER_DISABLED_MODULES)),)
+CXXFLAGS += -DDISABLE_TRACE_RECORDER=1
+endif
+
 STATIC_LIB := $(LIB_BASENAME).a
 SHARED_LIB := $(LIB_BASENAME).so.$(LIB_VERSION_X).$(LIB_VERSION_Y).$(LIB_VERSION_Z)
 
@@ -134,6 +138,19 @@ $(LIB_BUILD_DIR)/test: $(TEST_OBJECTS)
 #test : print_test_vars $(LIB_BUILD_DIR)/test
 test : $(LIB_BUILD_DIR)/test
 
+# 替换了全局 operator new 来统计内存分配的测试，单独编译成 alloc_test，不影响其它测试
+ifneq ($(ALLOC_TEST_CPP_SRC_FILES),)
+ALLOC_TEST_OBJECTS := $(foreach src,$(ALLOC_TEST_CPP_SRC_FILES),$(call CPP_SOURCE_TO_TEST_OBJECT,$(src)))
+
+$(foreach src,$(filter-out $(TEST_CPP_SRC_FILES),$(ALLOC_TEST_CPP_SRC_FILES)),$(eval $(call CREATE_CPP_TEST_OBJECT,$(src))))
+
+$(LIB_BUILD_DIR)/alloc_test: $(ALLOC_TEST_OBJECTS)
+	@echo "\033[35mBUILD alloc_test\033[0m"
+	@$(CXX) -o $@ $(ALLOC_TEST_OBJECTS) $(TEST_LDFLAGS) -lgmock_main -lgmock -lgtest -lpthread
+
+test : $(LIB_BUILD_DIR)/alloc_test
+endif
+
 ################################################################
 # install and uninstall
 ################################################################
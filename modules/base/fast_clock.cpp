@@ -0,0 +1,250 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "fast_clock.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <mutex>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace tbox {
+
+namespace {
+
+std::atomic<ClockSource> _clock_source(ClockSource::kSystem);
+
+inline uint64_t GetClockNanoseconds(clockid_t clock_id)
+{
+    struct timespec ts;
+    ::clock_gettime(clock_id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+#if defined(__x86_64__)
+/**
+ * TSC 的换算参数
+ * ns = steady_base_ns + (tsc - tsc_base) * ns_per_tick
+ */
+struct TscParam {
+    uint64_t tsc_base;
+    uint64_t steady_base_ns;
+    uint64_t mult;              //!< ns_per_tick * 2^32
+    int64_t  system_offset_ns;  //!< 墙上时钟与单调时钟之差
+};
+
+/**
+ * 每次选用 kTsc 都会重新校准，参数由顺序锁保护：
+ * 写时序号先变为奇数，写完再变为偶数；读时不加锁，读前后序号不一致或为奇数就重读。
+ * 读者在读的过程中被挂起多久都不会读到不一致的参数
+ */
+struct TscParamSeqLock {
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint64_t> tsc_base{0};
+    std::atomic<uint64_t> steady_base_ns{0};
+    std::atomic<uint64_t> mult{0};
+    std::atomic<int64_t>  system_offset_ns{0};
+} _tsc_param;
+
+std::mutex _tsc_calibrate_lock;
+bool _is_tsc_ready = false;     //!< 是否校准成功过，只在 _tsc_calibrate_lock 内访问
+
+//! CPU 是否支持恒速 TSC，即 TSC 不随变频与休眠而变化
+bool IsInvariantTscSupported()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+}
+
+//! 读取同一时刻的 TSC 与单调时钟，取 TSC 前后两次的中点
+void SampleTscAndSteady(uint64_t &tsc, uint64_t &steady_ns)
+{
+    uint64_t tsc_1 = __rdtsc();
+    steady_ns = GetClockNanoseconds(CLOCK_MONOTONIC);
+    uint64_t tsc_2 = __rdtsc();
+    tsc = tsc_1 + (tsc_2 - tsc_1) / 2;
+}
+
+//! 校准 TSC，成功后切换到新参数
+bool CalibrateTsc()
+{
+    if (!IsInvariantTscSupported())
+        return false;
+
+    uint64_t tsc_1, steady_1, tsc_2, steady_2;
+    SampleTscAndSteady(tsc_1, steady_1);
+
+    struct timespec wait_ts = { 0, 20 * 1000000 };
+    ::nanosleep(&wait_ts, nullptr);
+
+    SampleTscAndSteady(tsc_2, steady_2);
+    if (tsc_2 <= tsc_1 || steady_2 <= steady_1)
+        return false;
+
+    int64_t system_offset_ns = GetClockNanoseconds(CLOCK_REALTIME) - GetClockNanoseconds(CLOCK_MONOTONIC);
+
+    //! 只在 _tsc_calibrate_lock 内写
+    auto &p = _tsc_param;
+    uint32_t seq = p.seq.load(std::memory_order_relaxed);
+    p.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    p.tsc_base.store(tsc_2, std::memory_order_relaxed);
+    p.steady_base_ns.store(steady_2, std::memory_order_relaxed);
+    p.mult.store(((steady_2 - steady_1) << 32) / (tsc_2 - tsc_1), std::memory_order_relaxed);
+    p.system_offset_ns.store(system_offset_ns, std::memory_order_relaxed);
+    p.seq.store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+inline TscParam GetTscParam()
+{
+    auto &p = _tsc_param;
+    TscParam param;
+    for (;;) {
+        uint32_t seq = p.seq.load(std::memory_order_acquire);
+        param.tsc_base = p.tsc_base.load(std::memory_order_relaxed);
+        param.steady_base_ns = p.steady_base_ns.load(std::memory_order_relaxed);
+        param.mult = p.mult.load(std::memory_order_relaxed);
+        param.system_offset_ns = p.system_offset_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq & 1) == 0 && p.seq.load(std::memory_order_relaxed) == seq)
+            return param;
+    }
+}
+
+inline uint64_t GetTscNanoseconds(const TscParam &param)
+{
+    uint64_t delta = __rdtsc() - param.tsc_base;
+    return param.steady_base_ns +
+           static_cast<uint64_t>((static_cast<unsigned __int128>(delta) * param.mult) >> 32);
+}
+#endif
+
+/**
+ * 线程号缓存
+ *
+ * fork() 之后，子进程中唯一的线程继承了父进程该线程的缓存，须清除
+ */
+thread_local long _thread_id_cache = 0;
+
+void ResetThreadIdCacheInChild()
+{
+    _thread_id_cache = 0;
+}
+
+struct AtForkRegister {
+    AtForkRegister() { ::pthread_atfork(nullptr, nullptr, ResetThreadIdCacheInChild); }
+} _at_fork_register;
+
+}
+
+bool SetClockSource(ClockSource source)
+{
+    if (source == ClockSource::kTsc) {
+#if defined(__x86_64__)
+        std::lock_guard<std::mutex> lg(_tsc_calibrate_lock);
+        //! 重新校准失败时，沿用上次成功的参数
+        if (CalibrateTsc())
+            _is_tsc_ready = true;
+        if (!_is_tsc_ready)
+            return false;
+#else
+        return false;
+#endif
+    }
+
+    _clock_source.store(source, std::memory_order_release);
+    return true;
+}
+
+ClockSource GetClockSource()
+{
+    return _clock_source.load(std::memory_order_relaxed);
+}
+
+bool ClockSourceFromString(const std::string &name, ClockSource &source)
+{
+    if (name == "system")
+        source = ClockSource::kSystem;
+    else if (name == "coarse")
+        source = ClockSource::kCoarse;
+    else if (name == "tsc")
+        source = ClockSource::kTsc;
+    else
+        return false;
+    return true;
+}
+
+const char* ClockSourceToString(ClockSource source)
+{
+    switch (source) {
+        case ClockSource::kCoarse: return "coarse";
+        case ClockSource::kTsc:    return "tsc";
+        default:                   return "system";
+    }
+}
+
+uint64_t GetSteadyClockNanoseconds()
+{
+    switch (_clock_source.load(std::memory_order_acquire)) {
+        case ClockSource::kCoarse:
+            return GetClockNanoseconds(CLOCK_MONOTONIC_COARSE);
+#if defined(__x86_64__)
+        case ClockSource::kTsc:
+            return GetTscNanoseconds(GetTscParam());
+#endif
+        default:
+            return GetClockNanoseconds(CLOCK_MONOTONIC);
+    }
+}
+
+uint64_t GetSystemClockMicroseconds()
+{
+    switch (_clock_source.load(std::memory_order_acquire)) {
+        case ClockSource::kCoarse:
+            return GetClockNanoseconds(CLOCK_REALTIME_COARSE) / 1000;
+#if defined(__x86_64__)
+        case ClockSource::kTsc: {
+            auto param = GetTscParam();
+            return (GetTscNanoseconds(param) + param.system_offset_ns) / 1000;
+        }
+#endif
+        default:
+            return GetClockNanoseconds(CLOCK_REALTIME) / 1000;
+    }
+}
+
+long GetCurrentThreadId()
+{
+    if (_thread_id_cache == 0)
+        _thread_id_cache = ::syscall(SYS_gettid);
+    return _thread_id_cache;
+}
+
+}
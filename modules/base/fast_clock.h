@@ -0,0 +1,81 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_BASE_FAST_CLOCK_H_20251018
+#define TBOX_BASE_FAST_CLOCK_H_20251018
+
+/**
+ * 供日志、trace、事件统计等热点路径使用的时钟与线程号
+ *
+ * 线程号在首次获取后缓存在 thread_local 中，不必每次都 syscall(SYS_gettid)。
+ * 时钟源可以选择：
+ *   kSystem  clock_gettime()，经由 vDSO，精度高，默认
+ *   kCoarse  CLOCK_*_COARSE，更快，但精度只有一个 jiffy（通常1~4ms）
+ *   kTsc     读 CPU 时间戳计数器，以 CLOCK_MONOTONIC 校准，仅 x86_64 且 TSC 恒速时可用
+ *
+ * 各时钟源的单调时钟与 std::chrono::steady_clock 的起点相同，可以混用；
+ * 墙上时钟在 kTsc 下由单调时钟加上校准时的差值得到，之后修改系统时间不会被感知，
+ * 需要时可再次调用 SetClockSource(ClockSource::kTsc) 重新校准，校准期间会阻塞约20ms。
+ *
+ * 在 tbox.main 中，可通过配置 log.clock_source 或终端命令 log/clock_source 选择，
+ * 取值为 "system"、"coarse"、"tsc"。
+ */
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+
+namespace tbox {
+
+enum class ClockSource {
+    kSystem,
+    kCoarse,
+    kTsc,
+};
+
+//! 选择时钟源，不支持时返回 false 且不切换。选择 kTsc 时每次都会重新校准
+bool SetClockSource(ClockSource source);
+ClockSource GetClockSource();
+
+//! 时钟源与其名称 "system"、"coarse"、"tsc" 互转，名称无效时返回 false
+bool ClockSourceFromString(const std::string &name, ClockSource &source);
+const char* ClockSourceToString(ClockSource source);
+
+//! 单调时钟，单位ns
+uint64_t GetSteadyClockNanoseconds();
+//! 墙上时钟，单位us
+uint64_t GetSystemClockMicroseconds();
+
+//! 当前线程的线程号，与 syscall(SYS_gettid) 的一致
+long GetCurrentThreadId();
+
+//! 与 std::chrono::steady_clock 兼容的时钟，time_point 可与之直接比较与相减
+struct FastSteadyClock {
+    using duration   = std::chrono::nanoseconds;
+    using rep        = duration::rep;
+    using period     = duration::period;
+    using time_point = std::chrono::time_point<std::chrono::steady_clock, duration>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(duration(GetSteadyClockNanoseconds())); }
+};
+
+}
+
+#endif //TBOX_BASE_FAST_CLOCK_H_20251018
@@ -0,0 +1,198 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+#include <thread>
+#include <iostream>
+
+#include "fast_clock.h"
+#include "scope_exit.hpp"
+
+namespace tbox {
+namespace {
+
+const ClockSource kAllSources[] = { ClockSource::kSystem, ClockSource::kCoarse, ClockSource::kTsc };
+
+uint64_t GetTimeOfDayMicroseconds()
+{
+    struct timeval tv;
+    ::gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000ull + tv.tv_usec;
+}
+
+}
+
+TEST(FastClock, ThreadId)
+{
+    EXPECT_EQ(GetCurrentThreadId(), ::syscall(SYS_gettid));
+    EXPECT_EQ(GetCurrentThreadId(), ::syscall(SYS_gettid));
+
+    long main_tid = GetCurrentThreadId();
+    long sub_tid = 0;
+    long sub_expect_tid = -1;
+    std::thread t([&] {
+        sub_tid = GetCurrentThreadId();
+        sub_expect_tid = ::syscall(SYS_gettid);
+    });
+    t.join();
+
+    EXPECT_EQ(sub_tid, sub_expect_tid);
+    EXPECT_NE(sub_tid, main_tid);
+}
+
+//! fork() 之后，子进程不能沿用父进程的缓存
+TEST(FastClock, ThreadIdAfterFork)
+{
+    GetCurrentThreadId();
+
+    pid_t pid = ::fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+        ::_exit(GetCurrentThreadId() == ::syscall(SYS_gettid) ? 0 : 1);
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(FastClock, Sources)
+{
+    SetScopeExitAction([] { SetClockSource(ClockSource::kSystem); });
+
+    for (auto source : kAllSources) {
+        if (!SetClockSource(source)) {
+            std::cout << ClockSourceToString(source) << " is not supported" << std::endl;
+            continue;
+        }
+        EXPECT_EQ(GetClockSource(), source);
+
+        //! 粗略时钟的误差在一个 jiffy 以内
+        auto steady_ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+                            (std::chrono::steady_clock::now().time_since_epoch()).count();
+        auto fast_steady_ns = GetSteadyClockNanoseconds();
+        EXPECT_NEAR(fast_steady_ns, steady_ns, 10000000) << ClockSourceToString(source);
+
+        auto system_us = GetTimeOfDayMicroseconds();
+        auto fast_system_us = GetSystemClockMicroseconds();
+        EXPECT_NEAR(fast_system_us, system_us, 10000) << ClockSourceToString(source);
+
+        //! 单调不减
+        uint64_t last_ns = GetSteadyClockNanoseconds();
+        for (int i = 0; i < 10000; ++i) {
+            uint64_t now_ns = GetSteadyClockNanoseconds();
+            ASSERT_GE(now_ns, last_ns) << ClockSourceToString(source);
+            last_ns = now_ns;
+        }
+    }
+}
+
+TEST(FastClock, SourceName)
+{
+    for (auto source : kAllSources) {
+        ClockSource parsed = ClockSource::kSystem;
+        EXPECT_TRUE(ClockSourceFromString(ClockSourceToString(source), parsed));
+        EXPECT_EQ(parsed, source);
+    }
+
+    ClockSource parsed = ClockSource::kCoarse;
+    EXPECT_FALSE(ClockSourceFromString("hpet", parsed));
+    EXPECT_EQ(parsed, ClockSource::kCoarse);
+}
+
+//! 再次选用 kTsc 会重新校准，其间其它线程读取的时间仍然准确
+TEST(FastClock, TscRecalibrate)
+{
+    SetScopeExitAction([] { SetClockSource(ClockSource::kSystem); });
+
+    if (!SetClockSource(ClockSource::kTsc)) {
+        std::cout << "tsc is not supported" << std::endl;
+        return;
+    }
+
+    std::atomic<bool> is_stop(false);
+    std::atomic<int> bad_count(0);
+    std::thread reader([&] {
+        while (!is_stop) {
+            auto steady_ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+                                (std::chrono::steady_clock::now().time_since_epoch()).count();
+            auto diff = static_cast<int64_t>(GetSteadyClockNanoseconds()) - steady_ns;
+            if (diff > 10000000 || diff < -10000000)
+                ++bad_count;
+        }
+    });
+
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(SetClockSource(ClockSource::kTsc));
+
+    is_stop = true;
+    reader.join();
+    EXPECT_EQ(bad_count, 0);
+    EXPECT_NEAR(GetSystemClockMicroseconds(), GetTimeOfDayMicroseconds(), 10000);
+}
+
+TEST(FastClock, CompatibleWithSteadyClock)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto cost = FastSteadyClock::now() - start;
+
+    EXPECT_GE(cost, std::chrono::milliseconds(19));
+    EXPECT_LT(cost, std::chrono::milliseconds(200));
+}
+
+//! 对比各方式单次调用的耗时
+TEST(FastClock, Benchmark)
+{
+    SetScopeExitAction([] { SetClockSource(ClockSource::kSystem); });
+
+    const int kLoopNum = 200000;
+    volatile uint64_t sink = 0;
+
+    auto measure = [&] (const char *what, const std::function<uint64_t()> &func) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kLoopNum; ++i)
+            sink = sink + func();
+        auto cost = std::chrono::steady_clock::now() - start;
+        std::cout << what << ": "
+                  << std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count() / kLoopNum
+                  << " ns" << std::endl;
+    };
+
+    measure("syscall(SYS_gettid)", [] { return ::syscall(SYS_gettid); });
+    measure("GetCurrentThreadId()", [] { return GetCurrentThreadId(); });
+    measure("gettimeofday()", [] { return GetTimeOfDayMicroseconds(); });
+
+    for (auto source : kAllSources) {
+        if (!SetClockSource(source))
+            continue;
+        std::string name = ClockSourceToString(source);
+        measure((name + " GetSteadyClockNanoseconds()").c_str(), [] { return GetSteadyClockNanoseconds(); });
+        measure((name + " GetSystemClockMicroseconds()").c_str(), [] { return GetSystemClockMicroseconds(); });
+    }
+}
+
+}
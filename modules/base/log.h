@@ -43,11 +43,22 @@
 #endif //LOG_MODULE_ID
 
 //! Define commonly macros
+//! Each call site keeps its own level cache, so a suppressed log costs only two loads and a compare.
+//! They are void expressions (GNU statement expression), usable as `cond ? LogWarn("x") : (void)0`.
+//! Note: the arguments are not evaluated if the log is suppressed.
 #define LogPrintf(level, fmt, ...) \
-    LogPrintfFunc(LOG_MODULE_ID, __func__, __FILE__, __LINE__, level, 1, fmt, ## __VA_ARGS__)
+    ({ \
+        static uint32_t _log_level_cache = 0; \
+        LogIsLevelEnabled(LOG_MODULE_ID, level, &_log_level_cache) ? \
+            LogPrintfFunc(LOG_MODULE_ID, __func__, __FILE__, __LINE__, level, 1, fmt, ## __VA_ARGS__) : (void)0; \
+    })
 
 #define LogPuts(level, text) \
-    LogPrintfFunc(LOG_MODULE_ID, __func__, __FILE__, __LINE__, level, 0, text)
+    ({ \
+        static uint32_t _log_level_cache = 0; \
+        LogIsLevelEnabled(LOG_MODULE_ID, level, &_log_level_cache) ? \
+            LogPrintfFunc(LOG_MODULE_ID, __func__, __FILE__, __LINE__, level, 0, text) : (void)0; \
+    })
 
 #define LogFatal(fmt, ...)      LogPrintf(LOG_LEVEL_FATAL,  fmt, ## __VA_ARGS__)
 #define LogErr(fmt, ...)        LogPrintf(LOG_LEVEL_ERROR,  fmt, ## __VA_ARGS__)
@@ -59,15 +70,15 @@
 #if !defined(STATIC_LOG_LEVEL) || (STATIC_LOG_LEVEL >= LOG_LEVEL_DEBUG)
     #define LogDbg(fmt, ...)    LogPrintf(LOG_LEVEL_DEBUG, fmt, ## __VA_ARGS__)
 #else
-    #define LogDbg(fmt, ...)
+    #define LogDbg(fmt, ...)    ((void)0)
 #endif
 
 #if !defined(STATIC_LOG_LEVEL) || (STATIC_LOG_LEVEL >= LOG_LEVEL_TRACE)
     #define LogTrace(fmt, ...)  LogPrintf(LOG_LEVEL_TRACE, fmt, ## __VA_ARGS__)
     #define LogTag()            LogPuts(LOG_LEVEL_TRACE, "==> Run Here <==")
 #else
-    #define LogTrace(fmt, ...)
-    #define LogTag()
+    #define LogTrace(fmt, ...)  ((void)0)
+    #define LogTag()            ((void)0)
 #endif
 
 #define LogUndo() LogPuts(LOG_LEVEL_NOTICE, "!!! Undo !!!")
@@ -75,10 +86,37 @@
 //! 打印错误码，需要 #include <string.h>
 #define LogErrno(err, fmt, ...) LogErr("Errno:%d(%s) " fmt, (err), strerror(err), ## __VA_ARGS__)
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+//! Version of the output channels' level settings, increased on every change
+extern uint32_t LogLevelVersion;
+
+//!
+//! \brief  Slow path of LogIsLevelEnabled()
+//!
+//! Calculate the effective max level of module_id among all output channels,
+//! and store it with current LogLevelVersion into cache.
+//!
+int LogIsLevelEnabledSlow(const char *module_id, int level, uint32_t *cache);
+
+//!
+//! \brief  Check whether a log of level from module_id will be printed by any output channel
+//!
+//! \param  cache   Call site cache, must be zero initialized.
+//!                 High 24 bits is LogLevelVersion, low 8 bits is the effective max level + 1
+//!
+static inline int LogIsLevelEnabled(const char *module_id, int level, uint32_t *cache)
+{
+    uint32_t value = __atomic_load_n(cache, __ATOMIC_RELAXED);
+    if ((value >> 8) == (__atomic_load_n(&LogLevelVersion, __ATOMIC_RELAXED) & 0xffffff))
+        return level < (int)(value & 0xff);
+    return LogIsLevelEnabledSlow(module_id, level, cache);
+}
+
 //!
 //! \brief  Log print function
 //!
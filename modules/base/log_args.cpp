@@ -0,0 +1,497 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "log_args.h"
+#include "log_impl.h"
+
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+namespace {
+
+//! 参数的类型，决定了 va_arg() 取值与格式化时传参的类型
+enum class ArgKind : uint8_t {
+    kInt,
+    kLong,
+    kLongLong,
+    kSizeT,
+    kPtrdiff,
+    kIntmax,
+    kDouble,
+    kLongDouble,
+    kPointer,
+    kString,
+};
+
+//! 一个转换说明，如 "%-8.3f"
+struct ConvSpec {
+    std::string literal;    //!< 在它之前的普通文本，"%%" 已转为 "%"
+    std::string spec;       //!< 转换说明本身
+    ArgKind kind;
+    bool is_unsigned;
+    uint8_t star_num;       //!< 宽度与精度中 '*' 的个数，它们作为 int 参数排在值之前
+    bool is_star_precision; //!< 精度是否为 '*'
+    int precision;          //!< 固定的精度，没有则为 -1
+};
+
+//! 解析后的格式串，创建后不再修改，也不释放
+struct InternedFormat {
+    const char *key;        //!< 格式串的地址
+    std::string fmt;        //!< 格式串的内容，用于校验地址相同的格式串内容是否也相同
+    bool is_supported;
+    std::vector<ConvSpec> specs;
+    std::string tail;       //!< 最后一个转换说明之后的普通文本
+};
+
+const char* ParseLength(const char *p, char &length)
+{
+    length = 0;
+    switch (*p) {
+        case 'h':
+            length = (p[1] == 'h') ? 'H' : 'h';
+            return p + ((p[1] == 'h') ? 2 : 1);
+        case 'l':
+            length = (p[1] == 'l') ? 'q' : 'l';
+            return p + ((p[1] == 'l') ? 2 : 1);
+        case 'q': case 'L': case 'j': case 'z': case 't':
+            length = *p;
+            return p + 1;
+        default:
+            return p;
+    }
+}
+
+//! 根据长度修饰与转换字符确定参数类型，不支持的返回 false
+bool GetArgKind(char length, char conv, ArgKind &kind, bool &is_unsigned)
+{
+    is_unsigned = false;
+    switch (conv) {
+        case 'o': case 'u': case 'x': case 'X':
+            is_unsigned = true;
+            //! fall through
+        case 'd': case 'i':
+            switch (length) {
+                case 0: case 'h': case 'H': kind = ArgKind::kInt; return true;
+                case 'l': kind = ArgKind::kLong; return true;
+                case 'q': case 'L': kind = ArgKind::kLongLong; return true;
+                case 'z': kind = ArgKind::kSizeT; return true;
+                case 't': kind = ArgKind::kPtrdiff; return true;
+                case 'j': kind = ArgKind::kIntmax; return true;
+            }
+            return false;
+        case 'c':
+            kind = ArgKind::kInt;
+            return length == 0;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (length == 0 || length == 'l') {
+                kind = ArgKind::kDouble;
+                return true;
+            } else if (length == 'L') {
+                kind = ArgKind::kLongDouble;
+                return true;
+            }
+            return false;
+        case 'p':
+            kind = ArgKind::kPointer;
+            return length == 0;
+        case 's':
+            kind = ArgKind::kString;
+            return length == 0;
+        default:    //! %n, %m 以及未知的
+            return false;
+    }
+}
+
+InternedFormat* Parse(const char *fmt)
+{
+    auto f = new InternedFormat;
+    f->key = fmt;
+    f->fmt = fmt;
+    f->is_supported = false;
+
+    std::string literal;
+    const char *p = fmt;
+    while (*p != '\0') {
+        if (*p != '%') {
+            literal.push_back(*p++);
+            continue;
+        }
+
+        if (p[1] == '%') {
+            literal.push_back('%');
+            p += 2;
+            continue;
+        }
+
+        ConvSpec cs;
+        cs.star_num = 0;
+        cs.is_star_precision = false;
+        cs.precision = -1;
+
+        const char *start = p++;
+        while (*p != '\0' && ::strchr("-+ #0'", *p) != nullptr)
+            ++p;
+
+        if (*p == '*') {
+            ++cs.star_num;
+            ++p;
+        } else {
+            while (*p >= '0' && *p <= '9')
+                ++p;
+        }
+
+        if (*p == '.') {
+            ++p;
+            if (*p == '*') {
+                ++cs.star_num;
+                cs.is_star_precision = true;
+                ++p;
+            } else {
+                cs.precision = 0;
+                while (*p >= '0' && *p <= '9')
+                    cs.precision = cs.precision * 10 + (*p++ - '0');
+            }
+        }
+
+        char length = 0;
+        p = ParseLength(p, length);
+
+        if (*p == '\0' || !GetArgKind(length, *p, cs.kind, cs.is_unsigned))
+            return f;   //! 不支持
+
+        ++p;
+        cs.spec.assign(start, p);
+        cs.literal.swap(literal);
+        f->specs.push_back(cs);
+    }
+
+    f->tail.swap(literal);
+    f->is_supported = true;
+    return f;
+}
+
+const size_t kInternTableSize = 4096;   //!< 须为2的幂
+const size_t kMaxProbeNum = 16;
+std::atomic<InternedFormat*> _intern_table[kInternTableSize];
+
+//! 统计，见 LogGetInternStat()
+std::atomic<uint32_t> _intern_used_num(0);
+std::atomic<uint64_t> _intern_overflow_num(0);
+std::atomic<uint64_t> _intern_mismatch_num(0);
+
+/**
+ * 查找或解析格式串。表满了，或同一地址上的内容变了（非常量格式串），返回 nullptr
+ *
+ * 表项一经占用就不再释放。栈上或堆上拼出来的格式串每个新地址都会占用一项，
+ * 可能把表占满，之后新的格式串在探测 kMaxProbeNum 次后都只能立即格式化
+ */
+const InternedFormat* Intern(const char *fmt)
+{
+    size_t hash = (reinterpret_cast<uintptr_t>(fmt) >> 3) * 0x9E3779B97F4A7C15ull;
+    size_t index = hash >> 20;
+
+    for (size_t i = 0; i < kMaxProbeNum; ++i) {
+        auto &slot = _intern_table[(index + i) & (kInternTableSize - 1)];
+        auto f = slot.load(std::memory_order_acquire);
+        if (f == nullptr) {
+            auto new_f = Parse(fmt);
+            if (slot.compare_exchange_strong(f, new_f, std::memory_order_acq_rel)) {
+                _intern_used_num.fetch_add(1, std::memory_order_relaxed);
+                return new_f;
+            }
+            delete new_f;   //! 被别的线程抢先占用了，f 为其所写入的值
+        }
+
+        if (f->key == fmt) {
+            if (::strcmp(f->fmt.c_str(), fmt) == 0)
+                return f;
+            _intern_mismatch_num.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    _intern_overflow_num.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+class Writer {
+  public:
+    Writer(void *buff, uint32_t size) : begin_(static_cast<uint8_t*>(buff)), end_(begin_ + size), curr_(begin_) { }
+
+    bool put(const void *data, size_t size) {
+        if (static_cast<size_t>(end_ - curr_) < size)
+            return false;
+        ::memcpy(curr_, data, size);
+        curr_ += size;
+        return true;
+    }
+
+    template <typename T>
+    bool put(T value) { return put(&value, sizeof(value)); }
+
+    uint32_t size() const { return curr_ - begin_; }
+
+  private:
+    uint8_t *begin_;
+    uint8_t *end_;
+    uint8_t *curr_;
+};
+
+class Reader {
+  public:
+    Reader(const void *buff, uint32_t size) : curr_(static_cast<const uint8_t*>(buff)), end_(curr_ + size) { }
+
+    bool get(void *data, size_t size) {
+        if (static_cast<size_t>(end_ - curr_) < size)
+            return false;
+        ::memcpy(data, curr_, size);
+        curr_ += size;
+        return true;
+    }
+
+    template <typename T>
+    bool get(T &value) { return get(&value, sizeof(value)); }
+
+    const char* skip(size_t size) {
+        if (static_cast<size_t>(end_ - curr_) < size)
+            return nullptr;
+        auto p = reinterpret_cast<const char*>(curr_);
+        curr_ += size;
+        return p;
+    }
+
+  private:
+    const uint8_t *curr_;
+    const uint8_t *end_;
+};
+
+const uint32_t kNullStringLen = UINT32_MAX;
+
+//! 按转换说明格式化一个值，追加到 out 中
+template <typename T>
+void AppendValue(std::string &out, const ConvSpec &cs, const int *stars, T value)
+{
+    char buff[128];
+    const char *spec = cs.spec.c_str();
+    int len = 0;
+
+    switch (cs.star_num) {
+        case 0: len = ::snprintf(buff, sizeof(buff), spec, value); break;
+        case 1: len = ::snprintf(buff, sizeof(buff), spec, stars[0], value); break;
+        default: len = ::snprintf(buff, sizeof(buff), spec, stars[0], stars[1], value); break;
+    }
+
+    if (len < 0)
+        return;
+
+    if (static_cast<size_t>(len) < sizeof(buff)) {
+        out.append(buff, len);
+        return;
+    }
+
+    size_t offset = out.size();
+    out.resize(offset + len + 1);
+    switch (cs.star_num) {
+        case 0: ::snprintf(&out[offset], len + 1, spec, value); break;
+        case 1: ::snprintf(&out[offset], len + 1, spec, stars[0], value); break;
+        default: ::snprintf(&out[offset], len + 1, spec, stars[0], stars[1], value); break;
+    }
+    out.resize(offset + len);
+}
+
+bool FormatArgs(const void *args_ptr, uint32_t args_len, std::string &out)
+{
+    Reader r(args_ptr, args_len);
+
+    const InternedFormat *f = nullptr;
+    if (!r.get(f) || f == nullptr)
+        return false;
+
+    for (const auto &cs : f->specs) {
+        out.append(cs.literal);
+
+        int stars[2] = { 0, 0 };
+        for (int i = 0; i < cs.star_num; ++i) {
+            int64_t star = 0;
+            if (!r.get(star))
+                return false;
+            stars[i] = static_cast<int>(star);
+        }
+
+        switch (cs.kind) {
+            case ArgKind::kInt:
+            case ArgKind::kLong:
+            case ArgKind::kLongLong:
+            case ArgKind::kSizeT:
+            case ArgKind::kPtrdiff:
+            case ArgKind::kIntmax: {
+                int64_t v = 0;
+                if (!r.get(v))
+                    return false;
+                if (cs.kind == ArgKind::kInt) {
+                    if (cs.is_unsigned)
+                        AppendValue(out, cs, stars, static_cast<unsigned int>(v));
+                    else
+                        AppendValue(out, cs, stars, static_cast<int>(v));
+                } else if (cs.kind == ArgKind::kLong) {
+                    if (cs.is_unsigned)
+                        AppendValue(out, cs, stars, static_cast<unsigned long>(v));
+                    else
+                        AppendValue(out, cs, stars, static_cast<long>(v));
+                } else if (cs.kind == ArgKind::kSizeT) {
+                    AppendValue(out, cs, stars, static_cast<size_t>(v));
+                } else if (cs.kind == ArgKind::kPtrdiff) {
+                    AppendValue(out, cs, stars, static_cast<ptrdiff_t>(v));
+                } else if (cs.kind == ArgKind::kIntmax) {
+                    AppendValue(out, cs, stars, static_cast<intmax_t>(v));
+                } else {
+                    if (cs.is_unsigned)
+                        AppendValue(out, cs, stars, static_cast<unsigned long long>(v));
+                    else
+                        AppendValue(out, cs, stars, static_cast<long long>(v));
+                }
+                break;
+            }
+            case ArgKind::kDouble: {
+                double v = 0;
+                if (!r.get(v))
+                    return false;
+                AppendValue(out, cs, stars, v);
+                break;
+            }
+            case ArgKind::kLongDouble: {
+                long double v = 0;
+                if (!r.get(v))
+                    return false;
+                AppendValue(out, cs, stars, v);
+                break;
+            }
+            case ArgKind::kPointer: {
+                const void *v = nullptr;
+                if (!r.get(v))
+                    return false;
+                AppendValue(out, cs, stars, v);
+                break;
+            }
+            case ArgKind::kString: {
+                uint32_t len = 0;
+                if (!r.get(len))
+                    return false;
+                if (len == kNullStringLen) {
+                    AppendValue(out, cs, stars, static_cast<const char*>(nullptr));
+                } else {
+                    const char *str = r.skip(len);
+                    if (str == nullptr)
+                        return false;
+                    AppendValue(out, cs, stars, std::string(str, len).c_str());
+                }
+                break;
+            }
+        }
+    }
+
+    out.append(f->tail);
+    return true;
+}
+
+}
+
+void LogGetInternStat(LogInternStat *stat)
+{
+    stat->used_num = _intern_used_num.load(std::memory_order_relaxed);
+    stat->total_num = kInternTableSize;
+    stat->overflow_num = _intern_overflow_num.load(std::memory_order_relaxed);
+    stat->mismatch_num = _intern_mismatch_num.load(std::memory_order_relaxed);
+}
+
+uint32_t LogEncodeArgs(const char *fmt, va_list args, void *buff, uint32_t buff_size)
+{
+    const InternedFormat *f = Intern(fmt);
+    if (f == nullptr || !f->is_supported)
+        return 0;
+
+    Writer w(buff, buff_size);
+    if (!w.put(f))
+        return 0;
+
+    for (const auto &cs : f->specs) {
+        int precision = cs.precision;
+        for (int i = 0; i < cs.star_num; ++i) {
+            int star = va_arg(args, int);
+            if (cs.is_star_precision && i == cs.star_num - 1)
+                precision = star;
+            if (!w.put(static_cast<int64_t>(star)))
+                return 0;
+        }
+
+        bool is_ok = true;
+        switch (cs.kind) {
+            case ArgKind::kInt:      is_ok = w.put(static_cast<int64_t>(va_arg(args, int))); break;
+            case ArgKind::kLong:     is_ok = w.put(static_cast<int64_t>(va_arg(args, long))); break;
+            case ArgKind::kLongLong: is_ok = w.put(static_cast<int64_t>(va_arg(args, long long))); break;
+            case ArgKind::kSizeT:    is_ok = w.put(static_cast<int64_t>(va_arg(args, size_t))); break;
+            case ArgKind::kPtrdiff:  is_ok = w.put(static_cast<int64_t>(va_arg(args, ptrdiff_t))); break;
+            case ArgKind::kIntmax:   is_ok = w.put(static_cast<int64_t>(va_arg(args, intmax_t))); break;
+            case ArgKind::kDouble:   is_ok = w.put(va_arg(args, double)); break;
+            case ArgKind::kLongDouble: is_ok = w.put(va_arg(args, long double)); break;
+            case ArgKind::kPointer:  is_ok = w.put(va_arg(args, void*)); break;
+            case ArgKind::kString: {
+                const char *str = va_arg(args, const char*);
+                if (str == nullptr) {
+                    is_ok = w.put(kNullStringLen);
+                } else {
+                    //! 有精度限制时，字符串可以没有结束符
+                    uint32_t len = (precision >= 0) ? ::strnlen(str, precision) : ::strlen(str);
+                    is_ok = w.put(len) && w.put(str, len);
+                }
+                break;
+            }
+        }
+
+        if (!is_ok)
+            return 0;
+    }
+
+    return w.size();
+}
+
+extern "C" {
+
+uint32_t LogFormatArgs(const void *args_ptr, uint32_t args_len, char *buff, uint32_t buff_size)
+{
+    thread_local std::string out;
+    out.clear();
+
+    if (!FormatArgs(args_ptr, args_len, out))
+        out = "(BAD ARGS)";
+
+    if (buff_size > 0) {
+        size_t copy_size = std::min(out.size(), static_cast<size_t>(buff_size - 1));
+        ::memcpy(buff, out.data(), copy_size);
+        buff[copy_size] = '\0';
+    }
+    return out.size();
+}
+
+}
@@ -0,0 +1,52 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_BASE_LOG_ARGS_H_20251018
+#define TBOX_BASE_LOG_ARGS_H_20251018
+
+/**
+ * 日志的延迟格式化
+ *
+ * 打印日志的线程不调用 vsnprintf()，只按格式串将参数编码为二进制，
+ * 由后台线程调用 LogFormatArgs() 完成格式化。
+ *
+ * 格式串在首次使用时被解析，结果按格式串地址缓存起来（interning），此后只需查表。
+ * 表的大小固定，表项不会释放，所以格式串应为常量。栈上或堆上拼出来的格式串每个地址
+ * 都占一项，会将表占满，此后新的格式串都退而立即格式化，可通过 LogGetInternStat() 观察。
+ * 字符串参数（%s）会被拷贝，其它参数按值保存。
+ * 遇到不支持的转换（如 %n, %m, %ls）时，返回0，由调用者退而立即格式化。
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+
+//! 按格式串编码参数，返回编码后的大小。不支持或 buff 空间不足时返回 0
+uint32_t LogEncodeArgs(const char *fmt, va_list args, void *buff, uint32_t buff_size);
+
+struct LogInternStat {
+    uint32_t used_num;      //!< 已缓存的格式串数
+    uint32_t total_num;     //!< 表的容量
+    uint64_t overflow_num;  //!< 表中已无空位，未能缓存而立即格式化的次数
+    uint64_t mismatch_num;  //!< 同一地址上格式串的内容变了，而立即格式化的次数
+};
+
+//! 获取格式串缓存的统计，overflow_num 不为0时，说明有非常量的格式串占满了表
+void LogGetInternStat(LogInternStat *stat);
+
+#endif //TBOX_BASE_LOG_ARGS_H_20251018
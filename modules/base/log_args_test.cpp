@@ -0,0 +1,184 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "log_args.h"
+#include "log_impl.h"
+
+namespace {
+
+uint32_t Encode(void *buff, uint32_t size, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    auto len = LogEncodeArgs(fmt, args, buff, size);
+    va_end(args);
+    return len;
+}
+
+std::string Format(const void *args, uint32_t args_len)
+{
+    char buff[1024];
+    uint32_t len = LogFormatArgs(args, args_len, buff, sizeof(buff));
+    return std::string(buff, len);
+}
+
+//! 比较延迟格式化与 snprintf() 的结果
+#define EXPECT_SAME_AS_SNPRINTF(fmt, ...) \
+    do { \
+        uint8_t args[1024]; \
+        uint32_t args_len = Encode(args, sizeof(args), fmt, ##__VA_ARGS__); \
+        ASSERT_GT(args_len, 0u) << fmt; \
+        char expect[1024]; \
+        ::snprintf(expect, sizeof(expect), fmt, ##__VA_ARGS__); \
+        EXPECT_EQ(Format(args, args_len), expect); \
+    } while (0)
+
+}
+
+TEST(LogArgs, Integer)
+{
+    EXPECT_SAME_AS_SNPRINTF("no args");
+    EXPECT_SAME_AS_SNPRINTF("%d %i %u", -1, 123, 4000000000u);
+    EXPECT_SAME_AS_SNPRINTF("%x %X %o %#x", 0xabcdu, 0xabcdu, 8u, 255u);
+    EXPECT_SAME_AS_SNPRINTF("%hhd %hd %c", 300, 70000, 'A');
+    EXPECT_SAME_AS_SNPRINTF("%ld %lu", -1234567890123l, 1234567890123ul);
+    EXPECT_SAME_AS_SNPRINTF("%lld %llu %llx", -1ll, ~0ull, ~0ull);
+    EXPECT_SAME_AS_SNPRINTF("%zu %zd %td %jd", sizeof(int), static_cast<ssize_t>(-5), static_cast<ptrdiff_t>(-6), static_cast<intmax_t>(-7));
+    EXPECT_SAME_AS_SNPRINTF("[%-8d] [%08d] [%+d] [% d]", 12, 34, 56, 78);
+}
+
+TEST(LogArgs, Float)
+{
+    EXPECT_SAME_AS_SNPRINTF("%f %.2f %e %g", 1.5, 3.14159, 12345.678, 0.0001);
+    EXPECT_SAME_AS_SNPRINTF("%10.3f|%-10.1E|%a", -2.5, 1e10, 1.0);
+    EXPECT_SAME_AS_SNPRINTF("%Lf %.3Lg", 1.25L, 3.0L);
+}
+
+TEST(LogArgs, StringAndPointer)
+{
+    int value = 0;
+    EXPECT_SAME_AS_SNPRINTF("%s, %s!", "hello", "world");
+    EXPECT_SAME_AS_SNPRINTF("[%10s] [%-10s] [%.3s]", "abc", "def", "ghijkl");
+    EXPECT_SAME_AS_SNPRINTF("%p %p", static_cast<void*>(&value), static_cast<void*>(nullptr));
+    EXPECT_SAME_AS_SNPRINTF("100%% %s %%", "done");
+}
+
+TEST(LogArgs, Star)
+{
+    EXPECT_SAME_AS_SNPRINTF("[%*d] [%-*d]", 6, 42, 6, 42);
+    EXPECT_SAME_AS_SNPRINTF("[%.*f] [%*.*f]", 2, 3.14159, 10, 3, 2.71828);
+    EXPECT_SAME_AS_SNPRINTF("[%.*s]", 3, "abcdef");
+
+    //! 有精度限制的字符串可以没有结束符
+    const char no_nul[4] = { 'a', 'b', 'c', 'd' };
+    EXPECT_SAME_AS_SNPRINTF("[%.*s]", 4, no_nul);
+}
+
+TEST(LogArgs, NullString)
+{
+    uint8_t args[256];
+    const char *null_str = nullptr;
+    uint32_t args_len = Encode(args, sizeof(args), "[%s]", null_str);
+    ASSERT_GT(args_len, 0u);
+    EXPECT_EQ(Format(args, args_len), "[(null)]");
+}
+
+TEST(LogArgs, StringCopied)
+{
+    char str[] = "before";
+    uint8_t args[256];
+    uint32_t args_len = Encode(args, sizeof(args), "str:%s", str);
+    ASSERT_GT(args_len, 0u);
+    ::strcpy(str, "after");
+    EXPECT_EQ(Format(args, args_len), "str:before");
+}
+
+TEST(LogArgs, Unsupported)
+{
+    uint8_t args[256];
+    int n = 0;
+    EXPECT_EQ(Encode(args, sizeof(args), "abc%n", &n), 0u);
+    EXPECT_EQ(Encode(args, sizeof(args), "%m"), 0u);
+    EXPECT_EQ(Encode(args, sizeof(args), "%ls", L"wide"), 0u);
+}
+
+TEST(LogArgs, BuffTooSmall)
+{
+    uint8_t args[32];
+    std::string long_str(100, 'x');
+    EXPECT_EQ(Encode(args, sizeof(args), "%s", long_str.c_str()), 0u);
+}
+
+TEST(LogArgs, NonConstantFormat)
+{
+    //! 同一地址上格式串的内容变了，不能沿用之前的解析结果
+    char fmt[16];
+    uint8_t args[256];
+
+    ::strcpy(fmt, "a:%d");
+    uint32_t args_len = Encode(args, sizeof(args), fmt, 1);
+    ASSERT_GT(args_len, 0u);
+    EXPECT_EQ(Format(args, args_len), "a:1");
+
+    LogInternStat stat_before;
+    LogGetInternStat(&stat_before);
+
+    ::strcpy(fmt, "b:%s");
+    EXPECT_EQ(Encode(args, sizeof(args), fmt, "x"), 0u);
+
+    LogInternStat stat_after;
+    LogGetInternStat(&stat_after);
+    EXPECT_EQ(stat_after.mismatch_num, stat_before.mismatch_num + 1);
+}
+
+//! 非常量的格式串会将表占满，之后的都只能立即格式化，并被计数。在子进程中进行，以免影响其它测试
+TEST(LogArgs, InternTableOverflow)
+{
+    EXPECT_EXIT(
+        {
+            LogInternStat stat;
+            LogGetInternStat(&stat);
+            std::vector<std::string> fmts(stat.total_num + 1, "%d");
+            uint8_t args[256];
+            for (auto &fmt : fmts)
+                Encode(args, sizeof(args), fmt.c_str(), 1);
+
+            LogGetInternStat(&stat);
+            bool is_ok = stat.used_num <= stat.total_num && stat.overflow_num > 0;
+            ::exit(is_ok ? 0 : 1);
+        },
+        ::testing::ExitedWithCode(0), ""
+    );
+}
+
+TEST(LogArgs, FormatTruncate)
+{
+    uint8_t args[256];
+    uint32_t args_len = Encode(args, sizeof(args), "%s-%d", "hello", 12345);
+    ASSERT_GT(args_len, 0u);
+
+    char buff[8];
+    EXPECT_EQ(LogFormatArgs(args, args_len, buff, sizeof(buff)), 11u);
+    EXPECT_STREQ(buff, "hello-1");
+}
@@ -18,30 +18,66 @@
  * of the source tree.
  */
 #include "log_impl.h"
+#include "log_args.h"
+#include "fast_clock.h"
 
-#include <sys/time.h>
-#include <sys/syscall.h>
-#include <unistd.h>
 #include <cstring>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <mutex>
+#include <atomic>
+#include <thread>
 
 namespace {
 
 size_t _LogTextMaxLength = (100 << 10);     //! 限定单条日志最大长度，默认为100KB
 
 std::mutex _lock;
-uint32_t _id_alloc = 0;
 
 struct OutputChannel {
     uint32_t id;
     LogPrintfFuncType func;
     void *ptr;
+    LogLevelFuncType level_func;
+    bool is_deferred_format;
 };
 
-std::vector<OutputChannel> _output_channels;
+/**
+ * 输出通道表，发布后就不再修改
+ * 增删改通道时，拷贝出新表修改后整体替换。打印日志时直接读当前的表，不加锁也不拷贝
+ */
+struct ChannelList {
+    std::vector<OutputChannel> channels;
+    size_t eager_channel_num = 0;   //!< 不支持延迟格式化的通道数
+};
+
+std::atomic<const ChannelList*> _channel_list(nullptr);   //!< 没有通道时为空
+
+std::mutex _write_lock;     //!< 串行化对通道表的修改
+uint32_t _id_alloc = 0;     //!< 只在 _write_lock 内访问
+std::vector<const ChannelList*> _retired_lists; //!< 被替换下来的表，可能还有派发在读，只在 _write_lock 内访问
+
+/**
+ * 派发中的线程数，按代分两组计数
+ * 删除通道时切换到下一代，再等旧一代的派发都结束，以保证返回后不再调用被删除的输出函数，
+ * 此前被替换下来的表也在这时回收
+ */
+std::atomic<uint32_t> _dispatch_epoch(0);
+std::atomic<size_t> _dispatching_num[2];
+std::mutex _remove_lock;        //!< 串行化删除，以免两次删除等待同一组计数
+
+//! 延迟格式化时，编码参数所用的栈空间，放不下的就立即格式化
+constexpr size_t kMaxArgsSize = 1024;
+
+//! 递增版本号，跳过低24位为0的值，因为调用点的缓存初始为0
+void IncreaseLevelVersion()
+{
+    uint32_t version;
+    do {
+        version = __atomic_add_fetch(&LogLevelVersion, 1, __ATOMIC_RELEASE);
+    } while ((version & 0xffffff) == 0);
+}
 
 const char* Basename(const char *full_path)
 {
@@ -57,19 +93,97 @@ const char* Basename(const char *full_path)
 
 bool CantDispatch()
 {
-    std::lock_guard<std::mutex> lg(_lock);
-    return _output_channels.empty();
+    return _channel_list.load(std::memory_order_relaxed) == nullptr;
 }
 
-void Dispatch(const LogContent &content)
+/**
+ * 拷贝当前的表，由 func 修改后发布，旧表留到下次删除通道时回收。需在 _write_lock 内调用
+ * func 返回 false 表示没有修改
+ */
+template <typename Func>
+bool UpdateChannelList(Func &&func)
 {
-    std::lock_guard<std::mutex> lg(_lock);
-    for (const auto &item : _output_channels) {
-        if (item.func)
-            item.func(&content, item.ptr);
+    auto old_list = _channel_list.load(std::memory_order_relaxed);
+    auto new_list = (old_list != nullptr) ? new ChannelList(*old_list) : new ChannelList;
+
+    if (!func(*new_list)) {
+        delete new_list;
+        return false;
     }
+
+    if (new_list->channels.empty()) {
+        delete new_list;
+        new_list = nullptr;
+    }
+
+    _channel_list.store(new_list);
+    if (old_list != nullptr)
+        _retired_lists.push_back(old_list);
+
+    IncreaseLevelVersion();
+    return true;
 }
 
+/**
+ * 派发用的通道快照
+ *
+ * 构造时登记到当前一代，再取当前的表，析构前这张表都不会被回收。
+ * 全程不加锁，慢的输出函数也不会挡住增删通道
+ */
+class ChannelSnapshot {
+  public:
+    ChannelSnapshot()
+    {
+        for (;;) {
+            epoch_ = _dispatch_epoch.load();
+            _dispatching_num[epoch_ & 1].fetch_add(1);
+            //! 登记前已换代的话，删除方可能已经等过了这一组，要重新登记
+            if (_dispatch_epoch.load() == epoch_)
+                break;
+            _dispatching_num[epoch_ & 1].fetch_sub(1, std::memory_order_release);
+        }
+        list_ = _channel_list.load();
+    }
+
+    ~ChannelSnapshot()
+    {
+        _dispatching_num[epoch_ & 1].fetch_sub(1, std::memory_order_release);
+    }
+
+    //! 是否有不支持延迟格式化的通道
+    bool isEagerFormatNeeded() const { return list_ != nullptr && list_->eager_channel_num != 0; }
+
+    void dispatch(const LogContent &content) const
+    {
+        if (list_ == nullptr)
+            return;
+
+        for (const auto &item : list_->channels) {
+            if (item.func)
+                item.func(&content, item.ptr);
+        }
+    }
+
+    //! 求各通道中 module_id 的最高等级
+    int maxLevel(const char *module_id) const
+    {
+        int max_level = -1;
+        if (list_ == nullptr)
+            return max_level;
+
+        for (const auto &item : list_->channels) {
+            int channel_level = (item.level_func != nullptr) ?
+                item.level_func(module_id, item.ptr) : (LOG_LEVEL_MAX - 1);
+            max_level = std::max(max_level, channel_level);
+        }
+        return max_level;
+    }
+
+  private:
+    const ChannelList *list_ = nullptr;
+    uint32_t epoch_ = 0;
+};
+
 }
 
 const char  LOG_LEVEL_LEVEL_CODE[LOG_LEVEL_MAX] = {
@@ -89,6 +203,22 @@ const char* LOG_LEVEL_COLOR_CODE[LOG_LEVEL_MAX] = {
 
 extern "C" {
 
+uint32_t LogLevelVersion = 1;
+
+int LogIsLevelEnabledSlow(const char *module_id, int level, uint32_t *cache)
+{
+    //! 先取版本号再取表，期间如有变更，下次检查时会发现版本不一致而重算
+    uint32_t version = __atomic_load_n(&LogLevelVersion, __ATOMIC_ACQUIRE) & 0xffffff;
+    ChannelSnapshot channels;
+
+    int max_level = channels.maxLevel((module_id != nullptr) ? module_id : "???");
+
+    uint32_t level_value = std::min(std::max(max_level + 1, 0), 0xff);
+    __atomic_store_n(cache, (version << 8) | level_value, __ATOMIC_RELAXED);
+
+    return level < static_cast<int>(level_value);
+}
+
 size_t LogSetMaxLength(size_t max_len)
 {
     std::lock_guard<std::mutex> lg(_lock);
@@ -107,7 +237,7 @@ size_t LogGetMaxLength()
  * \brief   日志格式化打印接口的实现
  *
  * 1.对数据合法性进行校验;
- * 2.将日志数据打包成 LogContent，然后调用 _output_channels 指向的函数进行输出
+ * 2.将日志数据打包成 LogContent，然后调用 _channel_list 中的函数进行输出
  */
 void LogPrintfFunc(const char *module_id, const char *func_name, const char *file_name,
                    int line, int level, int with_args, const char *fmt, ...)
@@ -120,15 +250,16 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
 
     const char *module_id_be_print = (module_id != nullptr) ? module_id : "???";
 
-    struct timeval tv;
-    struct timezone tz;
-    gettimeofday(&tv, &tz);
+    //! 决定是否延迟格式化与派发，都基于同一份快照
+    ChannelSnapshot channels;
+
+    uint64_t now_us = tbox::GetSystemClockMicroseconds();
 
     LogContent content = {
-        .thread_id = syscall(SYS_gettid),
+        .thread_id = tbox::GetCurrentThreadId(),
         .timestamp = {
-            .sec  = static_cast<uint32_t>(tv.tv_sec),
-            .usec = static_cast<uint32_t>(tv.tv_usec),
+            .sec  = static_cast<uint32_t>(now_us / 1000000),
+            .usec = static_cast<uint32_t>(now_us % 1000000),
         },
         .module_id = module_id_be_print,
         .func_name = func_name,
@@ -138,10 +269,27 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
         .text_len = 0,
         .text_ptr = nullptr,
         .text_trunc = false,
+        .args_len = 0,
+        .args_ptr = nullptr,
     };
 
     if (fmt != nullptr) {
         if (with_args) {
+            if (!channels.isEagerFormatNeeded()) {
+                uint8_t args_buff[kMaxArgsSize];
+                va_list args;
+                va_start(args, fmt);
+                uint32_t args_len = LogEncodeArgs(fmt, args, args_buff, sizeof(args_buff));
+                va_end(args);
+
+                if (args_len > 0) {
+                    content.args_len = args_len;
+                    content.args_ptr = args_buff;
+                    channels.dispatch(content);
+                    return;
+                }
+            }
+
             constexpr size_t kMaxBuffSize = 2048lu;
             uint32_t buff_size = std::min(kMaxBuffSize, _LogTextMaxLength) + 1;
 
@@ -164,7 +312,7 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
                 if (len < buff_size) {
                     content.text_len = len;
                     content.text_ptr = buffer;
-                    Dispatch(content);
+                    channels.dispatch(content);
                     break;
                 }
 
@@ -188,11 +336,11 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
             }
 
             content.text_ptr = fmt;
-            Dispatch(content);
+            channels.dispatch(content);
         }
 
     } else {
-        Dispatch(content);
+        channels.dispatch(content);
     }
 }
 
@@ -200,30 +348,108 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
 
 uint32_t LogAddPrintfFunc(LogPrintfFuncType func, void *ptr)
 {
-    std::lock_guard<std::mutex> lg(_lock);
+    std::lock_guard<std::mutex> lg(_write_lock);
     uint32_t new_id = ++_id_alloc;
-    OutputChannel channel = {
-        .id     = new_id,
-        .func   = func,
-        .ptr    = ptr
-    };
-    _output_channels.push_back(channel);
+    UpdateChannelList(
+        [=] (ChannelList &list) {
+            OutputChannel channel = {
+                .id     = new_id,
+                .func   = func,
+                .ptr    = ptr,
+                .level_func = nullptr,
+                .is_deferred_format = false,
+            };
+            list.channels.push_back(channel);
+            ++list.eager_channel_num;
+            return true;
+        }
+    );
     return new_id;
 }
 
 bool LogRemovePrintfFunc(uint32_t id)
 {
-    std::lock_guard<std::mutex> lg(_lock);
-    auto iter = std::remove_if(_output_channels.begin(), _output_channels.end(),
-        [id](const OutputChannel &item) {
-            return (item.id == id);
+    std::lock_guard<std::mutex> remove_lg(_remove_lock);
+    uint32_t old_epoch = 0;
+    std::vector<const ChannelList*> retired_lists;
+    {
+        std::lock_guard<std::mutex> lg(_write_lock);
+        bool is_removed = UpdateChannelList(
+            [id] (ChannelList &list) {
+                auto iter = std::remove_if(list.channels.begin(), list.channels.end(),
+                    [id](const OutputChannel &item) {
+                        return (item.id == id);
+                    }
+                );
+
+                if (iter == list.channels.end())
+                    return false;
+
+                list.eager_channel_num -= std::count_if(iter, list.channels.end(),
+                    [](const OutputChannel &item) { return !item.is_deferred_format; }
+                );
+                list.channels.erase(iter, list.channels.end());
+                return true;
+            }
+        );
+
+        if (!is_removed)
+            return false;
+
+        //! 换代之后登记的派发只会取到新表，换代前替换下来的表等旧一代派发结束就可以回收了
+        old_epoch = _dispatch_epoch.fetch_add(1);
+        retired_lists.swap(_retired_lists);
+    }
+
+    //! 等持有旧快照的派发结束。删除通道很少发生，让出CPU等待即可
+    while (_dispatching_num[old_epoch & 1].load() != 0)
+        std::this_thread::yield();
+
+    for (auto list : retired_lists)
+        delete list;
+
+    return true;
+}
+
+bool LogSetLevelFunc(uint32_t id, LogLevelFuncType func)
+{
+    std::lock_guard<std::mutex> lg(_write_lock);
+    return UpdateChannelList(
+        [=] (ChannelList &list) {
+            for (auto &item : list.channels) {
+                if (item.id == id) {
+                    item.level_func = func;
+                    return true;
+                }
+            }
+            return false;
         }
     );
+}
 
-    if (iter != _output_channels.end()) {
-        _output_channels.erase(iter, _output_channels.end());
-        return true;
-    }
-    return false;
+void LogLevelChanged()
+{
+    IncreaseLevelVersion();
 }
 
+bool LogSetDeferredFormat(uint32_t id, bool enable)
+{
+    std::lock_guard<std::mutex> lg(_write_lock);
+    return UpdateChannelList(
+        [=] (ChannelList &list) {
+            for (auto &item : list.channels) {
+                if (item.id == id) {
+                    if (item.is_deferred_format != enable) {
+                        item.is_deferred_format = enable;
+                        if (enable)
+                            --list.eager_channel_num;
+                        else
+                            ++list.eager_channel_num;
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+    );
+}
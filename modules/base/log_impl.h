@@ -51,6 +51,8 @@ struct LogContent {
     uint32_t    text_len;   //!< 内容大小
     const char *text_ptr;   //!< 内容地址
     bool        text_trunc; //!< 是否截断
+    uint32_t    args_len;   //!< 编码后的参数大小
+    const void *args_ptr;   //!< 编码后的参数地址，非空时 text_ptr 为空，正文需由 LogFormatArgs() 得到
 };
 
 //! 日志等级颜色表
@@ -65,10 +67,44 @@ size_t   LogSetMaxLength(size_t max_len);
 //! 获取最大长度
 size_t   LogGetMaxLength();
 
-//! 添加与删除日志输出函数
+/**
+ * 添加与删除日志输出函数
+ *
+ * 注意：输出函数会被打印日志的各线程同时调用，需自行保证线程安全，且不能再打印日志，
+ *       也不能在其中删除输出函数。LogRemovePrintfFunc() 会等正在进行的调用结束后才返回，
+ *       返回后，该函数就不会再被调用了
+ */
 uint32_t LogAddPrintfFunc(LogPrintfFuncType func, void *ptr);
 bool     LogRemovePrintfFunc(uint32_t id);
 
+/**
+ * 日志等级预过滤
+ *
+ * 输出通道可以提供一个查询函数，返回它对指定模块所输出的最高等级。
+ * 各通道的最大值就是该模块的有效等级，超出的日志在格式化之前就被丢弃。
+ * 没有设置查询函数的通道，视为输出所有等级。
+ * 通道的等级设置有变更时，须调用 LogLevelChanged() 使各调用点的缓存失效。
+ */
+typedef int (*LogLevelFuncType)(const char *module_id, void *ptr);
+
+//! 设置日志输出函数的等级查询函数
+bool     LogSetLevelFunc(uint32_t id, LogLevelFuncType func);
+//! 通知等级设置已变更
+void     LogLevelChanged();
+
+/**
+ * 延迟格式化
+ *
+ * 当所有输出函数都声明能处理延迟格式化时，打印日志的线程不再调用 vsnprintf()，
+ * 而是将参数编码后通过 args_ptr 与 args_len 交给输出函数，由其在别的线程中格式化。
+ * 编码后的参数仅在输出函数内有效，需要保留的须自行拷贝。
+ * 格式串与其参数不被延迟格式化支持时，仍会立即格式化，通过 text_ptr 交付。
+ */
+bool     LogSetDeferredFormat(uint32_t id, bool enable);
+
+//! 将编码后的参数格式化到 buff 中，返回值与 snprintf() 一样，为完整格式化所需的长度
+uint32_t LogFormatArgs(const void *args_ptr, uint32_t args_len, char *buff, uint32_t buff_size);
+
 #ifdef __cplusplus
 }
 #endif
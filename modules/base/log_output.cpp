@@ -103,6 +103,9 @@ extern "C" {
             !LogOutput_FilterFunc(content))
             return;
 
+        //! 多线程会同时调用，要防止各行内容交错
+        static std::mutex _print_lock;
+        std::lock_guard<std::mutex> lg(_print_lock);
         _PrintLogToStdout(content);
     }
 }
@@ -18,6 +18,9 @@
  * of the source tree.
  */
 #include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "log.h"
 #include "log_impl.h"
 #include "log_output.h"
@@ -53,6 +56,18 @@ TEST(Log, LogPuts)
     LogOutput_Disable();
 }
 
+//! 日志宏是表达式，可以用在逗号表达式与条件表达式中
+TEST(Log, AsExpression)
+{
+    LogOutput_Enable();
+    int value = 0;
+    bool is_ok = false;
+    is_ok ? LogInfo("ok") : LogWarn("not ok, value:%d", value);
+    value = (LogPuts(LOG_LEVEL_INFO, "in comma expression"), 1);
+    EXPECT_EQ(value, 1);
+    LogOutput_Disable();
+}
+
 TEST(Log, error)
 {
     LogOutput_Enable();
@@ -79,3 +94,84 @@ TEST(Log, Truncate)
     LogSetMaxLength(origin_len);
     LogOutput_Disable();
 }
+
+//! 输出函数执行期间不持有锁，增删其它通道不会被挡住；删除通道会等正在进行的调用结束
+TEST(Log, ChangeChannelWhileOutputting)
+{
+    struct Ctx {
+        std::atomic<bool> is_entered{false};
+        std::atomic<bool> is_released{false};
+        std::atomic<int> count{0};
+    } ctx;
+
+    auto slow_func = [] (const LogContent *, void *ptr) {
+        auto ctx = static_cast<Ctx*>(ptr);
+        ctx->is_entered = true;
+        while (!ctx->is_released)
+            std::this_thread::yield();
+        ++ctx->count;
+    };
+    auto empty_func = [] (const LogContent *, void *) { };
+
+    auto slow_id = LogAddPrintfFunc(slow_func, &ctx);
+    std::thread t([] { LogInfo("slow"); });
+    while (!ctx.is_entered)
+        std::this_thread::yield();
+
+    auto other_id = LogAddPrintfFunc(empty_func, nullptr);
+    EXPECT_NE(other_id, 0u);
+
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ctx.is_released = true;
+    });
+    EXPECT_TRUE(LogRemovePrintfFunc(slow_id));
+    EXPECT_EQ(ctx.count, 1);    //! 返回时，正在进行的调用已结束
+
+    EXPECT_TRUE(LogRemovePrintfFunc(other_id));
+    t.join();
+    releaser.join();
+}
+
+//! 多个线程不停打印日志的同时反复增删通道，删除返回后不应再被调用
+TEST(Log, AddRemoveWhileLogging)
+{
+    struct Ctx {
+        std::atomic<bool> is_removed{false};
+        std::atomic<int> late_count{0};
+    };
+
+    auto count_func = [] (const LogContent *, void *ptr) {
+        auto ctx = static_cast<Ctx*>(ptr);
+        if (ctx->is_removed)
+            ++ctx->late_count;
+    };
+
+    std::atomic<bool> is_stop(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back(
+            [&] {
+                while (!is_stop)
+                    LogInfo("test %d", 123);
+            }
+        );
+    }
+
+    int late_count = 0;
+    for (int i = 0; i < 100; ++i) {
+        Ctx ctx;
+        auto id = LogAddPrintfFunc(count_func, &ctx);
+        std::this_thread::yield();
+        EXPECT_TRUE(LogRemovePrintfFunc(id));
+        ctx.is_removed = true;
+        std::this_thread::yield();
+        late_count += ctx.late_count;
+    }
+
+    is_stop = true;
+    for (auto &t : threads)
+        t.join();
+
+    EXPECT_EQ(late_count, 0);
+}
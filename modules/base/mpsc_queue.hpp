@@ -0,0 +1,129 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_BASE_MPSC_QUEUE_HPP_20251018
+#define TBOX_BASE_MPSC_QUEUE_HPP_20251018
+
+#include <atomic>
+#include <type_traits>
+
+#include "defines.h"
+
+namespace tbox {
+
+//! MpscQueue 的节点，需要入队的对象继承它即可
+struct MpscQueueNode {
+    std::atomic<MpscQueueNode*> mpsc_next{nullptr};
+};
+
+/**
+ * MpscQueue，无锁多生产者单消费者侵入式队列
+ *
+ * 实现参考 Dmitry Vyukov 的 intrusive MPSC node-based queue：
+ * - push() 只有一次 exchange 与一次 store，无等待，可在任意线程调用；
+ * - pop() 只能由同一时刻唯一的消费者调用；
+ * - 节点的内存由使用者管理，队列不分配也不释放任何内存。
+ *
+ * 注意：
+ * - 当某个生产者正处于 push() 的两个步骤之间时，pop() 可能暂时返回 nullptr，
+ *   即便队列中还有其它节点。使用者需要有配套的唤醒机制，让该生产者完成后再次
+ *   触发消费；
+ * - 队列析构时不会处理残留的节点，使用者需要在析构前将其 pop() 干净。
+ *
+ * 使用示例：
+ * -----------------------------------------------------------------
+ * struct Task : public MpscQueueNode { int value; };
+ *
+ * MpscQueue<Task> queue;
+ * queue.push(new Task{...});     //! 任意线程
+ * ...
+ * while (auto t = queue.pop()) { //! 消费者线程
+ *   ...
+ *   delete t;
+ * }
+ * -----------------------------------------------------------------
+ */
+template <typename T>
+class MpscQueue {
+    static_assert(std::is_base_of<MpscQueueNode, T>::value, "T must derive from MpscQueueNode");
+
+  public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) { }
+
+    NONCOPYABLE(MpscQueue);
+    IMMOVABLE(MpscQueue);
+
+    //! 入队，可在任意线程调用
+    void push(T *node) { pushNode(node); }
+
+    //! 出队，仅限消费者调用。队列为空时返回 nullptr
+    T* pop() {
+        MpscQueueNode *tail = tail_;
+        MpscQueueNode *next = tail->mpsc_next.load(std::memory_order_acquire);
+
+        if (tail == &stub_) {
+            if (next == nullptr)
+                return nullptr;
+            tail_ = next;
+            tail = next;
+            next = next->mpsc_next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+
+        //! tail 不是最后一个节点，说明有生产者还没有完成链接
+        if (tail != head_.load(std::memory_order_acquire))
+            return nullptr;
+
+        //! 只剩最后一个节点，将 stub_ 重新放入队尾，以便取出 tail
+        pushNode(&stub_);
+
+        next = tail->mpsc_next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        return nullptr;
+    }
+
+    //! 判断队列是否为空，仅限消费者调用
+    bool empty() const {
+        return tail_ == &stub_ &&
+               stub_.mpsc_next.load(std::memory_order_acquire) == nullptr;
+    }
+
+  private:
+    void pushNode(MpscQueueNode *node) {
+        node->mpsc_next.store(nullptr, std::memory_order_relaxed);
+        MpscQueueNode *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->mpsc_next.store(node, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<MpscQueueNode*> head_;  //!< 生产者一侧
+    MpscQueueNode *tail_;               //!< 消费者一侧
+    MpscQueueNode  stub_;
+};
+
+}
+
+#endif //TBOX_BASE_MPSC_QUEUE_HPP_20251018
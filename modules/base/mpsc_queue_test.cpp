@@ -0,0 +1,101 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "mpsc_queue.hpp"
+
+namespace tbox {
+namespace {
+
+struct Item : public MpscQueueNode {
+    explicit Item(int p, int v) : producer(p), value(v) { }
+    int producer;
+    int value;
+};
+
+TEST(MpscQueue, Empty) {
+    MpscQueue<Item> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.pop(), nullptr);
+}
+
+TEST(MpscQueue, Fifo) {
+    MpscQueue<Item> queue;
+    Item a(0, 1), b(0, 2), c(0, 3);
+    Item *items[] = { &a, &b, &c };
+
+    for (auto item : items)
+        queue.push(item);
+    EXPECT_FALSE(queue.empty());
+
+    for (auto item : items)
+        EXPECT_EQ(queue.pop(), item);
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.pop(), nullptr);
+
+    //! 取空之后再次使用
+    queue.push(&b);
+    EXPECT_EQ(queue.pop(), &b);
+    EXPECT_EQ(queue.pop(), nullptr);
+}
+
+//! 多个生产者同时push，检查每个生产者的数据都完整且保持各自的顺序
+TEST(MpscQueue, MultiProducer) {
+    const int kProducerNum = 8;
+    const int kItemNum = 20000;
+
+    MpscQueue<Item> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducerNum; ++p) {
+        producers.emplace_back(
+            [&queue, p] {
+                for (int i = 0; i < kItemNum; ++i)
+                    queue.push(new Item(p, i));
+            }
+        );
+    }
+
+    std::vector<int> next_values(kProducerNum, 0);
+    int total = 0;
+    while (total < kProducerNum * kItemNum) {
+        auto item = queue.pop();
+        if (item == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        EXPECT_EQ(item->value, next_values[item->producer]);
+        next_values[item->producer] = item->value + 1;
+        ++total;
+        delete item;
+    }
+
+    for (auto &t : producers)
+        t.join();
+
+    EXPECT_EQ(queue.pop(), nullptr);
+    for (int v : next_values)
+        EXPECT_EQ(v, kItemNum);
+}
+
+}
+}
@@ -18,8 +18,9 @@
 * of the source tree.
 */
 #include"recorder.h"
+#include "fast_clock.h"
 
-#include <sys/time.h>
+#include <atomic>
 
 namespace tbox {
 namespace trace {
@@ -29,55 +30,54 @@ void __attribute((weak)) CommitRecordFunc(
    const char *name, const char *module, uint32_t line,
    uint64_t end_timepoint_us, uint64_t duration_us
 );
+void __attribute((weak)) CommitEventFunc(
+   const char *name, const char *module, uint32_t line, uint64_t timepoint_us
+);
 
 namespace{
-uint64_t GetCurrentUTCMicroseconds()
+std::atomic<uint32_t> _sample_min_duration_us(0);
+
+inline uint64_t GetCurrentUTCMicroseconds()
 {
-   struct timeval tv;
-   struct timezone tz;
-   gettimeofday(&tv, &tz);
-   return tv.tv_sec * 1000000 + tv.tv_usec;
+   return GetSystemClockMicroseconds();
 }
 }
 
-Recorder::Recorder(const char *name, const char *module, uint32_t line, bool start_now)
- : name_(name)
- , module_(module)
- , line_(line)
+uint32_t RecordSampleEveryN = 1;
+
+void SetRecordSampling(uint32_t every_n, uint32_t min_duration_us)
 {
-   if (start_now)
-       start();
+   __atomic_store_n(&RecordSampleEveryN, every_n, __ATOMIC_RELAXED);
+   _sample_min_duration_us.store(min_duration_us, std::memory_order_relaxed);
 }
 
-Recorder::~Recorder()
+void GetRecordSampling(uint32_t &every_n, uint32_t &min_duration_us)
 {
-   stop();
+   every_n = __atomic_load_n(&RecordSampleEveryN, __ATOMIC_RELAXED);
+   min_duration_us = _sample_min_duration_us.load(std::memory_order_relaxed);
 }
 
-void Recorder::start()
+void Recorder::doStart()
 {
    if (CommitRecordFunc)
        start_ts_us_ = GetCurrentUTCMicroseconds();
 }
 
-void Recorder::stop()
+void Recorder::doStop()
 {
-   if (start_ts_us_ == 0)
-       return;
-
    auto end_ts_us = GetCurrentUTCMicroseconds();
    auto duration_us = end_ts_us - start_ts_us_;
 
-   if (CommitRecordFunc)
+   if (CommitRecordFunc && duration_us >= _sample_min_duration_us.load(std::memory_order_relaxed))
        CommitRecordFunc(name_, module_, line_, end_ts_us, duration_us);
 
    start_ts_us_ = 0;
 }
 
-void RecordEvent(const char *name, const char *module, uint32_t line)
+void RecordEvent(const char *name, const char *module, uint32_t line, uint32_t *sample_counter)
 {
-   if (CommitRecordFunc)
-       CommitRecordFunc(name, module, line, GetCurrentUTCMicroseconds(), 0);
+   if (CommitEventFunc && IsRecordSampled(sample_counter))
+       CommitEventFunc(name, module, line, GetCurrentUTCMicroseconds());
 }
 
 }
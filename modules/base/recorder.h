@@ -35,38 +35,91 @@
 namespace tbox {
 namespace trace {
 
+/**
+ * 采样设置，对所有记录器生效
+ *
+ * every_n          每个调用点每 N 次只记录1次，各线程分别计数。为0或1时每次都记录
+ * min_duration_us  只提交时长不小于该值的记录，为0时不限。对 RECORD_EVENT() 无效
+ */
+void SetRecordSampling(uint32_t every_n, uint32_t min_duration_us);
+void GetRecordSampling(uint32_t &every_n, uint32_t &min_duration_us);
+
+//! 供下面内联判断用，只能通过 SetRecordSampling() 修改
+extern uint32_t RecordSampleEveryN;
+
+//! 按调用点的计数器决定本次是否记录，未被采中时只有一次自增，不读时钟
+inline bool IsRecordSampled(uint32_t *sample_counter)
+{
+    uint32_t every_n = __atomic_load_n(&RecordSampleEveryN, __ATOMIC_RELAXED);
+    if (every_n <= 1 || sample_counter == nullptr)
+        return true;
+
+    uint32_t count = (*sample_counter)++;
+    if (*sample_counter >= every_n)
+        *sample_counter = 0;
+    return count == 0;
+}
+
 class Recorder {
   public:
-    Recorder(const char *name, const char *module, uint32_t line, bool start_now);
-    ~Recorder();
+    //! sample_counter 为调用点的采样计数器，为 nullptr 则不参与 1/N 采样
+    Recorder(const char *name, const char *module, uint32_t line, bool start_now,
+             uint32_t *sample_counter = nullptr)
+        : name_(name), module_(module), line_(line), sample_counter_(sample_counter)
+    {
+        if (start_now)
+            start();
+    }
+
+    ~Recorder() { stop(); }
+
+    inline void start() {
+        if (IsRecordSampled(sample_counter_))
+            doStart();
+    }
 
-    void start();
-    void stop();
+    inline void stop() {
+        if (start_ts_us_ != 0)
+            doStop();
+    }
+
+  private:
+    void doStart();
+    void doStop();
 
   private:
     const char *name_;
     const char *module_;
     uint32_t line_;
+    uint32_t *sample_counter_;
     uint64_t start_ts_us_ = 0;
 };
 
-void RecordEvent(const char *name, const char *module, uint32_t line);
+void RecordEvent(const char *name, const char *module, uint32_t line, uint32_t *sample_counter = nullptr);
 
 }
 }
 
-//! 区域记录器
-#define _RECORDER_1(func,line)  tbox::trace::Recorder _trace_recorder_at_##line(func, TRACE_MODULE_ID, line, true)
+//! 区域记录器，每个调用点各有一个采样计数器
+#define _RECORDER_1(func,line)  \
+    static thread_local uint32_t _trace_sample_counter_at_##line = 0; \
+    tbox::trace::Recorder _trace_recorder_at_##line(func, TRACE_MODULE_ID, line, true, &_trace_sample_counter_at_##line)
 #define _RECORDER_0(func,line)  _RECORDER_1(func, line)
 #define RECORD_SCOPE()  _RECORDER_0(__PRETTY_FUNCTION__, __LINE__)
 
 //! 有名记录器
-#define _NAMED_RECORDER_0(func,line,name) tbox::trace::Recorder _trace_recorder_##name(func, TRACE_MODULE_ID, line, false)
+#define _NAMED_RECORDER_0(func,line,name) \
+    static thread_local uint32_t _trace_sample_counter_##name = 0; \
+    tbox::trace::Recorder _trace_recorder_##name(func, TRACE_MODULE_ID, line, false, &_trace_sample_counter_##name)
 #define RECORD_DEFINE(name) _NAMED_RECORDER_0(__PRETTY_FUNCTION__, __LINE__, name)
 #define RECORD_START(name)  _trace_recorder_##name.start()
 #define RECORD_STOP(name)   _trace_recorder_##name.stop()
 
 //! 记录事件
-#define RECORD_EVENT()  tbox::trace::RecordEvent(__PRETTY_FUNCTION__, TRACE_MODULE_ID, __LINE__)
+#define RECORD_EVENT() \
+    do { \
+        static thread_local uint32_t _trace_sample_counter = 0; \
+        tbox::trace::RecordEvent(__PRETTY_FUNCTION__, TRACE_MODULE_ID, __LINE__, &_trace_sample_counter); \
+    } while (0)
 
 #endif //TBOX_TRACE_RECORDER_H_20240525
@@ -0,0 +1,195 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_BASE_SMALL_FUNCTION_HPP_20261018
+#define TBOX_BASE_SMALL_FUNCTION_HPP_20261018
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "defines.h"
+
+namespace tbox {
+
+template <typename Signature, size_t kInlineSize = 48>
+class SmallFunction;
+
+/**
+ * SmallFunction，带内置缓冲的可调用对象容器
+ *
+ * 作用与 std::function 相同，区别在于：
+ * - 内置缓冲的大小可以指定，默认 48 字节，足以放下一个 std::function 或捕获了
+ *   五六个指针的 lambda。放得下的可调用对象直接构造在内置缓冲中，不分配内存；
+ *   放不下的，或移动构造可能抛异常的，才退回到堆上；
+ * - 只能移动，不能复制，移动时不会分配内存。
+ *
+ * 使用示例：
+ * -----------------------------------------------------------------
+ * SmallFunction<void()> f = [a, b, c] { ... };
+ * auto g = std::move(f);   //! f 变为空
+ * if (g)
+ *   g();
+ * -----------------------------------------------------------------
+ */
+template <typename R, typename... Args, size_t kInlineSize>
+class SmallFunction<R(Args...), kInlineSize> {
+  public:
+    SmallFunction() { }
+    SmallFunction(std::nullptr_t) { }
+
+    template <typename F,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, SmallFunction>::value>::type>
+    SmallFunction(F &&f) { assign(std::forward<F>(f)); }
+
+    SmallFunction(SmallFunction &&other) noexcept { moveFrom(other); }
+
+    ~SmallFunction() { reset(); }
+
+    NONCOPYABLE(SmallFunction);
+
+    SmallFunction& operator = (SmallFunction &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    SmallFunction& operator = (std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    R operator () (Args... args) const {
+        return ops_->invoke(const_cast<void*>(static_cast<const void*>(storage_)), std::forward<Args>(args)...);
+    }
+
+    void reset() {
+        if (ops_ != nullptr) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    //! 可调用对象是否存放在内置缓冲中
+    bool isInline() const { return ops_ != nullptr && ops_->is_inline; }
+
+  private:
+    struct Ops {
+        R (*invoke)(void *storage, Args&&... args);
+        void (*move)(void *dst, void *src);     //!< 将 src 中的对象移到 dst，并析构 src 中的对象
+        void (*destroy)(void *storage);
+        bool is_inline;
+    };
+
+    template <typename F>
+    struct CanBeInline {
+        static constexpr bool value = sizeof(F) <= kInlineSize &&
+                                      alignof(F) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible<F>::value;
+    };
+
+    //! 对象直接构造在内置缓冲中
+    template <typename F>
+    struct InlineOps {
+        static R Invoke(void *storage, Args&&... args) {
+            return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+        }
+        static void Move(void *dst, void *src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void Destroy(void *storage) {
+            static_cast<F*>(storage)->~F();
+        }
+        static const Ops* Get() {
+            static const Ops ops = { &Invoke, &Move, &Destroy, true };
+            return &ops;
+        }
+    };
+
+    //! 内置缓冲中只存放对象的指针，对象在堆上
+    template <typename F>
+    struct HeapOps {
+        static F*& Ptr(void *storage) { return *static_cast<F**>(storage); }
+
+        static R Invoke(void *storage, Args&&... args) {
+            return (*Ptr(storage))(std::forward<Args>(args)...);
+        }
+        static void Move(void *dst, void *src) {
+            Ptr(dst) = Ptr(src);
+            Ptr(src) = nullptr;
+        }
+        static void Destroy(void *storage) {
+            delete Ptr(storage);
+        }
+        static const Ops* Get() {
+            static const Ops ops = { &Invoke, &Move, &Destroy, false };
+            return &ops;
+        }
+    };
+
+    template <typename F>
+    static bool IsNull(const F &) { return false; }
+    template <typename S>
+    static bool IsNull(const std::function<S> &f) { return !f; }
+    template <typename T>
+    static bool IsNull(T *p) { return p == nullptr; }
+
+    template <typename F>
+    typename std::enable_if<CanBeInline<typename std::decay<F>::type>::value>::type
+    assign(F &&f) {
+        using Functor = typename std::decay<F>::type;
+        if (IsNull(f))
+            return;
+        new (storage_) Functor(std::forward<F>(f));
+        ops_ = InlineOps<Functor>::Get();
+    }
+
+    template <typename F>
+    typename std::enable_if<!CanBeInline<typename std::decay<F>::type>::value>::type
+    assign(F &&f) {
+        using Functor = typename std::decay<F>::type;
+        if (IsNull(f))
+            return;
+        HeapOps<Functor>::Ptr(storage_) = new Functor(std::forward<F>(f));
+        ops_ = HeapOps<Functor>::Get();
+    }
+
+    void moveFrom(SmallFunction &other) noexcept {
+        if (other.ops_ != nullptr) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+  private:
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize < sizeof(void*) ? sizeof(void*) : kInlineSize];
+    const Ops *ops_ = nullptr;
+};
+
+}
+
+#endif //TBOX_BASE_SMALL_FUNCTION_HPP_20261018
@@ -0,0 +1,111 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <array>
+#include <memory>
+#include "small_function.hpp"
+
+namespace tbox {
+namespace {
+
+TEST(SmallFunction, Empty) {
+    SmallFunction<void()> f;
+    EXPECT_FALSE(f);
+
+    SmallFunction<void()> g = nullptr;
+    EXPECT_FALSE(g);
+
+    //! 空的 std::function 与空指针都视为空
+    std::function<void()> empty_std_func;
+    SmallFunction<void()> h = empty_std_func;
+    EXPECT_FALSE(h);
+
+    void (*null_func_ptr)() = nullptr;
+    SmallFunction<void()> k = null_func_ptr;
+    EXPECT_FALSE(k);
+}
+
+TEST(SmallFunction, Inline) {
+    int a = 1, b = 2;
+    SmallFunction<int(int)> f = [&a, &b] (int c) { return a + b + c; };
+    EXPECT_TRUE(f);
+    EXPECT_TRUE(f.isInline());
+    EXPECT_EQ(f(3), 6);
+
+    //! std::function 也能放进内置缓冲
+    std::function<int(int)> std_func = [&a] (int c) { return a * c; };
+    SmallFunction<int(int)> g = std::move(std_func);
+    EXPECT_TRUE(g.isInline());
+    EXPECT_EQ(g(5), 5);
+}
+
+TEST(SmallFunction, Heap) {
+    std::array<char, 64> big;
+    big.fill('x');
+    SmallFunction<char()> f = [big] { return big[10]; };
+    EXPECT_TRUE(f);
+    EXPECT_FALSE(f.isInline());
+    EXPECT_EQ(f(), 'x');
+
+    auto g = std::move(f);
+    EXPECT_FALSE(f);
+    EXPECT_EQ(g(), 'x');
+}
+
+TEST(SmallFunction, MoveAndDestroy) {
+    auto counter = std::make_shared<int>(0);
+    {
+        SmallFunction<void()> f = [counter] { ++*counter; };
+        EXPECT_EQ(counter.use_count(), 2);
+
+        SmallFunction<void()> g = std::move(f);
+        EXPECT_FALSE(f);
+        EXPECT_EQ(counter.use_count(), 2);
+        g();
+
+        SmallFunction<void()> h;
+        h = std::move(g);
+        h();
+        EXPECT_EQ(counter.use_count(), 2);
+
+        h = nullptr;
+        EXPECT_FALSE(h);
+        EXPECT_EQ(counter.use_count(), 1);
+
+        h = [counter] { ++*counter; };
+        h();
+    }
+    EXPECT_EQ(*counter, 3);
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(SmallFunction, MoveOnlyCallable) {
+    std::unique_ptr<int> p(new int(10));
+    struct Callable {
+        std::unique_ptr<int> p;
+        int operator () () const { return *p; }
+    };
+    SmallFunction<int()> f = Callable{std::move(p)};
+    EXPECT_TRUE(f.isInline());
+    EXPECT_EQ(f(), 10);
+}
+
+}
+}
@@ -20,11 +20,15 @@
 /**
  * 在 recorder.h 的基础上加 ENABLE_TRACE_RECORDER 宏开关
  * 使 recorder 功能可以在编译期间被关彻底关闭
+ *
+ * 在 ENABLE_TRACE_RECORDER 开启的情况下，还可以在个别模块中定义 DISABLE_TRACE_RECORDER，
+ * 将热点模块中的记录器单独去掉。见 config.mk 中的 TRACE_RECORDER_DISABLED_MODULES，
+ * 与 CMake 的 TBOX_TRACE_RECORDER_DISABLED_MODULES
  */
 #ifndef TBOX_TRACE_WRAPPED_RECORDER_H_20240610
 #define TBOX_TRACE_WRAPPED_RECORDER_H_20240610
 
-#if ENABLE_TRACE_RECORDER
+#if ENABLE_TRACE_RECORDER && !DISABLE_TRACE_RECORDER
     #include "recorder.h"
 #else
     #define RECORD_SCOPE()
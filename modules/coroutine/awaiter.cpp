@@ -0,0 +1,97 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "awaiter.h"
+
+#include <tbox/base/assert.h>
+
+namespace tbox {
+namespace coroutine {
+
+constexpr Awaiter::Duration Awaiter::kForever;
+
+Awaiter::Awaiter(Scheduler &sch) :
+    sch_(sch),
+    sp_timer_ev_(sch.getLoop()->newTimerEvent("Awaiter::sp_timer_ev_"))
+{
+    sp_timer_ev_->setCallback([this] { wakeup(Result::kTimeout); });
+}
+
+Awaiter::~Awaiter()
+{
+    TBOX_ASSERT(!isWaiting());
+    CHECK_DELETE_RESET_OBJ(sp_timer_ev_);
+}
+
+Awaiter::Result Awaiter::sleep(const Duration &duration)
+{
+    auto result = await(duration);
+    return result == Result::kTimeout ? Result::kOk : result;
+}
+
+void Awaiter::cancel()
+{
+    wakeup(Result::kCanceled);
+}
+
+Awaiter::Result Awaiter::await(const Duration &timeout)
+{
+    if (sch_.isInMainRoutine())
+        return Result::kError;
+
+    TBOX_ASSERT(!isWaiting());
+
+    if (sch_.isCanceled())
+        return Result::kCanceled;
+
+    waiting_token_ = sch_.getToken();
+    is_woken_ = false;
+    result_ = Result::kOk;
+
+    if (timeout >= Duration::zero()) {
+        sp_timer_ev_->initialize(timeout, event::Event::Mode::kOneshot);
+        sp_timer_ev_->enable();
+    }
+
+    //! 协程也可能被别处 resume()，所以要循环等待，直到真正被唤醒
+    while (!is_woken_) {
+        sch_.wait();
+        if (sch_.isCanceled()) {
+            result_ = Result::kCanceled;
+            break;
+        }
+    }
+
+    sp_timer_ev_->disable();
+    waiting_token_.reset();
+    return result_;
+}
+
+void Awaiter::wakeup(Result result)
+{
+    if (!isWaiting() || is_woken_)
+        return;
+
+    is_woken_ = true;
+    result_ = result;
+    sch_.resume(waiting_token_);
+}
+
+}
+}
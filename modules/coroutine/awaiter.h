@@ -0,0 +1,93 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_AWAITER_H_20261018
+#define TBOX_COROUTINE_AWAITER_H_20261018
+
+#include <chrono>
+#include <tbox/event/timer_event.h>
+
+#include "scheduler.h"
+
+namespace tbox {
+namespace coroutine {
+
+/**
+ * 协程等待器基类
+ *
+ * 将"挂起当前协程，直到事件回调、超时或取消"这一过程封装起来，
+ * 子类只需要在事件回调中调用 wakeup() 即可。
+ * 超时定时器与回调函数在构造时创建并设置好，每次等待都不再申请堆内存。
+ *
+ * 注意：同一个等待器同一时刻只能被一个协程使用
+ */
+class Awaiter {
+  public:
+    using Duration = std::chrono::nanoseconds;
+
+    enum class Result {
+        kOk,        //!< 等待的事件已发生
+        kTimeout,   //!< 超时
+        kCanceled,  //!< 被 cancel() 或 Scheduler::cancel() 取消
+        kClosed,    //!< 对端已关闭
+        kError,     //!< 出错
+    };
+
+    static constexpr Duration kForever = Duration(-1);  //!< 永不超时
+
+    explicit Awaiter(Scheduler &sch);
+    virtual ~Awaiter();
+
+    NONCOPYABLE(Awaiter);
+    IMMOVABLE(Awaiter);
+
+  public:
+    //! 让当前协程休眠指定时长，正常结束返回 kOk，仅限子协程调用，在主协程中调用返回 kError
+    Result sleep(const Duration &duration);
+
+    //! 取消正在进行的等待，等待者将返回 kCanceled。可以在任意协程中调用
+    void cancel();
+
+    inline bool isWaiting() const { return !waiting_token_.isNull(); }
+
+  protected:
+    /**
+     * 挂起当前协程，直到 wakeup()、超时或被取消，仅限子协程调用
+     * 主协程不能挂起，在主协程中调用直接返回 kError
+     *
+     * \param timeout   超时时长，为负数表示不超时
+     */
+    Result await(const Duration &timeout);
+
+    //! 唤醒 await() 中的协程，通常在事件回调中调用
+    void wakeup(Result result = Result::kOk);
+
+    Scheduler &sch_;
+
+  private:
+    event::TimerEvent *sp_timer_ev_;
+    RoutineToken waiting_token_;
+    bool is_woken_ = false;
+    Result result_ = Result::kOk;
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_AWAITER_H_20261018
@@ -0,0 +1,210 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "context.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace tbox {
+namespace coroutine {
+
+#ifdef TBOX_COROUTINE_ASM_CONTEXT
+
+extern "C" {
+//! 将当前寄存器压栈，栈顶存入 *from_sp，再从 to_sp 恢复
+void tbox_coroutine_context_swap(void **from_sp, void *to_sp);
+//! 新上下文的第一次返回地址，从保存的寄存器中取出 entry 与 arg 并调用
+void tbox_coroutine_context_start();
+}
+
+#if defined(__x86_64__)
+/**
+ * 栈帧，从低地址到高地址：
+ *   mxcsr(4) fpu_cw(4) | r15 r14 r13 r12 rbx rbp | 返回地址
+ *
+ * 新上下文中 r12 为 arg，r13 为 entry
+ */
+asm(R"(
+    .text
+    .globl  tbox_coroutine_context_swap
+    .hidden tbox_coroutine_context_swap
+    .type   tbox_coroutine_context_swap, @function
+    .align  16
+tbox_coroutine_context_swap:
+    pushq   %rbp
+    pushq   %rbx
+    pushq   %r12
+    pushq   %r13
+    pushq   %r14
+    pushq   %r15
+    subq    $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw  4(%rsp)
+    movq    %rsp, (%rdi)
+    movq    %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw   4(%rsp)
+    addq    $8, %rsp
+    popq    %r15
+    popq    %r14
+    popq    %r13
+    popq    %r12
+    popq    %rbx
+    popq    %rbp
+    ret
+    .size   tbox_coroutine_context_swap, .-tbox_coroutine_context_swap
+
+    .globl  tbox_coroutine_context_start
+    .hidden tbox_coroutine_context_start
+    .type   tbox_coroutine_context_start, @function
+    .align  16
+tbox_coroutine_context_start:
+    movq    %r12, %rdi
+    callq   *%r13
+    ud2
+    .size   tbox_coroutine_context_start, .-tbox_coroutine_context_start
+)");
+
+namespace {
+enum {
+    kFrameFpCtrl = 0,
+    kFrameR15, kFrameR14, kFrameR13, kFrameR12, kFrameRbx, kFrameRbp,
+    kFrameRet,
+    kFrameSize
+};
+}
+
+void Context::make(void *stack, size_t stack_size, Entry entry, void *arg)
+{
+    //! 栈顶按 16 字节对齐，start 中 call 之前的 rsp 也要求 16 字节对齐
+    auto top = (reinterpret_cast<uintptr_t>(stack) + stack_size) & ~uintptr_t(15);
+    auto frame = reinterpret_cast<uint64_t*>(top - 16) - kFrameSize;
+    ::memset(frame, 0, sizeof(uint64_t) * kFrameSize);
+
+    frame[kFrameFpCtrl] = (uint64_t(0x037F) << 32) | 0x1F80;  //! fpu_cw, mxcsr 的默认值
+    frame[kFrameR12] = reinterpret_cast<uint64_t>(arg);
+    frame[kFrameR13] = reinterpret_cast<uint64_t>(entry);
+    frame[kFrameRet] = reinterpret_cast<uint64_t>(&tbox_coroutine_context_start);
+
+    sp_ = frame;
+}
+
+#elif defined(__aarch64__)
+/**
+ * 栈帧，从低地址到高地址：
+ *   d8-d15 | x19-x28 | x29 x30
+ *
+ * 新上下文中 x19 为 entry，x20 为 arg，x30 为 start
+ */
+asm(R"(
+    .text
+    .globl  tbox_coroutine_context_swap
+    .hidden tbox_coroutine_context_swap
+    .type   tbox_coroutine_context_swap, %function
+    .align  4
+tbox_coroutine_context_swap:
+    sub     sp, sp, #160
+    stp     d8,  d9,  [sp, #0]
+    stp     d10, d11, [sp, #16]
+    stp     d12, d13, [sp, #32]
+    stp     d14, d15, [sp, #48]
+    stp     x19, x20, [sp, #64]
+    stp     x21, x22, [sp, #80]
+    stp     x23, x24, [sp, #96]
+    stp     x25, x26, [sp, #112]
+    stp     x27, x28, [sp, #128]
+    stp     x29, x30, [sp, #144]
+    mov     x9, sp
+    str     x9, [x0]
+    mov     sp, x1
+    ldp     d8,  d9,  [sp, #0]
+    ldp     d10, d11, [sp, #16]
+    ldp     d12, d13, [sp, #32]
+    ldp     d14, d15, [sp, #48]
+    ldp     x19, x20, [sp, #64]
+    ldp     x21, x22, [sp, #80]
+    ldp     x23, x24, [sp, #96]
+    ldp     x25, x26, [sp, #112]
+    ldp     x27, x28, [sp, #128]
+    ldp     x29, x30, [sp, #144]
+    add     sp, sp, #160
+    ret
+    .size   tbox_coroutine_context_swap, .-tbox_coroutine_context_swap
+
+    .globl  tbox_coroutine_context_start
+    .hidden tbox_coroutine_context_start
+    .type   tbox_coroutine_context_start, %function
+    .align  4
+tbox_coroutine_context_start:
+    mov     x0, x20
+    blr     x19
+    brk     #0
+    .size   tbox_coroutine_context_start, .-tbox_coroutine_context_start
+)");
+
+namespace {
+enum {
+    kFrameD8 = 0,
+    kFrameX19 = 8, kFrameX20,
+    kFrameX29 = 18, kFrameX30,
+    kFrameSize
+};
+}
+
+void Context::make(void *stack, size_t stack_size, Entry entry, void *arg)
+{
+    auto top = (reinterpret_cast<uintptr_t>(stack) + stack_size) & ~uintptr_t(15);
+    auto frame = reinterpret_cast<uint64_t*>(top) - kFrameSize;
+    ::memset(frame, 0, sizeof(uint64_t) * kFrameSize);
+
+    frame[kFrameX19] = reinterpret_cast<uint64_t>(entry);
+    frame[kFrameX20] = reinterpret_cast<uint64_t>(arg);
+    frame[kFrameX30] = reinterpret_cast<uint64_t>(&tbox_coroutine_context_start);
+
+    sp_ = frame;
+}
+
+#endif
+
+void Context::Swap(Context &from, Context &to)
+{
+    tbox_coroutine_context_swap(&from.sp_, to.sp_);
+}
+
+#else   //! TBOX_COROUTINE_ASM_CONTEXT
+
+void Context::make(void *stack, size_t stack_size, Entry entry, void *arg)
+{
+    getcontext(&ctx_);
+    ctx_.uc_stack.ss_size = stack_size;
+    ctx_.uc_stack.ss_sp = stack;
+    ctx_.uc_link = nullptr;
+    makecontext(&ctx_, (void(*)(void))entry, 1, arg);
+}
+
+void Context::Swap(Context &from, Context &to)
+{
+    swapcontext(&from.ctx_, &to.ctx_);
+}
+
+#endif  //! TBOX_COROUTINE_ASM_CONTEXT
+
+}
+}
@@ -0,0 +1,65 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_CONTEXT_H_20251018
+#define TBOX_COROUTINE_CONTEXT_H_20251018
+
+#include <cstddef>
+
+/**
+ * 协程上下文的切换实现，编译时选择：
+ * - 定义了 HAVE_ASM_CONTEXT 且为 x86-64 或 aarch64 时，用手写的汇编切换，只保存被调用者保存的寄存器；
+ * - 否则退回 ucontext。glibc 的 swapcontext() 每次都会调用 sigprocmask，多一次系统调用。
+ */
+#if defined(HAVE_ASM_CONTEXT) && (defined(__x86_64__) || defined(__aarch64__))
+#define TBOX_COROUTINE_ASM_CONTEXT 1
+#else
+#include <ucontext.h>
+#endif
+
+namespace tbox {
+namespace coroutine {
+
+//! 协程上下文，仅供 Scheduler 内部使用
+class Context {
+  public:
+    using Entry = void (*)(void *arg);
+
+    /**
+     * \brief   在指定的栈上准备上下文，被切换进来后执行 entry(arg)
+     *
+     * \note    entry 不可返回，结束前必须切换到别的上下文
+     */
+    void make(void *stack, size_t stack_size, Entry entry, void *arg);
+
+    //! 保存当前的执行状态到 from，并切换到 to 去执行
+    static void Swap(Context &from, Context &to);
+
+  private:
+#ifdef TBOX_COROUTINE_ASM_CONTEXT
+    void *sp_ = nullptr;    //!< 切换出去时的栈顶，寄存器都保存在栈上
+#else
+    ucontext_t ctx_;
+#endif
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_CONTEXT_H_20251018
@@ -0,0 +1,164 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <ucontext.h>
+#include "context.h"
+
+namespace tbox {
+namespace coroutine {
+namespace {
+
+using namespace std::chrono;
+
+struct PingPong {
+    Context main_ctx;
+    Context routine_ctx;
+    int count = 0;
+    int times = 0;
+    double sum = 0;
+};
+
+void PingPongEntry(void *arg)
+{
+    auto p = static_cast<PingPong*>(arg);
+    //! 这些局部变量跨越切换，会放在被调用者保存的寄存器里
+    double factor = 0.5;
+    long   acc = 0;
+    for (int i = 0; i < p->times; ++i) {
+        ++p->count;
+        acc += i;
+        p->sum += factor * i;
+        Context::Swap(p->routine_ctx, p->main_ctx);
+        factor += 0.5;
+    }
+    EXPECT_EQ(acc, long(p->times) * (p->times - 1) / 2);
+    ++p->count;
+    Context::Swap(p->routine_ctx, p->main_ctx);
+}
+
+TEST(Context, PingPong)
+{
+    std::vector<char> stack(64 << 10);
+
+    PingPong pp;
+    pp.times = 100;
+    pp.routine_ctx.make(stack.data(), stack.size(), PingPongEntry, &pp);
+
+    double expect_sum = 0;
+    double factor = 0.5;
+    for (int i = 0; i < pp.times; ++i) {
+        Context::Swap(pp.main_ctx, pp.routine_ctx);
+        EXPECT_EQ(pp.count, i + 1);
+        expect_sum += factor * i;
+        factor += 0.5;
+    }
+    EXPECT_DOUBLE_EQ(pp.sum, expect_sum);
+
+    Context::Swap(pp.main_ctx, pp.routine_ctx);
+    EXPECT_EQ(pp.count, pp.times + 1);
+}
+
+//! 在协程中调用要求栈对齐的函数，如 printf 浮点数
+void AlignedCallEntry(void *arg)
+{
+    auto p = static_cast<PingPong*>(arg);
+    char buff[32];
+    snprintf(buff, sizeof(buff), "%.2f", 3.14159);
+    p->count = (std::string(buff) == "3.14") ? 1 : -1;
+    Context::Swap(p->routine_ctx, p->main_ctx);
+}
+
+TEST(Context, StackAligned)
+{
+    std::vector<char> stack(64 << 10);
+
+    //! 故意给一个不对齐的栈
+    PingPong pp;
+    pp.routine_ctx.make(stack.data() + 3, stack.size() - 8, AlignedCallEntry, &pp);
+    Context::Swap(pp.main_ctx, pp.routine_ctx);
+    EXPECT_EQ(pp.count, 1);
+}
+
+struct UcontextPingPong {
+    ucontext_t main_ctx;
+    ucontext_t routine_ctx;
+    int times = 0;
+};
+
+void UcontextPingPongEntry(void *arg)
+{
+    auto p = static_cast<UcontextPingPong*>(arg);
+    for (int i = 0; i < p->times; ++i)
+        swapcontext(&p->routine_ctx, &p->main_ctx);
+    swapcontext(&p->routine_ctx, &p->main_ctx);
+}
+
+void PingPongBenchmarkEntry(void *arg)
+{
+    auto p = static_cast<PingPong*>(arg);
+    for (int i = 0; i < p->times; ++i)
+        Context::Swap(p->routine_ctx, p->main_ctx);
+    Context::Swap(p->routine_ctx, p->main_ctx);
+}
+
+/**
+ * 一来一回两次切换的耗时，与直接使用 ucontext 的对比
+ */
+TEST(Context, Benchmark)
+{
+    const int kTimes = 1000000;
+    std::vector<char> stack(64 << 10);
+
+    PingPong pp;
+    pp.times = kTimes;
+    pp.routine_ctx.make(stack.data(), stack.size(), PingPongBenchmarkEntry, &pp);
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        Context::Swap(pp.main_ctx, pp.routine_ctx);
+    auto context_cost = steady_clock::now() - start;
+    Context::Swap(pp.main_ctx, pp.routine_ctx);
+
+    UcontextPingPong upp;
+    upp.times = kTimes;
+    getcontext(&upp.routine_ctx);
+    upp.routine_ctx.uc_stack.ss_sp = stack.data();
+    upp.routine_ctx.uc_stack.ss_size = stack.size();
+    upp.routine_ctx.uc_link = nullptr;
+    makecontext(&upp.routine_ctx, (void(*)(void))UcontextPingPongEntry, 1, &upp);
+
+    start = steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        swapcontext(&upp.main_ctx, &upp.routine_ctx);
+    auto ucontext_cost = steady_clock::now() - start;
+    swapcontext(&upp.main_ctx, &upp.routine_ctx);
+
+    auto context_ns = duration_cast<nanoseconds>(context_cost).count() / kTimes;
+    auto ucontext_ns = duration_cast<nanoseconds>(ucontext_cost).count() / kTimes;
+    std::cout << "Context round trip: " << context_ns << " ns, "
+              << "ucontext round trip: " << ucontext_ns << " ns" << std::endl;
+}
+
+}
+}
+}
@@ -0,0 +1,60 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "fd_awaiter.h"
+
+namespace tbox {
+namespace coroutine {
+
+FdAwaiter::FdAwaiter(Scheduler &sch) :
+    Awaiter(sch),
+    sp_fd_ev_(sch.getLoop()->newFdEvent("FdAwaiter::sp_fd_ev_"))
+{
+    sp_fd_ev_->setCallback([this] (short) { wakeup(); });
+}
+
+FdAwaiter::~FdAwaiter()
+{
+    CHECK_DELETE_RESET_OBJ(sp_fd_ev_);
+}
+
+FdAwaiter::Result FdAwaiter::waitReadable(int fd, const Duration &timeout)
+{
+    return waitEvents(fd, event::FdEvent::kReadEvent, timeout);
+}
+
+FdAwaiter::Result FdAwaiter::waitWritable(int fd, const Duration &timeout)
+{
+    return waitEvents(fd, event::FdEvent::kWriteEvent, timeout);
+}
+
+FdAwaiter::Result FdAwaiter::waitEvents(int fd, short events, const Duration &timeout)
+{
+    if (!sp_fd_ev_->initialize(fd, events, event::Event::Mode::kOneshot))
+        return Result::kError;
+
+    sp_fd_ev_->enable();
+    auto result = await(timeout);
+    sp_fd_ev_->disable();
+
+    return result;
+}
+
+}
+}
@@ -0,0 +1,55 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_FD_AWAITER_H_20261018
+#define TBOX_COROUTINE_FD_AWAITER_H_20261018
+
+#include <tbox/event/fd_event.h>
+
+#include "awaiter.h"
+
+namespace tbox {
+namespace coroutine {
+
+/**
+ * 文件描述符等待器，让协程等待 fd 可读或可写
+ *
+ * 内部的 FdEvent 只创建一次，连续等待同一个 fd 时不会重复初始化
+ */
+class FdAwaiter : public Awaiter {
+  public:
+    explicit FdAwaiter(Scheduler &sch);
+    virtual ~FdAwaiter() override;
+
+  public:
+    //! 以下仅限子协程调用
+    Result waitReadable(int fd, const Duration &timeout = kForever);
+    Result waitWritable(int fd, const Duration &timeout = kForever);
+
+  protected:
+    Result waitEvents(int fd, short events, const Duration &timeout);
+
+  private:
+    event::FdEvent *sp_fd_ev_;
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_FD_AWAITER_H_20261018
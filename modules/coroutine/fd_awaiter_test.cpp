@@ -0,0 +1,210 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include "fd_awaiter.h"
+
+using namespace std;
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::coroutine;
+
+TEST(FdAwaiter, Sleep)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    FdAwaiter awaiter(sch);
+
+    bool is_done = false;
+    sch.create(
+        [&] (Scheduler &) {
+            auto start = chrono::steady_clock::now();
+            EXPECT_EQ(awaiter.sleep(chrono::milliseconds(50)), Awaiter::Result::kOk);
+            EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(50));
+            is_done = true;
+        }
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(100));
+    sp_loop->runLoop();
+    EXPECT_TRUE(is_done);
+}
+
+//! 主协程不能挂起，直接返回 kError
+TEST(FdAwaiter, SleepInMainRoutine)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    FdAwaiter awaiter(sch);
+
+    EXPECT_EQ(awaiter.sleep(chrono::milliseconds(10)), Awaiter::Result::kError);
+    EXPECT_FALSE(awaiter.isWaiting());
+}
+
+/**
+ * 协程等待管道可读，定时器在 20ms 后往管道里写数据
+ */
+TEST(FdAwaiter, WaitReadable)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe(fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    Scheduler sch(sp_loop);
+    FdAwaiter awaiter(sch);
+
+    int recv_count = 0;
+    sch.create(
+        [&] (Scheduler &) {
+            for (int i = 0; i < 3; ++i) {
+                EXPECT_EQ(awaiter.waitReadable(fds[0]), Awaiter::Result::kOk);
+                char ch = 0;
+                EXPECT_EQ(read(fds[0], &ch, 1), 1);
+                EXPECT_EQ(ch, 'a' + i);
+                ++recv_count;
+            }
+        }
+    );
+
+    char ch = 'a';
+    auto sp_timer = sp_loop->newTimerEvent();
+    SetScopeExitAction([sp_timer]{ delete sp_timer;});
+    sp_timer->initialize(chrono::milliseconds(20), Event::Mode::kPersist);
+    sp_timer->setCallback([&] { EXPECT_EQ(write(fds[1], &ch, 1), 1); ++ch; });
+    sp_timer->enable();
+
+    sp_loop->exitLoop(chrono::milliseconds(100));
+    sp_loop->runLoop();
+    EXPECT_EQ(recv_count, 3);
+}
+
+TEST(FdAwaiter, WaitWritable)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe(fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    Scheduler sch(sp_loop);
+    FdAwaiter awaiter(sch);
+
+    bool is_done = false;
+    sch.create(
+        [&] (Scheduler &) {
+            EXPECT_EQ(awaiter.waitWritable(fds[1], chrono::milliseconds(10)), Awaiter::Result::kOk);
+            is_done = true;
+        }
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(50));
+    sp_loop->runLoop();
+    EXPECT_TRUE(is_done);
+}
+
+TEST(FdAwaiter, Timeout)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe(fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    Scheduler sch(sp_loop);
+    FdAwaiter awaiter(sch);
+
+    bool is_done = false;
+    sch.create(
+        [&] (Scheduler &) {
+            auto start = chrono::steady_clock::now();
+            EXPECT_EQ(awaiter.waitReadable(fds[0], chrono::milliseconds(30)), Awaiter::Result::kTimeout);
+            EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(30));
+            //! 超时之后，等待器可以继续使用
+            EXPECT_EQ(awaiter.waitWritable(fds[1], chrono::milliseconds(30)), Awaiter::Result::kOk);
+            is_done = true;
+        }
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(100));
+    sp_loop->runLoop();
+    EXPECT_TRUE(is_done);
+}
+
+/**
+ * 分别用 Awaiter::cancel() 与 Scheduler::cancel() 取消等待
+ */
+TEST(FdAwaiter, Cancel)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe(fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    Scheduler sch(sp_loop);
+    FdAwaiter awaiter_1(sch);
+    FdAwaiter awaiter_2(sch);
+
+    int cancel_count = 0;
+    sch.create(
+        [&] (Scheduler &) {
+            EXPECT_EQ(awaiter_1.waitReadable(fds[0]), Awaiter::Result::kCanceled);
+            ++cancel_count;
+        }
+    );
+    auto token = sch.create(
+        [&] (Scheduler &) {
+            EXPECT_EQ(awaiter_2.sleep(chrono::seconds(10)), Awaiter::Result::kCanceled);
+            ++cancel_count;
+        }
+    );
+
+    auto sp_timer = sp_loop->newTimerEvent();
+    SetScopeExitAction([sp_timer]{ delete sp_timer;});
+    sp_timer->initialize(chrono::milliseconds(10), Event::Mode::kOneshot);
+    sp_timer->setCallback(
+        [&] {
+            EXPECT_TRUE(awaiter_1.isWaiting());
+            EXPECT_TRUE(awaiter_2.isWaiting());
+            awaiter_1.cancel();
+            sch.cancel(token);
+        }
+    );
+    sp_timer->enable();
+
+    sp_loop->exitLoop(chrono::milliseconds(50));
+    sp_loop->runLoop();
+    EXPECT_EQ(cancel_count, 2);
+    EXPECT_FALSE(awaiter_1.isWaiting());
+    EXPECT_FALSE(awaiter_2.isWaiting());
+}
@@ -22,12 +22,14 @@
 #include <cstring>
 
 #include <queue>
-#include <ucontext.h>
 
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/cabinet.hpp>
 
+#include "context.h"
+#include "stack_allocator.h"
+
 namespace tbox {
 namespace coroutine {
 
@@ -40,12 +42,14 @@ using RoutineCabinet = cabinet::Cabinet<Routine>;
 struct Scheduler::Data {
     event::Loop *wp_loop = nullptr;
 
-    ucontext_t main_ctx;   //! 主协程上下文
+    Context main_ctx;   //! 主协程上下文
+    StackAllocator stack_allocator;     //! 子协程栈的分配器，栈在协程间复用
     RoutineCabinet routine_cabinet;
     Routine *curr_routine = nullptr;    //! 当前协程的 Routine 对象指针，为 nullptr 表示主协程
 
     using ReadyRoutineQueue = std::queue<RoutineToken>;
     ReadyRoutineQueue ready_routines;      //! 已就绪的 Routine 链表
+    ReadyRoutineQueue running_routines;    //! schedule() 本轮要执行的 Routine 链表，复用以免每轮重新申请内存
 };
 
 //! 协程对象
@@ -55,7 +59,8 @@ struct Routine {
     string       name;  //! 协程名
     Scheduler   &scheduler; //! 协度器引用
 
-    ucontext_t   ctx;   //! 协程上下文
+    StackAllocator::Stack stack;    //! 协程栈
+    Context      ctx;   //! 协程上下文
 
     //! 协程状态
     enum class State {
@@ -78,9 +83,12 @@ struct Routine {
         LogDbg("Routine %u:%s end", token.id(), name.c_str());
     }
 
-    static void RoutineMainEntry(Routine *p_routine)
+    static void RoutineMainEntry(void *arg)
     {
+        auto p_routine = static_cast<Routine*>(arg);
         p_routine->mainEntry();
+        //! 切回主协程后，由 switchToRoutine() 释放，不会再切回来
+        Context::Swap(p_routine->ctx, p_routine->scheduler.d_->main_ctx);
     }
 
     Routine(const RoutineEntry &e, const string &n, size_t ss, Scheduler &sch) :
@@ -88,16 +96,11 @@ struct Routine {
     {
         LogDbg("Routine(%u)", token.id());
 
-        void *p_stack_mem = malloc(ss);
-        TBOX_ASSERT(p_stack_mem != nullptr);
-
-        //!TODO: 是否可以加哨兵标记，检查栈溢出
+        //! 栈的低地址端有保护页，栈溢出会立即触发 SIGSEGV
+        stack = scheduler.d_->stack_allocator.alloc(ss);
+        TBOX_ASSERT(stack.base != nullptr);
 
-        getcontext(&ctx);
-        ctx.uc_stack.ss_size = ss;
-        ctx.uc_stack.ss_sp = p_stack_mem;
-        ctx.uc_link = &(scheduler.d_->main_ctx);
-        makecontext(&ctx, (void(*)(void))RoutineMainEntry, 1, this);
+        ctx.make(stack.base, stack.size, RoutineMainEntry, this);
     }
 
     ~Routine()
@@ -105,8 +108,11 @@ struct Routine {
         //! 只有没有启动或是已结束的协程才能被释放
         TBOX_ASSERT(!is_started || state == State::kDead);
 
-        free(ctx.uc_stack.ss_sp);
-        LogDbg("~Routine(%u)", token.id());
+        auto stack_hwm = scheduler.d_->stack_allocator.free(stack);
+        if (stack_hwm > stack.size / 4 * 3)
+            LogNotice("Routine %u:%s stack usage %zu/%zu", token.id(), name.c_str(), stack_hwm, stack.size);
+
+        LogDbg("~Routine(%u), stack_hwm:%zu", token.id(), stack_hwm);
     }
 };
 
@@ -117,8 +123,6 @@ Scheduler::Scheduler(Loop *wp_loop) :
 {
     TBOX_ASSERT(d_ != nullptr);
     d_->wp_loop = wp_loop;
-
-    ::memset(&d_->main_ctx, 0, sizeof(ucontext_t));
 }
 
 Scheduler::~Scheduler()
@@ -195,7 +199,7 @@ void Scheduler::wait()
         return;
 
     d_->curr_routine->state = Routine::State::kSuspend;
-    swapcontext(&(d_->curr_routine->ctx), &d_->main_ctx);
+    Context::Swap(d_->curr_routine->ctx, d_->main_ctx);
 }
 
 void Scheduler::yield()
@@ -205,7 +209,7 @@ void Scheduler::yield()
         return;
 
     makeRoutineReady(d_->curr_routine);
-    swapcontext(&(d_->curr_routine->ctx), &d_->main_ctx);
+    Context::Swap(d_->curr_routine->ctx, d_->main_ctx);
 }
 
 bool Scheduler::join(const RoutineToken &other_routine)
@@ -226,7 +230,7 @@ bool Scheduler::join(const RoutineToken &other_routine)
         routine->join_token = d_->curr_routine->token;
 
         d_->curr_routine->state = Routine::State::kSuspend;
-        swapcontext(&(d_->curr_routine->ctx), &d_->main_ctx);
+        Context::Swap(d_->curr_routine->ctx, d_->main_ctx);
 
         //! 如果不是被cancel唤醒的，那返回成功；否则返回失败
         return !d_->curr_routine->is_canceled;
@@ -252,11 +256,22 @@ string Scheduler::getName() const
     return d_->curr_routine->name;
 }
 
+size_t Scheduler::getStackHighWaterMark() const
+{
+    TBOX_ASSERT(!isInMainRoutine());
+    return d_->stack_allocator.highWaterMark(d_->curr_routine->stack);
+}
+
 event::Loop* Scheduler::getLoop() const
 {
     return d_->wp_loop;
 }
 
+StackAllocator& Scheduler::getStackAllocator()
+{
+    return d_->stack_allocator;
+}
+
 /**
  * 将 routine 状态置为 kReady，然后将其丢到就绪列表中
  */
@@ -268,7 +283,7 @@ bool Scheduler::makeRoutineReady(Routine *routine)
 
     routine->state = Routine::State::kReady;
     d_->ready_routines.push(routine->token);
-    d_->wp_loop->runNext(std::bind(&Scheduler::schedule, this), "Scheduler::makeRoutineReady");
+    d_->wp_loop->runNext([this] { schedule(); }, "Scheduler::makeRoutineReady");
     return true;
 }
 
@@ -280,7 +295,7 @@ void Scheduler::switchToRoutine(Routine *routine)
     d_->curr_routine->state = Routine::State::kRunning;
 
     //! 切换到 curr_routine 指定协程去执行
-    swapcontext(&d_->main_ctx, &(d_->curr_routine->ctx));
+    Context::Swap(d_->main_ctx, d_->curr_routine->ctx);
     //! 从 curr_routine 指定协程返回来
 
     //! 检查协程状态，如果已经结束了的协程，要释放资源
@@ -307,7 +322,8 @@ void Scheduler::schedule()
     //! 进而导致 schedule() 函数无法退出。导致 Loop 中的其它事件阻塞，得不到处理。
     //! 这里的处理方法，就是将 ready_routines 中的内容移到 tmp 中来。后来执行中就绪
     //! 的协程留到下一轮去处理。
-    Data::ReadyRoutineQueue tmp;
+    //! tmp 用的是 running_routines，它与 ready_routines 轮流交换，不用每轮构造新的队列
+    auto &tmp = d_->running_routines;
     std::swap(tmp, d_->ready_routines);
 
     //! 逐一切换到就绪链表对应的协程去执行，直到就绪链表为空
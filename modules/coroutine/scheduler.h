@@ -29,6 +29,7 @@ namespace coroutine {
 
 struct Routine;
 class Scheduler;
+class StackAllocator;
 
 using RoutineToken  = cabinet::Token;
 using RoutineEntry  = std::function<void(Scheduler&)>;
@@ -55,6 +56,7 @@ class Scheduler {
 
     bool resume(const RoutineToken &token); //! 恢复指定协程
     bool cancel(const RoutineToken &token); //! 取消指定协程，只能给协程发送了取消请求，并非立即停止
+    bool isInMainRoutine() const;           //! 是否处于主协程中
 
   public:
     //! 以下仅限子协程调用
@@ -65,18 +67,21 @@ class Scheduler {
     RoutineToken getToken() const;  //! 获取当前协程token
     bool isCanceled() const;        //! 当前协程是否被取消
     std::string getName() const;    //! 当前协程的名称
+    size_t getStackHighWaterMark() const;   //! 当前协程栈至今用到的最大深度
     event::Loop* getLoop() const;
 
   public:
     //! 以下仅限主协程调用
     void cleanup(); //! 强行停止并清理所有的协程，通常在程序退出前使用
 
+    //! 子协程栈的分配器，可以调整栈的复用数量与按需提交的大小
+    StackAllocator& getStackAllocator();
+
   protected:
     void schedule();    //! 调度，依次切换到已就绪的 Routine 去执行，直到没有 Routine 就绪为止
 
     bool makeRoutineReady(Routine *routine);
     void switchToRoutine(Routine *routine);
-    bool isInMainRoutine() const;   //! 是否处于主协程中
 
   private:
     struct Data;
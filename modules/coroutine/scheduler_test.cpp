@@ -22,6 +22,7 @@
 #include <tbox/event/loop.h>
 #include <tbox/event/timer_event.h>
 #include <tbox/base/scope_exit.hpp>
+#include "stack_allocator.h"
 
 using namespace std;
 using namespace tbox;
@@ -315,3 +316,48 @@ TEST(Scheduler, OneLoopTwoSchedule)
     EXPECT_TRUE(sch1_routine2_run);
     EXPECT_TRUE(sch2_routine_run);
 }
+
+//! 在栈上用掉 16KB，不内联，免得它的栈空间算到调用者的栈帧里
+__attribute__((noinline)) void Use16KBStack()
+{
+    volatile char buff[16 << 10];
+    for (size_t i = 0; i < sizeof(buff); ++i)
+        buff[i] = 1;
+}
+
+//! 测试协程栈的最高水位统计，以及栈的复用
+TEST(Scheduler, StackHighWaterMark)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    sch.getStackAllocator().setHighWaterMarkEnabled(true);
+
+    size_t hwm_before = 0;
+    size_t hwm_after = 0;
+    sch.create(
+        [&](Scheduler &sch) {
+            hwm_before = sch.getStackHighWaterMark();
+            Use16KBStack();
+            hwm_after = sch.getStackHighWaterMark();
+        }, true, "", 64 << 10
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(10));
+    sp_loop->runLoop();
+
+    EXPECT_GT(hwm_before, 0u);
+    EXPECT_GE(hwm_after, 16u << 10);
+    EXPECT_LT(hwm_after, 64u << 10);
+
+    //! 再创建一个同样栈大小的协程，应复用前一个协程的栈
+    sch.create([](Scheduler &) { }, true, "", 64 << 10);
+    sp_loop->exitLoop(chrono::milliseconds(10));
+    sp_loop->runLoop();
+
+    auto stat = sch.getStackAllocator().getStat();
+    EXPECT_EQ(stat.total_alloc_times, 2u);
+    EXPECT_EQ(stat.total_mmap_times, 1u);
+    EXPECT_GE(stat.peak_stack_hwm, hwm_after);
+}
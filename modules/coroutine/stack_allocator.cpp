@@ -0,0 +1,197 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "stack_allocator.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <tbox/base/log.h>
+
+namespace tbox {
+namespace coroutine {
+
+StackAllocator::StackAllocator() :
+    page_size_(::sysconf(_SC_PAGESIZE))
+{ }
+
+StackAllocator::~StackAllocator()
+{
+    clear();
+}
+
+StackAllocator::Stack StackAllocator::alloc(size_t size)
+{
+    ++stat_.total_alloc_times;
+
+    Stack stack;
+    stack.size = (size + page_size_ - 1) / page_size_ * page_size_;
+    if (stack.size == 0)
+        stack.size = page_size_;
+
+    auto iter = free_stacks_.find(stack.size);
+    if (iter != free_stacks_.end() && !iter->second.empty()) {
+        stack.base = iter->second.back();
+        stack.is_mapped = true;
+        iter->second.pop_back();
+        return stack;
+    }
+
+    //! 小栈在分配时即提交，按需提交的栈只占地址空间
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK;
+    if (!isLazyCommit(stack.size))
+        flags |= MAP_POPULATE;
+
+    auto mem = ::mmap(nullptr, stack.size + page_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+    //! 设置保护页要拆分映射区，也可能因为映射区数量超限而失败
+    if (mem != MAP_FAILED && ::mprotect(mem, page_size_, PROT_NONE) != 0) {
+        ::munmap(mem, stack.size + page_size_);
+        mem = MAP_FAILED;
+    }
+
+    if (mem == MAP_FAILED) {
+        //! 通常是映射区的数量超限了，退回 calloc()，清零是为了统计最高水位
+        if (stat_.total_calloc_times == 0)
+            LogErrno(errno, "mmap stack fail, size:%zu, fallback to calloc", stack.size);
+        ++stat_.total_calloc_times;
+
+        stack.base = ::calloc(1, stack.size);
+        if (stack.base == nullptr)
+            stack.size = 0;
+        return stack;
+    }
+    ++stat_.total_mmap_times;
+
+    //! 最低的一页是保护页，它被提交的物理页还回去
+    if (!isLazyCommit(stack.size))
+        ::madvise(mem, page_size_, MADV_DONTNEED);
+
+    stack.base = static_cast<uint8_t*>(mem) + page_size_;
+    stack.is_mapped = true;
+    return stack;
+}
+
+size_t StackAllocator::free(const Stack &stack)
+{
+    if (stack.base == nullptr)
+        return 0;
+
+    size_t hwm = 0;
+    if (is_hwm_enabled_) {
+        hwm = highWaterMark(stack);
+        if (hwm > stat_.peak_stack_hwm)
+            stat_.peak_stack_hwm = hwm;
+    }
+
+    if (!stack.is_mapped) {
+        ::free(stack.base);
+        return hwm;
+    }
+
+    auto &stacks = free_stacks_[stack.size];
+    if (stacks.size() >= keep_number_) {
+        unmap(stack);
+        return hwm;
+    }
+
+    auto top = static_cast<uint8_t*>(stack.base) + stack.size;
+    if (isLazyCommit(stack.size)) {
+        //! 除了最高的一页，用过的页都还给系统，再用到时重新提交，读到的是 0
+        size_t used = is_hwm_enabled_ ? hwm : stack.size;
+        if (used > page_size_) {
+            auto begin = static_cast<uint8_t*>(stack.base) + (stack.size - used) / page_size_ * page_size_;
+            ::madvise(begin, top - page_size_ - begin, MADV_DONTNEED);
+        }
+        if (is_hwm_enabled_)
+            ::memset(top - std::min(hwm, page_size_), 0, std::min(hwm, page_size_));
+
+    } else if (is_hwm_enabled_) {
+        //! 将用过的部分清零，下次复用时统计的最高水位才准确
+        ::memset(top - hwm, 0, hwm);
+    }
+
+    stacks.push_back(stack.base);
+    return hwm;
+}
+
+size_t StackAllocator::highWaterMark(const Stack &stack) const
+{
+    if (stack.base == nullptr)
+        return 0;
+
+    auto begin = static_cast<uint8_t*>(stack.base);
+    auto end = begin + stack.size;
+
+    //! 按需提交的栈，跳过还没有提交的页，免得为读它们而产生缺页
+    if (stack.is_mapped && isLazyCommit(stack.size)) {
+        unsigned char vec[64];
+        bool found = false;
+        while (!found && begin < end) {
+            size_t len = std::min<size_t>(end - begin, sizeof(vec) * page_size_);
+            if (::mincore(begin, len, vec) != 0)
+                break;
+
+            size_t pages = (len + page_size_ - 1) / page_size_;
+            size_t i = 0;
+            while (i < pages && (vec[i] & 1) == 0)
+                ++i;
+
+            begin += i * page_size_;
+            found = (i < pages);
+        }
+    }
+
+    //! 栈从高地址端往低地址端增长，没有被用过的部分都是 0
+    //! 先与全 0 的块整块地比较，memcmp() 有向量化的实现，再在块内逐字查找
+    static const uint64_t zero_block[128] = { 0 };
+    auto p = reinterpret_cast<const uint64_t*>(begin);
+    auto p_end = reinterpret_cast<const uint64_t*>(end);
+    while (p + 128 <= p_end && ::memcmp(p, zero_block, sizeof(zero_block)) == 0)
+        p += 128;
+    while (p < p_end && *p == 0)
+        ++p;
+
+    return (p_end - p) * sizeof(uint64_t);
+}
+
+void StackAllocator::clear()
+{
+    for (auto &item : free_stacks_) {
+        Stack stack;
+        stack.size = item.first;
+        for (auto base : item.second) {
+            stack.base = base;
+            unmap(stack);
+        }
+    }
+    free_stacks_.clear();
+}
+
+void StackAllocator::unmap(const Stack &stack)
+{
+    ::munmap(static_cast<uint8_t*>(stack.base) - page_size_, stack.size + page_size_);
+}
+
+}
+}
@@ -0,0 +1,110 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_STACK_ALLOCATOR_H_20251018
+#define TBOX_COROUTINE_STACK_ALLOCATOR_H_20251018
+
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace coroutine {
+
+/**
+ * 协程栈分配器
+ *
+ * - 栈用 mmap() 分配，低地址端有一个 PROT_NONE 的保护页，栈溢出时立即触发 SIGSEGV，而不是悄悄地踩坏堆；
+ * - 释放的栈按大小放入空闲列表，再分配同样大小的栈时直接复用；
+ * - 小于 lazy_commit_size 的栈在分配时即提交内存，运行时不再缺页；
+ *   不小于它的栈按需提交，只有被用到的页才占用物理内存，回收时将其归还给系统；
+ * - 可选地在回收时统计栈的最高水位，并将用过的部分清零，复用时的统计依然准确。
+ *   统计要扫描整个栈，默认不开启；
+ *
+ * 每个带保护页的栈要占用两个内存映射区，同时存在的协程太多时会超出 vm.max_map_count 的限制，
+ * 这时 mmap() 失败，退回用 calloc() 分配没有保护页的栈，这样的栈不复用。
+ *
+ * 非线程安全，每个 Scheduler 有一个自己的分配器
+ */
+class StackAllocator {
+  public:
+    struct Stack {
+        void  *base = nullptr;  //!< 可用部分的起始地址（低地址端），不含保护页
+        size_t size = 0;        //!< 可用部分的大小，为页大小的整数倍
+        bool   is_mapped = false;   //!< 是否由 mmap() 分配，否则是在映射数量超限后退回 calloc() 分配的，没有保护页
+    };
+
+    struct Stat {
+        size_t total_alloc_times = 0;   //!< 总共调用 alloc() 的次数
+        size_t total_mmap_times  = 0;   //!< 其中真正 mmap() 的次数
+        size_t total_calloc_times = 0;  //!< 其中因 mmap() 失败而退回 calloc() 的次数
+        size_t peak_stack_hwm    = 0;   //!< 回收过的栈中最高的水位
+    };
+
+  public:
+    StackAllocator();
+    ~StackAllocator();
+
+    NONCOPYABLE(StackAllocator);
+    IMMOVABLE(StackAllocator);
+
+  public:
+    //! 设置每种大小最多保留的空闲栈数，默认 64
+    void setKeepNumber(size_t keep_number) { keep_number_ = keep_number; }
+    //! 设置按需提交的栈大小下限，默认 64KB
+    void setLazyCommitSize(size_t size) { lazy_commit_size_ = size; }
+    //! 开启最高水位统计，应在分配栈之前设置
+    void setHighWaterMarkEnabled(bool enable) { is_hwm_enabled_ = enable; }
+
+    //! 分配不小于 size 的栈，失败则返回的 base 为 nullptr
+    Stack alloc(size_t size);
+    //! 回收栈，开启了最高水位统计时返回其最高水位，否则返回 0
+    size_t free(const Stack &stack);
+
+    /**
+     * 统计栈从高地址端起用到的最大深度，精度为 8 字节
+     *
+     * \note   没有开启最高水位统计时，复用的栈没有清零，得到的是包括之前使用者在内的最高水位
+     */
+    size_t highWaterMark(const Stack &stack) const;
+
+    //! 释放所有空闲的栈
+    void clear();
+
+    Stat getStat() const { return stat_; }
+
+  protected:
+    bool isLazyCommit(size_t size) const { return size >= lazy_commit_size_; }
+    void unmap(const Stack &stack);
+
+  private:
+    size_t page_size_;
+    size_t keep_number_ = 64;
+    size_t lazy_commit_size_ = 64 << 10;
+    bool is_hwm_enabled_ = false;
+
+    std::map<size_t, std::vector<void*>> free_stacks_;  //!< 以 size 为 key 的空闲栈
+    Stat stat_;
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_STACK_ALLOCATOR_H_20251018
@@ -0,0 +1,190 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <csignal>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include "stack_allocator.h"
+
+namespace tbox {
+namespace coroutine {
+namespace {
+
+using namespace std::chrono;
+
+//! 模拟栈从高地址端往下使用了 depth 字节
+void UseStack(const StackAllocator::Stack &stack, size_t depth)
+{
+    auto top = static_cast<char*>(stack.base) + stack.size;
+    ::memset(top - depth, 0x5a, depth);
+}
+
+TEST(StackAllocator, Reuse)
+{
+    StackAllocator sa;
+
+    auto s1 = sa.alloc(8192);
+    ASSERT_NE(s1.base, nullptr);
+    EXPECT_GE(s1.size, 8192u);
+    sa.free(s1);
+
+    auto s2 = sa.alloc(8192);
+    EXPECT_EQ(s2.base, s1.base);
+    EXPECT_EQ(s2.size, s1.size);
+
+    //! 不同大小的不复用
+    auto s3 = sa.alloc(16384);
+    EXPECT_NE(s3.base, s1.base);
+
+    sa.free(s2);
+    sa.free(s3);
+
+    auto stat = sa.getStat();
+    EXPECT_EQ(stat.total_alloc_times, 3u);
+    EXPECT_EQ(stat.total_mmap_times, 2u);
+}
+
+TEST(StackAllocator, KeepNumber)
+{
+    StackAllocator sa;
+    sa.setKeepNumber(1);
+
+    auto s1 = sa.alloc(8192);
+    auto s2 = sa.alloc(8192);
+    sa.free(s1);
+    sa.free(s2);    //! 超出保留数量，直接释放
+
+    EXPECT_EQ(sa.alloc(8192).base, s1.base);
+    sa.alloc(8192);
+    EXPECT_EQ(sa.getStat().total_mmap_times, 3u);
+}
+
+TEST(StackAllocator, HighWaterMark)
+{
+    StackAllocator sa;
+    sa.setHighWaterMarkEnabled(true);
+
+    auto s1 = sa.alloc(8192);
+    EXPECT_EQ(sa.highWaterMark(s1), 0u);
+
+    UseStack(s1, 1000);
+    auto hwm = sa.highWaterMark(s1);
+    EXPECT_GE(hwm, 1000u);
+    EXPECT_LT(hwm, 1008u);
+    EXPECT_EQ(sa.free(s1), hwm);
+
+    //! 复用的栈要重新统计
+    auto s2 = sa.alloc(8192);
+    ASSERT_EQ(s2.base, s1.base);
+    EXPECT_EQ(sa.highWaterMark(s2), 0u);
+    UseStack(s2, 100);
+    EXPECT_LT(sa.highWaterMark(s2), 108u);
+    sa.free(s2);
+
+    EXPECT_GE(sa.getStat().peak_stack_hwm, 1000u);
+}
+
+TEST(StackAllocator, LazyCommit)
+{
+    StackAllocator sa;
+    sa.setLazyCommitSize(64 << 10);
+    sa.setHighWaterMarkEnabled(true);
+
+    auto s1 = sa.alloc(256 << 10);
+    ASSERT_NE(s1.base, nullptr);
+    EXPECT_EQ(sa.highWaterMark(s1), 0u);
+
+    UseStack(s1, 20000);
+    auto hwm = sa.highWaterMark(s1);
+    EXPECT_GE(hwm, 20000u);
+    EXPECT_LT(hwm, 20008u);
+    sa.free(s1);
+
+    auto s2 = sa.alloc(256 << 10);
+    ASSERT_EQ(s2.base, s1.base);
+    EXPECT_EQ(sa.highWaterMark(s2), 0u);
+    UseStack(s2, 100);
+    EXPECT_LT(sa.highWaterMark(s2), 108u);
+    sa.free(s2);
+}
+
+TEST(StackAllocator, GuardPage)
+{
+    StackAllocator sa;
+    auto s = sa.alloc(8192);
+    ASSERT_NE(s.base, nullptr);
+
+    //! 写到栈底以下，即保护页上
+    EXPECT_EXIT(
+        {
+            static_cast<volatile char*>(s.base)[-1] = 1;
+            std::exit(0);
+        },
+        ::testing::KilledBySignal(SIGSEGV), ""
+    );
+
+    sa.free(s);
+}
+
+/**
+ * 分配、使用 1KB、回收，与 malloc() 8KB 的对比，分别统计开启与不开启最高水位统计的情况
+ */
+TEST(StackAllocator, Benchmark)
+{
+    const int kTimes = 100000;
+    const size_t kStackSize = 8192;
+    const size_t kUsed = 1024;
+
+    nanoseconds sa_cost[2];
+    for (int enable_hwm = 0; enable_hwm < 2; ++enable_hwm) {
+        StackAllocator sa;
+        sa.setHighWaterMarkEnabled(enable_hwm != 0);
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < kTimes; ++i) {
+            auto s = sa.alloc(kStackSize);
+            UseStack(s, kUsed);
+            sa.free(s);
+        }
+        sa_cost[enable_hwm] = steady_clock::now() - start;
+        EXPECT_EQ(sa.getStat().total_mmap_times, 1u);
+    }
+
+    //! 通过 volatile 指针调用，免得 malloc() 与 free() 被编译器优化掉
+    void* (* volatile malloc_func)(size_t) = ::malloc;
+    void  (* volatile free_func)(void*) = ::free;
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        auto p = static_cast<char*>(malloc_func(kStackSize));
+        ::memset(p + kStackSize - kUsed, 0x5a, kUsed);
+        free_func(p);
+    }
+    auto malloc_cost = steady_clock::now() - start;
+
+    std::cout << "StackAllocator: " << sa_cost[0].count() / kTimes << " ns, "
+              << "with hwm: " << sa_cost[1].count() / kTimes << " ns, "
+              << "malloc: " << duration_cast<nanoseconds>(malloc_cost).count() / kTimes << " ns" << std::endl;
+}
+
+}
+}
+}
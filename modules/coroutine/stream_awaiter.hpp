@@ -0,0 +1,231 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_STREAM_AWAITER_HPP_20261018
+#define TBOX_COROUTINE_STREAM_AWAITER_HPP_20261018
+
+#include <algorithm>
+#include <string>
+#include <tbox/base/assert.h>
+#include <tbox/network/byte_stream.h>
+#include <tbox/network/buffered_fd.h>
+
+#include "awaiter.h"
+
+namespace tbox {
+namespace coroutine {
+
+/**
+ * 字节流等待器，让协程以顺序的方式读写 ByteStream
+ *
+ * 构造时会接管 stream 的接收与发送完成回调，析构时清除。接收到的数据
+ * 仍然存放在 stream 的接收缓冲中，读取时直接从中取，不另做拷贝。
+ * 对于 BufferedFd，还会接管其对端关闭与读写出错的回调，从而能返回
+ * kClosed 与 kError；普通的 ByteStream 无法感知关闭，只能依赖超时。
+ *
+ * 使用示例：
+ *
+ *  StreamAwaiter io(sch, buffered_fd);
+ *  std::string line;
+ *  while (io.readUntil("\r\n", line, std::chrono::seconds(3)) == Awaiter::Result::kOk) {
+ *      io.write(line.data(), line.size());
+ *      line.clear();
+ *  }
+ */
+class StreamAwaiter : public Awaiter {
+  public:
+    StreamAwaiter(Scheduler &sch, network::ByteStream &stream) :
+        Awaiter(sch), stream_(stream)
+    {
+        hookStream();
+    }
+
+    StreamAwaiter(Scheduler &sch, network::BufferedFd &buffered_fd) :
+        Awaiter(sch), stream_(buffered_fd), wp_buffered_fd_(&buffered_fd)
+    {
+        hookStream();
+
+        buffered_fd.setReadZeroCallback([this] { is_closed_ = true; wakeup(Result::kClosed); });
+        buffered_fd.setReadErrorCallback([this] (int) { is_error_ = true; wakeup(Result::kError); });
+        buffered_fd.setWriteErrorCallback([this] (int) { is_error_ = true; wakeup(Result::kError); });
+    }
+
+    virtual ~StreamAwaiter() override {
+        stream_.setReceiveCallback(nullptr, 0);
+        stream_.setSendCompleteCallback(nullptr);
+
+        if (wp_buffered_fd_ != nullptr) {
+            wp_buffered_fd_->setReadZeroCallback(nullptr);
+            wp_buffered_fd_->setReadErrorCallback(nullptr);
+            wp_buffered_fd_->setWriteErrorCallback(nullptr);
+        }
+    }
+
+  public:
+    //! 以下仅限子协程调用
+
+    /**
+     * 读取数据，接收缓冲中有多少取多少，最多 size 字节；缓冲为空时才等待
+     *
+     * \param read_size 实际读到的字节数，只有返回 kOk 时才大于 0
+     */
+    Result read(void *buff, size_t size, size_t &read_size, const Duration &timeout = kForever) {
+        read_size = 0;
+        auto deadline = toDeadline(timeout);
+
+        for (;;) {
+            auto rbuf = stream_.getReceiveBuffer();
+            if (rbuf->readableSize() > 0) {
+                read_size = rbuf->fetch(buff, size);
+                return Result::kOk;
+            }
+
+            auto result = awaitFor(WaitFor::kRead, deadline);
+            if (result != Result::kOk)
+                return result;
+        }
+    }
+
+    /**
+     * 一直读到 delim 为止，将数据连同 delim 一起追加到 out 的末尾
+     *
+     * 若未等到 delim 就超时或关闭，已接收的数据仍留在接收缓冲中
+     */
+    Result readUntil(const std::string &delim, std::string &out, const Duration &timeout = kForever) {
+        TBOX_ASSERT(!delim.empty());
+
+        auto deadline = toDeadline(timeout);
+        size_t scanned_size = 0;    //! 已经查找过的数据长度，避免每次从头找
+
+        for (;;) {
+            auto rbuf = stream_.getReceiveBuffer();
+            auto begin = reinterpret_cast<const char*>(rbuf->readableBegin());
+            auto end = begin + rbuf->readableSize();
+            auto from = begin + (scanned_size >= delim.size() ? scanned_size - delim.size() + 1 : 0);
+
+            auto pos = std::search(from, end, delim.begin(), delim.end());
+            if (pos != end) {
+                size_t size = pos - begin + delim.size();
+                out.append(begin, size);
+                rbuf->hasRead(size);
+                return Result::kOk;
+            }
+            scanned_size = end - begin;
+
+            auto result = awaitFor(WaitFor::kRead, deadline);
+            if (result != Result::kOk)
+                return result;
+        }
+    }
+
+    //! 发送数据，并等待发送完成
+    Result write(const void *data, size_t size, const Duration &timeout = kForever) {
+        if (is_error_)
+            return Result::kError;
+
+        is_sending_ = true;
+        if (!stream_.send(data, size)) {
+            is_sending_ = false;
+            return Result::kError;
+        }
+
+        //! BufferedFd 直接发送出错时会丢弃数据并返回 true，之后不会有任何回调，不能再等
+        if (wp_buffered_fd_ != nullptr && !wp_buffered_fd_->isSending()) {
+            is_sending_ = false;
+            is_error_ = true;
+            return Result::kError;
+        }
+
+        auto deadline = toDeadline(timeout);
+        while (is_sending_) {
+            auto result = awaitFor(WaitFor::kWrite, deadline);
+            if (result != Result::kOk)
+                return result;
+        }
+        return Result::kOk;
+    }
+
+  protected:
+    using Clock = std::chrono::steady_clock;
+
+    enum class WaitFor { kNone, kRead, kWrite };
+
+    void hookStream() {
+        stream_.setReceiveCallback(
+            [this] (network::Buffer &) {
+                if (wait_for_ == WaitFor::kRead)
+                    wakeup();
+            }, 0
+        );
+
+        stream_.setSendCompleteCallback(
+            [this] {
+                is_sending_ = false;
+                if (wait_for_ == WaitFor::kWrite)
+                    wakeup();
+            }
+        );
+    }
+
+    static Clock::time_point toDeadline(const Duration &timeout) {
+        if (timeout < Duration::zero())
+            return Clock::time_point::max();
+        return Clock::now() + timeout;
+    }
+
+    Result awaitFor(WaitFor what, const Clock::time_point &deadline) {
+        if (is_error_)
+            return Result::kError;
+
+        if (is_closed_ && what == WaitFor::kRead)
+            return Result::kClosed;
+
+        Duration timeout = kForever;
+        if (deadline != Clock::time_point::max()) {
+            auto now = Clock::now();
+            if (now >= deadline)
+                return Result::kTimeout;
+            timeout = deadline - now;
+        }
+
+        wait_for_ = what;
+        auto result = await(timeout);
+        wait_for_ = WaitFor::kNone;
+
+        //! 写的时候对端关闭了读端，并不影响写，继续等
+        if (result == Result::kClosed && what == WaitFor::kWrite)
+            result = Result::kOk;
+
+        return result;
+    }
+
+  private:
+    network::ByteStream &stream_;
+    network::BufferedFd *wp_buffered_fd_ = nullptr;
+
+    WaitFor wait_for_ = WaitFor::kNone;
+    bool is_sending_ = false;
+    bool is_closed_ = false;
+    bool is_error_ = false;
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_STREAM_AWAITER_HPP_20261018
@@ -0,0 +1,281 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <iostream>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include "stream_awaiter.hpp"
+
+using namespace std;
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+using namespace tbox::coroutine;
+
+/**
+ * 对端分三次发出 "hello\r\nwor", "ld\r\npar", "tial"
+ * 协程用 readUntil() 读出两行，再等待第三行超时，最后用 read() 读出剩余的数据
+ */
+TEST(StreamAwaiter, ReadUntil)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    BufferedFd buffered_fd(sp_loop);
+    buffered_fd.initialize(fds[0]);
+    buffered_fd.enable();
+
+    Scheduler sch(sp_loop);
+    StreamAwaiter io(sch, buffered_fd);
+
+    bool is_done = false;
+    sch.create(
+        [&] (Scheduler &) {
+            string line;
+            EXPECT_EQ(io.readUntil("\r\n", line), Awaiter::Result::kOk);
+            EXPECT_EQ(line, "hello\r\n");
+            line.clear();
+            EXPECT_EQ(io.readUntil("\r\n", line), Awaiter::Result::kOk);
+            EXPECT_EQ(line, "world\r\n");
+            line.clear();
+            EXPECT_EQ(io.readUntil("\r\n", line, chrono::milliseconds(50)), Awaiter::Result::kTimeout);
+            EXPECT_TRUE(line.empty());
+
+            char buff[16] = { 0 };
+            size_t read_size = 0;
+            EXPECT_EQ(io.read(buff, sizeof(buff), read_size), Awaiter::Result::kOk);
+            EXPECT_EQ(string(buff, read_size), "partial");
+            is_done = true;
+        }
+    );
+
+    const char *pieces[] = { "hello\r\nwor", "ld\r\npar", "tial" };
+    int send_times = 0;
+    auto sp_timer = sp_loop->newTimerEvent();
+    SetScopeExitAction([sp_timer]{ delete sp_timer;});
+    sp_timer->initialize(chrono::milliseconds(10), Event::Mode::kPersist);
+    sp_timer->setCallback(
+        [&] {
+            auto p = pieces[send_times++];
+            EXPECT_EQ(write(fds[1], p, strlen(p)), static_cast<ssize_t>(strlen(p)));
+            if (send_times == 3)
+                sp_timer->disable();
+        }
+    );
+    sp_timer->enable();
+
+    sp_loop->exitLoop(chrono::milliseconds(200));
+    sp_loop->runLoop();
+    EXPECT_TRUE(is_done);
+}
+
+/**
+ * 协程把收到的每一行原样发回去，对端关闭写端后，协程收到 kClosed 退出
+ */
+TEST(StreamAwaiter, EchoUntilClosed)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    BufferedFd server_fd(sp_loop);
+    server_fd.initialize(fds[0]);
+    server_fd.enable();
+
+    BufferedFd client_fd(sp_loop);
+    client_fd.initialize(fds[1]);
+    client_fd.enable();
+
+    Scheduler sch(sp_loop);
+    StreamAwaiter io(sch, server_fd);
+
+    int echo_times = 0;
+    Awaiter::Result last_result = Awaiter::Result::kOk;
+    sch.create(
+        [&] (Scheduler &) {
+            string line;
+            for (;;) {
+                line.clear();
+                last_result = io.readUntil("\n", line);
+                if (last_result != Awaiter::Result::kOk)
+                    break;
+                EXPECT_EQ(io.write(line.data(), line.size()), Awaiter::Result::kOk);
+                ++echo_times;
+            }
+        }
+    );
+
+    string echo;
+    client_fd.setReceiveCallback(
+        [&] (Buffer &buff) {
+            echo.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+            if (echo == "a\nbb\nccc\n")
+                shutdown(fds[1], SHUT_WR);
+        }, 0
+    );
+    client_fd.send("a\nbb\n", 5);
+    client_fd.send("ccc\n", 4);
+
+    sp_loop->exitLoop(chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(echo, "a\nbb\nccc\n");
+    EXPECT_EQ(echo_times, 3);
+    EXPECT_EQ(last_result, Awaiter::Result::kClosed);
+}
+
+/**
+ * 本端已关闭写，发送直接出错，数据被丢弃，write() 要返回 kError 而不是一直等
+ */
+TEST(StreamAwaiter, WriteError)
+{
+    //! 向已关闭写的 socket 写会收到 SIGPIPE
+    auto old_handler = signal(SIGPIPE, SIG_IGN);
+    SetScopeExitAction([old_handler]{ signal(SIGPIPE, old_handler); });
+
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+    BufferedFd buffered_fd(sp_loop);
+    buffered_fd.initialize(fds[0]);
+    buffered_fd.enable();
+
+    Scheduler sch(sp_loop);
+    StreamAwaiter io(sch, buffered_fd);
+
+    shutdown(fds[0], SHUT_WR);
+
+    bool is_done = false;
+    sch.create(
+        [&] (Scheduler &) {
+            EXPECT_EQ(io.write("hello", 5), Awaiter::Result::kError);
+            EXPECT_EQ(io.write("hello", 5), Awaiter::Result::kError);
+            is_done = true;
+        }
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(100));
+    sp_loop->runLoop();
+    EXPECT_TRUE(is_done);
+}
+
+/**
+ * 对比同样的一问一答，对端都用回调实现，本端分别用回调与协程实现，
+ * 统计每一轮的耗时
+ */
+TEST(StreamAwaiter, Benchmark)
+{
+    const int kRounds = 20000;
+
+    for (int use_coroutine = 0; use_coroutine < 2; ++use_coroutine) {
+        Loop *sp_loop = Loop::New();
+        SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        SetScopeExitAction([fds]{ close(fds[0]); close(fds[1]); });
+
+        BufferedFd server_fd(sp_loop);
+        server_fd.initialize(fds[0]);
+        server_fd.enable();
+
+        BufferedFd client_fd(sp_loop);
+        client_fd.initialize(fds[1]);
+        client_fd.enable();
+
+        //! 对端：收到一行就回一行
+        client_fd.setReceiveCallback(
+            [&] (Buffer &buff) {
+                while (buff.readableSize() >= 5) {
+                    client_fd.send(buff.readableBegin(), 5);
+                    buff.hasRead(5);
+                }
+            }, 5
+        );
+
+        int rounds = 0;
+        chrono::steady_clock::time_point start_time;
+        auto onStart = [&] {
+            start_time = chrono::steady_clock::now();
+        };
+        auto onFinish = [&] {
+            auto cost = chrono::steady_clock::now() - start_time;
+            cout << (use_coroutine ? "coroutine" : "callback ")
+                 << ": " << chrono::duration_cast<chrono::nanoseconds>(cost).count() / kRounds << " ns/round" << endl;
+            sp_loop->exitLoop();
+        };
+
+        Scheduler sch(sp_loop);
+        StreamAwaiter io(sch, server_fd);
+
+        if (use_coroutine) {
+            sch.create(
+                [&] (Scheduler &) {
+                    string line;
+                    line.reserve(16);
+                    onStart();
+                    for (rounds = 0; rounds < kRounds; ++rounds) {
+                        io.write("ping\n", 5);
+                        line.clear();
+                        if (io.readUntil("\n", line) != Awaiter::Result::kOk)
+                            break;
+                    }
+                    onFinish();
+                }
+            );
+        } else {
+            server_fd.setReceiveCallback(
+                [&] (Buffer &buff) {
+                    while (buff.readableSize() >= 5) {
+                        buff.hasRead(5);
+                        if (++rounds == kRounds) {
+                            onFinish();
+                            return;
+                        }
+                        server_fd.send("ping\n", 5);
+                    }
+                }, 5
+            );
+            onStart();
+            server_fd.send("ping\n", 5);
+        }
+
+        sp_loop->exitLoop(chrono::seconds(10));
+        sp_loop->runLoop();
+        EXPECT_EQ(rounds, kRounds);
+    }
+}
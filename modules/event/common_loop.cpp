@@ -27,52 +27,70 @@
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/defines.h>
+#include <tbox/base/fast_clock.h>
 
 #include "fd_event.h"
 #include "stat.h"
 #include "misc.h"
 #include "timer_event.h"
+#include "timers/wheel.h"
 
 namespace tbox {
 namespace event {
 
 using namespace std::chrono;
 
+CommonLoop::CommonLoop()
+    : sp_timer_queue_(new WheelTimerQueue)
+{
+    //! eventfd 在构造时就创建，使 runInLoop() 在任何时刻都可以无锁地唤醒 Loop
+    run_event_fd_ = CreateEventFd();
+}
+
 CommonLoop::~CommonLoop()
 {
     TBOX_ASSERT(cb_level_ == 0);
     CHECK_DELETE_RESET_OBJ(sp_exit_timer_);
+    CHECK_DELETE_RESET_OBJ(sp_timer_queue_);
+
+    //! 释放还未被取出的任务
+    while (auto node = run_in_loop_node_queue_.pop())
+        delete node;
+
+    auto node = free_node_head_.exchange(nullptr);
+    while (node != nullptr) {
+        auto next = node->free_next;
+        delete node;
+        node = next;
+    }
+
+    CHECK_CLOSE_RESET_FD(run_event_fd_);
 }
 
 bool CommonLoop::isInLoopThread()
 {
-    std::lock_guard<std::recursive_mutex> g(lock_);
     return isInLoopThreadLockless();
 }
 
 bool CommonLoop::isRunning() const
 {
-    std::lock_guard<std::recursive_mutex> g(lock_);
     return isRunningLockless();
 }
 
 bool CommonLoop::isInLoopThreadLockless() const
 {
-    return std::this_thread::get_id() == loop_thread_id_;
+    return std::this_thread::get_id() == loop_thread_id_.load(std::memory_order_acquire);
 }
 
 bool CommonLoop::isRunningLockless() const
 {
-    return sp_run_read_event_ != nullptr;
+    return is_running_.load(std::memory_order_acquire);
 }
 
 void CommonLoop::runThisBeforeLoop()
 {
-    int event_fd = CreateEventFd();
-
     FdEvent *sp_read_event = newFdEvent("CommonLoop::sp_run_read_event_");
-    if (!sp_read_event->initialize(event_fd, FdEvent::kReadEvent, Event::Mode::kPersist)) {
-        close(event_fd);
+    if (!sp_read_event->initialize(run_event_fd_, FdEvent::kReadEvent, Event::Mode::kPersist)) {
         delete sp_read_event;
         return;
     }
@@ -81,37 +99,30 @@ void CommonLoop::runThisBeforeLoop()
     sp_read_event->setCallback(std::bind(&CommonLoop::handleRunInLoopFunc, this));
     sp_read_event->enable();
 
-    std::lock_guard<std::recursive_mutex> g(lock_);
-    loop_thread_id_ = std::this_thread::get_id();
-    run_event_fd_ = event_fd;
     sp_run_read_event_ = sp_read_event;
-
-    if (!run_in_loop_func_queue_.empty())
-        commitRunRequest();
+    loop_thread_id_.store(std::this_thread::get_id(), std::memory_order_release);
+    is_running_.store(true, std::memory_order_release);
 
     resetStat();
 }
 
 void CommonLoop::runThisAfterLoop()
 {
-    std::lock_guard<std::recursive_mutex> g(lock_);
     cleanupDeferredTasks();
 
-    loop_thread_id_ = std::thread::id();    //! 清空 loop_thread_id_
-    if (sp_run_read_event_ != nullptr) {
-        CHECK_DELETE_RESET_OBJ(sp_run_read_event_);
-        CHECK_CLOSE_RESET_FD(run_event_fd_);
-    }
+    is_running_.store(false, std::memory_order_release);
+    loop_thread_id_.store(std::thread::id(), std::memory_order_release);   //! 清空 loop_thread_id_
+    CHECK_DELETE_RESET_OBJ(sp_run_read_event_);
 }
 
 void CommonLoop::beginLoopProcess()
 {
-    loop_stat_start_ = steady_clock::now();
+    loop_stat_start_ = FastSteadyClock::now();
 }
 
 void CommonLoop::endLoopProcess()
 {
-    auto cost = steady_clock::now() - loop_stat_start_;
+    auto cost = FastSteadyClock::now() - loop_stat_start_;
     ++loop_count_;
     loop_acc_cost_ += cost;
     if (loop_peak_cost_ < cost)
@@ -123,12 +134,12 @@ void CommonLoop::endLoopProcess()
 
 void CommonLoop::beginEventProcess()
 {
-    event_cb_stat_start_ = steady_clock::now();
+    event_cb_stat_start_ = FastSteadyClock::now();
 }
 
 void CommonLoop::endEventProcess(Event *event)
 {
-    auto cost = steady_clock::now() - event_cb_stat_start_;
+    auto cost = FastSteadyClock::now() - event_cb_stat_start_;
     if (cost > water_line_.event_cb_cost)
         LogNotice("event_cb_cost: %" PRIu64 " us, what: '%s'",
                   cost.count()/1000, event->what().c_str());
@@ -138,7 +149,7 @@ Stat CommonLoop::getStat() const
 {
     Stat stat;
     using namespace std::chrono;
-    stat.stat_time_us = duration_cast<microseconds>(steady_clock::now() - whole_stat_start_).count();
+    stat.stat_time_us = duration_cast<microseconds>(FastSteadyClock::now() - whole_stat_start_).count();
 
     stat.loop_count = loop_count_;
     stat.loop_acc_cost_us = duration_cast<microseconds>(loop_acc_cost_).count();
@@ -152,7 +163,7 @@ Stat CommonLoop::getStat() const
 
 void CommonLoop::resetStat()
 {
-    whole_stat_start_ = loop_stat_start_ = steady_clock::now();
+    whole_stat_start_ = loop_stat_start_ = FastSteadyClock::now();
 
     loop_count_ = 0;
     loop_acc_cost_ = nanoseconds::zero();
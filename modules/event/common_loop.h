@@ -20,17 +20,22 @@
 #ifndef TBOX_EVENT_COMMON_LOOP_H_20170713
 #define TBOX_EVENT_COMMON_LOOP_H_20170713
 
-#include <deque>
+#include <vector>
 #include <mutex>
 #include <thread>
+#include <atomic>
 #include <map>
 #include <set>
+#include <memory>
 
+#include <tbox/base/defines.h>
 #include <tbox/base/cabinet.hpp>
 #include <tbox/base/object_pool.hpp>
+#include <tbox/base/mpsc_queue.hpp>
 
 #include "loop.h"
 #include "signal_event_impl.h"
+#include "timers/timer_queue.h"
 
 #include <chrono>
 
@@ -39,12 +44,23 @@ namespace event {
 
 class CommonLoop : public Loop {
   public:
+    explicit CommonLoop();
     virtual ~CommonLoop() override;
 
   public:
     virtual bool isInLoopThread() override;
     virtual bool isRunning() const override;
 
+    using Loop::runInLoop;
+    using Loop::runNext;
+    using Loop::run;
+
+    virtual RunId runInLoop(Func &&func, const char *what) override;
+    virtual RunId runInLoop(const Func &func, const char *what) override;
+    virtual RunId runNext(Func &&func, const char *what) override;
+    virtual RunId runNext(const Func &func, const char *what) override;
+    virtual RunId run(Func &&func, const char *what) override;
+    virtual RunId run(const Func &func, const char *what) override;
     virtual RunId runInLoop(Func &&func, const std::string &what) override;
     virtual RunId runInLoop(const Func &func, const std::string &what) override;
     virtual RunId runNext(Func &&func, const std::string &what) override;
@@ -77,11 +93,15 @@ class CommonLoop : public Loop {
 
     //! Timer 相关
     virtual TimerEvent* newTimerEvent(const std::string &what) override;
-    using TimerCallback = std::function<void()>;
-    cabinet::Token addTimer(uint64_t interval, uint64_t repeat, const TimerCallback &cb);
-    void deleteTimer(const cabinet::Token &token);
+    virtual bool setTimerEngine(const std::string &timer_engine) override;
+    virtual TimerToken addTimer(uint64_t interval, uint64_t repeat, TimerCallback &&cb) override;
+    virtual bool deleteTimer(const TimerToken &token) override;
 
   protected:
+    virtual RunId runInLoopFunc(RunFunc &&func, const char *what) override;
+    virtual RunId runNextFunc(RunFunc &&func, const char *what) override;
+    virtual RunId runFunc(RunFunc &&func, const char *what) override;
+
     bool isInLoopThreadLockless() const;
     bool isRunningLockless() const;
 
@@ -93,59 +113,91 @@ class CommonLoop : public Loop {
 
     void commitRunRequest();
     void finishRunRequest();
+    void collectRunInLoopFunc();
     void handleRunInLoopFunc();
     void handleNextFunc();
     bool hasNextFunc() const;
 
     void handleExpiredTimers();
+    //! 获取距离最近一个定时器到期的时长，单位 us，-1 表示无限等待
     int64_t getWaitTime() const;
 
     virtual void stopLoop() = 0;
 
   private:
-    struct Timer {
-        cabinet::Token token;
-        uint64_t interval = 0;
-        uint64_t expired = 0;
-        uint64_t repeat = 0;
+    //! 只能移动，不能复制，避免复制 func 时产生内存分配
+    struct RunFuncItem {
+        RunFuncItem(RunId id, RunFunc &&func, const char *what);
+        RunFuncItem(RunId id, RunFunc &&func, const std::string &what);
 
-        TimerCallback cb;
-    };
+        RunFuncItem(RunFuncItem &&) = default;
+        RunFuncItem& operator = (RunFuncItem &&) = default;
+        NONCOPYABLE(RunFuncItem);
 
-    struct TimerCmp {
-        bool operator()(const Timer *x, const Timer *y) const {
-            return x->expired > y->expired;
-        }
+        RunId id;
+        std::chrono::steady_clock::time_point commit_time_point;
+        RunFunc func;
+        const char *what;
+        /**
+         * 由 std::string 版本传入的 what 的拷贝，what 指向它的内容
+         * 放在堆上，移动时 what 仍有效；字面量版本只多一个空指针，入队出队不必搬动字符串
+         */
+        std::unique_ptr<std::string> what_str;
     };
 
-    struct RunFuncItem {
-        RunFuncItem(RunId id, Func &&func, const std::string &what);
+    /**
+     * 使用 vector 而不是 deque，配合 swap() 与 clear() 循环使用，
+     * 其容量只增不减，稳定运行后入队与出队都不再分配内存
+     */
+    using RunFuncQueue = std::vector<RunFuncItem>;
+
+    //! runInLoop() 投递到 MPSC 队列中的节点
+    struct RunInLoopNode : public MpscQueueNode {
+        explicit RunInLoopNode(RunFuncItem &&i) : item(std::move(i)) { }
+        RunFuncItem item;
+        RunInLoopNode *free_next = nullptr;     //!< 在回收链表中时使用
+    };
 
-        RunId id;
-        std::chrono::steady_clock::time_point commit_time_point;
-        Func func;
-        std::string what;
+    //! 每个线程的 RunInLoopNode 缓存链表，线程退出时释放
+    struct RunInLoopNodeCache {
+        ~RunInLoopNodeCache();
+        RunInLoopNode *head = nullptr;
     };
 
-    using RunFuncQueue = std::deque<RunFuncItem>;
+    static constexpr size_t kMaxFreeRunInLoopNodeNum = 1024;    //!< Loop 回收链表的节点数上限
+
+    RunInLoopNode* allocRunInLoopNode();
+    void freeRunInLoopNode(RunInLoopNode *node);
 
     RunId allocRunInLoopId();
     RunId allocRunNextId();
 
-    static bool RemoveRunFuncItemById(RunFuncQueue &run_deqeue, RunId run_id);
+    void commitRunInLoop(RunFuncItem &&item);
+    void commitRunNext(RunFuncItem &&item);
+
+    static bool RemoveRunFuncItemById(RunFuncQueue &run_queue, RunId run_id);
+    void runFuncQueue(RunFuncQueue &run_queue, const std::chrono::nanoseconds &delay_water_line, const char *delay_tag);
 
   private:
+    /**
+     * 仅用于保护消费一侧：从 run_in_loop_node_queue_ 中取出任务，以及访问
+     * run_in_loop_func_queue_。runInLoop() 的投递过程是无锁的。
+     */
     mutable std::recursive_mutex lock_;
-    std::thread::id loop_thread_id_;
+    std::atomic<std::thread::id> loop_thread_id_;
+    std::atomic_bool is_running_{false};
     int cb_level_ = 0;
 
     //! run 相关
-    bool has_commit_run_req_ = false;
+    std::atomic_bool has_commit_run_req_{false}; //! 为 true 表示 eventfd 已写入，还未被处理
     int run_event_fd_ = -1;
     FdEvent *sp_run_read_event_ = nullptr;
-    RunId run_in_loop_id_alloc_ = 0;    //! 偶数
+    std::atomic<RunId> run_in_loop_id_alloc_{0};  //! 偶数
     RunId run_next_id_alloc_ = 1;       //! 奇数
-    RunFuncQueue run_in_loop_func_queue_;
+    MpscQueue<RunInLoopNode> run_in_loop_node_queue_;   //! 其它线程投递进来的任务
+    std::atomic<RunInLoopNode*> free_node_head_{nullptr};   //! 执行完回收的节点，供 runInLoop() 复用
+    std::atomic<size_t> free_node_num_{0};
+    RunFuncQueue run_in_loop_func_queue_;   //! 已从 run_in_loop_node_queue_ 中取出，待执行的任务
     RunFuncQueue run_next_func_queue_;
     RunFuncQueue tmp_func_queue_;   //! 当前将要立即执行的任务队列
 
@@ -168,7 +220,7 @@ class CommonLoop : public Loop {
     //! Timer 相关
     TimerEvent *sp_exit_timer_ = nullptr;
     cabinet::Cabinet<Timer> timer_cabinet_;
-    std::vector<Timer*>     timer_min_heap_;
+    TimerQueue             *sp_timer_queue_;
     ObjectPool<Timer>       timer_object_pool_{64};
 
     //! 警告水位线
@@ -185,7 +237,7 @@ class CommonLoop : public Loop {
     };
 
     std::chrono::steady_clock::time_point event_cb_stat_start_;
-    std::chrono::steady_clock::time_point request_stat_start_;
+    std::atomic<int64_t> request_stat_start_ns_{0};  //! commitRunRequest() 的时间点
 
 };
 
@@ -0,0 +1,110 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+/**
+ * 统计 runNext() 的内存分配次数
+ *
+ * 这里替换了全局的 operator new，会影响同一个程序中的所有测试，
+ * 所以单独编译成 tbox_event_alloc_test，不与 tbox_event_test 放在一起。
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "loop.h"
+
+namespace {
+std::atomic<size_t> _new_times(0);
+}
+
+void* operator new(size_t size)
+{
+    ++_new_times;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+namespace tbox {
+namespace event {
+
+using namespace std;
+
+namespace {
+struct RunNextContext {
+    Loop *loop;
+    int counter;
+    int warmup_times;   //!< 预热的次数，之后才开始统计
+    int total_times;
+    size_t start_new_times;
+    size_t new_times;
+};
+
+void RunNextStep(RunNextContext *ctx)
+{
+    ++ctx->counter;
+    if (ctx->counter == ctx->warmup_times)
+        ctx->start_new_times = _new_times;
+
+    if (ctx->counter < ctx->total_times) {
+        //! 捕获 24 字节，超出了 std::function 的内部缓冲
+        auto loop = ctx->loop;
+        auto step = &RunNextStep;
+        loop->runNext([ctx, loop, step] { if (loop != nullptr) step(ctx); }, "RunNextStep");
+    } else {
+        ctx->new_times = _new_times - ctx->start_new_times;
+        ctx->loop->exitLoop();
+    }
+}
+}
+
+/**
+ * 任务中不断地 runNext() 下一个任务，预热之后，每次 runNext() 都不应分配内存
+ */
+TEST(CommonLoopAlloc, RunNextSteadyState)
+{
+    const int kWarmupTimes = 1000;
+    const int kTestTimes = 100000;
+
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        Loop *sp_loop = event::Loop::New(e);
+
+        RunNextContext ctx = { sp_loop, 0, kWarmupTimes, kWarmupTimes + kTestTimes, 0, 0 };
+        sp_loop->runNext([&ctx] { RunNextStep(&ctx); });
+        sp_loop->runLoop();
+
+        delete sp_loop;
+
+        EXPECT_EQ(ctx.counter, kWarmupTimes + kTestTimes);
+        EXPECT_EQ(ctx.new_times, 0u) << "engine: " << e;
+        cout << "engine: " << e << ", runNext: " << kTestTimes
+             << ", " << static_cast<double>(ctx.new_times) / kTestTimes << " new/op" << endl;
+    }
+}
+
+}
+}
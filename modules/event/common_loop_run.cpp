@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
+#include <tbox/base/fast_clock.h>
 #include <tbox/base/wrapped_recorder.h>
 
 namespace tbox {
@@ -31,20 +32,39 @@ namespace event {
 
 using namespace std::chrono;
 
-CommonLoop::RunFuncItem::RunFuncItem(RunId i, Func &&f, const std::string &w)
+CommonLoop::RunFuncItem::RunFuncItem(RunId i, RunFunc &&f, const char *w)
     : id(i)
-    , commit_time_point(steady_clock::now())
+    , commit_time_point(FastSteadyClock::now())
     , func(std::move(f))
     , what(w)
 { }
 
+CommonLoop::RunFuncItem::RunFuncItem(RunId i, RunFunc &&f, const std::string &w)
+    : id(i)
+    , commit_time_point(FastSteadyClock::now())
+    , func(std::move(f))
+    , what_str(new std::string(w))
+{
+    what = what_str->c_str();
+}
+
+CommonLoop::RunInLoopNodeCache::~RunInLoopNodeCache()
+{
+    while (head != nullptr) {
+        auto node = head;
+        head = node->free_next;
+        delete node;
+    }
+}
+
 Loop::RunId CommonLoop::allocRunInLoopId()
 {
-    run_in_loop_id_alloc_ += 2;
-    if (run_in_loop_id_alloc_ == 0) //! 确保分配到的ID一定不为0
-      run_in_loop_id_alloc_ += 2;
+    RunId run_id = 0;
+    do {
+        run_id = run_in_loop_id_alloc_.fetch_add(2, std::memory_order_relaxed) + 2;
+    } while (run_id == 0); //! 确保分配到的ID一定不为0
 
-    return run_in_loop_id_alloc_;
+    return run_id;
 }
 
 Loop::RunId CommonLoop::allocRunNextId()
@@ -53,24 +73,111 @@ Loop::RunId CommonLoop::allocRunNextId()
     return run_next_id_alloc_;
 }
 
-Loop::RunId CommonLoop::runInLoop(Func &&func, const std::string &what)
+/**
+ * 取一个回收的 RunInLoopNode，没有则返回 nullptr。可在任意线程调用
+ *
+ * 每个线程有自己的缓存链表，从中取节点不需要任何同步。缓存空了，才用一次
+ * exchange() 把 Loop 的回收链表整条取过来。因为只有整条取走，没有单个弹出，
+ * 所以不存在 ABA 问题。
+ */
+CommonLoop::RunInLoopNode* CommonLoop::allocRunInLoopNode()
 {
-    RECORD_SCOPE();
-    std::lock_guard<std::recursive_mutex> g(lock_);
+    static thread_local RunInLoopNodeCache cache;
+
+    if (cache.head == nullptr) {
+        cache.head = free_node_head_.exchange(nullptr, std::memory_order_acquire);
+        free_node_num_.store(0, std::memory_order_relaxed);
+    }
+
+    auto node = cache.head;
+    if (node != nullptr)
+        cache.head = node->free_next;
+    return node;
+}
+
+/**
+ * 将用完的 RunInLoopNode 放回 Loop 的回收链表，仅限消费者一侧调用
+ * 回收链表中的节点数有上限，超出的直接释放
+ */
+void CommonLoop::freeRunInLoopNode(RunInLoopNode *node)
+{
+    if (free_node_num_.load(std::memory_order_relaxed) >= kMaxFreeRunInLoopNodeNum) {
+        delete node;
+        return;
+    }
 
+    node->free_next = free_node_head_.load(std::memory_order_relaxed);
+    while (!free_node_head_.compare_exchange_weak(node->free_next, node,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed));
+    free_node_num_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CommonLoop::commitRunInLoop(RunFuncItem &&item)
+{
+    auto node = allocRunInLoopNode();
+    if (node != nullptr)
+        node->item = std::move(item);
+    else
+        node = new RunInLoopNode(std::move(item));
+
+    run_in_loop_node_queue_.push(node);
+    commitRunRequest();
+}
+
+void CommonLoop::commitRunNext(RunFuncItem &&item)
+{
+    run_next_func_queue_.emplace_back(std::move(item));
+
+    auto queue_size = run_next_func_queue_.size();
+    if (queue_size > water_line_.run_next_queue_size)
+        LogNotice("run_next_queue_size: %u", queue_size);
+
+    if (queue_size > run_next_peak_num_)
+        run_next_peak_num_ = queue_size;
+}
+
+Loop::RunId CommonLoop::runInLoopFunc(RunFunc &&func, const char *what)
+{
+    RECORD_SCOPE();
     RunId run_id = allocRunInLoopId();
-    run_in_loop_func_queue_.emplace_back(RunFuncItem(run_id, std::move(func), what));
+    commitRunInLoop(RunFuncItem(run_id, std::move(func), what));
+    return run_id;
+}
 
-    if (sp_run_read_event_ != nullptr)
-        commitRunRequest();
+Loop::RunId CommonLoop::runNextFunc(RunFunc &&func, const char *what)
+{
+    RECORD_SCOPE();
+    RunId run_id = allocRunNextId();
+    commitRunNext(RunFuncItem(run_id, std::move(func), what));
+    return run_id;
+}
 
-    auto queue_size = run_in_loop_func_queue_.size();
-    if (queue_size > water_line_.run_in_loop_queue_size)
-        LogNotice("run_in_loop_queue_size: %u", queue_size);
+Loop::RunId CommonLoop::runFunc(RunFunc &&func, const char *what)
+{
+    RECORD_SCOPE();
+    bool can_run_next = !isRunningLockless() || isInLoopThreadLockless();
+    if (can_run_next)
+        return runNextFunc(std::move(func), what);
+    else
+        return runInLoopFunc(std::move(func), what);
+}
 
-    if (queue_size > run_in_loop_peak_num_)
-        run_in_loop_peak_num_ = queue_size;
+Loop::RunId CommonLoop::runInLoop(Func &&func, const char *what)
+{
+    return runInLoopFunc(RunFunc(std::move(func)), what);
+}
+
+Loop::RunId CommonLoop::runInLoop(const Func &func, const char *what)
+{
+    return runInLoopFunc(RunFunc(func), what);
+}
 
+Loop::RunId CommonLoop::runInLoop(Func &&func, const std::string &what)
+{
+    RECORD_SCOPE();
+    RunId run_id = allocRunInLoopId();
+    commitRunInLoop(RunFuncItem(run_id, RunFunc(std::move(func)), what));
     return run_id;
 }
 
@@ -80,19 +187,21 @@ Loop::RunId CommonLoop::runInLoop(const Func &func, const std::string &what)
     return runInLoop(std::move(func_copy), what);
 }
 
+Loop::RunId CommonLoop::runNext(Func &&func, const char *what)
+{
+    return runNextFunc(RunFunc(std::move(func)), what);
+}
+
+Loop::RunId CommonLoop::runNext(const Func &func, const char *what)
+{
+    return runNextFunc(RunFunc(func), what);
+}
+
 Loop::RunId CommonLoop::runNext(Func &&func, const std::string &what)
 {
     RECORD_SCOPE();
     RunId run_id = allocRunNextId();
-    run_next_func_queue_.emplace_back(RunFuncItem(run_id, std::move(func), what));
-
-    auto queue_size = run_next_func_queue_.size();
-    if (queue_size > water_line_.run_next_queue_size)
-        LogNotice("run_next_queue_size: %u", queue_size);
-
-    if (queue_size > run_next_peak_num_)
-        run_next_peak_num_ = queue_size;
-
+    commitRunNext(RunFuncItem(run_id, RunFunc(std::move(func)), what));
     return run_id;
 }
 
@@ -102,16 +211,20 @@ Loop::RunId CommonLoop::runNext(const Func &func, const std::string &what)
     return runNext(std::move(func_copy), what);
 }
 
+Loop::RunId CommonLoop::run(Func &&func, const char *what)
+{
+    return runFunc(RunFunc(std::move(func)), what);
+}
+
+Loop::RunId CommonLoop::run(const Func &func, const char *what)
+{
+    return runFunc(RunFunc(func), what);
+}
+
 Loop::RunId CommonLoop::run(Func &&func, const std::string &what)
 {
     RECORD_SCOPE();
-    bool can_run_next = true;
-    {
-        std::lock_guard<std::recursive_mutex> g(lock_);
-        if (isRunningLockless() && !isInLoopThreadLockless())
-            can_run_next = false;
-    }
-
+    bool can_run_next = !isRunningLockless() || isInLoopThreadLockless();
     if (can_run_next)
         return runNext(std::move(func), what);
     else
@@ -125,14 +238,14 @@ Loop::RunId CommonLoop::run(const Func &func, const std::string &what)
 }
 
 //! 从队列中删除指定run_id的项
-bool CommonLoop::RemoveRunFuncItemById(RunFuncQueue &run_deqeue, RunId run_id)
+bool CommonLoop::RemoveRunFuncItemById(RunFuncQueue &run_queue, RunId run_id)
 {
     auto is_run_id_match = [run_id] (RunFuncItem &item) { return item.id == run_id; };
 
-    auto end_iter = run_deqeue.end();
-    auto iter = std::remove_if(run_deqeue.begin(), end_iter, is_run_id_match);
+    auto end_iter = run_queue.end();
+    auto iter = std::remove_if(run_queue.begin(), end_iter, is_run_id_match);
     if (iter != end_iter) {
-        run_deqeue.erase(iter, end_iter);
+        run_queue.erase(iter, end_iter);
         return true;
     }
     return false;
@@ -143,14 +256,23 @@ bool CommonLoop::cancel(RunId run_id)
     if (run_id == 0)
         return false;
 
-    //! 先从正在执行的任务队列里删
-    if (RemoveRunFuncItemById(tmp_func_queue_, run_id))
-        return true;
+    /**
+     * 先从正在执行的任务队列里找。由于 runFuncQueue() 正在按下标遍历它，
+     * 所以这里不能删除元素，只能将其标记为已取消
+     */
+    for (auto &item : tmp_func_queue_) {
+        if (item.id == run_id) {
+            item.id = 0;
+            item.func = nullptr;
+            return true;
+        }
+    }
 
     if (run_id & 1) {   //! 奇数为runNext()的任务
         return RemoveRunFuncItemById(run_next_func_queue_, run_id);
     } else {    //! 偶数为runInLoop()的任务
         std::lock_guard<std::recursive_mutex> g(lock_);
+        collectRunInLoopFunc();
         return RemoveRunFuncItemById(run_in_loop_func_queue_, run_id);
     }
 }
@@ -170,29 +292,7 @@ void CommonLoop::handleNextFunc()
      * 的任务也可以被cancel。
      */
     run_next_func_queue_.swap(tmp_func_queue_);
-
-    while (!tmp_func_queue_.empty()) {
-        auto item = tmp_func_queue_.front();
-        tmp_func_queue_.pop_front();
-
-        auto now = steady_clock::now();
-        auto delay = now - item.commit_time_point;
-        if (delay > water_line_.run_next_delay)
-            LogNotice("run_next_delay: %" PRIu64 " us, what: '%s'",
-                      delay.count()/1000, item.what.c_str());
-
-        if (item.func) {
-            RECORD_SCOPE();
-            ++cb_level_;
-            item.func();
-            --cb_level_;
-        }
-
-        auto cost = steady_clock::now() - now;
-        if (cost > water_line_.run_cb_cost)
-            LogNotice("run_cb_cost: %" PRIu64 " us, what: '%s'",
-                      cost.count()/1000, item.what.c_str());
-    }
+    runFuncQueue(tmp_func_queue_, water_line_.run_next_delay, "run_next_delay");
 }
 
 bool CommonLoop::hasNextFunc() const
@@ -200,102 +300,152 @@ bool CommonLoop::hasNextFunc() const
     return !run_next_func_queue_.empty();
 }
 
+/**
+ * 将 run_in_loop_node_queue_ 中的任务全部取出，转存到 run_in_loop_func_queue_ 中
+ * 调用者需持有 lock_，以保证同一时刻只有一个消费者
+ */
+void CommonLoop::collectRunInLoopFunc()
+{
+    bool has_new = false;
+    while (auto node = run_in_loop_node_queue_.pop()) {
+        run_in_loop_func_queue_.emplace_back(std::move(node->item));
+        freeRunInLoopNode(node);
+        has_new = true;
+    }
+
+    if (!has_new)
+        return;
+
+    auto queue_size = run_in_loop_func_queue_.size();
+    if (queue_size > water_line_.run_in_loop_queue_size)
+        LogNotice("run_in_loop_queue_size: %u", queue_size);
+
+    if (queue_size > run_in_loop_peak_num_)
+        run_in_loop_peak_num_ = queue_size;
+}
+
 void CommonLoop::handleRunInLoopFunc()
 {
     RECORD_SCOPE();
+    /**
+     * 必须先清除 has_commit_run_req_ 再取任务。这样在清除之后才 push 的生产者一
+     * 定会重新写 eventfd；而在清除之前就 push 完成的任务一定能在本次被取到。
+     */
+    finishRunRequest();
     {
         //! 同handleNextFunc()的说明
         std::lock_guard<std::recursive_mutex> g(lock_);
+        collectRunInLoopFunc();
         run_in_loop_func_queue_.swap(tmp_func_queue_);
-        finishRunRequest();
     }
 
-    while (!tmp_func_queue_.empty()) {
-        auto item = tmp_func_queue_.front();
-        tmp_func_queue_.pop_front();
-
-        auto now = steady_clock::now();
-        auto delay = now - item.commit_time_point;
-        if (delay > water_line_.run_in_loop_delay)
-            LogNotice("run_in_loop_delay: %" PRIu64 " us, what: '%s'",
-                      delay.count()/1000, item.what.c_str());
+    runFuncQueue(tmp_func_queue_, water_line_.run_in_loop_delay, "run_in_loop_delay");
+}
 
-        if (item.func) {
+//! 逐一执行 run_queue 中的任务，执行完后清空 run_queue，但保留其容量
+void CommonLoop::runFuncQueue(RunFuncQueue &run_queue, const nanoseconds &delay_water_line, const char *delay_tag)
+{
+    //! 执行过程中 run_queue 可能因 cancel() 而被修改，所以要每次都重新取 size()，并且不能持有元素的引用
+    for (size_t i = 0; i < run_queue.size(); ++i) {
+        if (!run_queue[i].func)
+            continue;
+
+        //! 先将 func 移出，防止任务在执行过程中 cancel() 自己导致 func 被析构
+        RunFunc func = std::move(run_queue[i].func);
+        auto what_str = std::move(run_queue[i].what_str);   //! 持有它，what 才一直有效
+        const char *what = run_queue[i].what;
+        auto commit_time_point = run_queue[i].commit_time_point;
+        run_queue[i].id = 0;
+
+        auto now = FastSteadyClock::now();
+        auto delay = now - commit_time_point;
+        if (delay > delay_water_line)
+            LogNotice("%s: %" PRIu64 " us, what: '%s'", delay_tag, delay.count()/1000, what);
+
+        {
             RECORD_SCOPE();
             ++cb_level_;
-            item.func();
+            func();
             --cb_level_;
         }
 
-        auto cost = steady_clock::now() - now;
+        auto cost = FastSteadyClock::now() - now;
         if (cost > water_line_.run_cb_cost)
-            LogNotice("run_cb_cost: %" PRIu64 " us, what: '%s'",
-                      cost.count()/1000, item.what.c_str());
+            LogNotice("run_cb_cost: %" PRIu64 " us, what: '%s'", cost.count()/1000, what);
     }
+    run_queue.clear();
 }
 
 //! 清理 run_in_loop_func_queue_ 与 run_next_func_queue_ 中的任务
 void CommonLoop::cleanupDeferredTasks()
 {
     int remain_loop_count = 100; //! 限定次数，防止出现 runNext() 递归导致无法退出循环的问题
-    while ((!run_in_loop_func_queue_.empty() || !run_next_func_queue_.empty()) && remain_loop_count-- > 0) {
+    while (remain_loop_count-- > 0) {
+        RunFuncQueue run_in_loop_tasks;
+        {
+            std::lock_guard<std::recursive_mutex> g(lock_);
+            collectRunInLoopFunc();
+            run_in_loop_tasks = std::move(run_in_loop_func_queue_);
+            run_in_loop_func_queue_.clear();
+        }
+
+        if (run_in_loop_tasks.empty() && run_next_func_queue_.empty())
+            break;
 
         RunFuncQueue run_next_tasks = std::move(run_next_func_queue_);
-        RunFuncQueue run_in_loop_tasks = std::move(run_in_loop_func_queue_);
+        run_next_func_queue_.clear();
 
-        while (!run_next_tasks.empty()) {
-            RunFuncItem &item = run_next_tasks.front();
+        for (auto &item : run_next_tasks) {
             if (item.func) {
                 RECORD_SCOPE();
                 ++cb_level_;
                 item.func();
                 --cb_level_;
             }
-            run_next_tasks.pop_front();
         }
 
-        while (!run_in_loop_tasks.empty()) {
-            RunFuncItem &item = run_in_loop_tasks.front();
+        for (auto &item : run_in_loop_tasks) {
             if (item.func) {
                 RECORD_SCOPE();
                 ++cb_level_;
                 item.func();
                 --cb_level_;
             }
-            run_in_loop_tasks.pop_front();
         }
     }
 
-    if (remain_loop_count == 0)
+    if (remain_loop_count < 0)
         LogWarn("found recursive actions, force quit");
 }
 
 void CommonLoop::commitRunRequest()
 {
     RECORD_SCOPE();
-    if (!has_commit_run_req_) {
+    //! 合并唤醒：只有 finishRunRequest() 之后的第一个提交者才需要写 eventfd
+    if (!has_commit_run_req_.exchange(true, std::memory_order_acq_rel)) {
+        auto now_ns = duration_cast<nanoseconds>(FastSteadyClock::now().time_since_epoch()).count();
+        request_stat_start_ns_.store(now_ns, std::memory_order_relaxed);
+
         uint64_t one = 1;
         ssize_t wsize = write(run_event_fd_, &one, sizeof(one));
         if (wsize != sizeof(one))
             LogErr("write error");
-
-        has_commit_run_req_ = true;
-        request_stat_start_ = steady_clock::now();
     }
 }
 
 void CommonLoop::finishRunRequest()
 {
-    auto delay = loop_stat_start_ - request_stat_start_;
-    if (delay > water_line_.wake_delay)
-        LogNotice("wake_delay: %" PRIu64 " us", delay.count()/1000);
-
     uint64_t one = 1;
     ssize_t rsize = read(run_event_fd_, &one, sizeof(one));
     if (rsize != sizeof(one))
         LogErr("read error");
 
-    has_commit_run_req_ = false;
+    steady_clock::time_point request_time_point(nanoseconds(request_stat_start_ns_.load(std::memory_order_relaxed)));
+    has_commit_run_req_.exchange(false, std::memory_order_acq_rel);
+
+    auto delay = loop_stat_start_ - request_time_point;
+    if (delay > water_line_.wake_delay)
+        LogNotice("wake_delay: %" PRIu64 " us", delay.count()/1000);
 }
 
 }
@@ -19,6 +19,7 @@
  */
 #include <gtest/gtest.h>
 #include <thread>
+#include <atomic>
 
 #include "loop.h"
 #include "timer_event.h"
@@ -499,6 +500,36 @@ TEST(CommonLoop, cleanupDeferedTask1)
     }
 }
 
+/**
+ * what 以临时的 std::string 传入，在任务执行前就已析构，
+ * 将延时水位线设为 0 使其在执行时被打印出来
+ */
+TEST(CommonLoop, runWithStringWhat)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+        Loop *sp_loop = event::Loop::New(e);
+        SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+        sp_loop->water_line().run_in_loop_delay = std::chrono::nanoseconds::zero();
+        sp_loop->water_line().run_next_delay = std::chrono::nanoseconds::zero();
+
+        int run_count = 0;
+        for (int i = 0; i < 3; ++i) {
+            std::string what = "task_" + std::to_string(i) + "_with_a_long_name_to_avoid_sso";
+            sp_loop->runInLoop([&] { ++run_count; }, what);
+            sp_loop->runNext([&] { ++run_count; }, what + "_next");
+            sp_loop->run([&] { ++run_count; }, what + "_run");
+        }
+
+        sp_loop->exitLoop(std::chrono::milliseconds(10));
+        sp_loop->runLoop();
+
+        EXPECT_EQ(run_count, 9);
+    }
+}
+
 TEST(CommonLoop, RunInLoopBenchmark)
 {
     auto engines = Loop::Engines();
@@ -565,6 +596,130 @@ TEST(CommonLoop, RunBenchmark)
     }
 }
 
+/**
+ * 多个线程同时向Loop委派任务，测试 runInLoop() 的吞吐量
+ *
+ * 注意：在单核机器上，生产者之间没有真正的锁竞争，无锁的 MPSC 队列并不能提升吞吐。
+ * 它每个任务比加锁的队列多几次原子操作，还要把任务从节点搬到执行队列，吞吐反而更低。
+ * 它的收益在于多核上多个生产者不再争同一把锁。
+ */
+TEST(CommonLoop, RunInLoopMultiProducerBenchmark)
+{
+    const int kTaskNumPerThread = 100000;
+
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        for (int thread_num : { 1, 4, 16 }) {
+            Loop *sp_loop = event::Loop::New(e);
+
+            const int total_num = thread_num * kTaskNumPerThread;
+            int counter = 0;
+            auto func = [&] {
+                if (++counter == total_num)
+                    sp_loop->exitLoop();
+            };
+
+            auto start_time = steady_clock::now();
+
+            vector<thread> threads;
+            for (int i = 0; i < thread_num; ++i) {
+                threads.emplace_back(
+                    [&] {
+                        for (int j = 0; j < kTaskNumPerThread; ++j)
+                            sp_loop->runInLoop(func);
+                    }
+                );
+            }
+
+            sp_loop->runLoop();
+            auto cost = steady_clock::now() - start_time;
+
+            for (auto &t : threads)
+                t.join();
+
+            delete sp_loop;
+
+            EXPECT_EQ(counter, total_num);
+            cout << "engine: " << e << ", threads: " << thread_num
+                 << ", tasks: " << total_num
+                 << ", cost: " << duration_cast<milliseconds>(cost).count() << " ms"
+                 << ", " << total_num * 1000 / (duration_cast<microseconds>(cost).count() + 1) << " K/s"
+                 << endl;
+        }
+    }
+}
+
+namespace {
+struct RunNextBenchmarkContext {
+    Loop *loop;
+    int counter;
+    int total_times;
+};
+
+void RunNextBenchmarkStep(RunNextBenchmarkContext *ctx)
+{
+    if (++ctx->counter < ctx->total_times)
+        ctx->loop->runNext([ctx] { RunNextBenchmarkStep(ctx); }, "RunNextBenchmarkStep");
+    else
+        ctx->loop->exitLoop();
+}
+}
+
+/**
+ * 任务中不断地 runNext() 下一个任务，统计稳定运行后每次 runNext() 的耗时
+ * 内存分配次数的检查见 common_loop_alloc_test.cpp
+ */
+TEST(CommonLoop, RunNextSteadyBenchmark)
+{
+    const int kTestTimes = 1000000;
+
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        Loop *sp_loop = event::Loop::New(e);
+
+        RunNextBenchmarkContext ctx = { sp_loop, 0, kTestTimes };
+        sp_loop->runNext([&ctx] { RunNextBenchmarkStep(&ctx); });
+
+        auto start_time = steady_clock::now();
+        sp_loop->runLoop();
+        auto cost = steady_clock::now() - start_time;
+
+        delete sp_loop;
+
+        EXPECT_EQ(ctx.counter, kTestTimes);
+        cout << "engine: " << e << ", runNext: " << kTestTimes
+             << ", " << duration_cast<nanoseconds>(cost).count() / kTestTimes << " ns/op"
+             << endl;
+    }
+}
+
+/**
+ * lambda 捕获的内容超出 std::function 的内部缓冲，但在 RunFunc 的内置缓冲之内
+ */
+TEST(CommonLoop, RunLargeCaptureLambda)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+        Loop *sp_loop = event::Loop::New(e);
+        SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+        int sum = 0;
+        int a = 1, b = 2, c = 3, d = 4;
+        sp_loop->runInLoop([&sum, a, b, c, d] { sum += a + b + c + d; }, "large_capture");
+        sp_loop->runNext([&sum, a, b, c, d] { sum += a + b + c + d; });
+        sp_loop->run([&sum, a, b, c, d] { sum += a + b + c + d; });
+
+        std::thread t([&] { sp_loop->runInLoop([&sum, a, b, c, d] { sum += a + b + c + d; }); });
+        t.join();
+
+        sp_loop->exitLoop(std::chrono::milliseconds(10));
+        sp_loop->runLoop();
+
+        EXPECT_EQ(sum, 40);
+    }
+}
+
 //! 测试取消runNext()委托的任务
 TEST(CommonLoop, CancelRunNext)
 {
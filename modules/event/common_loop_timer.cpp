@@ -20,19 +20,22 @@
 #include "common_loop.h"
 
 #include <algorithm>
+#include <cinttypes>
 #include <tbox/base/defines.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/wrapped_recorder.h>
 
 #include "timer_event_impl.h"
+#include "timers/heap.h"
+#include "timers/wheel.h"
 
 namespace tbox {
 namespace event {
 
 namespace {
-uint64_t GetCurrentSteadyClockMilliseconds()
+uint64_t GetCurrentSteadyClockMicroseconds()
 {
-    return std::chrono::duration_cast<std::chrono::milliseconds> \
+    return std::chrono::duration_cast<std::chrono::microseconds> \
         (std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 }
@@ -42,52 +45,35 @@ int64_t CommonLoop::getWaitTime() const
     if (hasNextFunc())
         return 0;
 
-    /// Get the top of minimum heap
-    int64_t wait_time = -1;
-    if (!timer_min_heap_.empty()) {
-        wait_time = timer_min_heap_.front()->expired - GetCurrentSteadyClockMilliseconds();
-        if (wait_time < 0) //! If expired is little than now, then we consider this timer invalid and trigger it immediately.
-            wait_time = 0;
-    }
-
-    return wait_time;
+    return sp_timer_queue_->getWaitTime(GetCurrentSteadyClockMicroseconds());
 }
 
 void CommonLoop::handleExpiredTimers()
 {
     RECORD_SCOPE();
 
-    auto now = GetCurrentSteadyClockMilliseconds();
-
-    while (!timer_min_heap_.empty()) {
-        auto t = timer_min_heap_.front();
-        //TBOX_ASSERT(t != nullptr);
-
-        if (now < t->expired)
-            break;
+    auto now = GetCurrentSteadyClockMicroseconds();
 
-        int delay_ms = now - t->expired;
-        if (delay_ms > (water_line_.timer_delay.count() / 1000000))
-            LogNotice("timer delay over waterline: %d ms", delay_ms);
+    Timer *t = nullptr;
+    while ((t = sp_timer_queue_->popExpired(now)) != nullptr) {
+        uint64_t delay_us = now - t->expired;
+        if (delay_us > static_cast<uint64_t>(water_line_.timer_delay.count() / 1000))
+            LogNotice("timer delay over waterline: %" PRIu64 " us", delay_us);
 
         auto tobe_run = t->cb;
 
-        // swap first element and last element
-        std::pop_heap(timer_min_heap_.begin(), timer_min_heap_.end(), TimerCmp());
         if (UNLIKELY(t->repeat == 1)) {
-            // remove the last element
-            timer_min_heap_.pop_back();
             timer_cabinet_.free(t->token);
             timer_object_pool_.free(t);
         } else {
             t->expired += t->interval;
-            // push the last element to heap again
-            std::push_heap(timer_min_heap_.begin(), timer_min_heap_.end(), TimerCmp());
+            // push it to the queue again
+            sp_timer_queue_->push(t, now);
             if (LIKELY(t->repeat != 0))
                 --t->repeat;
         }
 
-        //! Q: 为什么不在L68执行？
+        //! Q: 为什么不在取出定时器后立即执行？
         //! A: 因为要尽可能地将回调放到最后执行。否则不满足测试 TEST(TimerEvent, DisableSelfInCallback)
         if (LIKELY(tobe_run)) {
             RECORD_SCOPE();
@@ -115,11 +101,11 @@ void CommonLoop::exitLoop(const std::chrono::milliseconds &wait_time)
     }
 }
 
-cabinet::Token CommonLoop::addTimer(uint64_t interval, uint64_t repeat, const TimerCallback &cb)
+Loop::TimerToken CommonLoop::addTimer(uint64_t interval, uint64_t repeat, TimerCallback &&cb)
 {
     TBOX_ASSERT(cb);
 
-    auto now = GetCurrentSteadyClockMilliseconds();
+    auto now = GetCurrentSteadyClockMicroseconds();
 
     Timer *t = timer_object_pool_.alloc();
     TBOX_ASSERT(t != nullptr);
@@ -128,34 +114,24 @@ cabinet::Token CommonLoop::addTimer(uint64_t interval, uint64_t repeat, const Ti
 
     t->expired = now + interval;
     t->interval = interval;
-    t->cb = cb;
+    t->cb = std::move(cb);
     t->repeat = repeat;
 
-    timer_min_heap_.push_back(t);
-    std::push_heap(timer_min_heap_.begin(), timer_min_heap_.end(), TimerCmp());
+    sp_timer_queue_->push(t, now);
 
     return t->token;
 }
 
-void CommonLoop::deleteTimer(const cabinet::Token& token)
+bool CommonLoop::deleteTimer(const TimerToken &token)
 {
     auto timer = timer_cabinet_.free(token);
     if (timer == nullptr)
-        return;
-
-#if 0
-    timer_min_heap_.erase(timer);
-    std::make_heap(timer_min_heap_.begin(), timer_min_heap_.end(), TimerCmp());
-#else
-    //! If we use the above method, it is likely to disrupt order, leading to a wide range of exchanges.
-    //! This method will be a little better.
-    timer->expired = 0;
-    std::make_heap(timer_min_heap_.begin(), timer_min_heap_.end(), TimerCmp());
-    std::pop_heap(timer_min_heap_.begin(), timer_min_heap_.end(), TimerCmp());
-    timer_min_heap_.pop_back();
-#endif
+        return false;
+
+    sp_timer_queue_->erase(timer);
 
     run([this, timer] { timer_object_pool_.free(timer); }, __func__); //! Delete later, avoid delete itself
+    return true;
 }
 
 TimerEvent* CommonLoop::newTimerEvent(const std::string &what)
@@ -163,5 +139,28 @@ TimerEvent* CommonLoop::newTimerEvent(const std::string &what)
     return new TimerEventImpl(this, what);
 }
 
+bool CommonLoop::setTimerEngine(const std::string &timer_engine)
+{
+    TimerQueue *new_timer_queue = nullptr;
+    if (timer_engine == "heap")
+        new_timer_queue = new HeapTimerQueue;
+    else if (timer_engine == "wheel")
+        new_timer_queue = new WheelTimerQueue;
+    else
+        return false;
+
+    //! 将已有的定时器迁移到新的队列中
+    std::vector<Timer*> timers;
+    sp_timer_queue_->takeAll(timers);
+
+    auto now = GetCurrentSteadyClockMicroseconds();
+    for (auto t : timers)
+        new_timer_queue->push(t, now);
+
+    delete sp_timer_queue_;
+    sp_timer_queue_ = new_timer_queue;
+    return true;
+}
+
 }
 }
@@ -19,6 +19,8 @@
  */
 #include <algorithm>
 #include <vector>
+#include <cstring>
+#include <errno.h>
 
 #include "fd_event.h"
 #include "loop.h"
@@ -79,6 +81,13 @@ bool EpollFdEvent::enable()
     if (events_ & kExceptEvent)
         ++d_->except_event_num;
 
+    if (events_ & kEdgeTriggered)
+        ++d_->et_event_num;
+
+    if (events_ & kExclusive)
+        ++d_->exclusive_event_num;
+
+    ++d_->enabled_event_num;
     d_->fd_events.push_back(this);
 
     reloadEpoll();
@@ -101,8 +110,20 @@ bool EpollFdEvent::disable()
     if (events_ & kExceptEvent)
         --d_->except_event_num;
 
+    if (events_ & kEdgeTriggered)
+        --d_->et_event_num;
+
+    if (events_ & kExclusive)
+        --d_->exclusive_event_num;
+
+    --d_->enabled_event_num;
     auto iter = std::find(d_->fd_events.begin(), d_->fd_events.end(), this);
-    d_->fd_events.erase(iter);
+    if (d_->dispatch_level > 0) {
+        *iter = nullptr;
+        d_->has_removed = true;
+    } else {
+        d_->fd_events.erase(iter);
+    }
 
     reloadEpoll();
 
@@ -130,17 +151,45 @@ void EpollFdEvent::reloadEpoll()
     if (d_->except_event_num > 0)
         new_events |= EPOLLERR;
 
-    d_->ev.events = new_events;
+    if (new_events != 0) {
+        //! 只要有一个 FdEvent 是水平触发的，就不能用边沿触发，否则它会漏掉事件
+        if (d_->et_event_num == d_->enabled_event_num)
+            new_events |= EPOLLET;
+#ifdef EPOLLEXCLUSIVE
+        if (d_->exclusive_event_num > 0)
+            new_events |= EPOLLEXCLUSIVE;
+#endif
+    }
 
-    if (old_events == 0) {
-        if (LIKELY(new_events != 0))
-            epoll_ctl(wp_loop_->epollFd(), EPOLL_CTL_ADD, fd_, &d_->ev);
-    } else {
-        if (new_events != 0)
-            epoll_ctl(wp_loop_->epollFd(), EPOLL_CTL_MOD, fd_, &d_->ev);
-        else
-            epoll_ctl(wp_loop_->epollFd(), EPOLL_CTL_DEL, fd_, nullptr);
+    //! 与已注册的一致，就不需要再调 epoll_ctl() 了
+    if (new_events == old_events)
+        return;
+
+    //! d_->ev.events 记录的是已注册成功的事件，epoll_ctl() 成功后才更新
+    struct epoll_event ev = d_->ev;
+    ev.events = new_events;
+
+    int op = EPOLL_CTL_MOD;
+    if (old_events == 0)
+        op = EPOLL_CTL_ADD;
+    else if (new_events == 0)
+        op = EPOLL_CTL_DEL;
+
+#ifdef EPOLLEXCLUSIVE
+    //! 带 EPOLLEXCLUSIVE 的注册不能 EPOLL_CTL_MOD，只能先删除再重新添加
+    if (op == EPOLL_CTL_MOD && ((old_events | new_events) & EPOLLEXCLUSIVE)) {
+        epoll_ctl(wp_loop_->epollFd(), EPOLL_CTL_DEL, fd_, nullptr);
+        d_->ev.events = 0;
+        op = EPOLL_CTL_ADD;
     }
+#endif
+
+    int ret = epoll_ctl(wp_loop_->epollFd(), op, fd_, (op == EPOLL_CTL_DEL) ? nullptr : &ev);
+    //! fd 先于 FdEvent 被关闭时 EPOLL_CTL_DEL 会失败，这是正常的，不必警告，它也已经不在 epoll 中了
+    if (ret == 0 || op == EPOLL_CTL_DEL)
+        d_->ev.events = new_events;
+    else
+        LogWarn("epoll_ctl fail, fd:%d, op:%d, errno:%d, %s", fd_, op, errno, strerror(errno));
 }
 
 void EpollFdEvent::OnEventCallback(uint32_t events, void *obj)
@@ -174,15 +223,38 @@ void EpollFdEvent::OnEventCallback(uint32_t events, void *obj)
         tbox_events |= kReadEvent;
     }
 
-    //! 要先复制一份，因为在for中很可能会改动到d->fd_events，引起迭代器失效问题
-    auto tmp = d->fd_events;
-    for (auto event : tmp)
-        event->onEvent(tbox_events);
+    DispatchEvents(d, tbox_events);
 
     if (events)
         LogWarn("unhandle events:%08X, fd:%d", events, d->fd);
 }
 
+/**
+ * 回调中很可能会 enable() 或 disable() 同一个fd上的 FdEvent，改动到 d->fd_events
+ * 为了不在每次分发时都复制一份 d->fd_events，这里：
+ * - 只分发进入时已有的 FdEvent，并按下标访问，在回调中新 enable() 的下一次才触发；
+ * - 在回调中 disable() 的，只会被置为 nullptr，在此跳过，分发完成后再统一清除。
+ */
+void EpollFdEvent::DispatchEvents(EpollFdSharedData *d, short events)
+{
+    ++d->dispatch_level;
+
+    auto num = d->fd_events.size();
+    for (size_t i = 0; i < num; ++i) {
+        auto event = d->fd_events[i];
+        if (event != nullptr)
+            event->onEvent(events);
+    }
+
+    --d->dispatch_level;
+
+    if (d->dispatch_level == 0 && d->has_removed) {
+        auto &fd_events = d->fd_events;
+        fd_events.erase(std::remove(fd_events.begin(), fd_events.end(), nullptr), fd_events.end());
+        d->has_removed = false;
+    }
+}
+
 void EpollFdEvent::onEvent(short events)
 {
     if (events_ & events) {
@@ -45,6 +45,7 @@ class EpollFdEvent : public FdEvent {
 
   public:
     static void OnEventCallback(uint32_t events, void *obj);
+    static void DispatchEvents(EpollFdSharedData *d, short events);
 
   protected:
     void reloadEpoll();
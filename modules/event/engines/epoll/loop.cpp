@@ -19,6 +19,7 @@
  */
 #include <sys/epoll.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include <cstdint>
 #include <cstring>
@@ -70,17 +71,20 @@ void EpollLoop::runLoop(Mode mode)
 
     keep_running_ = (mode == Loop::Mode::kForever);
     do {
-        int fds = epoll_wait(epoll_fd_, events.data(), events.size(), getWaitTime());
+        int fds = waitEvents(events);
 
         RECORD_SCOPE();
         beginLoopProcess();
 
         handleExpiredTimers();
 
+        is_dispatching_ = true;
         for (int i = 0; i < fds; ++i) {
             epoll_event &ev = events.at(i);
             EpollFdEvent::OnEventCallback(ev.events, ev.data.ptr);
         }
+        is_dispatching_ = false;
+        freeUnrefFdSharedData();
 
         //handleRunInLoopFunc();
         handleNextFunc();
@@ -100,6 +104,34 @@ void EpollLoop::runLoop(Mode mode)
     RECORD_EVENT();
 }
 
+int EpollLoop::waitEvents(std::vector<struct epoll_event> &events)
+{
+    auto wait_us = getWaitTime();
+
+#if HAVE_EPOLL_PWAIT2
+    //! 优先使用 epoll_pwait2()，它的超时参数精确到 ns
+    if (LIKELY(is_pwait2_supported_)) {
+        struct timespec ts, *p_ts = nullptr;
+        if (wait_us >= 0) {
+            ts.tv_sec  = wait_us / 1000000;
+            ts.tv_nsec = (wait_us % 1000000) * 1000;
+            p_ts = &ts;
+        }
+
+        int fds = epoll_pwait2(epoll_fd_, events.data(), events.size(), p_ts, nullptr);
+        if (LIKELY(fds >= 0 || errno != ENOSYS))
+            return fds;
+
+        LogNotice("epoll_pwait2() is not supported, use epoll_wait() instead");
+        is_pwait2_supported_ = false;
+    }
+#endif
+
+    //! epoll_wait() 的超时参数以 ms 为单位，向上取整，避免提前醒来空转
+    int wait_ms = wait_us >= 0 ? (wait_us + 999) / 1000 : -1;
+    return epoll_wait(epoll_fd_, events.data(), events.size(), wait_ms);
+}
+
 EpollFdSharedData* EpollLoop::refFdSharedData(int fd)
 {
     EpollFdSharedData *fd_shared_data = nullptr;
@@ -131,11 +163,21 @@ void EpollLoop::unrefFdSharedData(int fd)
         --fd_shared_data->ref;
         if (fd_shared_data->ref == 0) {
             fd_data_map_.erase(fd);
-            fd_shared_data_pool_.free(fd_shared_data);
+            if (is_dispatching_)
+                tobe_free_fd_shared_data_.push_back(fd_shared_data);
+            else
+                fd_shared_data_pool_.free(fd_shared_data);
         }
     }
 }
 
+void EpollLoop::freeUnrefFdSharedData()
+{
+    for (auto fd_shared_data : tobe_free_fd_shared_data_)
+        fd_shared_data_pool_.free(fd_shared_data);
+    tobe_free_fd_shared_data_.clear();
+}
+
 FdEvent* EpollLoop::newFdEvent(const std::string &what)
 {
     return new EpollFdEvent(this, what);
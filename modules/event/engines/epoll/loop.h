@@ -21,6 +21,7 @@
 #define TBOX_EVENT_EPOLL_LOOP_H_20220105
 
 #include <unordered_map>
+#include <vector>
 
 #include "../../common_loop.h"
 
@@ -49,17 +50,29 @@ class EpollLoop : public CommonLoop {
 
     EpollFdSharedData* refFdSharedData(int fd);
     void unrefFdSharedData(int fd);
+    void freeUnrefFdSharedData();
 
   protected:
     virtual void stopLoop() override { keep_running_ = false; }
+    int waitEvents(std::vector<struct epoll_event> &events);
 
   private:
     int  max_loop_entries_ = DEFAULT_MAX_LOOP_ENTRIES;
+#if HAVE_EPOLL_PWAIT2
+    bool is_pwait2_supported_ = true; //!< 内核是否支持 epoll_pwait2()
+#endif
     int  epoll_fd_ = -1;
     bool keep_running_ = true;
 
     std::unordered_map<int, EpollFdSharedData*> fd_data_map_;
     ObjectPool<EpollFdSharedData> fd_shared_data_pool_{64};
+
+    /**
+     * 在分发事件期间，引用数归零的 EpollFdSharedData 不能立即释放，因为它可能正在被
+     * OnEventCallback() 使用，先存放在这里，待本轮事件分发完成后再释放
+     */
+    bool is_dispatching_ = false;
+    std::vector<EpollFdSharedData*> tobe_free_fd_shared_data_;
 };
 
 }
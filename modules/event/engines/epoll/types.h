@@ -37,6 +37,16 @@ struct EpollFdSharedData {
     int read_event_num = 0;     //!< 监听可读事件的FdEvent个数
     int write_event_num = 0;    //!< 监听可写事件的FdEvent个数
     int except_event_num = 0;   //!< 监听异常事件的FdEvent个数
+    int enabled_event_num = 0;  //!< 已enable的FdEvent个数
+    int et_event_num = 0;       //!< 要求边沿触发的FdEvent个数
+    int exclusive_event_num = 0;//!< 要求EPOLLEXCLUSIVE的FdEvent个数
+
+    /**
+     * 正在分发事件的层数。大于0时，disable() 不能直接从 fd_events 中删除，
+     * 只能将对应位置置为 nullptr，待分发完成后再统一清除
+     */
+    int dispatch_level = 0;
+    bool has_removed = false;   //!< fd_events 中是否有待清除的 nullptr
 
     std::vector<EpollFdEvent*> fd_events;
 };
@@ -0,0 +1,192 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+
+#include "fd_event.h"
+#include "loop.h"
+#include <tbox/base/log.h>
+#include <tbox/base/assert.h>
+#include <tbox/base/wrapped_recorder.h>
+
+namespace tbox {
+namespace event {
+
+IoUringFdEvent::IoUringFdEvent(IoUringLoop *wp_loop, const std::string &what)
+  : FdEvent(what)
+  , wp_loop_(wp_loop)
+{ }
+
+IoUringFdEvent::~IoUringFdEvent()
+{
+    TBOX_ASSERT(cb_level_ == 0);
+
+    disable();
+
+    wp_loop_->unrefFdSharedData(fd_);
+}
+
+bool IoUringFdEvent::initialize(int fd, short events, Mode mode)
+{
+    if (isEnabled())
+        return false;
+
+    if (fd != fd_) {
+        wp_loop_->unrefFdSharedData(fd_);
+        fd_ = fd;
+        d_ = wp_loop_->refFdSharedData(fd_);
+    }
+
+    events_ = events;
+    if (mode == FdEvent::Mode::kOneshot)
+        is_stop_after_trigger_ = true;
+
+    return true;
+}
+
+bool IoUringFdEvent::enable()
+{
+    if (d_ == nullptr)
+        return false;
+
+    if (is_enabled_)
+        return true;
+
+    if (events_ & kReadEvent)
+        ++d_->read_event_num;
+
+    if (events_ & kWriteEvent)
+        ++d_->write_event_num;
+
+    if (events_ & kExceptEvent)
+        ++d_->except_event_num;
+
+    d_->fd_events.push_back(this);
+
+    //! 正在分发时不必重新提交，分发完成后会统一处理
+    if (d_->dispatch_level == 0)
+        wp_loop_->reloadPoll(d_);
+
+    is_enabled_ = true;
+    return true;
+}
+
+bool IoUringFdEvent::disable()
+{
+    if (d_ == nullptr || !is_enabled_)
+        return true;
+
+    if (events_ & kReadEvent)
+        --d_->read_event_num;
+
+    if (events_ & kWriteEvent)
+        --d_->write_event_num;
+
+    if (events_ & kExceptEvent)
+        --d_->except_event_num;
+
+    auto iter = std::find(d_->fd_events.begin(), d_->fd_events.end(), this);
+    if (d_->dispatch_level > 0) {
+        *iter = nullptr;
+        d_->has_removed = true;
+    } else {
+        d_->fd_events.erase(iter);
+        wp_loop_->reloadPoll(d_);
+    }
+
+    is_enabled_ = false;
+    return true;
+}
+
+Loop* IoUringFdEvent::getLoop() const
+{
+    return wp_loop_;
+}
+
+void IoUringFdEvent::OnPollCompleted(IoUringFdSharedData *d, int res)
+{
+    RECORD_SCOPE();
+    if (res < 0) {
+        //! 被内核撤消的 POLL_ADD 不是错误，由 IoUringLoop 重新提交即可
+        if (res != -ECANCELED)
+            LogWarn("poll fail, fd:%d, res:%d, %s", d->fd, res, strerror(-res));
+        return;
+    }
+
+    uint32_t events = res;
+    short tbox_events = 0;
+
+    //! 与 EpollFdEvent 一致，将 HUP 当成可读事件，由上层读到0字节来处理
+    if (events & (POLLIN | POLLHUP))
+        tbox_events |= kReadEvent;
+
+    if (events & POLLOUT)
+        tbox_events |= kWriteEvent;
+
+    if (events & POLLERR)
+        tbox_events |= kExceptEvent;
+
+    if (events & POLLNVAL)
+        LogWarn("fd:%d is invalid", d->fd);
+
+    DispatchEvents(d, tbox_events);
+}
+
+//! 与 EpollFdEvent::DispatchEvents() 相同，按下标分发，不复制 fd_events
+void IoUringFdEvent::DispatchEvents(IoUringFdSharedData *d, short events)
+{
+    ++d->dispatch_level;
+
+    auto num = d->fd_events.size();
+    for (size_t i = 0; i < num; ++i) {
+        auto event = d->fd_events[i];
+        if (event != nullptr)
+            event->onEvent(events);
+    }
+
+    --d->dispatch_level;
+
+    if (d->dispatch_level == 0 && d->has_removed) {
+        auto &fd_events = d->fd_events;
+        fd_events.erase(std::remove(fd_events.begin(), fd_events.end(), nullptr), fd_events.end());
+        d->has_removed = false;
+    }
+}
+
+void IoUringFdEvent::onEvent(short events)
+{
+    if (events_ & events) {
+        if (is_stop_after_trigger_)
+            disable();
+
+        wp_loop_->beginEventProcess();
+        if (cb_) {
+            RECORD_SCOPE();
+            ++cb_level_;
+            cb_(events);
+            --cb_level_;
+        }
+        wp_loop_->endEventProcess(this);
+    }
+}
+
+}
+}
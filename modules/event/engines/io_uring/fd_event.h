@@ -0,0 +1,74 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_IO_URING_FD_EVENT_H_20251018
+#define TBOX_EVENT_IO_URING_FD_EVENT_H_20251018
+
+#include "../../fd_event.h"
+#include "types.h"
+
+namespace tbox {
+namespace event {
+
+class IoUringLoop;
+
+/**
+ * 用 IORING_OP_POLL_ADD 实现的 FdEvent，语义与 EpollFdEvent 一致（水平触发）
+ * kEdgeTriggered 与 kExclusive 两个选项会被忽略
+ */
+class IoUringFdEvent : public FdEvent {
+  public:
+    explicit IoUringFdEvent(IoUringLoop *wp_loop, const std::string &what);
+    virtual ~IoUringFdEvent() override;
+
+  public:
+    virtual bool initialize(int fd, short events, Mode mode) override;
+    virtual void setCallback(CallbackFunc &&cb) override { cb_ = std::move(cb); }
+
+    virtual bool isEnabled() const override{ return is_enabled_; }
+    virtual bool enable() override;
+    virtual bool disable() override;
+
+    virtual Loop* getLoop() const override;
+
+  public:
+    static void OnPollCompleted(IoUringFdSharedData *d, int res);
+    static void DispatchEvents(IoUringFdSharedData *d, short events);
+
+  protected:
+    void onEvent(short events);
+
+  private:
+    IoUringLoop *wp_loop_;
+    bool is_stop_after_trigger_ = false;
+
+    int fd_ = -1;
+    short events_ = 0;
+    bool is_enabled_ = false;
+
+    CallbackFunc cb_;
+    IoUringFdSharedData *d_ = nullptr;
+
+    int cb_level_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_EVENT_IO_URING_FD_EVENT_H_20251018
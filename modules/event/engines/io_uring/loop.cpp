@@ -0,0 +1,472 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <cstring>
+#include <chrono>
+
+#include "loop.h"
+#include "fd_event.h"
+
+#include <tbox/base/log.h>
+#include <tbox/base/defines.h>
+#include <tbox/base/assert.h>
+#include <tbox/base/wrapped_recorder.h>
+
+namespace tbox {
+namespace event {
+
+namespace {
+const size_t kMaxFreeAsyncOpNum = 64;   //!< 最多缓存的空闲异步IO请求数
+
+inline uint64_t ToUserData(const void *ptr, uint64_t tag)
+{
+    return reinterpret_cast<uint64_t>(ptr) | tag;
+}
+}
+
+IoUringLoop::IoUringLoop()
+{
+    ring_.initialize(DEFAULT_IO_URING_ENTRIES);
+}
+
+IoUringLoop::~IoUringLoop()
+{
+    cleanup();
+
+    if (ring_.isValid())
+        cancelAllAndDrain();
+
+    for (auto op : free_async_ops_)
+        delete op;
+}
+
+void IoUringLoop::runLoop(Mode mode)
+{
+    RECORD_EVENT();
+
+    if (!ring_.isValid())
+        return;
+
+    runThisBeforeLoop();
+
+    keep_running_ = (mode == Loop::Mode::kForever);
+    do {
+        ring_.submitAndWait(getWaitTime());
+
+        RECORD_SCOPE();
+        beginLoopProcess();
+
+        handleExpiredTimers();
+        handleCompletions();
+        handleNextFunc();
+
+        endLoopProcess();
+
+    } while (keep_running_);
+
+    runThisAfterLoop();
+
+    RECORD_EVENT();
+}
+
+void IoUringLoop::handleCompletions()
+{
+    is_dispatching_ = true;
+    ring_.forEachCqe(
+        [this] (const struct io_uring_cqe &cqe) {
+            uint64_t tag = cqe.user_data & kIoUringTagMask;
+            void *ptr = reinterpret_cast<void*>(cqe.user_data & ~static_cast<uint64_t>(kIoUringTagMask));
+
+            if (tag == kIoUringTagPoll)
+                onPollCompleted(static_cast<IoUringPollReq*>(ptr), cqe.res);
+            else if (tag == kIoUringTagAsyncIo)
+                onAsyncIoCompleted(static_cast<IoUringAsyncOp*>(ptr), cqe.res);
+        }
+    );
+    is_dispatching_ = false;
+    freeUnrefFdSharedData();
+}
+
+void IoUringLoop::onPollCompleted(IoUringPollReq *req, int res)
+{
+    --inflight_num_;
+
+    auto d = req->d;
+    bool is_stale = req->is_stale;
+    poll_req_pool_.free(req);
+
+    if (is_stale)
+        return;
+
+    //! POLL_ADD 是一次性的，完成了就要重新提交
+    d->poll_req = nullptr;
+    IoUringFdEvent::OnPollCompleted(d, res);
+
+    //! 出错时不再重新提交，以免空转，直到事件有变动；被内核撤消的不算出错
+    if ((res >= 0 || res == -ECANCELED) && d->ref > 0)
+        reloadPoll(d);
+}
+
+void IoUringLoop::reloadPoll(IoUringFdSharedData *d)
+{
+    uint32_t events = 0;
+
+    if (d->read_event_num > 0)
+        events |= POLLIN;
+
+    if (d->write_event_num > 0)
+        events |= POLLOUT;
+
+    if (d->except_event_num > 0)
+        events |= POLLERR;
+
+    auto req = d->poll_req;
+    if (req != nullptr) {
+        if (req->events == events)
+            return;
+
+        d->poll_req = nullptr;
+        removePoll(req);
+    }
+
+    if (events == 0)
+        return;
+
+    auto sqe = ring_.getSqe();
+    if (sqe == nullptr) {
+        LogWarn("no sqe, fd:%d", d->fd);
+        return;
+    }
+
+    req = poll_req_pool_.alloc();
+    req->d = d;
+    req->events = events;
+    req->is_stale = false;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = d->fd;
+    sqe->poll32_events = events;
+    sqe->user_data = ToUserData(req, kIoUringTagPoll);
+
+    d->poll_req = req;
+    ++inflight_num_;
+}
+
+void IoUringLoop::removePoll(IoUringPollReq *req)
+{
+    req->is_stale = true;
+
+    auto sqe = ring_.getSqe();
+    if (sqe == nullptr) {
+        LogWarn("no sqe, fd:%d", req->d->fd);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = ToUserData(req, kIoUringTagPoll);
+    sqe->user_data = 0;
+}
+
+IoUringFdSharedData* IoUringLoop::refFdSharedData(int fd)
+{
+    IoUringFdSharedData *fd_shared_data = nullptr;
+
+    auto it = fd_data_map_.find(fd);
+    if (it != fd_data_map_.end())
+        fd_shared_data = it->second;
+
+    if (fd_shared_data == nullptr) {
+        fd_shared_data = fd_shared_data_pool_.alloc();
+        TBOX_ASSERT(fd_shared_data != nullptr);
+
+        fd_shared_data->fd = fd;
+        fd_data_map_.insert(std::make_pair(fd, fd_shared_data));
+    }
+
+    ++fd_shared_data->ref;
+    return fd_shared_data;
+}
+
+void IoUringLoop::unrefFdSharedData(int fd)
+{
+    auto it = fd_data_map_.find(fd);
+    if (it != fd_data_map_.end()) {
+        auto fd_shared_data = it->second;
+        --fd_shared_data->ref;
+        if (fd_shared_data->ref == 0) {
+            fd_data_map_.erase(fd);
+
+            if (fd_shared_data->poll_req != nullptr) {
+                removePoll(fd_shared_data->poll_req);
+                fd_shared_data->poll_req = nullptr;
+            }
+
+            if (is_dispatching_)
+                tobe_free_fd_shared_data_.push_back(fd_shared_data);
+            else
+                fd_shared_data_pool_.free(fd_shared_data);
+        }
+    }
+}
+
+void IoUringLoop::freeUnrefFdSharedData()
+{
+    for (auto fd_shared_data : tobe_free_fd_shared_data_)
+        fd_shared_data_pool_.free(fd_shared_data);
+    tobe_free_fd_shared_data_.clear();
+}
+
+FdEvent* IoUringLoop::newFdEvent(const std::string &what)
+{
+    return new IoUringFdEvent(this, what);
+}
+
+Loop::AsyncIoId IoUringLoop::asyncRead(int fd, void *buff, size_t size,
+                                       AsyncBuffHolder holder, AsyncReadCallback &&cb)
+{
+    auto op = allocAsyncOp(IORING_OP_READ, fd);
+    op->buff = buff;
+    op->size = size;
+    op->holder = std::move(holder);
+    op->read_cb = std::move(cb);
+    return commitAsyncOp(op);
+}
+
+Loop::AsyncIoId IoUringLoop::asyncRecv(int fd, void *buff, size_t size, int flags,
+                                       AsyncBuffHolder holder, AsyncReadCallback &&cb)
+{
+    auto op = allocAsyncOp(IORING_OP_RECV, fd);
+    op->buff = buff;
+    op->size = size;
+    op->flags = flags;
+    op->holder = std::move(holder);
+    op->read_cb = std::move(cb);
+    return commitAsyncOp(op);
+}
+
+Loop::AsyncIoId IoUringLoop::asyncWrite(int fd, const void *data, size_t size,
+                                        AsyncBuffHolder holder, AsyncWriteCallback &&cb)
+{
+    auto op = allocAsyncOp(IORING_OP_WRITE, fd);
+    op->buff = const_cast<void*>(data);
+    op->size = size;
+    op->holder = std::move(holder);
+    op->write_cb = std::move(cb);
+    return commitAsyncOp(op);
+}
+
+Loop::AsyncIoId IoUringLoop::asyncAccept(int fd, AsyncAcceptCallback &&cb)
+{
+    auto op = allocAsyncOp(IORING_OP_ACCEPT, fd);
+    op->accept_cb = std::move(cb);
+    return commitAsyncOp(op);
+}
+
+bool IoUringLoop::cancelAsyncIo(AsyncIoId id)
+{
+    auto it = async_ops_.find(id);
+    if (it == async_ops_.end())
+        return false;
+
+    auto op = it->second;
+    async_ops_.erase(it);
+
+    //! 请求要等到内核完成后才能释放，在此之前只是不再回调
+    op->is_cancelled = true;
+    op->read_cb = nullptr;
+    op->write_cb = nullptr;
+    op->accept_cb = nullptr;
+
+    auto sqe = ring_.getSqe();
+    if (sqe == nullptr) {
+        LogWarn("no sqe, fd:%d", op->fd);
+        return true;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = ToUserData(op, kIoUringTagAsyncIo);
+    sqe->user_data = 0;
+    return true;
+}
+
+IoUringAsyncOp* IoUringLoop::allocAsyncOp(uint8_t opcode, int fd)
+{
+    IoUringAsyncOp *op = nullptr;
+    if (!free_async_ops_.empty()) {
+        op = free_async_ops_.back();
+        free_async_ops_.pop_back();
+    } else {
+        op = new IoUringAsyncOp;
+    }
+
+    op->id = ++async_io_id_alloc_;
+    op->opcode = opcode;
+    op->fd = fd;
+    op->flags = 0;
+    op->is_cancelled = false;
+    op->buff = nullptr;
+    op->size = 0;
+    return op;
+}
+
+void IoUringLoop::freeAsyncOp(IoUringAsyncOp *op)
+{
+    op->holder.reset();
+    op->read_cb = nullptr;
+    op->write_cb = nullptr;
+    op->accept_cb = nullptr;
+
+    if (free_async_ops_.size() < kMaxFreeAsyncOpNum)
+        free_async_ops_.push_back(op);
+    else
+        delete op;
+}
+
+Loop::AsyncIoId IoUringLoop::commitAsyncOp(IoUringAsyncOp *op)
+{
+    auto id = submitAsyncOp(op, false);
+    if (id == 0)
+        freeAsyncOp(op);
+    return id;
+}
+
+Loop::AsyncIoId IoUringLoop::submitAsyncOp(IoUringAsyncOp *op, bool wait_ready)
+{
+    //! 需要两个 SQE 时，要保证它们之间不会被提交，所以先一起预留
+    if (!ring_.reserveSqes(wait_ready ? 2 : 1)) {
+        LogWarn("no sqe, fd:%d", op->fd);
+        return 0;
+    }
+
+    auto poll_sqe = wait_ready ? ring_.getSqe() : nullptr;
+    auto sqe = ring_.getSqe();
+
+    if (wait_ready) {
+        poll_sqe->opcode = IORING_OP_POLL_ADD;
+        poll_sqe->fd = op->fd;
+        poll_sqe->poll32_events = (op->opcode == IORING_OP_WRITE) ? POLLOUT : POLLIN;
+        poll_sqe->flags = IOSQE_IO_LINK;
+        poll_sqe->user_data = 0;
+    }
+
+    sqe->opcode = op->opcode;
+    sqe->fd = op->fd;
+    sqe->user_data = ToUserData(op, kIoUringTagAsyncIo);
+
+    switch (op->opcode) {
+        case IORING_OP_READ:
+        case IORING_OP_WRITE:
+            sqe->addr = reinterpret_cast<uint64_t>(op->buff);
+            sqe->len = op->size;
+            sqe->off = static_cast<uint64_t>(-1);   //!< 使用并更新文件的当前偏移
+            break;
+
+        case IORING_OP_RECV:
+            sqe->addr = reinterpret_cast<uint64_t>(op->buff);
+            sqe->len = op->size;
+            sqe->msg_flags = op->flags;
+            break;
+
+        case IORING_OP_ACCEPT:
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            break;
+    }
+
+    async_ops_[op->id] = op;
+    ++inflight_num_;
+    return op->id;
+}
+
+void IoUringLoop::onAsyncIoCompleted(IoUringAsyncOp *op, int res)
+{
+    --inflight_num_;
+
+    if (op->is_cancelled) {
+        freeAsyncOp(op);
+        return;
+    }
+
+    //! 内核按 O_NONBLOCK 返回了 EAGAIN，那就等fd就绪后再重新执行
+    if (res == -EAGAIN && submitAsyncOp(op, true) != 0)
+        return;
+
+    /**
+     * 不是本端撤消的，却收到了 ECANCELED，是被内核撤消的，如链接在前面的 POLL_ADD 失败了。
+     * 这不是读写本身的错误，不能当作错误回调上去，重新执行一次，真有错时会得到实际的错误码
+     */
+    if (res == -ECANCELED && submitAsyncOp(op, false) != 0)
+        return;
+
+    async_ops_.erase(op->id);
+
+    RECORD_SCOPE();
+    switch (op->opcode) {
+        case IORING_OP_READ:
+        case IORING_OP_RECV:
+            if (op->read_cb)
+                op->read_cb(res);
+            break;
+
+        case IORING_OP_WRITE:
+            if (op->write_cb)
+                op->write_cb(res);
+            break;
+
+        case IORING_OP_ACCEPT:
+            if (op->accept_cb)
+                op->accept_cb(res);
+            break;
+    }
+
+    freeAsyncOp(op);
+}
+
+void IoUringLoop::cancelAllAndDrain()
+{
+    while (!async_ops_.empty())
+        cancelAsyncIo(async_ops_.begin()->first);
+
+    for (auto &item : fd_data_map_) {
+        auto d = item.second;
+        if (d->poll_req != nullptr) {
+            removePoll(d->poll_req);
+            d->poll_req = nullptr;
+        }
+    }
+
+    //! 内核完成撤消一般很快，这里限定等待时长，防止异常时卡住
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (inflight_num_ > 0 && std::chrono::steady_clock::now() < deadline) {
+        ring_.submitAndWait(10000);
+        handleCompletions();
+    }
+
+    if (inflight_num_ > 0)
+        LogWarn("%d requests are still inflight", inflight_num_);
+}
+
+}
+}
@@ -0,0 +1,115 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_IO_URING_LOOP_H_20251018
+#define TBOX_EVENT_IO_URING_LOOP_H_20251018
+
+#include <unordered_map>
+#include <vector>
+
+#include "../../common_loop.h"
+
+#include <tbox/base/object_pool.hpp>
+#include "types.h"
+#include "uring.h"
+
+#ifndef DEFAULT_IO_URING_ENTRIES
+#define DEFAULT_IO_URING_ENTRIES (256)
+#endif
+
+namespace tbox {
+namespace event {
+
+/**
+ * 基于 io_uring 的事件循环
+ *
+ * FdEvent 用 IORING_OP_POLL_ADD 实现，行为与 epoll 的一致，已有的代码无需改动；
+ * 另外还提供 asyncRead() 等基于完成通知的接口，可省去就绪通知后再调用 read() 的系统调用
+ */
+class IoUringLoop : public CommonLoop {
+  public:
+    explicit IoUringLoop();
+    virtual ~IoUringLoop() override;
+
+    //! 内核是否支持，不支持时不可使用
+    bool isValid() const { return ring_.isValid(); }
+
+  public:
+    virtual void runLoop(Mode mode) override;
+
+    virtual FdEvent* newFdEvent(const std::string &what) override;
+
+    virtual bool isAsyncIoSupported() const override { return true; }
+    virtual AsyncIoId asyncRead(int fd, void *buff, size_t size,
+                                AsyncBuffHolder holder, AsyncReadCallback &&cb) override;
+    virtual AsyncIoId asyncRecv(int fd, void *buff, size_t size, int flags,
+                                AsyncBuffHolder holder, AsyncReadCallback &&cb) override;
+    virtual AsyncIoId asyncWrite(int fd, const void *data, size_t size,
+                                 AsyncBuffHolder holder, AsyncWriteCallback &&cb) override;
+    virtual AsyncIoId asyncAccept(int fd, AsyncAcceptCallback &&cb) override;
+    virtual bool cancelAsyncIo(AsyncIoId id) override;
+
+  public:
+    IoUringFdSharedData* refFdSharedData(int fd);
+    void unrefFdSharedData(int fd);
+    void freeUnrefFdSharedData();
+
+    //! 按 d 中各事件的数量，重新提交 POLL_ADD 请求
+    void reloadPoll(IoUringFdSharedData *d);
+
+  protected:
+    virtual void stopLoop() override { keep_running_ = false; }
+
+    void handleCompletions();
+    void onPollCompleted(IoUringPollReq *req, int res);
+    void onAsyncIoCompleted(IoUringAsyncOp *op, int res);
+
+    void removePoll(IoUringPollReq *req);
+
+    IoUringAsyncOp* allocAsyncOp(uint8_t opcode, int fd);
+    void freeAsyncOp(IoUringAsyncOp *op);
+    AsyncIoId commitAsyncOp(IoUringAsyncOp *op);   //!< 提交新请求，失败时回收 op
+    AsyncIoId submitAsyncOp(IoUringAsyncOp *op, bool wait_ready);
+
+    //! 撤消所有未完成的请求，并等待它们完成，之后才能释放缓冲
+    void cancelAllAndDrain();
+
+  private:
+    IoUring ring_;
+    bool keep_running_ = true;
+
+    int inflight_num_ = 0;  //!< 已提交但未完成的 POLL_ADD 与异步IO请求数
+
+    std::unordered_map<int, IoUringFdSharedData*> fd_data_map_;
+    ObjectPool<IoUringFdSharedData> fd_shared_data_pool_{64};
+    ObjectPool<IoUringPollReq> poll_req_pool_{64};
+
+    //! 见 EpollLoop 中的说明
+    bool is_dispatching_ = false;
+    std::vector<IoUringFdSharedData*> tobe_free_fd_shared_data_;
+
+    AsyncIoId async_io_id_alloc_ = 0;
+    std::unordered_map<AsyncIoId, IoUringAsyncOp*> async_ops_;
+    std::vector<IoUringAsyncOp*> free_async_ops_;  //!< 回收的请求对象
+};
+
+}
+}
+
+#endif //TBOX_EVENT_IO_URING_LOOP_H_20251018
@@ -0,0 +1,169 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <tbox/base/scope_exit.hpp>
+
+#include "../../loop.h"
+
+namespace tbox {
+namespace event {
+
+TEST(IoUringLoop, AsyncReadWrite)
+{
+    auto sp_loop = Loop::New("io_uring");
+    ASSERT_TRUE(sp_loop != nullptr);
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    if (!sp_loop->isAsyncIoSupported()) {
+        std::cout << "io_uring is not supported, skip" << std::endl;
+        return;
+    }
+
+    //! 阻塞模式的fd由内核等待就绪，不会阻塞线程
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    SetScopeExitAction([fds] { close(fds[0]); close(fds[1]); });
+
+    std::string recv_str;
+    ssize_t write_res = 0;
+
+    auto recv_buff = std::make_shared<std::vector<char>>(100);
+    auto read_id = sp_loop->asyncRead(fds[0], recv_buff->data(), recv_buff->size(), recv_buff,
+        [&] (ssize_t res) {
+            ASSERT_GT(res, 0);
+            recv_str.assign(recv_buff->data(), res);
+            sp_loop->exitLoop();
+        }
+    );
+    EXPECT_NE(read_id, 0u);
+
+    //! 内核直接从 send_buff 中取数据，由 holder 保证其在完成之前有效
+    auto send_buff = std::make_shared<std::string>("hello");
+    auto write_id = sp_loop->asyncWrite(fds[1], send_buff->data(), send_buff->size(), send_buff,
+                                        [&] (ssize_t res) { write_res = res; });
+    EXPECT_NE(write_id, 0u);
+    std::weak_ptr<std::string> send_buff_watcher = send_buff;
+    send_buff.reset();
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(write_res, 5);
+    EXPECT_EQ(recv_str, "hello");
+    EXPECT_TRUE(send_buff_watcher.expired());   //! 完成后引擎就释放了
+}
+
+TEST(IoUringLoop, CancelAsyncRead)
+{
+    auto sp_loop = Loop::New("io_uring");
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    if (!sp_loop->isAsyncIoSupported())
+        return;
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    SetScopeExitAction([fds] { close(fds[0]); close(fds[1]); });
+
+    int cancelled_cb_count = 0;
+    std::string recv_str;
+
+    auto cancelled_buff = std::make_shared<std::vector<char>>(100);
+    auto read_id = sp_loop->asyncRead(fds[0], cancelled_buff->data(), cancelled_buff->size(), cancelled_buff,
+                                      [&] (ssize_t) { ++cancelled_cb_count; });
+    EXPECT_TRUE(sp_loop->cancelAsyncIo(read_id));
+    EXPECT_FALSE(sp_loop->cancelAsyncIo(read_id));
+
+    //! 撤消后内核还没完成，缓冲仍由引擎持有
+    std::weak_ptr<std::vector<char>> cancelled_buff_watcher = cancelled_buff;
+    cancelled_buff.reset();
+    EXPECT_FALSE(cancelled_buff_watcher.expired());
+
+    //! 撤消后再读，数据应由新的请求读到
+    auto recv_buff = std::make_shared<std::vector<char>>(100);
+    sp_loop->asyncRecv(fds[0], recv_buff->data(), recv_buff->size(), 0, recv_buff,
+        [&] (ssize_t res) {
+            if (res > 0)
+                recv_str.assign(recv_buff->data(), res);
+        }
+    );
+    sp_loop->runNext([&] { EXPECT_EQ(::write(fds[1], "world", 5), 5); });
+
+    sp_loop->exitLoop(std::chrono::milliseconds(50));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(cancelled_cb_count, 0);
+    EXPECT_EQ(recv_str, "world");
+    EXPECT_TRUE(cancelled_buff_watcher.expired());
+}
+
+TEST(IoUringLoop, AsyncAccept)
+{
+    auto sp_loop = Loop::New("io_uring");
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    if (!sp_loop->isAsyncIoSupported())
+        return;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(listen_fd, 0);
+    SetScopeExitAction([listen_fd] { close(listen_fd); });
+
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)), 0);
+    ASSERT_EQ(listen(listen_fd, 1), 0);
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len);
+
+    int accepted_fd = -1;
+    sp_loop->asyncAccept(listen_fd,
+        [&] (int res) {
+            accepted_fd = res;
+            sp_loop->exitLoop();
+        }
+    );
+
+    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    SetScopeExitAction([client_fd] { close(client_fd); });
+    ASSERT_EQ(connect(client_fd, (struct sockaddr*)&addr, addr_len), 0);
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_GE(accepted_fd, 0);
+    if (accepted_fd >= 0)
+        close(accepted_fd);
+}
+
+}
+}
@@ -0,0 +1,88 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_IO_URING_TYPES_H_20251018
+#define TBOX_EVENT_IO_URING_TYPES_H_20251018
+
+#include <cstdint>
+#include <vector>
+
+#include "../../loop.h"
+
+namespace tbox {
+namespace event {
+
+class IoUringFdEvent;
+struct IoUringFdSharedData;
+
+/**
+ * 提交到 io_uring 的每个请求都以对象指针作为 user_data，低位用于区分对象类型
+ * 为 0 的 user_data 表示不关心其完成结果，如 POLL_REMOVE、ASYNC_CANCEL
+ */
+enum IoUringUserDataTag : uint64_t {
+    kIoUringTagPoll    = 0x1,
+    kIoUringTagAsyncIo = 0x2,
+    kIoUringTagMask    = 0x7,
+};
+
+//! 一次 POLL_ADD 请求，每次完成后都要重新提交，以实现水平触发
+struct IoUringPollReq {
+    IoUringFdSharedData *d = nullptr;
+    uint32_t events = 0;    //!< 请求时的 POLLIN/POLLOUT 掩码
+    bool is_stale = false;  //!< 已被撤消或替换，完成后直接丢弃
+};
+
+//! 同一个fd共享的数据
+struct IoUringFdSharedData {
+    int fd = 0;     //!< 文件描述符
+    int ref = 0;    //!< 引用计数
+
+    int read_event_num = 0;     //!< 监听可读事件的FdEvent个数
+    int write_event_num = 0;    //!< 监听可写事件的FdEvent个数
+    int except_event_num = 0;   //!< 监听异常事件的FdEvent个数
+
+    IoUringPollReq *poll_req = nullptr; //!< 当前有效的 POLL_ADD 请求
+
+    int dispatch_level = 0;     //!< 正在分发事件的层数，见 EpollFdSharedData
+    bool has_removed = false;   //!< fd_events 中是否有待清除的 nullptr
+
+    std::vector<IoUringFdEvent*> fd_events;
+};
+
+//! 一次基于完成通知的异步IO请求
+struct IoUringAsyncOp {
+    Loop::AsyncIoId id = 0;
+    uint8_t opcode = 0;
+    int fd = -1;
+    int flags = 0;
+    bool is_cancelled = false;
+
+    void *buff = nullptr;       //!< 读写缓冲，由使用者提供
+    size_t size = 0;
+    Loop::AsyncBuffHolder holder;   //!< 持有 buff 直到内核完成，避免撤消后内核仍访问已释放的内存
+
+    Loop::AsyncReadCallback   read_cb;
+    Loop::AsyncWriteCallback  write_cb;
+    Loop::AsyncAcceptCallback accept_cb;
+};
+
+}
+}
+
+#endif //TBOX_EVENT_IO_URING_TYPES_H_20251018
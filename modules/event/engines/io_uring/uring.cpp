@@ -0,0 +1,204 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "uring.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <tbox/base/log.h>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace event {
+
+IoUring::~IoUring()
+{
+    cleanup();
+}
+
+bool IoUring::initialize(unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        LogNotice("io_uring_setup() fail, errno:%d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    //! 等待时需要用 IORING_ENTER_EXT_ARG 传入超时时长，该特性自 5.11 起才有
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+        LogNotice("io_uring features 0x%x not enough", params.features);
+        close(fd);
+        return false;
+    }
+
+    ring_fd_ = fd;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    bool is_single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (is_single_mmap) {
+        if (cq_ring_size_ > sq_ring_size_)
+            sq_ring_size_ = cq_ring_size_;
+        cq_ring_size_ = sq_ring_size_;
+    }
+
+    sq_ring_ptr_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr_ == MAP_FAILED) {
+        sq_ring_ptr_ = nullptr;
+        goto fail;
+    }
+
+    if (is_single_mmap) {
+        cq_ring_ptr_ = sq_ring_ptr_;
+    } else {
+        cq_ring_ptr_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ptr_ == MAP_FAILED) {
+            cq_ring_ptr_ = nullptr;
+            goto fail;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        goto fail;
+    }
+
+    {
+        auto sq_ptr = static_cast<uint8_t*>(sq_ring_ptr_);
+        sq_khead_   = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.head);
+        sq_ktail_   = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.tail);
+        sq_mask_    = *reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.ring_entries);
+
+        //! SQ 的 array 固定为一一对应，SQE 按顺序使用
+        auto sq_array = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i)
+            sq_array[i] = i;
+
+        sqe_tail_ = sqe_flushed_ = *sq_ktail_;
+
+        auto cq_ptr = static_cast<uint8_t*>(cq_ring_ptr_);
+        cq_khead_ = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.head);
+        cq_ktail_ = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.tail);
+        cq_mask_  = *reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.ring_mask);
+        cqes_     = reinterpret_cast<struct io_uring_cqe*>(cq_ptr + params.cq_off.cqes);
+    }
+
+    return true;
+
+fail:
+    LogWarn("mmap io_uring fail, errno:%d, %s", errno, strerror(errno));
+    //! 要关闭 ring_fd_，isValid() 才会返回 false，Loop::New() 才会退回到 epoll
+    cleanup();
+    return false;
+}
+
+void IoUring::cleanup()
+{
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+
+    if (cq_ring_ptr_ != nullptr && cq_ring_ptr_ != sq_ring_ptr_)
+        munmap(cq_ring_ptr_, cq_ring_size_);
+    cq_ring_ptr_ = nullptr;
+
+    if (sq_ring_ptr_ != nullptr) {
+        munmap(sq_ring_ptr_, sq_ring_size_);
+        sq_ring_ptr_ = nullptr;
+    }
+
+    CHECK_CLOSE_RESET_FD(ring_fd_);
+}
+
+bool IoUring::reserveSqes(unsigned num)
+{
+    unsigned head = __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head + num > sq_entries_) {
+        submit();
+        head = __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head + num > sq_entries_) {
+            LogWarn("io_uring sq is full");
+            return false;
+        }
+    }
+    return true;
+}
+
+struct io_uring_sqe* IoUring::getSqe()
+{
+    if (!reserveSqes(1))
+        return nullptr;
+
+    auto sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size)
+{
+    return syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, arg, arg_size);
+}
+
+int IoUring::submitAndWait(int64_t wait_us)
+{
+    unsigned to_submit = sqe_tail_ - sqe_flushed_;
+    if (to_submit > 0) {
+        __atomic_store_n(sq_ktail_, sqe_tail_, __ATOMIC_RELEASE);
+        sqe_flushed_ = sqe_tail_;
+    }
+
+    if (wait_us == 0) {
+        if (to_submit == 0)
+            return 0;
+        return enter(to_submit, 0, 0, nullptr, 0);
+    }
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (wait_us > 0) {
+        ts.tv_sec  = wait_us / 1000000;
+        ts.tv_nsec = (wait_us % 1000000) * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+
+    int ret = enter(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (ret < 0 && errno != ETIME && errno != EINTR)
+        LogWarn("io_uring_enter() fail, errno:%d, %s", errno, strerror(errno));
+    return ret;
+}
+
+}
+}
@@ -0,0 +1,104 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_IO_URING_URING_H_20251018
+#define TBOX_EVENT_IO_URING_URING_H_20251018
+
+#include <cstdint>
+#include <cstddef>
+#include <linux/io_uring.h>
+
+namespace tbox {
+namespace event {
+
+/**
+ * 对 io_uring 系统调用的最小封装，不依赖 liburing
+ *
+ * 仅供 IoUringLoop 在 Loop 线程中使用，不是线程安全的
+ */
+class IoUring {
+  public:
+    ~IoUring();
+
+    //! 创建 ring，内核不支持或缺少所需特性时返回 false
+    bool initialize(unsigned entries);
+    bool isValid() const { return ring_fd_ >= 0; }
+
+    //! 获取一个空闲的 SQE，SQ 满时会先提交再获取
+    struct io_uring_sqe* getSqe();
+    //! 确保接下来能连续获取 num 个 SQE，用于 IOSQE_IO_LINK 链接的请求
+    bool reserveSqes(unsigned num);
+
+    /**
+     * 提交所有待提交的 SQE，并等待至少一个 CQE
+     *
+     * \param wait_us   等待时长，单位 us。-1 表示无限等待，0 表示不等待
+     */
+    int submitAndWait(int64_t wait_us);
+    int submit() { return submitAndWait(0); }
+
+    //! 遍历 CQE，func 的原型为 void (const struct io_uring_cqe &)
+    template <typename Func>
+    unsigned forEachCqe(Func &&func) {
+        unsigned head = *cq_khead_;
+        unsigned tail = __atomic_load_n(cq_ktail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            struct io_uring_cqe cqe = cqes_[head & cq_mask_];
+            ++head;
+            //! 先归还，回调中可能还会再次进入本函数
+            __atomic_store_n(cq_khead_, head, __ATOMIC_RELEASE);
+            func(cqe);
+            ++count;
+        }
+        return count;
+    }
+
+  private:
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size);
+    //! 解除映射并关闭 ring_fd_，可重复调用
+    void cleanup();
+
+  private:
+    int ring_fd_ = -1;
+
+    void  *sq_ring_ptr_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void  *cq_ring_ptr_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    struct io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_khead_ = nullptr;
+    unsigned *sq_ktail_ = nullptr;
+    unsigned  sq_mask_ = 0;
+    unsigned  sq_entries_ = 0;
+    unsigned  sqe_tail_ = 0;    //!< 本地已分配的 SQE 尾部
+    unsigned  sqe_flushed_ = 0; //!< 已写入 sq_ktail_ 的位置
+
+    unsigned *cq_khead_ = nullptr;
+    unsigned *cq_ktail_ = nullptr;
+    unsigned  cq_mask_ = 0;
+    struct io_uring_cqe *cqes_ = nullptr;
+};
+
+}
+}
+
+#endif //TBOX_EVENT_IO_URING_URING_H_20251018
@@ -98,7 +98,12 @@ bool SelectFdEvent::disable()
         --d_->except_event_num;
 
     auto iter = std::find(d_->fd_events.begin(), d_->fd_events.end(), this);
-    d_->fd_events.erase(iter);
+    if (d_->dispatch_level > 0) {
+        *iter = nullptr;
+        d_->has_removed = true;
+    } else {
+        d_->fd_events.erase(iter);
+    }
 
     is_enabled_ = false;
     return true;
@@ -123,10 +128,23 @@ void SelectFdEvent::OnEventCallback(bool is_readable, bool is_writable, bool is_
     if (is_except)
         tbox_events |= kExceptEvent;
 
-    //! 要先复制一份，因为在for中很可能会改动到d->fd_events，引起迭代器失效问题
-    auto tmp = data->fd_events;
-    for (auto event : tmp)
-        event->onEvent(tbox_events);
+    //! 同 EpollFdEvent::DispatchEvents() 的说明
+    ++data->dispatch_level;
+
+    auto num = data->fd_events.size();
+    for (size_t i = 0; i < num; ++i) {
+        auto event = data->fd_events[i];
+        if (event != nullptr)
+            event->onEvent(tbox_events);
+    }
+
+    --data->dispatch_level;
+
+    if (data->dispatch_level == 0 && data->has_removed) {
+        auto &fd_events = data->fd_events;
+        fd_events.erase(std::remove(fd_events.begin(), fd_events.end(), nullptr), fd_events.end());
+        data->has_removed = false;
+    }
 }
 
 void SelectFdEvent::onEvent(short events)
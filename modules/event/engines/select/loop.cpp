@@ -50,10 +50,10 @@ void SelectLoop::runLoop(Mode mode)
         int nfds = fillFdSets(read_set, write_set, except_set);
 
         struct timeval tv, *p_tv = nullptr;
-        auto wait_ms = getWaitTime();
-        if (wait_ms != -1) {
-            tv.tv_sec = wait_ms / 1000;
-            tv.tv_usec = wait_ms % 1000;
+        auto wait_us = getWaitTime();
+        if (wait_us != -1) {
+            tv.tv_sec = wait_us / 1000000;
+            tv.tv_usec = wait_us % 1000000;
             p_tv = &tv;
         }
 
@@ -65,16 +65,21 @@ void SelectLoop::runLoop(Mode mode)
         handleExpiredTimers();
 
         if (select_ret > 0) {
+            is_dispatching_ = true;
             for (int fd = 0; fd < nfds; ++fd) {
                 bool is_readable = FD_ISSET(fd, &read_set);
                 bool is_writable = FD_ISSET(fd, &write_set);
                 bool is_except   = FD_ISSET(fd, &except_set);
 
                 if (is_readable || is_writable || is_except) {
-                    auto *data = fd_data_map_.at(fd);
-                    SelectFdEvent::OnEventCallback(is_readable, is_writable, is_except, data);
+                    //! 前面的回调可能已经删除了该fd上所有的 FdEvent
+                    auto iter = fd_data_map_.find(fd);
+                    if (iter != fd_data_map_.end())
+                        SelectFdEvent::OnEventCallback(is_readable, is_writable, is_except, iter->second);
                 }
             }
+            is_dispatching_ = false;
+            freeUnrefFdSharedData();
         } else if (select_ret == -1) {
             if (errno == EBADF) {
                 removeInvalidFds();
@@ -187,11 +192,21 @@ void SelectLoop::unrefFdSharedData(int fd)
         --fd_shared_data->ref;
         if (fd_shared_data->ref == 0) {
             fd_data_map_.erase(fd);
-            fd_shared_data_pool_.free(fd_shared_data);
+            if (is_dispatching_)
+                tobe_free_fd_shared_data_.push_back(fd_shared_data);
+            else
+                fd_shared_data_pool_.free(fd_shared_data);
         }
     }
 }
 
+void SelectLoop::freeUnrefFdSharedData()
+{
+    for (auto fd_shared_data : tobe_free_fd_shared_data_)
+        fd_shared_data_pool_.free(fd_shared_data);
+    tobe_free_fd_shared_data_.clear();
+}
+
 FdEvent* SelectLoop::newFdEvent(const std::string &what)
 {
     return new SelectFdEvent(this, what);
@@ -42,6 +42,7 @@ class SelectLoop : public CommonLoop {
   public:
     SelectFdSharedData* refFdSharedData(int fd);
     void unrefFdSharedData(int fd);
+    void freeUnrefFdSharedData();
 
   protected:
     virtual void stopLoop() override { keep_running_ = false; }
@@ -53,6 +54,13 @@ class SelectLoop : public CommonLoop {
 
     std::unordered_map<int, SelectFdSharedData*> fd_data_map_;
     ObjectPool<SelectFdSharedData> fd_shared_data_pool_{64};
+
+    /**
+     * 在分发事件期间，引用数归零的 SelectFdSharedData 不能立即释放，因为它可能正在被
+     * OnEventCallback() 使用，先存放在这里，待本轮事件分发完成后再释放
+     */
+    bool is_dispatching_ = false;
+    std::vector<SelectFdSharedData*> tobe_free_fd_shared_data_;
 };
 
 }
@@ -36,6 +36,13 @@ struct SelectFdSharedData {
     int write_event_num = 0;    //!< 监听可写事件的FdEvent个数
     int except_event_num = 0;   //!< 监听异常事件的FdEvent个数
 
+    /**
+     * 正在分发事件的层数。大于0时，disable() 不能直接从 fd_events 中删除，
+     * 只能将对应位置置为 nullptr，待分发完成后再统一清除
+     */
+    int dispatch_level = 0;
+    bool has_removed = false;   //!< fd_events 中是否有待清除的 nullptr
+
     std::vector<SelectFdEvent*> fd_events;
 };
 
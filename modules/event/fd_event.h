@@ -35,6 +35,18 @@ class FdEvent : public Event {
         kExceptEvent = 0x04,    //!< 异常事件
     };
 
+    /**
+     * 可选的触发方式，与 EventTypes 一起通过 initialize() 的 events 参数传入
+     *
+     * 它们只是提示，不支持的引擎（如 select）会忽略它们，仍按水平触发处理。
+     * 所以使用者的代码必须在两种触发方式下都能正确工作，即：
+     * 每次回调都要将数据读完或写满，直到 EAGAIN 为止。
+     */
+    enum EventOptions {
+        kEdgeTriggered = 0x100, //!< 边沿触发。同一fd上所有的 FdEvent 都要求时才生效
+        kExclusive     = 0x200, //!< 多个Loop监听同一个fd时只唤醒其中之一，用于共享的监听socket
+    };
+
     using Event::Event;
 
     virtual bool initialize(int fd, short events, Mode mode) = 0;
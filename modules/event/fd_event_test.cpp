@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/socket.h>
 
 #include <errno.h>
 #include <cstring>
@@ -411,5 +412,448 @@ TEST(FdEvent, Exception)
     }
 }
 
+
+/// 在回调中 enable() 同一fd上的其它事件，新 enable() 的事件在下一轮才触发
+TEST(FdEvent, EnableOtherInCallback)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+        int write_fd(fds[1]);
+
+        auto sp_loop = Loop::New(e);
+        auto event_a = sp_loop->newFdEvent();
+        auto event_b = sp_loop->newFdEvent();
+        EXPECT_TRUE(event_a->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_b->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_a->enable());
+
+        int a_run_time = 0;
+        int b_run_time = 0;
+        int b_run_time_in_first_round = -1;
+
+        event_a->setCallback(
+            [&] (short) {
+                ++a_run_time;
+                if (a_run_time == 1) {
+                    event_b->enable();
+                } else {
+                    b_run_time_in_first_round = b_run_time;
+                    sp_loop->exitLoop();
+                }
+            }
+        );
+        event_b->setCallback([&] (short) { ++b_run_time; });
+
+        sp_loop->runLoop();
+
+        EXPECT_EQ(a_run_time, 2);
+        EXPECT_EQ(b_run_time_in_first_round, 0);
+        EXPECT_EQ(b_run_time, 1);
+
+        delete event_b;
+        delete event_a;
+        delete sp_loop;
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+/// 在回调中 disable() 同一fd上排在后面的事件，该事件在本轮不应再被触发
+TEST(FdEvent, DisableOtherInCallback)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+        int write_fd(fds[1]);
+
+        auto sp_loop = Loop::New(e);
+        auto event_a = sp_loop->newFdEvent();
+        auto event_b = sp_loop->newFdEvent();
+        auto event_c = sp_loop->newFdEvent();
+        EXPECT_TRUE(event_a->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_b->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_c->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_a->enable());
+        EXPECT_TRUE(event_b->enable());
+        EXPECT_TRUE(event_c->enable());
+
+        int a_run_time = 0;
+        int b_run_time = 0;
+        int c_run_time = 0;
+
+        event_a->setCallback(
+            [&] (short) {
+                ++a_run_time;
+                event_b->disable();
+                sp_loop->exitLoop();
+            }
+        );
+        event_b->setCallback([&] (short) { ++b_run_time; });
+        event_c->setCallback([&] (short) { ++c_run_time; });
+
+        sp_loop->runLoop();
+
+        EXPECT_EQ(a_run_time, 1);
+        EXPECT_EQ(b_run_time, 0);
+        EXPECT_EQ(c_run_time, 1);   //! 排在被 disable() 之后的仍要正常触发
+
+        //! 再次 enable() 之后能恢复
+        a_run_time = b_run_time = c_run_time = 0;
+        event_a->setCallback([&] (short) { ++a_run_time; sp_loop->exitLoop(); });
+        EXPECT_TRUE(event_b->enable());
+        sp_loop->runLoop();
+
+        EXPECT_EQ(a_run_time, 1);
+        EXPECT_EQ(b_run_time, 1);
+        EXPECT_EQ(c_run_time, 1);
+
+        delete event_c;
+        delete event_b;
+        delete event_a;
+        delete sp_loop;
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+/// 在回调中 disable() 自己，然后又 enable() 自己，本轮不应再次被触发
+TEST(FdEvent, DisableThenEnableSelfInCallback)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+        int write_fd(fds[1]);
+
+        auto sp_loop = Loop::New(e);
+        auto event_a = sp_loop->newFdEvent();
+        EXPECT_TRUE(event_a->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_a->enable());
+
+        int a_run_time = 0;
+        event_a->setCallback(
+            [&] (short) {
+                ++a_run_time;
+                event_a->disable();
+                event_a->enable();
+                if (a_run_time == 3)
+                    sp_loop->exitLoop();
+            }
+        );
+
+        sp_loop->runLoop();
+
+        EXPECT_EQ(a_run_time, 3);
+        EXPECT_TRUE(event_a->isEnabled());
+
+        delete event_a;
+        delete sp_loop;
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+/// 在回调中删除同一fd上的其它事件
+TEST(FdEvent, DeleteOtherInCallback)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+        int write_fd(fds[1]);
+
+        auto sp_loop = Loop::New(e);
+        auto event_a = sp_loop->newFdEvent();
+        auto event_b = sp_loop->newFdEvent();
+        EXPECT_TRUE(event_a->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_b->initialize(write_fd, FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(event_a->enable());
+        EXPECT_TRUE(event_b->enable());
+
+        int a_run_time = 0;
+        int b_run_time = 0;
+
+        event_a->setCallback(
+            [&] (short) {
+                ++a_run_time;
+                delete event_b;
+                event_b = nullptr;
+                sp_loop->exitLoop();
+            }
+        );
+        event_b->setCallback([&] (short) { ++b_run_time; });
+
+        sp_loop->runLoop();
+
+        EXPECT_EQ(a_run_time, 1);
+        EXPECT_EQ(b_run_time, 0);
+        EXPECT_EQ(event_b, nullptr);
+
+        delete event_a;
+        delete sp_loop;
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+/// 两个fd同时就绪，先触发的回调删除了另一个fd上唯一的事件
+TEST(FdEvent, DeleteEventOfOtherFdInCallback)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds_1[2] = { 0 };
+        int fds_2[2] = { 0 };
+        ASSERT_EQ(pipe2(fds_1, O_CLOEXEC | O_NONBLOCK), 0);
+        ASSERT_EQ(pipe2(fds_2, O_CLOEXEC | O_NONBLOCK), 0);
+
+        auto sp_loop = Loop::New(e);
+        FdEvent *events[2] = { sp_loop->newFdEvent(), sp_loop->newFdEvent() };
+        EXPECT_TRUE(events[0]->initialize(fds_1[1], FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(events[1]->initialize(fds_2[1], FdEvent::kWriteEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(events[0]->enable());
+        EXPECT_TRUE(events[1]->enable());
+
+        int run_time = 0;
+        for (int i = 0; i < 2; ++i) {
+            events[i]->setCallback(
+                [&, i] (short) {
+                    ++run_time;
+                    delete events[1 - i];
+                    events[1 - i] = nullptr;
+                    sp_loop->exitLoop();
+                }
+            );
+        }
+
+        sp_loop->runLoop();
+
+        EXPECT_EQ(run_time, 1);
+
+        delete events[0];
+        delete events[1];
+        delete sp_loop;
+
+        close(fds_1[0]);
+        close(fds_1[1]);
+        close(fds_2[0]);
+        close(fds_2[1]);
+    }
+}
+
+
+/// 边沿触发：只读走部分数据，不应再次触发，直到有新数据到来
+TEST(FdEvent, EdgeTriggered)
+{
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+
+    int read_fd(fds[0]);
+    int write_fd(fds[1]);
+
+    auto sp_loop = Loop::New("epoll");
+    auto read_event = sp_loop->newFdEvent();
+    EXPECT_TRUE(read_event->initialize(read_fd, FdEvent::kReadEvent | FdEvent::kEdgeTriggered, Event::Mode::kPersist));
+    EXPECT_TRUE(read_event->enable());
+
+    int run_time = 0;
+    read_event->setCallback(
+        [&] (short events) {
+            EXPECT_EQ(events, FdEvent::kReadEvent);
+            char tmp[5];
+            auto rsize = read(read_fd, tmp, sizeof(tmp));   //! 故意不读完
+            EXPECT_EQ(rsize, 5);
+            ++run_time;
+        }
+    );
+
+    auto wsize = ::write(write_fd, "0123456789", 10);
+    (void)wsize;
+    sp_loop->exitLoop(std::chrono::milliseconds(50));
+    sp_loop->runLoop();
+    EXPECT_EQ(run_time, 1);
+
+    //! 新数据到来，会再触发一次
+    wsize = ::write(write_fd, "abcde", 5);
+    (void)wsize;
+    sp_loop->exitLoop(std::chrono::milliseconds(50));
+    sp_loop->runLoop();
+    EXPECT_EQ(run_time, 2);
+
+    delete read_event;
+    delete sp_loop;
+
+    close(write_fd);
+    close(read_fd);
+}
+
+/// 同一fd上只要有一个水平触发的事件，就按水平触发处理
+TEST(FdEvent, EdgeTriggeredMixedWithLevelTriggered)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(pipe2(fds, O_CLOEXEC | O_NONBLOCK), 0);
+
+        int read_fd(fds[0]);
+        int write_fd(fds[1]);
+
+        auto sp_loop = Loop::New(e);
+        auto et_event = sp_loop->newFdEvent();
+        auto lt_event = sp_loop->newFdEvent();
+        EXPECT_TRUE(et_event->initialize(read_fd, FdEvent::kReadEvent | FdEvent::kEdgeTriggered, Event::Mode::kPersist));
+        EXPECT_TRUE(lt_event->initialize(read_fd, FdEvent::kReadEvent, Event::Mode::kPersist));
+        EXPECT_TRUE(et_event->enable());
+        EXPECT_TRUE(lt_event->enable());
+
+        int et_run_time = 0;
+        int lt_run_time = 0;
+        et_event->setCallback([&] (short) { ++et_run_time; });
+        lt_event->setCallback(
+            [&] (short) {
+                if (++lt_run_time == 3)
+                    sp_loop->exitLoop();
+            }
+        );
+
+        auto wsize = ::write(write_fd, "0123456789", 10);
+        (void)wsize;
+        sp_loop->exitLoop(std::chrono::milliseconds(50));
+        sp_loop->runLoop();
+
+        EXPECT_EQ(lt_run_time, 3);
+        EXPECT_EQ(et_run_time, 3);
+
+        delete lt_event;
+        delete et_event;
+        delete sp_loop;
+
+        close(write_fd);
+        close(read_fd);
+    }
+}
+
+/// 带 kExclusive 的 fd 上再 enable/disable 其它事件，注册要能正确更新
+TEST(FdEvent, ExclusiveThenChangeEvents)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+        auto sp_loop = Loop::New(e);
+        auto read_event = sp_loop->newFdEvent();
+        auto write_event = sp_loop->newFdEvent();
+        EXPECT_TRUE(read_event->initialize(fds[0], FdEvent::kReadEvent | FdEvent::kExclusive, Event::Mode::kPersist));
+        EXPECT_TRUE(write_event->initialize(fds[0], FdEvent::kWriteEvent, Event::Mode::kOneshot));
+        EXPECT_TRUE(read_event->enable());
+
+        int read_run_time = 0;
+        int write_run_time = 0;
+        read_event->setCallback(
+            [&] (short) {
+                char tmp[10];
+                auto rsize = read(fds[0], tmp, sizeof(tmp));
+                (void)rsize;
+                ++read_run_time;
+                sp_loop->exitLoop();
+            }
+        );
+        write_event->setCallback(
+            [&] (short) {
+                ++write_run_time;
+                auto wsize = ::write(fds[1], "0123456789", 10);
+                (void)wsize;
+            }
+        );
+
+        EXPECT_TRUE(write_event->enable());
+        sp_loop->exitLoop(std::chrono::milliseconds(50));
+        sp_loop->runLoop();
+
+        EXPECT_EQ(write_run_time, 1);
+        EXPECT_EQ(read_run_time, 1);
+
+        delete write_event;
+        delete read_event;
+        delete sp_loop;
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+
+/**
+ * epoll_ctl() 失败时，不能把事件记为已注册，否则之后同样的事件再也不会去注册
+ *
+ * 先对一个未打开的 fd 注册可读事件，失败；再让这个 fd 号指向管道，
+ * 另一个 FdEvent 注册同样的可读事件，应当能注册成功并收到事件
+ */
+TEST(FdEvent, EpollRegisterAgainAfterFail)
+{
+    auto sp_loop = Loop::New("epoll");
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+    int fd = dup(fds[0]);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    auto first_event = sp_loop->newFdEvent();
+    auto second_event = sp_loop->newFdEvent();
+    EXPECT_TRUE(first_event->initialize(fd, FdEvent::kReadEvent, Event::Mode::kPersist));
+    EXPECT_TRUE(second_event->initialize(fd, FdEvent::kReadEvent, Event::Mode::kPersist));
+    first_event->enable();  //! fd 还没有打开，注册失败
+
+    ASSERT_EQ(dup2(fds[0], fd), fd);
+    second_event->enable();
+
+    int run_time = 0;
+    second_event->setCallback(
+        [&] (short) {
+            char tmp[10];
+            auto rsize = read(fd, tmp, sizeof(tmp));
+            (void)rsize;
+            ++run_time;
+            sp_loop->exitLoop();
+        }
+    );
+
+    auto wsize = ::write(fds[1], "0123456789", 10);
+    (void)wsize;
+    sp_loop->exitLoop(std::chrono::milliseconds(50));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(run_time, 1);
+
+    delete second_event;
+    delete first_event;
+    delete sp_loop;
+
+    close(fd);
+    close(fds[0]);
+    close(fds[1]);
+}
 }
 }
@@ -26,6 +26,10 @@
 #include "engines/epoll/loop.h"
 #endif
 
+#if HAVE_IO_URING
+#include "engines/io_uring/loop.h"
+#endif
+
 namespace tbox {
 namespace event {
 
@@ -46,6 +50,17 @@ Loop* Loop::New(const std::string &engine_type)
     else if (engine_type == "epoll")
         return new EpollLoop;
 #endif
+#if HAVE_IO_URING
+    else if (engine_type == "io_uring") {
+        auto loop = new IoUringLoop;
+        if (loop->isValid())
+            return loop;
+
+        delete loop;
+        LogNotice("io_uring is not supported by kernel, use epoll instead");
+        return new EpollLoop;
+    }
+#endif
 
     return nullptr;
 }
@@ -58,8 +73,16 @@ std::vector<std::string> Loop::Engines()
     types.push_back("epoll");
 #endif
     types.push_back("select");
+#if HAVE_IO_URING
+    types.push_back("io_uring");
+#endif
     return types;
 }
 
+std::vector<std::string> Loop::TimerEngines()
+{
+    return { "heap", "wheel" };
+}
+
 }
 }
@@ -21,9 +21,14 @@
 #define TBOX_EVENT_LOOP_H
 
 #include <functional>
+#include <memory>
 #include <chrono>
 #include <string>
 #include <vector>
+#include <sys/types.h>
+
+#include <tbox/base/cabinet_token.h>
+#include <tbox/base/small_function.hpp>
 
 #include "forward.h"
 #include "stat.h"
@@ -35,10 +40,16 @@ class Loop {
   public:
     //! 创建默认类型的事件循环
     static Loop* New();
-    //! 创建指定类型的事件循环
+    /**
+     * 创建指定类型的事件循环
+     *
+     * 当指定 "io_uring" 而内核不支持时，会退而创建 "epoll" 的
+     */
     static Loop* New(const std::string &engine_type);
     //! 获取引擎列表
     static std::vector<std::string> Engines();
+    //! 获取定时器引擎列表
+    static std::vector<std::string> TimerEngines();
 
     enum class Mode {
         kOnce,      //!< 仅执行一次
@@ -63,7 +74,7 @@ class Loop {
      * runInLoop(), runNext(), run() 区别
      *
      * runInLoop()
-     *   功能：注入下一轮将执行的函数，有加锁操作，支持跨线程，跨Loop间调用；
+     *   功能：注入下一轮将执行的函数，无锁，支持跨线程，跨Loop间调用；
      *   场景：常用于不同Loop之间委派任务或其它线程向Loop线程妥派任务。
      *
      * runNext()
@@ -81,13 +92,41 @@ class Loop {
      * 使用建议：
      *   明确是Loop线程内的用 runNext(), 明确不是Loop线程内的用 runInLoop()。
      *   不清楚的直接用 run()。
+     *
+     * 参数 what 用于在超出警告水位线时打印：
+     *   const char* 版本只保存指针不做拷贝，必须是字符串字面量或生命期足够长的字符串；
+     *   std::string 版本会拷贝一份保存，可以传临时字符串，但可能会有一次内存分配。
+     */
+    virtual RunId runInLoop(Func &&func, const char *what = "") = 0;
+    virtual RunId runInLoop(const Func &func, const char *what = "") = 0;
+    virtual RunId runNext(Func &&func, const char *what = "") = 0;
+    virtual RunId runNext(const Func &func, const char *what = "") = 0;
+    virtual RunId run(Func &&func, const char *what = "") = 0;
+    virtual RunId run(const Func &func, const char *what = "") = 0;
+
+    virtual RunId runInLoop(Func &&func, const std::string &what) = 0;
+    virtual RunId runInLoop(const Func &func, const std::string &what) = 0;
+    virtual RunId runNext(Func &&func, const std::string &what) = 0;
+    virtual RunId runNext(const Func &func, const std::string &what) = 0;
+    virtual RunId run(Func &&func, const std::string &what) = 0;
+    virtual RunId run(const Func &func, const std::string &what) = 0;
+
+    /**
+     * 以下模板版本不经过 std::function，直接将 lambda 等可调用对象存放到 RunFunc
+     * 的内置缓冲中。只要捕获的内容不超过 RunFunc 内置缓冲的大小，投递任务就不会
+     * 分配内存；而 std::function 只能放下捕获两个指针的 lambda。
      */
-    virtual RunId runInLoop(Func &&func, const std::string &what = "") = 0;
-    virtual RunId runInLoop(const Func &func, const std::string &what = "") = 0;
-    virtual RunId runNext(Func &&func, const std::string &what = "") = 0;
-    virtual RunId runNext(const Func &func, const std::string &what = "") = 0;
-    virtual RunId run(Func &&func, const std::string &what = "") = 0;
-    virtual RunId run(const Func &func, const std::string &what = "") = 0;
+    using RunFunc = SmallFunction<void()>;
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Func>::value>::type>
+    RunId runInLoop(F &&func, const char *what = "") { return runInLoopFunc(RunFunc(std::forward<F>(func)), what); }
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Func>::value>::type>
+    RunId runNext(F &&func, const char *what = "") { return runNextFunc(RunFunc(std::forward<F>(func)), what); }
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Func>::value>::type>
+    RunId run(F &&func, const char *what = "") { return runFunc(RunFunc(std::forward<F>(func)), what); }
+
     virtual bool  cancel(RunId run_id) = 0;
 
     //! 创建事件
@@ -95,6 +134,62 @@ class Loop {
     virtual TimerEvent* newTimerEvent(const std::string &what = "") = 0;
     virtual SignalEvent* newSignalEvent(const std::string &what = "") = 0;
 
+    /**
+     * 选择定时器引擎，可以随时切换，已有的定时器会被迁移
+     *
+     * "wheel" 多级时间轮，默认。插入与删除均为 O(1)，适用于大量频繁取消的定时器
+     * "heap"  最小堆，插入与删除均为 O(logN)
+     *
+     * 注意：仅Loop线程中调用，禁止跨线程操作
+     */
+    virtual bool setTimerEngine(const std::string &timer_engine) = 0;
+
+    /**
+     * 轻量定时器，不需要创建 TimerEvent 对象
+     *
+     * 定时器节点由 Loop 内部的对象池分配，适用于大量频繁创建与取消的定时任务，如 eventx::TimerPool。
+     * interval 的单位为 us；repeat 为执行次数，0 表示一直重复。
+     * 执行完最后一次后自动删除，之后 deleteTimer() 返回 false。
+     *
+     * 注意：仅Loop线程中调用，禁止跨线程操作
+     */
+    using TimerToken = cabinet::Token;
+    using TimerCallback = std::function<void()>;
+    virtual TimerToken addTimer(uint64_t interval, uint64_t repeat, TimerCallback &&cb) = 0;
+    virtual bool deleteTimer(const TimerToken &token) = 0;
+
+    /**
+     * 基于完成通知的异步IO，目前仅 "io_uring" 引擎支持，其它引擎 isAsyncIoSupported() 返回 false
+     *
+     * 与 FdEvent 先等就绪再读写不同，这里是先提交读写请求，完成后再回调结果。
+     * 回调参数 res 与对应系统调用的返回值一致，出错时为 -errno。
+     * 每个请求只回调一次，cancelAsyncIo() 之后就不会再回调了。
+     *
+     * 内核直接读写使用者给出的 buff，引擎不做拷贝。buff 所在内存的生命期通过 holder 交给
+     * 引擎，引擎会一直持有它，直到内核不再访问为止，包括 cancelAsyncIo() 之后内核还没完成的
+     * 那段时间。所以 holder 必须保证 buff 有效，在此期间使用者也不应再改动 buff 中的数据。
+     *
+     * 设置了 O_NONBLOCK 的fd，未就绪时内核会直接返回 EAGAIN，引擎只能再挂一个 POLL_ADD 等
+     * 就绪后重试。为省掉这一轮，宜将fd设为阻塞模式，由 io_uring 在内核中等待，不会阻塞线程。
+     *
+     * 注意：仅Loop线程中调用，禁止跨线程操作
+     */
+    using AsyncIoId = uint64_t;   //!< 0 为无效值
+    using AsyncBuffHolder     = std::shared_ptr<void>;
+    using AsyncReadCallback   = std::function<void(ssize_t res)>;
+    using AsyncWriteCallback  = std::function<void(ssize_t res)>;
+    using AsyncAcceptCallback = std::function<void(int res)>; //!< res 为新连接的fd，已设置 NONBLOCK 与 CLOEXEC
+
+    virtual bool isAsyncIoSupported() const { return false; }
+    virtual AsyncIoId asyncRead(int /*fd*/, void * /*buff*/, size_t /*size*/,
+                                AsyncBuffHolder /*holder*/, AsyncReadCallback &&/*cb*/) { return 0; }
+    virtual AsyncIoId asyncRecv(int /*fd*/, void * /*buff*/, size_t /*size*/, int /*flags*/,
+                                AsyncBuffHolder /*holder*/, AsyncReadCallback &&/*cb*/) { return 0; }
+    virtual AsyncIoId asyncWrite(int /*fd*/, const void * /*data*/, size_t /*size*/,
+                                 AsyncBuffHolder /*holder*/, AsyncWriteCallback &&/*cb*/) { return 0; }
+    virtual AsyncIoId asyncAccept(int /*fd*/, AsyncAcceptCallback &&/*cb*/) { return 0; }
+    virtual bool cancelAsyncIo(AsyncIoId /*id*/) { return false; }
+
     //! 统计
     virtual Stat getStat() const = 0;
     virtual void resetStat() = 0;
@@ -117,6 +212,12 @@ class Loop {
 
   public:
     virtual ~Loop() { }
+
+  protected:
+    //! 由 runInLoop(), runNext(), run() 的模板版本调用
+    virtual RunId runInLoopFunc(RunFunc &&func, const char *what) = 0;
+    virtual RunId runNextFunc(RunFunc &&func, const char *what) = 0;
+    virtual RunId runFunc(RunFunc &&func, const char *what) = 0;
 };
 
 }
@@ -32,7 +32,8 @@ class TimerEvent : public Event {
   public:
     using Event::Event;
 
-    virtual bool initialize(const std::chrono::milliseconds &time_span, Mode mode) = 0;
+    //! 定时精度为 us，支持亚毫秒级的时长
+    virtual bool initialize(const std::chrono::nanoseconds &time_span, Mode mode) = 0;
 
     using CallbackFunc = std::function<void ()>;
     virtual void setCallback(CallbackFunc &&cb) = 0;
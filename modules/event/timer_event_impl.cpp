@@ -36,7 +36,7 @@ TimerEventImpl::~TimerEventImpl()
     disable();
 }
 
-bool TimerEventImpl::initialize(const std::chrono::milliseconds &interval, Mode mode)
+bool TimerEventImpl::initialize(const std::chrono::nanoseconds &interval, Mode mode)
 {
     disable();
 
@@ -64,7 +64,8 @@ bool TimerEventImpl::enable()
         return true;
 
     if (wp_loop_)
-        token_ = wp_loop_->addTimer(interval_.count(), mode_ == Mode::kOneshot ? 1 : 0, [this]{ onEvent(); });
+        token_ = wp_loop_->addTimer(std::chrono::duration_cast<std::chrono::microseconds>(interval_).count(),
+                                    mode_ == Mode::kOneshot ? 1 : 0, [this]{ onEvent(); });
 
     is_enabled_ = true;
 
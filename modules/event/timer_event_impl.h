@@ -34,7 +34,7 @@ class TimerEventImpl : public TimerEvent {
     virtual ~TimerEventImpl() override;
 
   public:
-    virtual bool initialize(const std::chrono::milliseconds &interval, Mode mode) override;
+    virtual bool initialize(const std::chrono::nanoseconds &interval, Mode mode) override;
     virtual void setCallback(CallbackFunc &&cb) override { cb_ = std::move(cb); }
 
     virtual bool isEnabled() const override;
@@ -52,7 +52,7 @@ class TimerEventImpl : public TimerEvent {
     bool is_inited_  = false;
     bool is_enabled_ = false;
 
-    std::chrono::milliseconds interval_;
+    std::chrono::nanoseconds interval_;
     Mode mode_ = Mode::kOneshot;
 
     CallbackFunc cb_;
@@ -138,5 +138,104 @@ TEST(TimerEvent, Precision)
     }
 }
 
+TEST(TimerEvent, TimerEngines)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        for (auto te : Loop::TimerEngines()) {
+            cout << "engine: " << e << ", timer engine: " << te << endl;
+            auto sp_loop = Loop::New(e);
+            EXPECT_TRUE(sp_loop->setTimerEngine(te));
+
+            auto oneshot_timer = sp_loop->newTimerEvent();
+            auto persist_timer = sp_loop->newTimerEvent();
+            auto cancel_timer = sp_loop->newTimerEvent();
+            EXPECT_TRUE(oneshot_timer->initialize(chrono::milliseconds(10), Event::Mode::kOneshot));
+            EXPECT_TRUE(persist_timer->initialize(chrono::milliseconds(10), Event::Mode::kPersist));
+            EXPECT_TRUE(cancel_timer->initialize(chrono::milliseconds(50), Event::Mode::kOneshot));
+
+            int oneshot_count = 0, persist_count = 0, cancel_count = 0;
+            oneshot_timer->setCallback([&] { ++oneshot_count; cancel_timer->disable(); });
+            persist_timer->setCallback([&] { ++persist_count; });
+            cancel_timer->setCallback([&] { ++cancel_count; });
+
+            EXPECT_TRUE(oneshot_timer->enable());
+            EXPECT_TRUE(persist_timer->enable());
+            EXPECT_TRUE(cancel_timer->enable());
+
+            sp_loop->exitLoop(std::chrono::milliseconds(100));
+            sp_loop->runLoop();
+
+            EXPECT_EQ(oneshot_count, 1);
+            EXPECT_EQ(persist_count, 10);
+            EXPECT_EQ(cancel_count, 0);
+
+            delete cancel_timer;
+            delete persist_timer;
+            delete oneshot_timer;
+            delete sp_loop;
+        }
+    }
+}
+
+TEST(TimerEvent, SwitchTimerEngine)
+{
+    auto sp_loop = Loop::New();
+    EXPECT_FALSE(sp_loop->setTimerEngine("unknown"));
+
+    auto timer_event = sp_loop->newTimerEvent();
+    EXPECT_TRUE(timer_event->initialize(chrono::milliseconds(10), Event::Mode::kPersist));
+    EXPECT_TRUE(timer_event->enable());
+
+    //! 运行过程中切换定时器引擎，已有的定时器不受影响
+    int run_time = 0;
+    timer_event->setCallback(
+        [&] {
+            ++run_time;
+            sp_loop->setTimerEngine(run_time % 2 ? "wheel" : "heap");
+        }
+    );
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(run_time, 10);
+
+    delete timer_event;
+    delete sp_loop;
+}
+
+TEST(TimerEvent, SubMillisecond)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        for (auto te : Loop::TimerEngines()) {
+            cout << "engine: " << e << ", timer engine: " << te << endl;
+            auto sp_loop = Loop::New(e);
+            EXPECT_TRUE(sp_loop->setTimerEngine(te));
+
+            auto timer_event = sp_loop->newTimerEvent();
+            EXPECT_TRUE(timer_event->initialize(chrono::microseconds(500), Event::Mode::kPersist));
+            EXPECT_TRUE(timer_event->enable());
+
+            int run_time = 0;
+            timer_event->setCallback([&]() { ++run_time; });
+
+            auto start_ts = chrono::steady_clock::now();
+            sp_loop->exitLoop(std::chrono::milliseconds(100));
+            sp_loop->runLoop();
+            auto elapsed_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_ts).count();
+
+            //! 100ms 内应触发 200 次，少数几次可能因为调度延迟未能赶上
+            //! 如果退出被延迟了，定时器会补触发，所以上限按实际运行时长计算
+            EXPECT_LE(run_time, elapsed_us / 500 + 1);
+            EXPECT_GE(run_time, 195);
+
+            delete timer_event;
+            delete sp_loop;
+        }
+    }
+}
+
 }
 }
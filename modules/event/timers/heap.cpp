@@ -0,0 +1,119 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "heap.h"
+
+namespace tbox {
+namespace event {
+
+void HeapTimerQueue::push(Timer *timer, uint64_t)
+{
+    timer_min_heap_.push_back(timer);
+    timer->heap_index = timer_min_heap_.size() - 1;
+    siftUp(timer->heap_index);
+}
+
+void HeapTimerQueue::erase(Timer *timer)
+{
+    size_t index = timer->heap_index;
+    Timer *last = timer_min_heap_.back();
+    timer_min_heap_.pop_back();
+
+    if (last == timer)
+        return;
+
+    //! 用最后一个填补空位，它可能比上面的小，也可能比下面的大
+    place(last, index);
+    if (index > 0 && last->expired < timer_min_heap_[(index - 1) / 2]->expired)
+        siftUp(index);
+    else
+        siftDown(index);
+}
+
+Timer* HeapTimerQueue::popExpired(uint64_t now)
+{
+    if (timer_min_heap_.empty())
+        return nullptr;
+
+    auto t = timer_min_heap_.front();
+    if (now < t->expired)
+        return nullptr;
+
+    erase(t);
+    return t;
+}
+
+int64_t HeapTimerQueue::getWaitTime(uint64_t now) const
+{
+    if (timer_min_heap_.empty())
+        return -1;
+
+    /// Get the top of minimum heap
+    int64_t wait_time = timer_min_heap_.front()->expired - now;
+    if (wait_time < 0) //! If expired is little than now, then we consider this timer invalid and trigger it immediately.
+        wait_time = 0;
+
+    return wait_time;
+}
+
+void HeapTimerQueue::takeAll(std::vector<Timer*> &timers)
+{
+    timers.insert(timers.end(), timer_min_heap_.begin(), timer_min_heap_.end());
+    timer_min_heap_.clear();
+}
+
+void HeapTimerQueue::place(Timer *timer, size_t index)
+{
+    timer_min_heap_[index] = timer;
+    timer->heap_index = index;
+}
+
+void HeapTimerQueue::siftUp(size_t index)
+{
+    Timer *timer = timer_min_heap_[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (timer_min_heap_[parent]->expired <= timer->expired)
+            break;
+        place(timer_min_heap_[parent], index);
+        index = parent;
+    }
+    place(timer, index);
+}
+
+void HeapTimerQueue::siftDown(size_t index)
+{
+    Timer *timer = timer_min_heap_[index];
+    size_t size = timer_min_heap_.size();
+    while (true) {
+        size_t child = index * 2 + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && timer_min_heap_[child + 1]->expired < timer_min_heap_[child]->expired)
+            ++child;
+        if (timer->expired <= timer_min_heap_[child]->expired)
+            break;
+        place(timer_min_heap_[child], index);
+        index = child;
+    }
+    place(timer, index);
+}
+
+}
+}
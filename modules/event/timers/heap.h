@@ -0,0 +1,54 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_TIMERS_HEAP_H_20250612
+#define TBOX_EVENT_TIMERS_HEAP_H_20250612
+
+#include "timer_queue.h"
+
+namespace tbox {
+namespace event {
+
+/**
+ * 基于最小堆的定时器队列
+ *
+ * 每个定时器记录自己在堆中的下标，删除时直接定位，不必重建整个堆
+ */
+class HeapTimerQueue : public TimerQueue {
+  public:
+    virtual void push(Timer *timer, uint64_t now) override;
+    virtual void erase(Timer *timer) override;
+    virtual Timer* popExpired(uint64_t now) override;
+    virtual int64_t getWaitTime(uint64_t now) const override;
+    virtual void takeAll(std::vector<Timer*> &timers) override;
+
+    virtual size_t size() const override { return timer_min_heap_.size(); }
+
+  private:
+    void place(Timer *timer, size_t index);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+
+    std::vector<Timer*> timer_min_heap_;
+};
+
+}
+}
+
+#endif //TBOX_EVENT_TIMERS_HEAP_H_20250612
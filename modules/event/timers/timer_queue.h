@@ -0,0 +1,78 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_TIMER_QUEUE_H_20250612
+#define TBOX_EVENT_TIMER_QUEUE_H_20250612
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <tbox/base/cabinet_token.h>
+
+namespace tbox {
+namespace event {
+
+//! 侵入式双向链表节点
+struct TimerListNode {
+    TimerListNode *prev = nullptr;
+    TimerListNode *next = nullptr;
+};
+
+//! 定时器，由 CommonLoop::addTimer() 创建
+struct Timer : public TimerListNode {
+    cabinet::Token token;
+    uint64_t interval = 0;
+    uint64_t expired = 0;
+    uint64_t repeat = 0;
+    size_t heap_index = 0;  //!< 在最小堆中的下标，仅 HeapTimerQueue 使用
+
+    std::function<void()> cb;
+};
+
+/**
+ * 定时器队列接口
+ *
+ * 负责按到期时间组织定时器，由 CommonLoop 使用。
+ * 目前有两种实现：
+ * - heap : 最小堆，插入与删除 O(logN)
+ * - wheel: 多级时间轮，插入与删除 O(1)，到期处理均摊 O(1)
+ */
+class TimerQueue {
+  public:
+    virtual ~TimerQueue() { }
+
+    //! 添加定时器，其 expired 字段必须已设置
+    virtual void push(Timer *timer, uint64_t now) = 0;
+    //! 移除定时器
+    virtual void erase(Timer *timer) = 0;
+    //! 取出一个在 now 之前到期的定时器，没有则返回 nullptr
+    virtual Timer* popExpired(uint64_t now) = 0;
+    //! 获取距离最近一个定时器到期的时长，没有定时器则返回 -1
+    virtual int64_t getWaitTime(uint64_t now) const = 0;
+    //! 取出所有的定时器，用于切换定时器引擎
+    virtual void takeAll(std::vector<Timer*> &timers) = 0;
+
+    virtual size_t size() const = 0;
+};
+
+}
+}
+
+#endif //TBOX_EVENT_TIMER_QUEUE_H_20250612
@@ -0,0 +1,309 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "heap.h"
+#include "wheel.h"
+
+namespace tbox {
+namespace event {
+namespace {
+
+using namespace std;
+
+TimerQueue* NewTimerQueue(const string &type)
+{
+    if (type == "heap")
+        return new HeapTimerQueue;
+    else
+        return new WheelTimerQueue;
+}
+
+const vector<string> kTimerEngines = { "heap", "wheel" };
+
+TEST(TimerQueue, PopInOrder)
+{
+    for (auto &e : kTimerEngines) {
+        cout << "timer engine: " << e << endl;
+        unique_ptr<TimerQueue> queue(NewTimerQueue(e));
+
+        //! 覆盖近端轮、各级远端轮与超出范围的情况
+        vector<uint64_t> delays = { 0, 1, 255, 256, 300, 16383, 16384, 100000, 1048576, 70000000, 5000000000ull };
+        vector<Timer> timers(delays.size());
+
+        uint64_t now = 1000;
+        for (size_t i = 0; i < delays.size(); ++i) {
+            timers[i].expired = now + delays[i];
+            queue->push(&timers[i], now);
+        }
+        EXPECT_EQ(queue->size(), delays.size());
+
+        for (size_t i = 0; i < delays.size(); ++i) {
+            auto wait_time = queue->getWaitTime(now);
+            ASSERT_GE(wait_time, 0);
+            EXPECT_LE(now + wait_time, timers[i].expired);
+
+            //! 快到期时不应提前弹出
+            if (timers[i].expired > now) {
+                EXPECT_EQ(queue->popExpired(timers[i].expired - 1), nullptr);
+            }
+
+            now = timers[i].expired;
+            EXPECT_EQ(queue->popExpired(now), &timers[i]);
+        }
+
+        EXPECT_EQ(queue->popExpired(now), nullptr);
+        EXPECT_EQ(queue->size(), 0u);
+        EXPECT_EQ(queue->getWaitTime(now), -1);
+    }
+}
+
+TEST(TimerQueue, Erase)
+{
+    for (auto &e : kTimerEngines) {
+        cout << "timer engine: " << e << endl;
+        unique_ptr<TimerQueue> queue(NewTimerQueue(e));
+
+        vector<Timer> timers(3);
+        uint64_t now = 0;
+        timers[0].expired = 10;
+        timers[1].expired = 20;
+        timers[2].expired = 20000;
+        for (auto &t : timers)
+            queue->push(&t, now);
+
+        queue->erase(&timers[0]);
+        queue->erase(&timers[2]);
+        EXPECT_EQ(queue->size(), 1u);
+        EXPECT_EQ(queue->getWaitTime(now), 20);
+
+        EXPECT_EQ(queue->popExpired(30000), &timers[1]);
+        EXPECT_EQ(queue->popExpired(30000), nullptr);
+        EXPECT_EQ(queue->size(), 0u);
+    }
+}
+
+TEST(TimerQueue, PushExpired)
+{
+    for (auto &e : kTimerEngines) {
+        cout << "timer engine: " << e << endl;
+        unique_ptr<TimerQueue> queue(NewTimerQueue(e));
+
+        Timer t;
+        t.expired = 100;
+        queue->push(&t, 200);
+        EXPECT_EQ(queue->getWaitTime(200), 0);
+        EXPECT_EQ(queue->popExpired(200), &t);
+    }
+}
+
+TEST(TimerQueue, TakeAll)
+{
+    for (auto &e : kTimerEngines) {
+        cout << "timer engine: " << e << endl;
+        unique_ptr<TimerQueue> queue(NewTimerQueue(e));
+
+        vector<Timer> timers(100);
+        for (size_t i = 0; i < timers.size(); ++i) {
+            timers[i].expired = i * 1000;
+            queue->push(&timers[i], 0);
+        }
+
+        vector<Timer*> taken;
+        queue->takeAll(taken);
+        EXPECT_EQ(taken.size(), timers.size());
+        EXPECT_EQ(queue->size(), 0u);
+        EXPECT_EQ(queue->popExpired(1000000), nullptr);
+    }
+}
+
+//! 最小堆按下标直接删除：删除堆顶、末尾、中间任意位置后，剩下的仍按到期时间弹出
+TEST(TimerQueue, HeapEraseAnywhere)
+{
+    HeapTimerQueue heap;
+
+    const size_t kNum = 1000;
+    vector<Timer> timers(kNum);
+    vector<bool> pushed(kNum, false);
+    mt19937 rand_engine(2);
+
+    for (int round = 0; round < 20; ++round) {
+        //! 到期时间的范围很小，有大量相等的
+        for (size_t i = 0; i < kNum; ++i) {
+            if (!pushed[i]) {
+                timers[i].expired = rand_engine() % 100;
+                heap.push(&timers[i], 0);
+                pushed[i] = true;
+            }
+        }
+
+        //! 先删堆顶，再随机删掉一半
+        Timer *top = heap.popExpired(100);
+        ASSERT_NE(top, nullptr);
+        pushed[top - timers.data()] = false;
+        for (size_t i = 0; i < kNum; ++i) {
+            if (pushed[i] && rand_engine() % 2 == 0) {
+                heap.erase(&timers[i]);
+                pushed[i] = false;
+            }
+        }
+
+        size_t pushed_num = count(pushed.begin(), pushed.end(), true);
+        ASSERT_EQ(heap.size(), pushed_num);
+
+        //! 弹出一部分，检查顺序，剩下的留到下一轮，与新加入的混在一起
+        uint64_t last_expired = 0;
+        for (size_t i = 0; i < pushed_num / 2; ++i) {
+            Timer *t = heap.popExpired(100);
+            ASSERT_NE(t, nullptr);
+            size_t index = t - timers.data();
+            ASSERT_TRUE(pushed[index]);
+            EXPECT_GE(t->expired, last_expired);
+            last_expired = t->expired;
+            pushed[index] = false;
+        }
+    }
+
+    //! 最后全部弹出，应与记录的一致
+    uint64_t last_expired = 0;
+    Timer *t = nullptr;
+    while ((t = heap.popExpired(100)) != nullptr) {
+        size_t index = t - timers.data();
+        ASSERT_TRUE(pushed[index]);
+        EXPECT_GE(t->expired, last_expired);
+        last_expired = t->expired;
+        pushed[index] = false;
+    }
+    EXPECT_EQ(count(pushed.begin(), pushed.end(), true), 0);
+}
+
+//! 与最小堆的结果进行比对
+TEST(TimerQueue, RandomCompareWithHeap)
+{
+    HeapTimerQueue heap;
+    WheelTimerQueue wheel;
+
+    const size_t kNum = 10000;
+    vector<Timer> heap_timers(kNum), wheel_timers(kNum);
+    vector<bool> pushed(kNum, false);
+
+    mt19937 rand_engine(1);
+    uint64_t now = 123456;
+
+    //! 轮流使用不同的时间跨度，以覆盖近端轮、远端轮的各种情况
+    const uint64_t kDelayRanges[] = { 300, 100000, 50000000 };
+    const uint64_t kStepRanges[] = { 3000, 3000, 3000, 3000, 2000000 };
+
+    for (int round = 0; round < 2000; ++round) {
+        auto delay_range = kDelayRanges[round % 3];
+        for (int i = 0; i < 100; ++i) {
+            auto index = rand_engine() % kNum;
+            if (pushed[index]) {
+                heap.erase(&heap_timers[index]);
+                wheel.erase(&wheel_timers[index]);
+            }
+            heap_timers[index].expired = wheel_timers[index].expired = now + rand_engine() % delay_range;
+            heap.push(&heap_timers[index], now);
+            wheel.push(&wheel_timers[index], now);
+            pushed[index] = true;
+        }
+
+        now += rand_engine() % kStepRanges[round % 5];
+
+        vector<size_t> heap_expired, wheel_expired;
+        Timer *t = nullptr;
+        while ((t = heap.popExpired(now)) != nullptr)
+            heap_expired.push_back(t - heap_timers.data());
+        while ((t = wheel.popExpired(now)) != nullptr)
+            wheel_expired.push_back(t - wheel_timers.data());
+
+        for (auto index : heap_expired)
+            pushed[index] = false;
+
+        sort(heap_expired.begin(), heap_expired.end());
+        sort(wheel_expired.begin(), wheel_expired.end());
+        ASSERT_EQ(heap_expired, wheel_expired);
+        ASSERT_EQ(heap.size(), wheel.size());
+    }
+}
+
+/**
+ * 分别在 1K, 100K, 1M 个定时器的规模下，测试插入、取消、到期的耗时
+ */
+TEST(TimerQueue, Benchmark)
+{
+    const uint64_t kMaxDelay = 60000;
+    const size_t kCancelNum = 20;
+
+    for (size_t num : { 1000u, 100000u, 1000000u }) {
+        vector<Timer> timers(num);
+        vector<size_t> cancel_indexes;
+
+        mt19937 rand_engine(1);
+        for (auto &t : timers)
+            t.expired = rand_engine() % kMaxDelay + 1;
+        for (size_t i = 0; i < kCancelNum; ++i)
+            cancel_indexes.push_back(rand_engine() % num);
+
+        for (auto &e : kTimerEngines) {
+            unique_ptr<TimerQueue> queue(NewTimerQueue(e));
+
+            auto start = chrono::steady_clock::now();
+            for (auto &t : timers)
+                queue->push(&t, 0);
+            auto push_cost = chrono::steady_clock::now() - start;
+
+            //! 取消之后再重新添加，以保持定时器的数量不变
+            start = chrono::steady_clock::now();
+            for (auto index : cancel_indexes) {
+                queue->erase(&timers[index]);
+                queue->push(&timers[index], 0);
+            }
+            auto cancel_cost = chrono::steady_clock::now() - start;
+
+            //! 模拟 Loop 的行为：等待到最近的定时器到期，再取出所有到期的定时器
+            start = chrono::steady_clock::now();
+            size_t expired_num = 0;
+            uint64_t now = 0;
+            while (queue->size() > 0) {
+                now += queue->getWaitTime(now);
+                while (queue->popExpired(now) != nullptr)
+                    ++expired_num;
+            }
+            auto expire_cost = chrono::steady_clock::now() - start;
+            EXPECT_EQ(expired_num, num);
+
+            cout << "timers: " << num << ", engine: " << e
+                 << ", push: " << chrono::duration_cast<chrono::nanoseconds>(push_cost).count() / num << " ns/op"
+                 << ", cancel: " << chrono::duration_cast<chrono::nanoseconds>(cancel_cost).count() / kCancelNum << " ns/op"
+                 << ", expire: " << chrono::duration_cast<chrono::nanoseconds>(expire_cost).count() / num << " ns/op"
+                 << endl;
+        }
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,318 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "wheel.h"
+
+#include <limits>
+
+namespace tbox {
+namespace event {
+
+constexpr int WheelTimerQueue::kNearBits;
+constexpr int WheelTimerQueue::kLevelBits;
+constexpr int WheelTimerQueue::kLevelNum;
+constexpr uint64_t WheelTimerQueue::kNearSize;
+constexpr uint64_t WheelTimerQueue::kNearMask;
+constexpr uint64_t WheelTimerQueue::kLevelSize;
+constexpr uint64_t WheelTimerQueue::kLevelMask;
+constexpr uint64_t WheelTimerQueue::kMaxSpan;
+
+namespace {
+
+inline void ListInit(TimerListNode *head)
+{
+    head->prev = head->next = head;
+}
+
+inline bool ListEmpty(const TimerListNode *head)
+{
+    return head->next == head;
+}
+
+inline void ListPushBack(TimerListNode *head, TimerListNode *node)
+{
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+inline void ListRemove(TimerListNode *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+//! 将 src 中的所有节点移到 dst 的尾部
+inline void ListSplice(TimerListNode *dst, TimerListNode *src)
+{
+    if (ListEmpty(src))
+        return;
+
+    src->next->prev = dst->prev;
+    dst->prev->next = src->next;
+    src->prev->next = dst;
+    dst->prev = src->prev;
+    ListInit(src);
+}
+
+}
+
+WheelTimerQueue::WheelTimerQueue()
+{
+    for (auto &slot : near_)
+        ListInit(&slot);
+
+    for (auto &level : levels_)
+        for (auto &slot : level)
+            ListInit(&slot);
+
+    for (auto &bits : near_bitmap_)
+        bits = 0;
+
+    for (auto &bits : level_bitmaps_)
+        bits = 0;
+
+    ListInit(&expired_list_);
+}
+
+void WheelTimerQueue::push(Timer *timer, uint64_t now)
+{
+    //! 队列为空时 current_tick_ 可能已经落后很久，直接对齐到当前时间
+    if (size_ == 0 && current_tick_ < now)
+        current_tick_ = now;
+
+    place(timer);
+    ++size_;
+}
+
+void WheelTimerQueue::erase(Timer *timer)
+{
+    ListRemove(timer);
+    --size_;
+}
+
+Timer* WheelTimerQueue::popExpired(uint64_t now)
+{
+    for (;;) {
+        if (!ListEmpty(&expired_list_)) {
+            auto node = expired_list_.next;
+            ListRemove(node);
+            --size_;
+            return static_cast<Timer*>(node);
+        }
+
+        if (size_ == 0) {
+            if (current_tick_ <= now)
+                current_tick_ = now + 1;
+            return nullptr;
+        }
+
+        //! 跳过中间没有定时器的 tick
+        auto tick = nextTick();
+        if (tick > now) {
+            current_tick_ = now + 1;
+            return nullptr;
+        }
+
+        current_tick_ = tick;
+        if ((tick & kNearMask) == 0)
+            cascade();
+
+        auto idx = tick & kNearMask;
+        ListSplice(&expired_list_, &near_[idx]);
+        near_bitmap_[idx / 64] &= ~(1ull << (idx % 64));
+
+        ++current_tick_;
+    }
+}
+
+int64_t WheelTimerQueue::getWaitTime(uint64_t now) const
+{
+    if (!ListEmpty(&expired_list_))
+        return 0;
+
+    if (size_ == 0)
+        return -1;
+
+    auto tick = nextTick();
+    return tick > now ? tick - now : 0;
+}
+
+void WheelTimerQueue::takeAll(std::vector<Timer*> &timers)
+{
+    auto take_list = [&timers] (TimerListNode *head) {
+        while (!ListEmpty(head)) {
+            auto node = head->next;
+            ListRemove(node);
+            timers.push_back(static_cast<Timer*>(node));
+        }
+    };
+
+    take_list(&expired_list_);
+
+    for (auto &slot : near_)
+        take_list(&slot);
+
+    for (auto &level : levels_)
+        for (auto &slot : level)
+            take_list(&slot);
+
+    for (auto &bits : near_bitmap_)
+        bits = 0;
+
+    for (auto &bits : level_bitmaps_)
+        bits = 0;
+
+    size_ = 0;
+}
+
+void WheelTimerQueue::place(Timer *timer)
+{
+    //! 已经过期了的定时器，直接放到到期链表中
+    if (timer->expired < current_tick_) {
+        ListPushBack(&expired_list_, timer);
+        return;
+    }
+
+    uint64_t expired = timer->expired;
+    uint64_t delta = expired - current_tick_;
+
+    if (delta < kNearSize) {
+        auto idx = expired & kNearMask;
+        ListPushBack(&near_[idx], timer);
+        near_bitmap_[idx / 64] |= 1ull << (idx % 64);
+        return;
+    }
+
+    if (delta > kMaxSpan) {
+        expired = current_tick_ + kMaxSpan;
+        delta = kMaxSpan;
+    }
+
+    for (int level = 0; level < kLevelNum; ++level) {
+        int shift = kNearBits + level * kLevelBits;
+        if (delta < (1ull << (shift + kLevelBits))) {
+            auto idx = (expired >> shift) & kLevelMask;
+            ListPushBack(&levels_[level][idx], timer);
+            level_bitmaps_[level] |= 1ull << idx;
+            return;
+        }
+    }
+}
+
+void WheelTimerQueue::cascade()
+{
+    for (int level = 0; level < kLevelNum; ++level) {
+        int shift = kNearBits + level * kLevelBits;
+        auto idx = (current_tick_ >> shift) & kLevelMask;
+
+        TimerListNode list;
+        ListInit(&list);
+        ListSplice(&list, &levels_[level][idx]);
+        level_bitmaps_[level] &= ~(1ull << idx);
+
+        while (!ListEmpty(&list)) {
+            auto node = list.next;
+            ListRemove(node);
+            place(static_cast<Timer*>(node));
+        }
+
+        //! 只有本级转完一圈，才需要处理上一级
+        if (idx != 0)
+            break;
+    }
+}
+
+uint64_t WheelTimerQueue::nextTick() const
+{
+    auto idx = current_tick_ & kNearMask;
+    auto base = current_tick_ - idx;
+
+    uint64_t next_tick = std::numeric_limits<uint64_t>::max();
+
+    int i = findNearSlot(idx);
+    if (i >= 0) {
+        //! 不在边界上时，远端轮最早也要在下一个边界才级联
+        if (idx != 0)
+            return base + i;
+        next_tick = base + i;
+
+    } else {
+        i = findNearSlot(0);
+        if (i >= 0)
+            next_tick = base + kNearSize + i;
+    }
+
+    //! 远端轮中非空槽的级联时刻
+    for (int level = 0; level < kLevelNum; ++level) {
+        int shift = kNearBits + level * kLevelBits;
+        uint64_t round = current_tick_ >> shift;
+        //! current_tick_ 恰好在本级边界上时，本级当前槽还没有级联
+        if ((current_tick_ & ((1ull << shift) - 1)) != 0)
+            ++round;
+
+        int d = findLevelSlot(level, round & kLevelMask);
+        if (d >= 0) {
+            uint64_t tick = (round + d) << shift;
+            if (tick < next_tick)
+                next_tick = tick;
+        }
+    }
+
+    return next_tick;
+}
+
+int WheelTimerQueue::findNearSlot(int from) const
+{
+    for (int w = from / 64; w < static_cast<int>(kNearSize / 64); ++w) {
+        uint64_t bits = near_bitmap_[w];
+        if (w == from / 64)
+            bits &= ~0ull << (from % 64);
+
+        while (bits != 0) {
+            int i = w * 64 + __builtin_ctzll(bits);
+            if (!ListEmpty(&near_[i]))
+                return i;
+
+            near_bitmap_[w] &= ~(1ull << (i % 64));
+            bits &= bits - 1;
+        }
+    }
+    return -1;
+}
+
+int WheelTimerQueue::findLevelSlot(int level, int from) const
+{
+    uint64_t &bits = level_bitmaps_[level];
+    while (bits != 0) {
+        uint64_t rotated = from == 0 ? bits : ((bits >> from) | (bits << (64 - from)));
+        int d = __builtin_ctzll(rotated);
+        int i = (from + d) & kLevelMask;
+        if (!ListEmpty(&levels_[level][i]))
+            return d;
+
+        bits &= ~(1ull << i);
+    }
+    return -1;
+}
+
+}
+}
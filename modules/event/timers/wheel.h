@@ -0,0 +1,87 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENT_TIMERS_WHEEL_H_20250612
+#define TBOX_EVENT_TIMERS_WHEEL_H_20250612
+
+#include "timer_queue.h"
+
+namespace tbox {
+namespace event {
+
+/**
+ * 基于多级时间轮的定时器队列
+ *
+ * 由一个 256 槽的近端轮与四个 64 槽的远端轮组成，覆盖 2^32 个 tick。
+ * tick 即 CommonLoop 的时间单位 us，覆盖约 71 分钟。
+ * 超出范围的定时器先放在最远的槽里，级联时再重新计算位置。
+ *
+ * 每个槽是侵入式双向链表，插入与删除都是 O(1)；
+ * 借助每一级的位图快速定位下一个非空的槽，使 getWaitTime() 与空转跳跃都是 O(1)。
+ */
+class WheelTimerQueue : public TimerQueue {
+  public:
+    explicit WheelTimerQueue();
+
+  public:
+    virtual void push(Timer *timer, uint64_t now) override;
+    virtual void erase(Timer *timer) override;
+    virtual Timer* popExpired(uint64_t now) override;
+    virtual int64_t getWaitTime(uint64_t now) const override;
+    virtual void takeAll(std::vector<Timer*> &timers) override;
+
+    virtual size_t size() const override { return size_; }
+
+  private:
+    static constexpr int kNearBits  = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevelNum  = 4;
+    static constexpr uint64_t kNearSize  = 1ull << kNearBits;
+    static constexpr uint64_t kNearMask  = kNearSize - 1;
+    static constexpr uint64_t kLevelSize = 1ull << kLevelBits;
+    static constexpr uint64_t kLevelMask = kLevelSize - 1;
+    static constexpr uint64_t kMaxSpan   = (1ull << (kNearBits + kLevelBits * kLevelNum)) - 1;
+
+    //! 将定时器放到对应的槽中
+    void place(Timer *timer);
+    //! 将远端轮中到期的槽降级
+    void cascade();
+    //! 下一个需要处理的 tick，是所有定时器到期时间的下界
+    uint64_t nextTick() const;
+
+    int findNearSlot(int from) const;
+    int findLevelSlot(int level, int from) const;
+
+  private:
+    TimerListNode near_[kNearSize];
+    TimerListNode levels_[kLevelNum][kLevelSize];
+
+    //! 非空槽位图，删除定时器时不即时清除，查找时再检查
+    mutable uint64_t near_bitmap_[kNearSize / 64];
+    mutable uint64_t level_bitmaps_[kLevelNum];
+
+    TimerListNode expired_list_;    //!< 已到期，等待被取出的定时器
+    uint64_t current_tick_ = 0;     //!< 下一个将要处理的 tick
+    size_t size_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_EVENT_TIMERS_WHEEL_H_20250612
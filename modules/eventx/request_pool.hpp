@@ -20,7 +20,6 @@
 #ifndef TBOX_UTIL_REQUEST_POOL_HPP_20220429
 #define TBOX_UTIL_REQUEST_POOL_HPP_20220429
 
-#include <tbox/base/cabinet.hpp>
 #include <tbox/event/loop.h>
 #include "timeout_monitor.hpp"
 
@@ -44,12 +43,13 @@ namespace eventx {
  * 2.在超时之后，能自动回复一个超时数据包；
  * 3.在业务处理完后，可根据token获取请求的上下文。
  *
- * 在实现上，利用 TimeoutMonitor 做超时功能
+ * 在实现上，利用 TimeoutMonitor 做超时功能，请求的上下文直接存在 TimeoutMonitor 中，
+ * Token 就是 TimeoutMonitor 的 Token。请求被取走时即从计时环中移除，不会留到超时再处理。
  */
 template <class T>
 class RequestPool {
   public:
-    using Token = cabinet::Token;
+    using Token = typename TimeoutMonitor<T*>::Token;
     using Duration = std::chrono::milliseconds;
     using TimeoutAction = std::function<void(T*)>;
 
@@ -71,8 +71,7 @@ class RequestPool {
 
     //! 设置超时回调
     void setTimeoutAction(const TimeoutAction &action) {
-        timeout_monitor_.setCallback([=] (const Token &token) {
-            auto req_ctx = req_ctx_cabinet_.free(token);
+        timeout_monitor_.setCallback([=] (T *req_ctx) {
             if (req_ctx != nullptr) {
                 if (action)
                     action(req_ctx);
@@ -82,9 +81,8 @@ class RequestPool {
     }
 
     void cleanup() {
+        timeout_monitor_.foreach([](T* req_ctx) { delete req_ctx; });
         timeout_monitor_.cleanup();
-        req_ctx_cabinet_.foreach([](T* req_ctx) { delete req_ctx; });
-        req_ctx_cabinet_.clear();
     }
 
     /**
@@ -93,9 +91,7 @@ class RequestPool {
      * \return  Token   请求的标识，后面可以拿这个标识来取之前存入的req_ctx
      */
     Token newRequest(T *req_ctx = nullptr) {
-        auto token = req_ctx_cabinet_.alloc(req_ctx);
-        timeout_monitor_.add(token);
-        return token;
+        return timeout_monitor_.add(req_ctx);
     }
 
     /**
@@ -106,7 +102,11 @@ class RequestPool {
      * \note    通常用于 newRequest() 时不方法提供上下文件，后面又需要更新的场景
      */
     bool updateRequest(const Token &token, T *req_ctx) {
-        return req_ctx_cabinet_.update(token, req_ctx);
+        auto p_req_ctx = timeout_monitor_.find(token);
+        if (p_req_ctx == nullptr)
+            return false;
+        *p_req_ctx = req_ctx;
+        return true;
     }
 
     /**
@@ -116,12 +116,16 @@ class RequestPool {
      * \note    在移除之后，RequestPool中就不再有该请求的记录了
      */
     T* removeRequest(const Token &token) {
-        return req_ctx_cabinet_.free(token);
+        auto p_req_ctx = timeout_monitor_.find(token);
+        if (p_req_ctx == nullptr)
+            return nullptr;
+        auto req_ctx = *p_req_ctx;
+        timeout_monitor_.remove(token);
+        return req_ctx;
     }
 
   private:
-    cabinet::Cabinet<T>     req_ctx_cabinet_;
-    TimeoutMonitor<Token>   timeout_monitor_;
+    TimeoutMonitor<T*>  timeout_monitor_;
 };
 
 }
@@ -18,6 +18,10 @@
  * of the source tree.
  */
 #include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <algorithm>
 #include "request_pool.hpp"
 #include <tbox/base/scope_exit.hpp>
 
@@ -124,6 +128,58 @@ TEST(RequestPool, Lost)
     EXPECT_EQ(count, 100);
 }
 
+/**
+ * 10万个未完成的请求，其中九成在超时前就被取走了，分别按先后顺序与乱序取走
+ *
+ * 统计创建与取走请求的耗时，以及处理超时所花的 Loop 时间
+ */
+TEST(RequestPool, Benchmark)
+{
+    const int kReqNum = 100000;
+
+    auto sp_loop = Loop::New();
+    SetScopeExitAction([=] {delete sp_loop;});
+
+    RequestPool<int> rp(sp_loop);
+    rp.initialize(milliseconds(10), 10);
+
+    int timeout_count = 0;
+    rp.setTimeoutAction([&] (int *p) { ++timeout_count; (void)p; });
+
+    std::vector<int> fifo_order(kReqNum);
+    for (int i = 0; i < kReqNum; ++i)
+        fifo_order[i] = i;
+
+    std::vector<int> random_order(fifo_order);
+    std::shuffle(random_order.begin(), random_order.end(), std::mt19937(1));
+
+    std::vector<RequestPool<int>::Token> tokens(kReqNum);
+    for (int round = 0; round < 4; ++round) {
+        auto &remove_order = (round % 2 == 0) ? fifo_order : random_order;
+        timeout_count = 0;
+        auto start = steady_clock::now();
+
+        for (int i = 0; i < kReqNum; ++i)
+            tokens[i] = rp.newRequest(new int(i));
+        for (int i : remove_order) {
+            if (i % 10 != 0)
+                delete rp.removeRequest(tokens[i]);
+        }
+
+        auto req_cost = steady_clock::now() - start;
+
+        sp_loop->resetStat();
+        sp_loop->exitLoop(milliseconds(150));
+        sp_loop->runLoop();
+        auto stat = sp_loop->getStat();
+
+        EXPECT_EQ(timeout_count, kReqNum / 10);
+        std::cout << "round " << round << (round % 2 == 0 ? " fifo: " : " random: ")
+                  << duration_cast<nanoseconds>(req_cost).count() / kReqNum << " ns/request, "
+                  << "loop cost " << stat.loop_acc_cost_us << " us" << std::endl;
+    }
+}
+
 }
 }
 }
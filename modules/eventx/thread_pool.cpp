@@ -21,23 +21,24 @@
 
 #include <cinttypes>
 #include <array>
-#include <map>
-#include <set>
 #include <deque>
+#include <vector>
 #include <thread>
 #include <mutex>
-#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <chrono>
+#include <memory>
 
 #include <tbox/base/log.h>
 #include <tbox/base/cabinet.hpp>
-#include <tbox/base/assert.h>
 #include <tbox/base/catch_throw.h>
-#include <tbox/base/object_pool.hpp>
+#include <tbox/base/mpsc_queue.hpp>
 #include <tbox/base/wrapped_recorder.h>
 #include <tbox/event/loop.h>
 
+#include "work_stealing_deque.hpp"
+
 #undef  MODULE_ID
 #define MODULE_ID "tbox.thread_pool"
 
@@ -46,6 +47,75 @@ namespace eventx {
 
 using Clock = std::chrono::steady_clock;
 
+namespace {
+
+constexpr size_t kTokenShardNum = 8;            //!< Token表的分片数
+constexpr size_t kWorkerDequeCapacity = 256;    //!< 每个工作线程每个优先级队列的容量
+constexpr size_t kMaxWorkerNum = 64;            //!< 最多有多少个工作线程拥有自己的队列
+constexpr size_t kCompletionBatchSize = 256;    //!< 主线程每批最多执行多少个 main_cb
+
+//! 当前线程所属的线程池与其 Worker，用于判定 execute() 是否在工作线程中调用
+thread_local const void *_current_pool = nullptr;
+thread_local void *_current_worker = nullptr;
+//! 当前线程下一次分配Token所用的分片，各线程错开以减少竞争
+thread_local size_t _next_token_shard = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+}
+
+/**
+ * 任务项
+ *
+ * 完成后如果有 main_cb，任务项本身会被放入完成队列，交给主线程执行并释放
+ */
+struct ThreadPool::Task : public MpscQueueNode {
+    enum State {
+        kStateWaiting,
+        kStateExecuting,
+        kStateCancelled,
+    };
+
+    TaskToken token;
+    int level = 0;
+    NonReturnFunc backend_task;   //! 任务在工作线程中执行函数
+    NonReturnFunc main_cb;        //! 任务执行完成后由main_loop执行的回调函数
+    Clock::time_point create_time_point;
+
+    std::atomic<int> state{kStateWaiting};
+    std::atomic<int> ref_count{2};  //!< Token表与任务队列各持有一份
+};
+
+/**
+ * 工作线程的任务队列
+ *
+ * 创建后一直保留到 cleanup()，线程退出后可以给新线程复用，
+ * 以便其它线程随时可以窃取，不必担心被释放
+ */
+struct ThreadPool::Worker {
+    size_t index = 0;
+    bool is_used = false;   //!< 是否有线程在用，由 Data::lock 保护
+    std::array<WorkStealingDeque<Task*, kWorkerDequeCapacity>, THREAD_POOL_PRIO_SIZE> deques;
+};
+
+/**
+ * 完成队列
+ *
+ * 工作线程将完成的任务放入其中，由主线程在一次 runInLoop() 中批量执行 main_cb。
+ * 只有在没有待执行的批次时才会 runInLoop()，所以每批最多唤醒主线程一次。
+ * 每批最多执行 kCompletionBatchSize 个，还有剩余的就再发起一批，免得长时间占住主线程。
+ *
+ * 由 shared_ptr 持有，待执行的批次也持有一份，线程池先于它析构也没关系
+ */
+struct ThreadPool::CompletionQueue {
+    MpscQueue<Task> tasks;
+    std::atomic_bool is_drain_pending{false};   //!< 是否已 runInLoop() 了但还没有执行
+
+    ~CompletionQueue() {
+        //! 主线程的Loop没有执行到就被销毁了，任务项只释放，不执行
+        while (auto item = tasks.pop())
+            delete item;
+    }
+};
+
 //! ThreadPool 的私有数据
 struct ThreadPool::Data {
     event::Loop *wp_loop = nullptr; //!< 主线程
@@ -55,32 +125,50 @@ struct ThreadPool::Data {
     size_t min_thread_num = 0; //!< 最少的线程个数
     size_t max_thread_num = 0; //!< 最多的线程个数
 
-    std::mutex lock;                //!< 互斥锁
+    std::mutex lock;                //!< 互斥锁，保护线程的创建、退出与休眠
     std::condition_variable cond_var;   //!< 条件变量
 
-    cabinet::Cabinet<Task> undo_tasks_cabinet;
-    std::array<std::deque<TaskToken>, THREAD_POOL_PRIO_SIZE> undo_tasks_token; //!< 优先级任务列表，THREAD_POOL_PRIO_SIZE级
-    std::set<TaskToken> doing_tasks_token;    //!< 记录正在从事的任务
-
-    size_t idle_thread_num = 0;         //!< 空间线程个数
     cabinet::Cabinet<std::thread> threads_cabinet;
-    bool all_threads_stop_flag = false; //!< 是否所有工作线程立即停止标记
-
-    size_t undo_task_peak_num_ = 0;
+    std::atomic<size_t> thread_num{0};
+    std::atomic<size_t> idle_thread_num{0};     //!< 空间线程个数
+    std::atomic<size_t> wakeup_num{0};          //!< 已通知但还没有醒来的线程个数
+    std::atomic<bool> all_threads_stop_flag{false}; //!< 是否所有工作线程立即停止标记
+
+    //! Token表分片，Token的pos中包含了分片号
+    struct TokenShard {
+        std::mutex lock;
+        cabinet::Cabinet<Task> tasks;
+    };
+    std::array<TokenShard, kTokenShardNum> token_shards;
+
+    //! 全局注入队列，非工作线程提交的任务放在这里
+    struct InjectionQueue {
+        std::mutex lock;
+        std::deque<Task*> tasks;
+    };
+    std::array<InjectionQueue, THREAD_POOL_PRIO_SIZE> injection_queues;
+
+    std::array<Worker*, kMaxWorkerNum> workers;
+    std::atomic<size_t> worker_num{0};
+
+    std::atomic<size_t> undo_task_num{0};
+    std::array<std::atomic<size_t>, THREAD_POOL_PRIO_SIZE> level_undo_task_num; //!< 各优先级的等待任务数
+    std::atomic<size_t> doing_task_num{0};
+    std::atomic<size_t> undo_task_peak_num{0};
+
+    std::shared_ptr<CompletionQueue> completion_queue = std::make_shared<CompletionQueue>();
+
+    Data() {
+        for (auto &num : level_undo_task_num)
+            num = 0;
+    }
 
-    ObjectPool<Task> task_pool{64};
-};
+    TokenShard& shardOf(const TaskToken &token) { return token_shards[token.pos() % kTokenShardNum]; }
 
-/**
- * 任务项
- */
-struct ThreadPool::Task {
-    TaskToken token;
-    NonReturnFunc backend_task;   //! 任务在工作线程中执行函数
-    NonReturnFunc main_cb;        //! 任务执行完成后由main_loop执行的回调函数
-    Clock::time_point create_time_point;
-
-    Task *next = nullptr;
+    //! 全局Token转换为分片内的Token
+    static TaskToken LocalToken(const TaskToken &token) {
+        return TaskToken(token.id(), token.pos() / kTokenShardNum);
+    }
 };
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -117,13 +205,13 @@ bool ThreadPool::initialize(ssize_t min_thread_num, ssize_t max_thread_num)
         std::lock_guard<std::mutex> lg(d_->lock);
         d_->min_thread_num = min_thread_num;
         d_->max_thread_num = max_thread_num;
+        d_->all_threads_stop_flag = false;
 
         for (ssize_t i = 0; i < min_thread_num; ++i)
             if (!createWorker())
                 return false;
     }
 
-    d_->all_threads_stop_flag = false;
     d_->is_ready = true;
 
     return true;
@@ -146,29 +234,54 @@ ThreadExecutor::TaskToken ThreadPool::execute(NonReturnFunc &&backend_task, NonR
 
     int level = prio + THREAD_POOL_PRIO_MAX;
 
+    Task *item = new Task;
+    item->level = level;
+    item->backend_task = std::move(backend_task);
+    item->main_cb = std::move(main_cb);
+    item->create_time_point = Clock::now();
+
+    size_t shard_index = _next_token_shard++ % kTokenShardNum;
+    auto &shard = d_->token_shards[shard_index];
     {
-        std::lock_guard<std::mutex> lg(d_->lock);
+        std::lock_guard<std::mutex> lg(shard.lock);
+        auto local_token = shard.tasks.alloc(item);
+        item->token = token = TaskToken(local_token.id(), local_token.pos() * kTokenShardNum + shard_index);
+    }
 
-        Task *item = d_->task_pool.alloc();
-        item->backend_task = std::move(backend_task);
-        item->main_cb = std::move(main_cb);
-        item->create_time_point = Clock::now();
-        item->token = token = d_->undo_tasks_cabinet.alloc(item);
+    //! 先计数再入队，以免任务被领取时计数还没有加上
+    ++d_->level_undo_task_num[level];
+    size_t undo_task_num = ++d_->undo_task_num;
+    pushTask(item, level);
 
-        d_->undo_tasks_token.at(level).push_back(token);
-        //! 如果空闲线程不够分配未认领的任务，且还可以再创建新的线程
-        if (d_->undo_tasks_cabinet.size() > d_->idle_thread_num) {
-            if (d_->threads_cabinet.size() < d_->max_thread_num) {
+    //! 如果空闲线程不够分配未认领的任务，且还可以再创建新的线程
+    if (undo_task_num > d_->idle_thread_num) {
+        if (d_->thread_num < d_->max_thread_num) {
+            std::lock_guard<std::mutex> lg(d_->lock);
+            if (d_->thread_num < d_->max_thread_num)
                 createWorker();
-            } else {
-                if (d_->undo_task_peak_num_ < d_->undo_tasks_cabinet.size())
-                    d_->undo_task_peak_num_ = d_->undo_tasks_cabinet.size();
-            }
+        } else {
+            size_t peak_num = d_->undo_task_peak_num;
+            while (peak_num < undo_task_num &&
+                   !d_->undo_task_peak_num.compare_exchange_weak(peak_num, undo_task_num));
         }
     }
 
     LogDbg("create task %u", token.id());
-    d_->cond_var.notify_one();
+
+    /**
+     * 只有在休眠的线程中还有没被通知到的，才需要唤醒。醒来的线程会一直取到没有任务为止，
+     * 所以连续提交时，不必每次都加锁通知。
+     * 工作线程是在持锁的情况下先增加 idle_thread_num 再检查 undo_task_num 的，
+     * 而这里是先增加 undo_task_num 再检查 idle_thread_num，所以不会漏掉唤醒。
+     * 加锁是为了等它真正进入 wait()
+     */
+    if (d_->idle_thread_num > d_->wakeup_num) {
+        std::lock_guard<std::mutex> lg(d_->lock);
+        if (d_->idle_thread_num > d_->wakeup_num) {
+            ++d_->wakeup_num;
+            d_->cond_var.notify_one();
+        }
+    }
 
     return token;
 }
@@ -212,13 +325,17 @@ ThreadExecutor::TaskToken ThreadPool::execute(const NonReturnFunc &backend_task,
 
 ThreadExecutor::TaskStatus ThreadPool::getTaskStatus(TaskToken task_token) const
 {
-    std::lock_guard<std::mutex> lg(d_->lock);
-
-    if (d_->undo_tasks_cabinet.at(task_token) != nullptr)
-        return TaskStatus::kWaiting;
-
-    if (d_->doing_tasks_token.find(task_token) != d_->doing_tasks_token.end())
-        return TaskStatus::kExecuting;
+    auto &shard = d_->shardOf(task_token);
+    std::lock_guard<std::mutex> lg(shard.lock);
+
+    auto item = shard.tasks.at(Data::LocalToken(task_token));
+    if (item != nullptr) {
+        auto state = item->state.load();
+        if (state == Task::kStateWaiting)
+            return TaskStatus::kWaiting;
+        if (state == Task::kStateExecuting)
+            return TaskStatus::kExecuting;
+    }
 
     return TaskStatus::kNotFound;
 }
@@ -226,26 +343,33 @@ ThreadExecutor::TaskStatus ThreadPool::getTaskStatus(TaskToken task_token) const
 ThreadExecutor::CancelResult ThreadPool::cancel(TaskToken token)
 {
     RECORD_SCOPE();
-    std::lock_guard<std::mutex> lg(d_->lock);
-
-    //! 如果正在执行
-    if (d_->doing_tasks_token.find(token) != d_->doing_tasks_token.end())
-        return CancelResult::kExecuting;   //! 返回正在执行
-
-    //! 从高优先级向低优先级遍历，找出优先级最高的任务
-    for (size_t i = 0; i < d_->undo_tasks_token.size(); ++i) {
-        auto &tasks_token = d_->undo_tasks_token.at(i);
-        if (!tasks_token.empty()) {
-            auto iter = std::find(tasks_token.begin(), tasks_token.end(), token);
-            if (iter != tasks_token.end()) {
-                tasks_token.erase(iter);
-                d_->task_pool.free(d_->undo_tasks_cabinet.free(token));
-                return CancelResult::kSuccess;
-            }
-        }
+    auto &shard = d_->shardOf(token);
+    Task *item = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(shard.lock);
+
+        auto local_token = Data::LocalToken(token);
+        item = shard.tasks.at(local_token);
+        if (item == nullptr)
+            return CancelResult::kNotFound;   //! 返回没有找到
+
+        //! 与工作线程的领取竞争，谁先改了状态算谁的
+        int state = Task::kStateWaiting;
+        if (!item->state.compare_exchange_strong(state, Task::kStateCancelled))
+            return CancelResult::kExecuting;   //! 返回正在执行
+
+        shard.tasks.free(local_token);
     }
 
-    return CancelResult::kNotFound;   //! 返回没有找到
+    --d_->level_undo_task_num[item->level];
+    --d_->undo_task_num;
+
+    //! 任务还留在队列中，等被取出时再释放。但函数对象要在调用者线程中析构
+    item->backend_task = nullptr;
+    item->main_cb = nullptr;
+    releaseTask(item);
+
+    return CancelResult::kSuccess;
 }
 
 void ThreadPool::cleanup()
@@ -257,16 +381,6 @@ void ThreadPool::cleanup()
     std::vector<std::thread*> thread_vec;
     {
         std::lock_guard<std::mutex> lg(d_->lock);
-        //! 清空task中的任务
-        for (size_t i = 0; i < d_->undo_tasks_token.size(); ++i) {
-            auto &tasks_token = d_->undo_tasks_token.at(i);
-            while (!tasks_token.empty()) {
-                auto token = tasks_token.front();
-                d_->task_pool.free(d_->undo_tasks_cabinet.free(token));
-                tasks_token.pop_front();
-            }
-        }
-
         //! 将threads_cabinet中的线程搬到thread_vec
         thread_vec.reserve(d_->threads_cabinet.size());
         d_->threads_cabinet.foreach(
@@ -275,9 +389,9 @@ void ThreadPool::cleanup()
             }
         );
         d_->threads_cabinet.clear();
+        d_->all_threads_stop_flag = true;
     }
 
-    d_->all_threads_stop_flag = true;
     d_->cond_var.notify_all();
 
     //! 等待所有的线程退出
@@ -286,138 +400,213 @@ void ThreadPool::cleanup()
         delete t;
     }
 
+    //! 没有工作线程了，清空队列中的任务
+    for (auto &queue : d_->injection_queues) {
+        std::lock_guard<std::mutex> lg(queue.lock);
+        for (auto item : queue.tasks)
+            releaseTask(item);
+        queue.tasks.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(d_->lock);
+        for (size_t i = 0; i < d_->worker_num; ++i) {
+            auto worker = d_->workers[i];
+            for (auto &deque : worker->deques) {
+                Task *item = nullptr;
+                while (deque.pop(item))
+                    releaseTask(item);
+            }
+            delete worker;
+        }
+        d_->worker_num = 0;
+        d_->thread_num = 0;
+    }
+
+    for (auto &shard : d_->token_shards) {
+        std::lock_guard<std::mutex> lg(shard.lock);
+        shard.tasks.foreach([this] (Task *item) { releaseTask(item); });
+        shard.tasks.clear();
+    }
+
+    for (auto &num : d_->level_undo_task_num)
+        num = 0;
+    d_->undo_task_num = 0;
+
     d_->is_ready = false;
 }
 
 ThreadPool::Snapshot ThreadPool::snapshot() const
 {
     Snapshot ss;
-    std::lock_guard<std::mutex> lg(d_->lock);
 
     ss.idle_thread_num = d_->idle_thread_num;
-    ss.thread_num = d_->threads_cabinet.size();
-    ss.doing_task_num = d_->doing_tasks_token.size();
+    ss.thread_num = d_->thread_num;
+    ss.doing_task_num = d_->doing_task_num;
     for (size_t i = 0; i < THREAD_POOL_PRIO_SIZE; ++i)
-        ss.undo_task_num[i] = d_->undo_tasks_token[i].size();
-    ss.undo_task_peak_num = d_->undo_task_peak_num_;
+        ss.undo_task_num[i] = d_->level_undo_task_num[i];
+    ss.undo_task_peak_num = d_->undo_task_peak_num;
 
     return ss;
 }
 
-void ThreadPool::threadProc(ThreadToken thread_token)
+void ThreadPool::threadProc(ThreadToken thread_token, Worker *worker)
 {
     bool let_main_loop_join_me = false;
 
+    _current_pool = this;
+    _current_worker = worker;
+
     LogDbg("thread %u start", thread_token.id());
 
     while (true) {
-        Task* item = nullptr;
-        {
+        if (d_->all_threads_stop_flag) {
+            LogDbg("thread %u will exit, stop flag.", thread_token.id());
+            break;
+        }
+
+        Task* item = pickTask(worker);  //! 取出优先级最高的任务，不需要加锁
+        if (item == nullptr) {
             std::unique_lock<std::mutex> lk(d_->lock);
 
+            if (d_->all_threads_stop_flag) {
+                LogDbg("thread %u will exit, stop flag.", thread_token.id());
+                break;
+            }
+
+            //! 有任务却没有取到，是别的线程正在放入或领取，让一让再取
+            if (d_->undo_task_num > 0) {
+                lk.unlock();
+                std::this_thread::yield();
+                continue;
+            }
+
             /**
-             * 如果当前空闲的线程数量大于等于未被领取的任务数，且当前的线程个数已超过长驻线程数，
+             * 如果没有未被领取的任务，且当前的线程个数已超过长驻线程数，
              * 说明线程数据已满足现有要求则退出当前线程
              */
-            if ((d_->idle_thread_num >= d_->undo_tasks_cabinet.size()) && (d_->threads_cabinet.size() > d_->min_thread_num)) {
+            if (d_->thread_num > d_->min_thread_num) {
                 LogDbg("thread %u will exit, no more work.", thread_token.id());
+                --d_->thread_num;
                 let_main_loop_join_me = true;
                 break;
             }
 
             //! 等待任务
             ++d_->idle_thread_num;
-            d_->cond_var.wait(lk, std::bind(&ThreadPool::shouldThreadExitWaiting, this));
-            --d_->idle_thread_num;
-
-            /**
-             * 有两种情况会从 cond_var.wait() 退出
-             * 1. 任务队列中有任务需要执行时
-             * 2. 线程池 cleanup() 时要求所有工作线程退出时
-             *
-             * 所以，下面检查 all_threads_stop_flag 看是不是请求退出
-             */
-            if (d_->all_threads_stop_flag) {
-                LogDbg("thread %u will exit, stop flag.", thread_token.id());
-                break;
+            while (!shouldThreadExitWaiting()) {
+                d_->cond_var.wait(lk);
+                /**
+                 * 每次醒来都要减，哪怕醒来时任务已被别的线程取完了又要继续睡，
+                 * 否则 wakeup_num 会越积越多，再也通知不到休眠的线程。
+                 * 不一定是被通知醒的，少算了顶多是多通知一次
+                 */
+                if (d_->wakeup_num > 0)
+                    --d_->wakeup_num;
             }
-
-            item = popOneTask();    //! 从任务队列中取出优先级最高的任务
+            --d_->idle_thread_num;
+            continue;
         }
 
-        //! 后面就是去执行任务，不需要再加锁了
-        if (item != nullptr) {
-            RECORD_SCOPE();
-            {
-                std::lock_guard<std::mutex> lg(d_->lock);
-                d_->doing_tasks_token.insert(item->token);
-            }
-
-            LogDbg("thread %u pick task %u", thread_token.id(), item->token.id());
-
-            auto exec_time_point = Clock::now();
-            auto wait_time_cost = exec_time_point - item->create_time_point;
-
-            {
-                RECORD_SCOPE();
-                CatchThrow(item->backend_task, true);
-            }
+        RECORD_SCOPE();
+        LogDbg("thread %u pick task %u", thread_token.id(), item->token.id());
 
-            auto exec_time_cost = Clock::now() - exec_time_point;
+        auto exec_time_point = Clock::now();
+        auto wait_time_cost = exec_time_point - item->create_time_point;
 
-            LogDbg("thread %u finish task %u, cost %" PRIu64 " + %" PRIu64 " us",
-                   thread_token.id(), item->token.id(),
-                   wait_time_cost.count() / 1000,
-                   exec_time_cost.count() / 1000);
+        {
+            RECORD_SCOPE();
+            CatchThrow(item->backend_task, true);
+        }
 
-            /**
-             * 有时在妥托给WorkThread执行动作时，会在lamda中捕获智能指针，它所指向的
-             * 对象的析构函数是有动作的，如：http的sp_ctx要在析构中发送HTTP回复，如果
-             * 析构函数在子线程中执行，则会出现不希望见到的多线程竞争。为此，我们在main_cb
-             * 中也让它持有这个智能指针，希望智能指针所指的对象只在主线程中析构。
-             *
-             * 为了保证main_cb中的持有的对象能够在main_loop线程中被析构，
-             * 所以这里要先task_pool.free()，然后再runInLoop(std::move(main_cpp))
-             */
+        auto exec_time_cost = Clock::now() - exec_time_point;
 
-            auto main_cb = std::move(item->main_cb);
+        LogDbg("thread %u finish task %u, cost %" PRIu64 " + %" PRIu64 " us",
+               thread_token.id(), item->token.id(),
+               wait_time_cost.count() / 1000,
+               exec_time_cost.count() / 1000);
 
-            {
-                std::lock_guard<std::mutex> lg(d_->lock);
-                d_->doing_tasks_token.erase(item->token);
-                d_->task_pool.free(item);
-            }
+        /**
+         * 有时在妥托给WorkThread执行动作时，会在lamda中捕获智能指针，它所指向的
+         * 对象的析构函数是有动作的，如：http的sp_ctx要在析构中发送HTTP回复，如果
+         * 析构函数在子线程中执行，则会出现不希望见到的多线程竞争。为此，我们在main_cb
+         * 中也让它持有这个智能指针，希望智能指针所指的对象只在主线程中析构。
+         *
+         * 为了保证main_cb中的持有的对象能够在main_loop线程中被析构，
+         * 所以这里要先finishTask()，然后再将任务项连同main_cb交给主线程
+         */
 
-            if (main_cb) {
-                RECORD_SCOPE();
-                d_->wp_loop->runInLoop(std::move(main_cb), "ThreadPool::threadProc, invoke main_cb");
-            }
-        }
+        finishTask(item);
     }
 
     LogDbg("thread %u exit", thread_token.id());
 
     if (let_main_loop_join_me) {
+        //! 将自己队列中剩下的任务转到注入队列，再把队列让给后来的线程
+        if (worker != nullptr) {
+            for (int level = 0; level < THREAD_POOL_PRIO_SIZE; ++level) {
+                Task *item = nullptr;
+                while (worker->deques[level].pop(item)) {
+                    if (item->state == Task::kStateWaiting) {
+                        auto &queue = d_->injection_queues[level];
+                        std::lock_guard<std::mutex> lg(queue.lock);
+                        queue.tasks.push_back(item);
+                    } else {
+                        releaseTask(item);
+                    }
+                }
+            }
+        }
+
         //! 则将线程取出来，交给main_loop去join()，然后delete
         std::unique_lock<std::mutex> lk(d_->lock);
 
+        if (worker != nullptr)
+            worker->is_used = false;
+
+        //! 如果找不到，说明 cleanup() 已经将它取走，会由 cleanup() 来join()
         auto t = d_->threads_cabinet.free(thread_token);
-        TBOX_ASSERT(t != nullptr);
-        d_->wp_loop->runInLoop(
-            [t]{ t->join(); delete t; },
-            "ThreadPool::threadProc, join and delete it"
-        );
+        if (t != nullptr) {
+            d_->wp_loop->runInLoop(
+                [t]{ t->join(); delete t; },
+                "ThreadPool::threadProc, join and delete it"
+            );
+        }
         //! 这个操作放到最后来做是为了减少主线程join()的等待时长
     }
 }
 
+//! 需要在持有 d_->lock 的情况下调用
 bool ThreadPool::createWorker()
 {
     RECORD_SCOPE();
+
+    //! 优先复用已退出线程留下的队列
+    Worker *worker = nullptr;
+    size_t worker_num = d_->worker_num;
+    for (size_t i = 0; i < worker_num; ++i) {
+        if (!d_->workers[i]->is_used) {
+            worker = d_->workers[i];
+            break;
+        }
+    }
+
+    if (worker == nullptr && worker_num < kMaxWorkerNum) {
+        worker = new Worker;
+        worker->index = worker_num;
+        d_->workers[worker_num] = worker;
+        d_->worker_num = worker_num + 1;
+    }
+
+    //! 超出 kMaxWorkerNum 的线程没有自己的队列，只从注入队列取与窃取
+    if (worker != nullptr)
+        worker->is_used = true;
+
     ThreadToken thread_token = d_->threads_cabinet.alloc();
-    auto *new_thread = new std::thread(std::bind(&ThreadPool::threadProc, this, thread_token));
+    auto *new_thread = new std::thread(std::bind(&ThreadPool::threadProc, this, thread_token, worker));
     if (new_thread != nullptr) {
         d_->threads_cabinet.update(thread_token, new_thread);
+        ++d_->thread_num;
         LogDbg("create thread %u", thread_token.id());
         return true;
 
@@ -429,32 +618,132 @@ bool ThreadPool::createWorker()
 
 bool ThreadPool::shouldThreadExitWaiting() const
 {
-    if (d_->all_threads_stop_flag)
-        return true;
+    return d_->all_threads_stop_flag || d_->undo_task_num > 0;
+}
 
-    for (size_t i = 0; i < d_->undo_tasks_token.size(); ++i) {
-        const auto &tasks_token = d_->undo_tasks_token.at(i);
-        if (!tasks_token.empty()) {
-            return true;
-        }
+void ThreadPool::pushTask(Task *item, int level)
+{
+    //! 在本线程池的工作线程中提交的任务，优先放到自己的队列中
+    if (_current_pool == this && _current_worker != nullptr) {
+        auto worker = static_cast<Worker*>(_current_worker);
+        if (worker->deques[level].push(item))
+            return;
     }
 
-    return false;
+    auto &queue = d_->injection_queues[level];
+    std::lock_guard<std::mutex> lg(queue.lock);
+    queue.tasks.push_back(item);
 }
 
-ThreadPool::Task* ThreadPool::popOneTask()
+ThreadPool::Task* ThreadPool::pickTask(Worker *worker)
 {
-    //! 从高优先级向低优先级遍历，找出优先级最高的任务
-    for (size_t i = 0; i < d_->undo_tasks_token.size(); ++i) {
-        auto &tasks_token = d_->undo_tasks_token.at(i);
-        if (!tasks_token.empty()) {
-            TaskToken token = tasks_token.front();
-            tasks_token.pop_front();
-            return d_->undo_tasks_cabinet.free(token);
+    //! 从高优先级向低优先级遍历，依次从自己的队列、注入队列、其它线程的队列中取
+    for (int level = 0; level < THREAD_POOL_PRIO_SIZE; ++level) {
+        while (d_->level_undo_task_num[level] > 0) {
+            Task *item = nullptr;
+
+            //! 自己的队列也从顶部取，以保持先进先出。失败只因被窃取者抢先了，队列不空就再试
+            if (worker != nullptr) {
+                auto &deque = worker->deques[level];
+                while (!deque.empty() && !deque.steal(item));
+            }
+
+            if (item == nullptr) {
+                auto &queue = d_->injection_queues[level];
+                std::lock_guard<std::mutex> lg(queue.lock);
+                if (!queue.tasks.empty()) {
+                    item = queue.tasks.front();
+                    queue.tasks.pop_front();
+                }
+            }
+
+            if (item == nullptr) {
+                size_t worker_num = d_->worker_num;
+                size_t start = (worker != nullptr) ? worker->index + 1 : 0;
+                for (size_t i = 0; i < worker_num; ++i) {
+                    auto victim = d_->workers[(start + i) % worker_num];
+                    if (victim != worker && victim->deques[level].steal(item))
+                        break;
+                }
+            }
+
+            if (item == nullptr)
+                break;
+
+            if (tryStartTask(item, level))
+                return item;
         }
     }
     return nullptr;
 }
 
+bool ThreadPool::tryStartTask(Task *item, int level)
+{
+    int state = Task::kStateWaiting;
+    if (!item->state.compare_exchange_strong(state, Task::kStateExecuting)) {
+        //! 已被取消，队列持有的这份引用由取出者释放
+        releaseTask(item);
+        return false;
+    }
+
+    ++d_->doing_task_num;
+    --d_->level_undo_task_num[level];
+    --d_->undo_task_num;
+    return true;
+}
+
+void ThreadPool::finishTask(Task *item)
+{
+    auto &shard = d_->shardOf(item->token);
+    {
+        std::lock_guard<std::mutex> lg(shard.lock);
+        shard.tasks.free(Data::LocalToken(item->token));
+    }
+    --d_->doing_task_num;
+
+    //! Token表中已经找不到它了，两份引用都在本线程手上
+    if (!item->main_cb) {
+        delete item;
+        return;
+    }
+
+    RECORD_SCOPE();
+    auto &cq = d_->completion_queue;
+    cq->tasks.push(item);
+    //! 已有待执行的批次，它会带上这个任务，不必再唤醒主线程
+    if (!cq->is_drain_pending.exchange(true))
+        d_->wp_loop->runInLoop(std::bind(&ThreadPool::DrainCompletions, cq, d_->wp_loop), "ThreadPool::DrainCompletions");
+}
+
+void ThreadPool::DrainCompletions(const std::shared_ptr<CompletionQueue> &cq, event::Loop *wp_loop)
+{
+    RECORD_SCOPE();
+    /**
+     * 要在取之前清除标记，这之后放入的任务会发起新的批次。
+     * 用 exchange() 而不用 store()，是为了与放入者的 exchange() 同步，
+     * 保证标记之前放入的任务都能被取到
+     */
+    cq->is_drain_pending.exchange(false);
+
+    for (size_t i = 0; i < kCompletionBatchSize; ++i) {
+        auto item = cq->tasks.pop();
+        if (item == nullptr)
+            return;
+
+        CatchThrow(item->main_cb, true);
+        delete item;
+    }
+
+    //! 还有剩余的，让出主线程，排到Loop中其它事件的后面再执行
+    if (!cq->tasks.empty() && !cq->is_drain_pending.exchange(true))
+        wp_loop->runInLoop(std::bind(&ThreadPool::DrainCompletions, cq, wp_loop), "ThreadPool::DrainCompletions");
+}
+
+void ThreadPool::releaseTask(Task *item)
+{
+    if (--item->ref_count == 0)
+        delete item;
+}
+
 }
 }
@@ -23,6 +23,7 @@
 #include <limits>
 #include <functional>
 #include <array>
+#include <memory>
 
 #include <tbox/event/forward.h>
 
@@ -43,6 +44,18 @@ namespace eventx {
 
 /**
  * 线程池类
+ *
+ * 采用工作窃取的方式调度：
+ * - 每个优先级有一个全局注入队列，非工作线程提交的任务放入其中；
+ * - 每个工作线程每个优先级有一个 Chase-Lev 双端队列，在任务中再提交的任务优先放入其中；
+ * - 工作线程按优先级从高到低，依次从自己的队列、注入队列、其它线程的队列中取任务，
+ *   每个队列都从头部取，先进先出。
+ *
+ * 任务Token表按分片加锁，取消与查询都是 O(1) 的，不必与任务的提交、领取竞争同一把锁。
+ * 注意：同一线程在同一优先级提交的任务，按提交的顺序开始执行；
+ *       不同线程提交的任务之间，以及工作线程的队列满了而转入注入队列的任务，不保证先后。
+ *
+ * 任务完成后的 main_cb 会批量交给主线程执行，主线程每一批只被唤醒一次。
  */
 class ThreadPool : public ThreadExecutor {
   public:
@@ -127,13 +140,23 @@ class ThreadPool : public ThreadExecutor {
   protected:
     using ThreadToken = cabinet::Token;
 
-    void threadProc(ThreadToken thread_token);
+    struct Task;
+    struct Worker;
+    struct CompletionQueue;
+
+    void threadProc(ThreadToken thread_token, Worker *worker);
     bool createWorker();
 
     bool shouldThreadExitWaiting() const;   //! 判定子线程是否需要退出条件变量的wait()函数
 
-    struct Task;
-    Task* popOneTask(); //! 取出一个优先级最高的任务
+    void pushTask(Task *task, int level);   //! 将任务放入队列
+    Task* pickTask(Worker *worker);         //! 取出一个优先级最高的任务
+    bool tryStartTask(Task *task, int level);   //! 将任务标记为执行中，如果已被取消则返回false
+    void finishTask(Task *task);        //! 释放任务，有 main_cb 的交给主线程
+    void releaseTask(Task *task);
+
+    //! 在主线程中执行完成队列中任务的 main_cb，一批执行不完的再发起一批
+    static void DrainCompletions(const std::shared_ptr<CompletionQueue> &cq, event::Loop *wp_loop);
 
   private:
     struct Data;
@@ -18,6 +18,9 @@
  * of the source tree.
  */
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
 #include <gtest/gtest.h>
 
 #include <tbox/base/log.h>
@@ -268,4 +271,361 @@ TEST(ThreadPool, cleanup_before_finish) {
     delete loop;
 }
 
+/**
+ * 在任务中再提交子任务，所有任务都应被执行，且只执行一次
+ */
+TEST(ThreadPool, nested_execute) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(2, 4));
+
+    const int kParentNum = 20;
+    const int kChildNum = 500;  //! 超过工作线程队列的容量，有部分会放到注入队列
+    std::atomic<int> run_count(0);
+    int main_cb_count = 0;
+
+    for (int i = 0; i < kParentNum; ++i) {
+        tp->execute(
+            [&] {
+                for (int j = 0; j < kChildNum; ++j)
+                    tp->execute([&] { ++run_count; }, [&] { ++main_cb_count; }, j % 5 - 2);
+                ++run_count;
+            },
+            [&] { ++main_cb_count; }
+        );
+    }
+
+    auto timer = loop->newTimerEvent();
+    timer->initialize(chrono::milliseconds(10), Event::Mode::kPersist);
+    timer->setCallback(
+        [&] {
+            if (main_cb_count == kParentNum * (kChildNum + 1))
+                loop->exitLoop();
+        }
+    );
+    timer->enable();
+
+    loop->exitLoop(std::chrono::seconds(10));
+    loop->runLoop();
+
+    EXPECT_EQ(run_count, kParentNum * (kChildNum + 1));
+    EXPECT_EQ(main_cb_count, kParentNum * (kChildNum + 1));
+
+    auto ss = tp->snapshot();
+    EXPECT_EQ(ss.doing_task_num, 0u);
+    for (auto num : ss.undo_task_num)
+        EXPECT_EQ(num, 0u);
+
+    tp->cleanup();
+
+    delete timer;
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 同一线程在同一优先级提交的任务，按提交的顺序执行
+ */
+TEST(ThreadPool, fifo_in_same_prio) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 1));
+
+    const int kTaskNum = 100;   //! 不超过工作线程队列的容量
+    std::vector<int> main_order, nested_order;  //! 只有一个工作线程，不必加锁
+    int main_cb_count = 0;
+
+    for (int i = 0; i < kTaskNum; ++i)
+        tp->execute([&, i] { main_order.push_back(i); }, [&] { ++main_cb_count; });
+
+    tp->execute(
+        [&] {
+            for (int i = 0; i < kTaskNum; ++i)
+                tp->execute([&, i] { nested_order.push_back(i); }, [&] { ++main_cb_count; });
+        },
+        [&] { ++main_cb_count; }
+    );
+
+    auto timer = loop->newTimerEvent();
+    timer->initialize(chrono::milliseconds(10), Event::Mode::kPersist);
+    timer->setCallback(
+        [&] {
+            if (main_cb_count == kTaskNum * 2 + 1)
+                loop->exitLoop();
+        }
+    );
+    timer->enable();
+
+    loop->exitLoop(std::chrono::seconds(10));
+    loop->runLoop();
+
+    ASSERT_EQ(main_order.size(), size_t(kTaskNum));
+    ASSERT_EQ(nested_order.size(), size_t(kTaskNum));
+    for (int i = 0; i < kTaskNum; ++i) {
+        EXPECT_EQ(main_order[i], i);
+        EXPECT_EQ(nested_order[i], i);
+    }
+
+    tp->cleanup();
+
+    delete timer;
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 在工作线程领取任务的同时取消，每个任务要么被执行，要么被取消成功，不能两者都是或都不是
+ */
+TEST(ThreadPool, cancel_while_running) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(2, 2));
+
+    const int kTaskNum = 20000;
+    std::vector<std::atomic<int>> run_times(kTaskNum);
+    for (auto &t : run_times)
+        t = 0;
+
+    vector<ThreadPool::TaskToken> tokens;
+    for (int i = 0; i < kTaskNum; ++i)
+        tokens.push_back(tp->execute([&run_times, i] { ++run_times[i]; }));
+
+    std::vector<bool> is_cancelled(kTaskNum, false);
+    for (int i = kTaskNum - 1; i >= 0; i -= 2)
+        is_cancelled[i] = (tp->cancel(tokens[i]) == ThreadPool::CancelResult::kSuccess);
+
+    //! 等所有的任务都结束
+    for (int i = 0; i < 1000; ++i) {
+        auto ss = tp->snapshot();
+        size_t undo_task_num = 0;
+        for (auto num : ss.undo_task_num)
+            undo_task_num += num;
+        if (undo_task_num == 0 && ss.doing_task_num == 0)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    tp->cleanup();
+
+    int bad_num = 0;
+    for (int i = 0; i < kTaskNum; ++i) {
+        if (run_times[i] + (is_cancelled[i] ? 1 : 0) != 1)
+            ++bad_num;
+    }
+    EXPECT_EQ(bad_num, 0);
+
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 线程池在 main_cb 执行前就被删除了，main_cb 仍应在主线程中被执行
+ */
+TEST(ThreadPool, main_cb_after_delete) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 1));
+
+    const int kTaskNum = 100;
+    std::atomic<int> run_count(0);
+    int main_cb_count = 0;
+    auto main_thread_id = std::this_thread::get_id();
+
+    for (int i = 0; i < kTaskNum; ++i) {
+        tp->execute(
+            [&] { ++run_count; },
+            [&] {
+                EXPECT_EQ(std::this_thread::get_id(), main_thread_id);
+                ++main_cb_count;
+            }
+        );
+    }
+
+    while (run_count < kTaskNum)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    tp->cleanup();
+    delete tp;
+
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    EXPECT_EQ(main_cb_count, kTaskNum);
+
+    delete loop;
+}
+
+/**
+ * main_cb 抛出异常，不能影响其它的 main_cb
+ */
+TEST(ThreadPool, main_cb_throw) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 1));
+
+    const int kTaskNum = 10;
+    int main_cb_count = 0;
+
+    for (int i = 0; i < kTaskNum; ++i) {
+        tp->execute(
+            [] { },
+            [&, i] {
+                ++main_cb_count;
+                if (i % 2 == 0)
+                    throw std::runtime_error("main_cb throw");
+            }
+        );
+    }
+
+    loop->exitLoop(std::chrono::milliseconds(100));
+    loop->runLoop();
+
+    EXPECT_EQ(main_cb_count, kTaskNum);
+
+    tp->cleanup();
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 积压了很多 main_cb 时，要分批执行，中间让Loop中的其它事件有机会执行
+ */
+TEST(ThreadPool, main_cb_batch) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 1));
+
+    const int kTaskNum = 1000;
+    std::atomic<int> run_count(0);
+    int main_cb_count = 0;
+    int main_cb_count_when_other_run = -1;
+
+    for (int i = 0; i < kTaskNum; ++i) {
+        tp->execute(
+            [&] { ++run_count; },
+            [&] {
+                if (main_cb_count++ == 0)
+                    loop->runInLoop([&] { main_cb_count_when_other_run = main_cb_count; });
+            }
+        );
+    }
+
+    //! 等所有的任务都完成了再运行Loop，这时 main_cb 都积压在完成队列中
+    while (run_count < kTaskNum)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    loop->exitLoop(std::chrono::milliseconds(100));
+    loop->runLoop();
+
+    EXPECT_EQ(main_cb_count, kTaskNum);
+    EXPECT_GT(main_cb_count_when_other_run, 0);
+    EXPECT_LT(main_cb_count_when_other_run, kTaskNum);
+
+    tp->cleanup();
+    delete tp;
+    delete loop;
+}
+
+/**
+ * main_cb 的吞吐量与延迟
+ *
+ * 延迟是从 backend_task 完成到 main_cb 被执行的时长
+ */
+TEST(ThreadPool, MainCbBenchmark) {
+    const int kTaskNum = 100000;
+    const int kThreadNum = 4;
+
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(kThreadNum, kThreadNum));
+
+    std::vector<std::chrono::steady_clock::time_point> finish_time_points(kTaskNum);
+    int main_cb_count = 0;
+    std::chrono::nanoseconds acc_latency(0);
+    std::chrono::nanoseconds max_latency(0);
+
+    loop->resetStat();
+    auto start = std::chrono::steady_clock::now();
+
+    //! 由另一个线程提交，主线程只负责执行 main_cb
+    std::thread producer(
+        [&] {
+            for (int i = 0; i < kTaskNum; ++i) {
+                tp->execute(
+                    [&finish_time_points, i] { finish_time_points[i] = std::chrono::steady_clock::now(); },
+                    [&, i] {
+                        auto latency = std::chrono::steady_clock::now() - finish_time_points[i];
+                        acc_latency += latency;
+                        if (latency > max_latency)
+                            max_latency = latency;
+                        if (++main_cb_count == kTaskNum)
+                            loop->exitLoop();
+                    }
+                );
+            }
+        }
+    );
+
+    loop->exitLoop(std::chrono::seconds(10));
+    loop->runLoop();
+    producer.join();
+
+    auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    auto stat = loop->getStat();
+
+    EXPECT_EQ(main_cb_count, kTaskNum);
+    cout << kTaskNum * 1000000ll / cost_us << " main_cb/sec, "
+         << "latency avg " << acc_latency.count() / 1000 / main_cb_count << " us, "
+         << "max " << max_latency.count() / 1000 << " us, "
+         << "loop count " << stat.loop_count << endl;
+
+    tp->cleanup();
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 短任务的吞吐量
+ *
+ * 1. 主线程提交；
+ * 2. 在任务中提交子任务
+ */
+TEST(ThreadPool, Benchmark) {
+    const int kTaskNum = 200000;
+    const int kThreadNum = 4;
+
+    for (bool nested : { false, true }) {
+        Loop *loop = Loop::New();
+        ThreadPool *tp = new ThreadPool(loop);
+        ASSERT_TRUE(tp->initialize(kThreadNum, kThreadNum));
+
+        std::atomic<int> done_count(0);
+        auto start = std::chrono::steady_clock::now();
+
+        if (nested) {
+            const int kParentNum = 100;
+            for (int i = 0; i < kParentNum; ++i) {
+                tp->execute(
+                    [&] {
+                        for (int j = 0; j < kTaskNum / kParentNum; ++j)
+                            tp->execute([&] { ++done_count; });
+                    }
+                );
+            }
+        } else {
+            for (int i = 0; i < kTaskNum; ++i)
+                tp->execute([&] { ++done_count; });
+        }
+
+        while (done_count < kTaskNum)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+        auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        cout << (nested ? "nested" : "main") << ": " << kTaskNum * 1000000ll / cost_us << " tasks/sec" << endl;
+
+        tp->cleanup();
+        delete tp;
+        delete loop;
+    }
+}
+
 }
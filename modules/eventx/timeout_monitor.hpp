@@ -21,6 +21,9 @@
 #define TBOX_UTIL_TIMEOUT_MONITOR_HPP_20230218
 
 #include <vector>
+#include <limits>
+#include <tbox/base/defines.h>
+#include <tbox/base/cabinet_token.h>
 #include <tbox/event/loop.h>
 #include <tbox/event/timer_event.h>
 
@@ -32,17 +35,27 @@ namespace eventx {
  *
  * 该类通常配合cabinet::Cabinet使用，实现请求池功能
  * 用于管理请求的超时自动处理功能
+ *
+ * 计时环的每个槽只是一个桶指针，桶中的项连续存放，并通过项记录表支持 O(1) 移除：
+ * - add() 返回 Token，提前完成的项可以用 remove() 移除，不会再触发回调，
+ *   也不必在超时的时候再去别处查找它是否还有效；
+ * - 被移除的项只在桶中留下一个空槽，桶中的项全部被移除后，桶立即被回收；
+ * - 没有项的槽不持有桶，桶回收后保留容量以复用，check_times 再大也只占一个指针。
  */
 template <typename T>
 class TimeoutMonitor {
   public:
     using Duration = std::chrono::milliseconds;
     using Callback = std::function<void(const T&)>;
+    using Token = cabinet::Token;
 
   public:
     explicit TimeoutMonitor(event::Loop *wp_loop);
     virtual ~TimeoutMonitor();
 
+    NONCOPYABLE(TimeoutMonitor);
+    IMMOVABLE(TimeoutMonitor);
+
     /**
      * \brief   初始化
      *
@@ -51,12 +64,20 @@ class TimeoutMonitor {
      * \param   timeout_action  指定超时的动作
      *
      * \return  bool    成功与否，通常都不会失败
-     * \note    尽要权衡，不要让check_times太大
+     * \note    超时时长为 check_interval * check_times，精度为 check_interval
      */
     bool initialize(const Duration &check_interval, int check_times);
     void setCallback(const Callback &cb) { cb_ = cb; }
 
-    void add(const T &value);
+    Token add(const T &value);
+    //! 移除还没有超时的项，不会触发回调。不存在则返回 false
+    bool remove(const Token &token);
+    //! 获取还没有超时的项，不存在则返回 nullptr
+    T* find(const Token &token) const;
+    //! 遍历所有还没有超时的项，遍历过程中不允许 add() 与 remove()
+    void foreach(const std::function<void(T&)> &func);
+    size_t size() const { return value_number_; }
+
     void clear();
 
     void cleanup();
@@ -64,17 +85,51 @@ class TimeoutMonitor {
   protected:
     void onTimerTick();
 
-    struct PollItem {
-        PollItem *next = nullptr;
-        std::vector<T> items;
+    struct Bucket;
+
+    //! 桶中被移除的项的 record_pos
+    static constexpr cabinet::Pos kDeadSlot = std::numeric_limits<cabinet::Pos>::max();
+
+    struct Slot {
+        cabinet::Pos record_pos;    //!< 对应的项记录位置，为 kDeadSlot 表示已被移除
+        T value;
+    };
+
+    //! 项记录，Token 的 pos 即为记录的下标
+    struct Record {
+        cabinet::Id id = 0;         //!< 为 0 表示空闲
+        Bucket *bucket = nullptr;   //!< 项所在的桶
+        size_t index = 0;           //!< 项在桶中的下标；空闲时为下一个空闲记录的位置
     };
 
+    struct Bucket {
+        size_t ring_index = 0;      //!< 所在的计时环槽
+        size_t live_number = 0;     //!< 还没有被移除的项数
+        std::vector<Slot> slots;
+    };
+
+    const Record* findRecord(const Token &token) const;
+    cabinet::Pos allocRecord();
+    void freeRecord(cabinet::Pos pos);
+
+    Bucket* allocBucket(size_t ring_index);
+    void recycleBucket(Bucket *bucket);
+
   private:
     event::TimerEvent *sp_timer_;
     Callback    cb_;
     int         cb_level_ = 0;
-    PollItem   *curr_item_ = nullptr;
-    int         value_number_ = 0;
+
+    std::vector<Bucket*> ring_;     //!< 计时环，没有项的槽为 nullptr
+    size_t      curr_index_ = 0;
+    Bucket     *expired_ = nullptr; //!< 正在处理的超时桶，回调中 remove() 的也要能从中移除
+    size_t      expired_head_ = 0;  //!< expired_ 中已处理的项数
+    std::vector<Bucket*> spare_buckets_;    //!< 回收的空桶，保留了 slots 的容量
+
+    std::vector<Record> records_;
+    cabinet::Pos first_free_record_ = std::numeric_limits<cabinet::Pos>::max();
+    cabinet::Id  last_id_ = 0;
+    size_t      value_number_ = 0;
 };
 
 }
@@ -51,63 +51,127 @@ bool TimeoutMonitor<T>::initialize(const Duration &check_interval, int check_tim
     sp_timer_->initialize(check_interval, event::Event::Mode::kPersist);
     sp_timer_->setCallback(std::bind(&TimeoutMonitor::onTimerTick, this));
 
-    //! 创建计时环
-    curr_item_ = new PollItem;
-    auto last_item = curr_item_;
-    for (int i = 1; i < check_times; ++i) {
-        auto new_item = new PollItem;
-        last_item->next = new_item;
-        last_item = new_item;
-    }
-    last_item->next = curr_item_;
+    //! 创建计时环，只是一组桶指针，桶在有项时才分配
+    clear();
+    std::vector<Bucket*>(check_times, nullptr).swap(ring_);
+    curr_index_ = 0;
 
     return true;
 }
 
 template <typename T>
-void TimeoutMonitor<T>::add(const T &value)
+typename TimeoutMonitor<T>::Token TimeoutMonitor<T>::add(const T &value)
 {
-    curr_item_->items.push_back(value);
+    TBOX_ASSERT(!ring_.empty());
+
+    auto &bucket = ring_[curr_index_];
+    if (bucket == nullptr)
+        bucket = allocBucket(curr_index_);
+
+    auto pos = allocRecord();
+    auto &record = records_[pos];
+    record.bucket = bucket;
+    record.index = bucket->slots.size();
+    bucket->slots.push_back(Slot{pos, value});
+    ++bucket->live_number;
+
     if (value_number_ == 0)
         sp_timer_->enable();
     ++value_number_;
+
+    return Token(record.id, pos);
 }
 
 template <typename T>
-void TimeoutMonitor<T>::clear()
+bool TimeoutMonitor<T>::remove(const Token &token)
 {
-    if (value_number_ > 0) {
-        value_number_ = 0;
-        sp_timer_->disable();
+    auto record = findRecord(token);
+    if (record == nullptr)
+        return false;
 
-        PollItem *item = curr_item_;
-        do {
-            item->items.clear();
-            item = item->next;
-        } while (item != curr_item_);
+    //! 只标记为空槽，不挪动桶中其它的项，超时的项仍按添加的顺序处理
+    //! 值要立即释放，不能等到整个桶被回收
+    auto bucket = record->bucket;
+    auto &slot = bucket->slots[record->index];
+    slot.record_pos = kDeadSlot;
+    slot.value = T();
+    --bucket->live_number;
+    freeRecord(token.pos());
+
+    if (bucket->live_number == 0 && bucket != expired_) {
+        ring_[bucket->ring_index] = nullptr;
+        recycleBucket(bucket);
     }
+
+    --value_number_;
+    if (value_number_ == 0)
+        sp_timer_->disable();
+
+    return true;
 }
 
 template <typename T>
-void TimeoutMonitor<T>::cleanup()
+T* TimeoutMonitor<T>::find(const Token &token) const
 {
-    if (curr_item_ == nullptr)
-        return;
+    auto record = findRecord(token);
+    return record != nullptr ? &record->bucket->slots[record->index].value : nullptr;
+}
 
+template <typename T>
+void TimeoutMonitor<T>::foreach(const std::function<void(T&)> &func)
+{
+    for (auto bucket : ring_) {
+        if (bucket != nullptr) {
+            for (auto &slot : bucket->slots) {
+                if (slot.record_pos != kDeadSlot)
+                    func(slot.value);
+            }
+        }
+    }
+
+    if (expired_ != nullptr) {
+        for (auto i = expired_head_; i < expired_->slots.size(); ++i) {
+            auto &slot = expired_->slots[i];
+            if (slot.record_pos != kDeadSlot)
+                func(slot.value);
+        }
+    }
+}
+
+template <typename T>
+void TimeoutMonitor<T>::clear()
+{
     if (value_number_ > 0) {
-        sp_timer_->disable();
         value_number_ = 0;
-    }
+        sp_timer_->disable();
+
+        for (auto &bucket : ring_) {
+            if (bucket != nullptr) {
+                recycleBucket(bucket);
+                bucket = nullptr;
+            }
+        }
 
-    PollItem *item = curr_item_->next;
-    curr_item_->next = nullptr;
-    curr_item_ = nullptr;
+        //! 正在处理的超时桶由 onTimerTick() 回收
+        if (expired_ != nullptr)
+            expired_->slots.clear();
 
-    while (item != nullptr) {
-        auto next = item->next;
-        delete item;
-        item = next;
+        records_.clear();
+        first_free_record_ = std::numeric_limits<cabinet::Pos>::max();
     }
+}
+
+template <typename T>
+void TimeoutMonitor<T>::cleanup()
+{
+    clear();
+
+    for (auto bucket : spare_buckets_)
+        delete bucket;
+    std::vector<Bucket*>().swap(spare_buckets_);
+    std::vector<Bucket*>().swap(ring_);
+    std::vector<Record>().swap(records_);
+    curr_index_ = 0;
 
     cb_ = nullptr;
 }
@@ -115,21 +179,105 @@ void TimeoutMonitor<T>::cleanup()
 template <typename T>
 void TimeoutMonitor<T>::onTimerTick()
 {
-    curr_item_ = curr_item_->next;
+    curr_index_ = (curr_index_ + 1) % ring_.size();
+
+    //! 整个桶从计时环中取下，回调中 add() 的项放入的是新的桶
+    expired_ = ring_[curr_index_];
+    if (expired_ == nullptr)
+        return;
+
+    ring_[curr_index_] = nullptr;
+    expired_head_ = 0;
+
+    ++cb_level_;
+    while (expired_head_ < expired_->slots.size()) {
+        auto &slot = expired_->slots[expired_head_++];
+        if (slot.record_pos == kDeadSlot)
+            continue;
+
+        freeRecord(slot.record_pos);
+        --value_number_;
+
+        T value = std::move(slot.value);
+        slot.value = T();
+        if (cb_)
+            cb_(value);
+    }
+    --cb_level_;
+
+    auto bucket = expired_;
+    expired_ = nullptr;
+    expired_head_ = 0;
 
-    std::vector<T> tobe_handle;
-    std::swap(tobe_handle, curr_item_->items);
+    if (ring_.empty())  //! 在回调中执行了 cleanup()
+        delete bucket;
+    else
+        recycleBucket(bucket);
 
-    value_number_ -= tobe_handle.size();
     if (value_number_ == 0)
         sp_timer_->disable();
+}
 
-    if (cb_) {
-        ++cb_level_;
-        for (auto value : tobe_handle)
-            cb_(value);
-        --cb_level_;
+template <typename T>
+const typename TimeoutMonitor<T>::Record* TimeoutMonitor<T>::findRecord(const Token &token) const
+{
+    if (token.isNull() || token.pos() >= records_.size())
+        return nullptr;
+
+    auto &record = records_[token.pos()];
+    return record.id == token.id() ? &record : nullptr;
+}
+
+template <typename T>
+cabinet::Pos TimeoutMonitor<T>::allocRecord()
+{
+    //! 避免分配 0 作为 id
+    if (last_id_ == std::numeric_limits<cabinet::Id>::max())
+        last_id_ = 0;
+
+    cabinet::Pos pos = first_free_record_;
+    if (pos != std::numeric_limits<cabinet::Pos>::max()) {
+        first_free_record_ = records_[pos].index;
+    } else {
+        pos = records_.size();
+        records_.push_back(Record());
+    }
+
+    records_[pos].id = ++last_id_;
+    return pos;
+}
+
+template <typename T>
+void TimeoutMonitor<T>::freeRecord(cabinet::Pos pos)
+{
+    auto &record = records_[pos];
+    record.id = 0;
+    record.bucket = nullptr;
+    record.index = first_free_record_;
+    first_free_record_ = pos;
+}
+
+template <typename T>
+typename TimeoutMonitor<T>::Bucket* TimeoutMonitor<T>::allocBucket(size_t ring_index)
+{
+    Bucket *bucket = nullptr;
+    if (!spare_buckets_.empty()) {
+        bucket = spare_buckets_.back();
+        spare_buckets_.pop_back();
+    } else {
+        bucket = new Bucket;
     }
+
+    bucket->ring_index = ring_index;
+    return bucket;
+}
+
+template <typename T>
+void TimeoutMonitor<T>::recycleBucket(Bucket *bucket)
+{
+    bucket->slots.clear();
+    bucket->live_number = 0;
+    spare_buckets_.push_back(bucket);
 }
 
 }
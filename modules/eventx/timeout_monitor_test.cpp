@@ -18,6 +18,8 @@
  * of the source tree.
  */
 #include <gtest/gtest.h>
+#include <vector>
+#include <memory>
 #include "timeout_monitor.hpp"
 #include <tbox/base/scope_exit.hpp>
 
@@ -88,6 +90,90 @@ TEST(TimeoutMonitor, Clear)
     EXPECT_FALSE(run);
 }
 
+
+TEST(TimeoutMonitor, Remove)
+{
+    auto sp_loop = Loop::New();
+    SetScopeExitAction([=] {delete sp_loop;});
+
+    TimeoutMonitor<int> tm(sp_loop);
+    tm.initialize(milliseconds(10), 3);
+
+    std::vector<int> timeout_values;
+    tm.setCallback([&] (int value) { timeout_values.push_back(value); });
+
+    auto token_100 = tm.add(100);
+    auto token_101 = tm.add(101);
+    tm.add(102);
+    EXPECT_EQ(tm.size(), 3u);
+
+    EXPECT_TRUE(tm.remove(token_101));
+    EXPECT_FALSE(tm.remove(token_101));
+    ASSERT_NE(tm.find(token_100), nullptr);
+    EXPECT_EQ(*tm.find(token_100), 100);
+    EXPECT_EQ(tm.find(token_101), nullptr);
+    EXPECT_EQ(tm.size(), 2u);
+
+    sp_loop->exitLoop(milliseconds(100));
+    sp_loop->runLoop();
+
+    ASSERT_EQ(timeout_values.size(), 2u);
+    EXPECT_EQ(timeout_values[0], 100);
+    EXPECT_EQ(timeout_values[1], 102);
+    EXPECT_EQ(tm.size(), 0u);
+    EXPECT_FALSE(tm.remove(token_100));
+}
+
+//! 移除后，值要立即被释放，不能留到超时的时候
+TEST(TimeoutMonitor, RemoveReleaseValue)
+{
+    auto sp_loop = Loop::New();
+    SetScopeExitAction([=] {delete sp_loop;});
+
+    TimeoutMonitor<std::shared_ptr<int>> tm(sp_loop);
+    tm.initialize(milliseconds(10), 3);
+
+    auto sp_value = std::make_shared<int>(100);
+    auto token = tm.add(sp_value);
+    tm.add(std::make_shared<int>(101));     //! 让桶不会因为空了而被回收
+    EXPECT_EQ(sp_value.use_count(), 2);
+
+    EXPECT_TRUE(tm.remove(token));
+    EXPECT_EQ(sp_value.use_count(), 1);
+}
+
+//! 在超时回调中移除同一批中还没有处理的项，以及添加新的项
+TEST(TimeoutMonitor, RemoveInCallback)
+{
+    auto sp_loop = Loop::New();
+    SetScopeExitAction([=] {delete sp_loop;});
+
+    TimeoutMonitor<int> tm(sp_loop);
+    tm.initialize(milliseconds(10), 2);
+
+    std::vector<int> timeout_values;
+    TimeoutMonitor<int>::Token token_2;
+    tm.setCallback([&] (int value) {
+        timeout_values.push_back(value);
+        if (value == 1) {
+            EXPECT_TRUE(tm.remove(token_2));
+            tm.add(4);
+        }
+    });
+
+    tm.add(1);
+    token_2 = tm.add(2);
+    tm.add(3);
+
+    sp_loop->exitLoop(milliseconds(100));
+    sp_loop->runLoop();
+
+    ASSERT_EQ(timeout_values.size(), 3u);
+    EXPECT_EQ(timeout_values[0], 1);
+    EXPECT_EQ(timeout_values[1], 3);
+    EXPECT_EQ(timeout_values[2], 4);
+}
+
 }
 }
 }
@@ -22,8 +22,8 @@
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/cabinet.hpp>
+#include <tbox/base/object_pool.hpp>
 #include <tbox/event/loop.h>
-#include <tbox/event/timer_event.h>
 
 #undef  MODULE_ID
 #define MODULE_ID "tbox.timer_pool"
@@ -31,6 +31,10 @@
 namespace tbox {
 namespace eventx {
 
+/**
+ * 直接使用 Loop::addTimer() 实现，不再为每个任务创建 TimerEvent 对象。
+ * 任务节点从对象池中分配，交给 Loop 的回调只捕获两个指针，不会引起 std::function 的内存分配。
+ */
 class TimerPool::Impl {
   public:
     Impl(event::Loop *wp_loop) : wp_loop_(wp_loop) { }
@@ -44,9 +48,24 @@ class TimerPool::Impl {
     bool cancel(const TimerToken &token);
     void cleanup();
 
+  protected:
+    struct Task {
+        TimerToken token;
+        event::Loop::TimerToken loop_timer_token;
+        bool is_oneshot = false;
+        bool is_cancelled = false;  //!< 在自己的回调中被取消了，等回调结束再回收
+        Callback cb;
+    };
+
+    TimerToken addTask(const Milliseconds &m_sec, bool is_oneshot, Callback &&cb);
+    void onTaskExpired(Task *task);
+    void freeTask(Task *task);
+
   private:
     event::Loop *wp_loop_;
-    cabinet::Cabinet<event::TimerEvent> timers_;
+    cabinet::Cabinet<Task> tasks_;
+    ObjectPool<Task> task_pool_;
+    Task *running_task_ = nullptr;  //!< 正在执行回调的周期任务
 };
 
 TimerPool::Impl::~Impl()
@@ -56,46 +75,12 @@ TimerPool::Impl::~Impl()
 
 TimerPool::TimerToken TimerPool::Impl::doEvery(const Milliseconds &m_sec, Callback &&cb)
 {
-    if (!cb) {
-        LogWarn("cb == nullptr");
-        return TimerToken();
-    }
-
-    auto timer = wp_loop_->newTimerEvent("TimerPool::doEvery");
-    auto token = timers_.alloc(timer);
-    timer->initialize(m_sec, event::Event::Mode::kPersist);
-    timer->setCallback(std::move(cb));
-    timer->enable();
-    return token;
+    return addTask(m_sec, false, std::move(cb));
 }
 
 TimerPool::TimerToken TimerPool::Impl::doAfter(const Milliseconds &m_sec, Callback &&cb)
 {
-    if (!cb) {
-        LogWarn("cb == nullptr");
-        return TimerToken();
-    }
-
-    auto timer = wp_loop_->newTimerEvent("TimerPool::doAfter");
-    auto token = timers_.alloc(timer);
-    timer->initialize(m_sec, event::Event::Mode::kOneshot);
-
-#if __cplusplus >= 201402L
-    timer->setCallback([this, cb = std::move(cb), token] {
-        cb();
-        auto timer = timers_.free(token);
-        wp_loop_->runNext([timer] { delete timer; });
-    });
-#elif __cplusplus >= 201103L
-    timer->setCallback([this, cb, token] {
-        cb();
-        auto timer = timers_.free(token);
-        wp_loop_->runNext([timer] { delete timer; });
-    });
-#endif
-
-    timer->enable();
-    return token;
+    return addTask(m_sec, true, std::move(cb));
 }
 
 TimerPool::TimerToken TimerPool::Impl::doAt(const TimePoint &time_point, Callback &&cb)
@@ -107,31 +92,73 @@ TimerPool::TimerToken TimerPool::Impl::doAt(const TimePoint &time_point, Callbac
 
 bool TimerPool::Impl::cancel(const TimerToken &token)
 {
-    auto timer = timers_.free(token);
-    if (timer != nullptr) {
-        timer->disable();
-        if (wp_loop_->isRunning())
-            wp_loop_->run([timer] { delete timer; }, "TimerPool::cancel");
-        else
-            delete timer;
-        return true;
-    }
+    auto task = tasks_.free(token);
+    if (task == nullptr)
+        return false;
 
-    return false;
+    wp_loop_->deleteTimer(task->loop_timer_token);
+    freeTask(task);
+    return true;
 }
 
 void TimerPool::Impl::cleanup()
 {
-    timers_.foreach(
-        [this](event::TimerEvent *timer) {
-            timer->disable();
-            if (wp_loop_->isRunning())
-                wp_loop_->run([timer]{ delete timer; }, "TimerPool::cleanup");
-            else
-                delete timer;
+    tasks_.foreach(
+        [this](Task *task) {
+            wp_loop_->deleteTimer(task->loop_timer_token);
+            freeTask(task);
         }
     );
-    timers_.clear();
+    tasks_.clear();
+}
+
+TimerPool::TimerToken TimerPool::Impl::addTask(const Milliseconds &m_sec, bool is_oneshot, Callback &&cb)
+{
+    if (!cb) {
+        LogWarn("cb == nullptr");
+        return TimerToken();
+    }
+
+    //! doAt() 指定的时间点已经过去了，就尽快执行
+    int64_t interval_us = std::chrono::duration_cast<std::chrono::microseconds>(m_sec).count();
+    if (interval_us < 0)
+        interval_us = 0;
+
+    auto task = task_pool_.alloc();
+    task->token = tasks_.alloc(task);
+    task->is_oneshot = is_oneshot;
+    task->cb = std::move(cb);
+    task->loop_timer_token = wp_loop_->addTimer(interval_us, is_oneshot ? 1 : 0,
+                                                [this, task] { onTaskExpired(task); });
+    return task->token;
+}
+
+void TimerPool::Impl::onTaskExpired(Task *task)
+{
+    if (task->is_oneshot) {
+        //! Loop 已经删除了定时器，先回收任务，回调中再 doAfter() 就可以复用它
+        tasks_.free(task->token);
+        auto cb = std::move(task->cb);
+        task_pool_.free(task);
+        cb();
+        return;
+    }
+
+    running_task_ = task;
+    task->cb();
+    running_task_ = nullptr;
+
+    if (task->is_cancelled)
+        task_pool_.free(task);
+}
+
+void TimerPool::Impl::freeTask(Task *task)
+{
+    //! 回调还在执行，不能析构它
+    if (task == running_task_)
+        task->is_cancelled = true;
+    else
+        task_pool_.free(task);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -34,6 +34,7 @@ namespace eventx {
 
 //! 定时任务管理器
 //! 让开发者轻松创建定时任务而不必关心定时器的生命期
+//! 任务直接挂在 Loop 的定时器上，不创建 TimerEvent 对象，cancel() 是 O(1) 的
 class TimerPool {
   public:
     using TimerToken = cabinet::Token;
@@ -0,0 +1,110 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+/**
+ * 统计 TimerPool 的内存分配次数与耗时
+ *
+ * 这里替换了全局的 operator new，会影响同一个程序中的所有测试，
+ * 所以单独编译成 tbox_eventx_alloc_test，不与 tbox_eventx_test 放在一起。
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "timer_pool.h"
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+
+namespace {
+std::atomic<size_t> _new_times(0);
+}
+
+void* operator new(size_t size)
+{
+    ++_new_times;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+namespace tbox {
+namespace eventx {
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * 大量单次任务的创建、取消与执行
+ *
+ * 统计每个任务的 operator new 次数与每个操作的耗时。
+ * 两轮：第一轮对象池还是空的，第二轮可以复用
+ */
+TEST(TimerPoolAlloc, Benchmark)
+{
+    const int kTaskNum = 100000;
+
+    for (auto timer_engine : event::Loop::TimerEngines()) {
+        cout << "timer engine: " << timer_engine << endl;
+
+        event::Loop *sp_loop = event::Loop::New();
+        SetScopeExitAction([sp_loop]{ delete sp_loop;});
+        ASSERT_TRUE(sp_loop->setTimerEngine(timer_engine));
+
+        TimerPool timer_pool(sp_loop);
+
+        std::vector<TimerPool::TimerToken> tokens(kTaskNum);
+        for (int round = 0; round < 2; ++round) {
+            int run_count = 0;
+            size_t new_times = _new_times;
+            auto start = steady_clock::now();
+
+            for (int i = 0; i < kTaskNum; ++i)
+                tokens[i] = timer_pool.doAfter(milliseconds(1 + i % 50), [&] { ++run_count; });
+            for (int i = 0; i < kTaskNum; i += 2)
+                timer_pool.cancel(tokens[i]);
+
+            auto schedule_cost = steady_clock::now() - start;
+            new_times = _new_times - new_times;
+
+            timer_pool.doAfter(milliseconds(60), [sp_loop] { sp_loop->exitLoop(); });
+            sp_loop->runLoop();
+
+            auto total_cost = steady_clock::now() - start;
+            EXPECT_EQ(run_count, kTaskNum / 2);
+
+            cout << "round " << round << ": "
+                 << duration_cast<nanoseconds>(schedule_cost).count() / (kTaskNum * 3 / 2) << " ns/op, "
+                 << static_cast<double>(new_times) / kTaskNum << " new/task, "
+                 << "total " << duration_cast<milliseconds>(total_cost).count() << " ms" << endl;
+        }
+
+        timer_pool.cleanup();
+    }
+}
+
+}
+}
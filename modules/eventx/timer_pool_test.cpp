@@ -229,3 +229,32 @@ TEST(TimerPool, all)
     EXPECT_EQ(count, 5);
     EXPECT_TRUE(is_run);
 }
+
+/**
+ * 在周期任务的回调中取消自己，之后不应再被执行
+ */
+TEST(TimerPool, cancel_self_in_callback)
+{
+    Loop *sp_loop = event::Loop::New();
+    TimerPool timer_pool(sp_loop);
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int count = 0;
+    TimerPool::TimerToken token;
+    token = timer_pool.doEvery(milliseconds(10),
+        [&] {
+            ++count;
+            if (count == 3) {
+                EXPECT_TRUE(timer_pool.cancel(token));
+            }
+        }
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_FALSE(timer_pool.cancel(token));
+    timer_pool.cleanup();
+
+    EXPECT_EQ(count, 3);
+}
@@ -0,0 +1,142 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENTX_WORK_STEALING_DEQUE_HPP_20251018
+#define TBOX_EVENTX_WORK_STEALING_DEQUE_HPP_20251018
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace eventx {
+
+/**
+ * 工作窃取双端队列（Chase-Lev），容量固定，无锁
+ *
+ * 只有持有者线程可以在底部 push() 与 pop()，后进先出；
+ * 任意线程（包括持有者）都可以从顶部 steal()，先进先出。
+ * 取失败时不会修改 value。
+ * 满了就 push() 失败，由调用者另做处理，所以不需要扩容，也就不存在旧缓冲的回收问题。
+ *
+ * 参考：Lê, Pop, Cohen, Zappa Nardelli.
+ *       Correct and Efficient Work-Stealing for Weak Memory Models. PPoPP 2013
+ */
+template <typename T, size_t CAPACITY>
+class WorkStealingDeque {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be power of 2");
+
+  public:
+    WorkStealingDeque() {
+        for (auto &item : buffer_)
+            item.store(T(), std::memory_order_relaxed);
+    }
+
+    NONCOPYABLE(WorkStealingDeque);
+    IMMOVABLE(WorkStealingDeque);
+
+  public:
+    //! 在底部放入，仅由持有者线程调用。满了返回 false
+    bool push(T value) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(CAPACITY))
+            return false;
+
+        buffer_[b & kMask].store(value, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    //! 从底部取出，仅由持有者线程调用。空了返回 false
+    bool pop(T &value) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            //! 已空
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        T item = buffer_[b & kMask].load(std::memory_order_relaxed);
+        if (t < b) {
+            value = item;
+            return true;
+        }
+
+        //! 只剩最后一个，要与窃取者竞争
+        bool is_won = top_.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        if (is_won)
+            value = item;
+        return is_won;
+    }
+
+    //! 从顶部窃取，任意线程可调用。空了或竞争失败返回 false
+    bool steal(T &value) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        T item = buffer_[t & kMask].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+            return false;
+
+        value = item;
+        return true;
+    }
+
+    //! 大概的个数，仅供参考
+    size_t size() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    constexpr size_t capacity() const { return CAPACITY; }
+
+  private:
+    static constexpr int64_t kMask = CAPACITY - 1;
+
+    //! top_ 与 bottom_ 分别由窃取者与持有者频繁修改，隔开以免伪共享
+    //! 不用 alignas 是因为 C++17 之前 new 不保证超对齐
+    std::atomic<int64_t> top_{0};
+    char top_padding_[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom_{0};
+    char bottom_padding_[64 - sizeof(std::atomic<int64_t>)];
+    std::array<std::atomic<T>, CAPACITY> buffer_;
+};
+
+}
+}
+
+#endif //TBOX_EVENTX_WORK_STEALING_DEQUE_HPP_20251018
@@ -0,0 +1,136 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "work_stealing_deque.hpp"
+
+namespace tbox {
+namespace eventx {
+namespace {
+
+TEST(WorkStealingDeque, PushPop)
+{
+    WorkStealingDeque<int, 4> deque;
+    EXPECT_TRUE(deque.empty());
+
+    for (int i = 1; i <= 4; ++i)
+        EXPECT_TRUE(deque.push(i));
+    EXPECT_FALSE(deque.push(5));    //! 已满
+    EXPECT_EQ(deque.size(), 4u);
+
+    int value = 0;
+    EXPECT_TRUE(deque.pop(value));  //! 持有者后进先出
+    EXPECT_EQ(value, 4);
+    EXPECT_TRUE(deque.steal(value));    //! 窃取者先进先出
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(value, 3);
+    EXPECT_TRUE(deque.pop(value));
+    EXPECT_EQ(value, 2);
+
+    value = 7;
+    EXPECT_FALSE(deque.pop(value));
+    EXPECT_FALSE(deque.steal(value));
+    EXPECT_EQ(value, 7);            //! 取失败不修改 value
+    EXPECT_TRUE(deque.empty());
+}
+
+TEST(WorkStealingDeque, Wrap)
+{
+    WorkStealingDeque<int, 4> deque;
+    int value = 0;
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(deque.push(i));
+        EXPECT_TRUE(deque.push(i + 1000));
+        EXPECT_TRUE(deque.steal(value));
+        EXPECT_EQ(value, i);
+        EXPECT_TRUE(deque.pop(value));
+        EXPECT_EQ(value, i + 1000);
+    }
+    EXPECT_TRUE(deque.empty());
+}
+
+//! 持有者边放边取，多个窃取者同时窃取，每个值都应被取到且只取到一次
+TEST(WorkStealingDeque, ConcurrentSteal)
+{
+    const int kValueNum = 200000;
+    const int kThiefNum = 3;
+
+    WorkStealingDeque<int, 64> deque;
+    std::vector<std::atomic<int>> taken_times(kValueNum);
+    for (auto &t : taken_times)
+        t = 0;
+
+    std::atomic<int> taken_num(0);
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < kThiefNum; ++i) {
+        thieves.emplace_back(
+            [&] {
+                int value = 0;
+                while (taken_num < kValueNum) {
+                    if (deque.steal(value)) {
+                        ++taken_times[value];
+                        ++taken_num;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        );
+    }
+
+    int value = 0;
+    for (int i = 0; i < kValueNum; ++i) {
+        while (!deque.push(i)) {
+            if (deque.pop(value)) {
+                ++taken_times[value];
+                ++taken_num;
+            }
+        }
+        if (i % 3 == 0 && deque.pop(value)) {
+            ++taken_times[value];
+            ++taken_num;
+        }
+    }
+
+    while (deque.pop(value)) {
+        ++taken_times[value];
+        ++taken_num;
+    }
+
+    for (auto &t : thieves)
+        t.join();
+
+    EXPECT_EQ(taken_num, kValueNum);
+    int bad_num = 0;
+    for (auto &t : taken_times) {
+        if (t != 1)
+            ++bad_num;
+    }
+    EXPECT_EQ(bad_num, 0);
+}
+
+}
+}
+}
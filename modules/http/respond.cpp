@@ -29,6 +29,11 @@ bool Respond::isValid() const
 }
 
 std::string Respond::toString() const
+{
+    return headerToString() + body;
+}
+
+std::string Respond::headerToString() const
 {
     std::ostringstream oss;
     oss << HttpVerToString(http_ver) << " " << StatusCodeToString(status_code) << CRLF;
@@ -41,10 +46,9 @@ std::string Respond::toString() const
     }
 
     if (!has_content_length)
-        oss << "Content-Length: " << body.length() << CRLF;
+        oss << "Content-Length: " << (body.length() + (file_body.fd.isNull() ? 0 : file_body.size)) << CRLF;
 
     oss << CRLF;
-    oss << body;
 
     return oss.str();
 }
@@ -20,6 +20,9 @@
 #ifndef TBOX_HTTP_RESPOND_H_20220501
 #define TBOX_HTTP_RESPOND_H_20220501
 
+#include <sys/types.h>
+#include <tbox/util/fd.h>
+
 #include "common.h"
 
 namespace tbox {
@@ -32,8 +35,21 @@ struct Respond {
     Headers headers;
     std::string body;
 
+    /**
+     * 以文件区间作为 body，跟在 body 之后由 sendfile() 直接发送，不读入内存
+     * file.fd 为空时不使用。toString() 中不包含这部分内容
+     */
+    struct FileBody {
+        util::Fd fd;
+        off_t offset = 0;
+        size_t size = 0;
+    };
+    FileBody file_body;
+
     bool isValid() const;
     std::string toString() const;
+    //! 仅状态行与头部，不含 body，用于与 body 分开发送
+    std::string headerToString() const;
 };
 
 }
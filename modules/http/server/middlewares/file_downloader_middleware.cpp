@@ -19,15 +19,22 @@
  */
 #include "file_downloader_middleware.h"
 
-#include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <limits>
+#include <cerrno>
+#include <cstdlib>
+#include <chrono>
+#include <list>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/util/string.h>
 #include <tbox/util/fs.h>
-#include <tbox/eventx/work_thread.h>
 #include <tbox/base/recorder.h>
 
 namespace tbox {
@@ -47,6 +54,82 @@ bool IsPathSafe(const std::string& path) {
 
     return true;
 }
+
+/**
+ * 解析十进制数，超出 size_t 范围的按最大值算：
+ * 起始位置超大时按区间超出文件处理，结束位置或后缀长度超大时截到文件末尾，与 RFC 7233 一致
+ */
+bool ParseNumber(const std::string &str, size_t &value) {
+    if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    errno = 0;
+    char *end_ptr = nullptr;
+    unsigned long long num = ::strtoull(str.c_str(), &end_ptr, 10);
+    if (end_ptr != str.c_str() + str.size())
+        return false;
+
+    if (errno == ERANGE || num > std::numeric_limits<size_t>::max())
+        value = std::numeric_limits<size_t>::max();
+    else
+        value = static_cast<size_t>(num);
+    return true;
+}
+
+enum class RangeResult {
+    kNone,          //!< 没有或无法识别，按整个文件回复
+    kValid,         //!< 有效，按区间回复
+    kUnsatisfiable, //!< 区间超出了文件
+};
+
+/**
+ * 解析 "Range: bytes=begin-end"，得到闭区间 [begin, end]
+ * 仅支持单个区间，多个区间的按整个文件回复，这是 RFC 7233 所允许的
+ */
+RangeResult ParseRange(const std::string &value, size_t file_size, size_t &begin, size_t &end) {
+    const std::string prefix = "bytes=";
+    if (value.compare(0, prefix.size(), prefix) != 0)
+        return RangeResult::kNone;
+
+    std::string spec = util::string::Strip(value.substr(prefix.size()));
+    auto dash_pos = spec.find('-');
+    if (dash_pos == std::string::npos || spec.find(',') != std::string::npos)
+        return RangeResult::kNone;
+
+    std::string first = util::string::Strip(spec.substr(0, dash_pos));
+    std::string last = util::string::Strip(spec.substr(dash_pos + 1));
+
+    if (first.empty()) {
+        //! bytes=-N 表示最后N个字节
+        size_t suffix_len = 0;
+        if (!ParseNumber(last, suffix_len))
+            return RangeResult::kNone;
+        if (suffix_len == 0 || file_size == 0)
+            return RangeResult::kUnsatisfiable;
+        begin = file_size > suffix_len ? file_size - suffix_len : 0;
+        end = file_size - 1;
+        return RangeResult::kValid;
+    }
+
+    if (!ParseNumber(first, begin))
+        return RangeResult::kNone;
+
+    if (last.empty()) {
+        end = file_size - 1;
+    } else {
+        if (!ParseNumber(last, end) || end < begin)
+            return RangeResult::kNone;
+        end = std::min(end, file_size - 1);
+    }
+
+    if (begin >= file_size)
+        return RangeResult::kUnsatisfiable;
+
+    return RangeResult::kValid;
+}
+
+//! 缓存中的文件距上次检查超过这个时长，就要重新 stat() 检查是否有变更
+const auto kFileCacheCheckInterval = std::chrono::seconds(1);
 }
 
 //! 目录配置项
@@ -56,21 +139,34 @@ struct DirectoryConfig {
     std::string default_file; //! 默认文件
 };
 
+//! 文件缓存项
+struct FileCacheItem {
+    util::Fd fd;
+    size_t size;
+    ino_t ino;
+    struct timespec mtime;
+    std::chrono::steady_clock::time_point check_time;   //! 上次检查文件有无变更的时间
+    std::list<std::string>::iterator lru_iter;
+};
+
 //! 中间件私有数据结构
 struct FileDownloaderMiddleware::Data {
-    eventx::WorkThread worker;
     std::vector<DirectoryConfig> directories;        //! 目录配置列表
     std::map<std::string, std::string> path_mappings;//! 特定路径映射
     std::map<std::string, std::string> mime_types;   //! MIME类型映射
     std::string default_mime_type;                   //! 默认MIME类型
     bool directory_listing_enabled;                  //! 是否允许目录列表
-    size_t switch_to_worker_filesize_threshold;
 
-    Data(event::Loop *wp_loop)
-        : worker(wp_loop)
-        , default_mime_type("application/octet-stream")
+    std::unordered_map<std::string, FileCacheItem> file_cache;  //! 文件缓存，以路径为键
+    std::list<std::string> file_cache_lru;           //! 最近使用的排在前面
+    size_t file_cache_max_num;
+    size_t file_cache_max_filesize;
+
+    Data()
+        : default_mime_type("application/octet-stream")
         , directory_listing_enabled(false)
-        , switch_to_worker_filesize_threshold(100 << 10)
+        , file_cache_max_num(32)
+        , file_cache_max_filesize(100 << 10)
     {
         //! 初始化常见MIME类型
         mime_types["html"] = "text/html";
@@ -100,8 +196,8 @@ struct FileDownloaderMiddleware::Data {
     }
 };
 
-FileDownloaderMiddleware::FileDownloaderMiddleware(event::Loop *wp_loop)
-    : d_(new Data(wp_loop))
+FileDownloaderMiddleware::FileDownloaderMiddleware(event::Loop *)
+    : d_(new Data)
 { }
 
 FileDownloaderMiddleware::~FileDownloaderMiddleware() { delete d_; }
@@ -152,6 +248,16 @@ void FileDownloaderMiddleware::setMimeType(const std::string& ext, const std::st
     d_->mime_types[ext] = mime_type;
 }
 
+void FileDownloaderMiddleware::setFileCache(size_t max_num, size_t max_filesize) {
+    d_->file_cache_max_num = max_num;
+    d_->file_cache_max_filesize = max_filesize;
+
+    while (d_->file_cache_lru.size() > max_num) {
+        d_->file_cache.erase(d_->file_cache_lru.back());
+        d_->file_cache_lru.pop_back();
+    }
+}
+
 void FileDownloaderMiddleware::handle(ContextSptr sp_ctx, const NextFunc& next) {
     const auto& request = sp_ctx->req();
 
@@ -246,21 +352,73 @@ std::string FileDownloaderMiddleware::getMimeType(const std::string& filename) c
     return d_->default_mime_type;
 }
 
+bool FileDownloaderMiddleware::openFile(const std::string& file_path, util::Fd& fd, size_t& file_size) {
+    auto now = std::chrono::steady_clock::now();
+    struct stat st;
+
+    auto iter = d_->file_cache.find(file_path);
+    if (iter != d_->file_cache.end()) {
+        auto &item = iter->second;
+        bool is_valid = true;
+
+        if (now - item.check_time >= kFileCacheCheckInterval) {
+            //! 检查文件有没有被替换或修改过
+            is_valid = ::stat(file_path.c_str(), &st) == 0 &&
+                       st.st_ino == item.ino &&
+                       static_cast<size_t>(st.st_size) == item.size &&
+                       st.st_mtim.tv_sec == item.mtime.tv_sec &&
+                       st.st_mtim.tv_nsec == item.mtime.tv_nsec;
+            item.check_time = now;
+        }
+
+        if (is_valid) {
+            d_->file_cache_lru.splice(d_->file_cache_lru.begin(), d_->file_cache_lru, item.lru_iter);
+            fd = item.fd;
+            file_size = item.size;
+            return true;
+        }
+
+        d_->file_cache_lru.erase(item.lru_iter);
+        d_->file_cache.erase(iter);
+    }
+
+    int file_fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file_fd < 0)
+        return false;
+
+    fd = util::Fd(file_fd);
+    if (::fstat(file_fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    file_size = static_cast<size_t>(st.st_size);
+
+    //! 只缓存小文件，大文件的 open() 开销相对于传输可以忽略
+    if (d_->file_cache_max_num > 0 && file_size <= d_->file_cache_max_filesize) {
+        if (d_->file_cache_lru.size() >= d_->file_cache_max_num) {
+            d_->file_cache.erase(d_->file_cache_lru.back());
+            d_->file_cache_lru.pop_back();
+        }
+
+        d_->file_cache_lru.push_front(file_path);
+        d_->file_cache[file_path] = FileCacheItem{ fd, file_size, st.st_ino, st.st_mtim, now, d_->file_cache_lru.begin() };
+    }
+
+    return true;
+}
+
 bool FileDownloaderMiddleware::respondFile(ContextSptr sp_ctx, const std::string& file_path) {
     auto& res = sp_ctx->res();
 
     //! 打开文件
-    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
+    util::Fd fd;
+    size_t file_size = 0;
+    if (!openFile(file_path, fd, file_size)) {
         res.status_code = StatusCode::k404_NotFound;
         return true;
     }
 
     res.headers["Content-Type"] = getMimeType(file_path);
-
-    //! 获取文件大小
-    size_t file_size = static_cast<size_t>(file.tellg());
-    file.seekg(0, std::ios::beg);
+    res.headers["Accept-Ranges"] = "bytes";
 
     //! 如果是HEAD请求，不返回内容
     if (sp_ctx->req().method == Method::kHead) {
@@ -269,32 +427,39 @@ bool FileDownloaderMiddleware::respondFile(ContextSptr sp_ctx, const std::string
         return true;
     }
 
-    //! 文件是否大于100KB
-    if (file_size < d_->switch_to_worker_filesize_threshold) {
-        //! 小文件就直接读了
-        res.status_code = StatusCode::k200_OK;
-        res.headers["Content-Length"] = std::to_string(file_size);
-        //! 将文件内容读到body中去
-        res.body = std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        LogInfo("Served file: %s (%zu bytes)", file_path.c_str(), file_size);
+    res.status_code = StatusCode::k200_OK;
 
-    } else {
-        //! 文件太大就采用子线程去读
-        d_->worker.execute(
-            [sp_ctx, file_path] {
-                auto& res = sp_ctx->res();
-                if (util::fs::ReadBinaryFromFile(file_path, res.body)) {
-                    res.status_code = StatusCode::k200_OK;
-                    res.headers["Content-Length"] = std::to_string(res.body.size());
-                    LogInfo("Served file: %s (%zu bytes)", file_path.c_str(), res.body.size());
-                } else {
-                    res.status_code = StatusCode::k404_NotFound;
-                }
-            },
-            [sp_ctx] { } //! 这是为了确保sp_ctx在主线程上析构
-        );
+    size_t begin = 0;
+    size_t end = file_size - 1;
+
+    auto &req_headers = sp_ctx->req().headers;
+    auto range_iter = req_headers.find("Range");
+    if (range_iter != req_headers.end()) {
+        auto result = ParseRange(range_iter->second, file_size, begin, end);
+        if (result == RangeResult::kUnsatisfiable) {
+            res.status_code = StatusCode::k416_RequestedRangeNotSatisfiable;
+            res.headers["Content-Range"] = "bytes */" + std::to_string(file_size);
+            return true;
+        }
+
+        if (result == RangeResult::kValid) {
+            res.status_code = StatusCode::k206_PartialContent;
+            res.headers["Content-Range"] = "bytes " + std::to_string(begin) + "-" + std::to_string(end)
+                                         + "/" + std::to_string(file_size);
+        } else {
+            begin = 0;
+            end = file_size - 1;
+        }
     }
 
+    //! 由 sendfile() 直接从文件发送，不读入内存
+    size_t send_size = (file_size > 0) ? (end - begin + 1) : 0;
+    res.headers["Content-Length"] = std::to_string(send_size);
+    res.file_body.fd = fd;
+    res.file_body.offset = static_cast<off_t>(begin);
+    res.file_body.size = send_size;
+
+    LogInfo("Served file: %s (%zu/%zu bytes)", file_path.c_str(), send_size, file_size);
     return true;
 }
 
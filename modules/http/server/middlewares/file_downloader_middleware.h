@@ -39,6 +39,9 @@ namespace server {
  *
  * 用于处理静态文件的下载请求，可以设置多个目录作为文件源
  * 自动防止目录遍历攻击（防止访问指定目录之外的文件）
+ *
+ * 文件内容不读入内存，由 sendfile() 直接从文件发往 socket，支持 Range 请求。
+ * 小文件的 fd 与 stat 结果会缓存起来，免去每次 open() 与 stat()
  */
 class FileDownloaderMiddleware : public Middleware {
   public:
@@ -93,6 +96,14 @@ class FileDownloaderMiddleware : public Middleware {
      */
     void setMimeType(const std::string& ext, const std::string& mime_type);
 
+    /**
+     * 设置文件缓存
+     *
+     * \param max_num      最多缓存的文件数，为0则不缓存，默认 32
+     * \param max_filesize 只缓存不超过该大小的文件，默认 100KB
+     */
+    void setFileCache(size_t max_num, size_t max_filesize);
+
   protected:
     /**
      * 实现Middleware接口的处理函数
@@ -110,6 +121,11 @@ class FileDownloaderMiddleware : public Middleware {
      */
     bool respondFile(ContextSptr sp_ctx, const std::string& file_path);
 
+    /**
+     * 打开文件并获取大小，优先从缓存中取
+     */
+    bool openFile(const std::string& file_path, util::Fd& fd, size_t& file_size);
+
     /**
      * 生成目录列表
      */
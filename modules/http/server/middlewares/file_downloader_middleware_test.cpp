@@ -0,0 +1,124 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <cstdlib>
+
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/event/loop.h>
+#include <tbox/util/fs.h>
+
+#include "../server.h"
+#include "file_downloader_middleware.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+namespace {
+
+const uint16_t kPort = 22300;
+
+/**
+ * 发送一个带 Range 的 GET 请求，运行一会儿 Loop，返回收到的回复
+ * 客户端 socket 与 Server 在同一线程，所以先发送再运行 Loop
+ */
+std::string RequestWithRange(event::Loop *wp_loop, const std::string &range)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(fd);
+        return "";
+    }
+
+    std::string req = "GET /file.txt HTTP/1.1\r\nHost: localhost\r\nRange: " + range + "\r\n\r\n";
+    if (::write(fd, req.data(), req.size()) != static_cast<ssize_t>(req.size())) {
+        ::close(fd);
+        return "";
+    }
+
+    wp_loop->exitLoop(std::chrono::milliseconds(100));
+    wp_loop->runLoop();
+
+    std::string res;
+    char buff[1024];
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    ssize_t rsize = 0;
+    while ((rsize = ::read(fd, buff, sizeof(buff))) > 0)
+        res.append(buff, rsize);
+
+    ::close(fd);
+    return res;
+}
+
+}
+
+TEST(FileDownloaderMiddleware, Range)
+{
+    char dir[] = "/tmp/tbox_file_downloader_test_XXXXXX";
+    ASSERT_NE(::mkdtemp(dir), nullptr);
+    std::string file_path = std::string(dir) + "/file.txt";
+    ASSERT_TRUE(util::fs::WriteStringToTextFile(file_path, "0123456789"));
+    SetScopeExitAction([&] { util::fs::RemoveFile(file_path); util::fs::RemoveDirectory(dir); });
+
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    Server srv(sp_loop);
+    ASSERT_TRUE(srv.initialize(network::SockAddr::FromString("127.0.0.1:" + std::to_string(kPort)), 5));
+    ASSERT_TRUE(srv.start());
+
+    FileDownloaderMiddleware file_downloader(sp_loop);
+    ASSERT_TRUE(file_downloader.addDirectory("/", dir));
+    srv.use(&file_downloader);
+
+    auto res = RequestWithRange(sp_loop, "bytes=2-4");
+    EXPECT_NE(res.find("206"), std::string::npos);
+    EXPECT_NE(res.find("Content-Range: bytes 2-4/10"), std::string::npos);
+
+    //! 超出 size_t 范围的数值，不能导致异常
+    res = RequestWithRange(sp_loop, "bytes=99999999999999999999999-");
+    EXPECT_NE(res.find("416"), std::string::npos);
+    EXPECT_NE(res.find("Content-Range: bytes */10"), std::string::npos);
+
+    res = RequestWithRange(sp_loop, "bytes=2-99999999999999999999999");
+    EXPECT_NE(res.find("206"), std::string::npos);
+    EXPECT_NE(res.find("Content-Range: bytes 2-9/10"), std::string::npos);
+
+    res = RequestWithRange(sp_loop, "bytes=-99999999999999999999999");
+    EXPECT_NE(res.find("206"), std::string::npos);
+    EXPECT_NE(res.find("Content-Range: bytes 0-9/10"), std::string::npos);
+
+    srv.cleanup();
+}
+
+}
+}
+}
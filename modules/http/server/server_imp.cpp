@@ -191,6 +191,27 @@ void Server::Impl::onTcpSendCompleted(const TcpServer::ConnToken &ct)
         tcp_server_.disconnect(ct);
 }
 
+//! 头部与 body 分开发送，免去将 body 拷贝拼接到头部之后
+void Server::Impl::sendRespond(const TcpServer::ConnToken &ct, Respond *res)
+{
+    const string &header = res->headerToString();
+
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(header.data());
+    iov[0].iov_len  = header.size();
+    iov[1].iov_base = const_cast<char*>(res->body.data());
+    iov[1].iov_len  = res->body.size();
+    tcp_server_.sendv(ct, iov, 2);
+
+    if (!res->file_body.fd.isNull())
+        tcp_server_.sendFile(ct, res->file_body.fd, res->file_body.offset, res->file_body.size);
+
+    if (context_log_enable_)
+        LogDbg("RES: [%s%s]", header.c_str(), res->body.c_str());
+
+    delete res;
+}
+
 /**
  * 为了保证管道化连接中Respond与Request的顺序一致性，要做特殊处理。
  * 如果所提交的index不是当前需要回复的res_index，那么就先暂存起来，等前面的发送完成后再发送；
@@ -209,13 +230,7 @@ void Server::Impl::commitRespond(const TcpServer::ConnToken &ct, int index, Resp
 
     if (index == conn->res_index) {
         //! 将当前的数据直接发送出去
-        {
-            const string &content = res->toString();
-            tcp_server_.send(ct, content.data(), content.size());
-            delete res;
-            if (context_log_enable_)
-                LogDbg("RES: [%s]", content.c_str());
-        }
+        sendRespond(ct, res);
 
         ++conn->res_index;
 
@@ -229,13 +244,7 @@ void Server::Impl::commitRespond(const TcpServer::ConnToken &ct, int index, Resp
 
         while (iter != res_buff.end()) {
             Respond *res = iter->second;
-            {
-                const string &content = res->toString();
-                tcp_server_.send(ct, content.data(), content.size());
-                delete res;
-                if (context_log_enable_)
-                    LogDbg("RES: [%s]", content.c_str());
-            }
+            sendRespond(ct, res);
 
             res_buff.erase(iter);
             ++conn->res_index;
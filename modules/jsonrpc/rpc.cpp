@@ -105,8 +105,9 @@ void Rpc::request(const std::string &method, const Json &js_params, RequestCallb
 
     if (cb) {
         int_id = allocIntId();
-        request_callback_[int_id] = std::move(cb);
-        request_timeout_.add(int_id);
+        auto &item = request_callback_[int_id];
+        item.cb = std::move(cb);
+        item.timeout_token = request_timeout_.add(int_id);
     }
 
     if (id_type_ == IdType::kInt) {
@@ -160,7 +161,7 @@ void Rpc::respondResult(int int_id, const Json &js_result)
         }
     }
 
-    tobe_respond_.erase(int_id);
+    eraseTobeRespond(int_id);
 }
 
 void Rpc::respondError(int int_id, int errcode, const std::string &message)
@@ -184,7 +185,7 @@ void Rpc::respondError(int int_id, int errcode, const std::string &message)
         }
     }
 
-    tobe_respond_.erase(int_id);
+    eraseTobeRespond(int_id);
 }
 
 std::string Rpc::getStrId(int int_id) const
@@ -222,7 +223,7 @@ void Rpc::onRecvRequestInt(int int_id, const std::string &method, const Json &js
     if (iter != method_services_.end() && iter->second) {
         Response response;
         if (int_id != 0) {
-            tobe_respond_.insert(int_id);
+            tobe_respond_[int_id] = TimeoutToken();
             if (iter->second(int_id, js_params, response)) {
                 if (response.error.code == 0) {
                     respondResult(int_id, response.js_result);
@@ -231,7 +232,10 @@ void Rpc::onRecvRequestInt(int int_id, const std::string &method, const Json &js
                     respondError(int_id, error.code, error.message);
                 }
             } else {
-                respond_timeout_.add(int_id);
+                //! 有可能在服务函数中就已经回复了
+                auto tobe_respond_iter = tobe_respond_.find(int_id);
+                if (tobe_respond_iter != tobe_respond_.end())
+                    tobe_respond_iter->second = respond_timeout_.add(int_id);
             }
         } else {
             iter->second(int_id, js_params, response);
@@ -260,8 +264,9 @@ void Rpc::onRecvRespondInt(int int_id, const Response &response)
     RECORD_SCOPE();
     auto iter = request_callback_.find(int_id);
     if (iter != request_callback_.end()) {
-        if (iter->second)
-            iter->second(response);
+        request_timeout_.remove(iter->second.timeout_token);
+        if (iter->second.cb)
+            iter->second.cb(response);
         request_callback_.erase(iter);
     }
 }
@@ -289,8 +294,8 @@ void Rpc::onRequestTimeout(int int_id)
 
     auto iter = request_callback_.find(int_id);
     if (iter != request_callback_.end()) {
-        if (iter->second)
-            iter->second(response);
+        if (iter->second.cb)
+            iter->second.cb(response);
         request_callback_.erase(iter);
 
         //! 如果是string类的，还要将map中的记录删除
@@ -339,5 +344,14 @@ int Rpc::allocIntId()
 
 }
 
+void Rpc::eraseTobeRespond(int int_id)
+{
+    auto iter = tobe_respond_.find(int_id);
+    if (iter != tobe_respond_.end()) {
+        respond_timeout_.remove(iter->second);
+        tobe_respond_.erase(iter);
+    }
+}
+
 }
 }
@@ -22,7 +22,6 @@
 
 #include <functional>
 #include <unordered_map>
-#include <unordered_set>
 #include <tbox/base/json_fwd.h>
 #include <tbox/event/forward.h>
 #include <tbox/eventx/timeout_monitor.hpp>
@@ -104,6 +103,7 @@ class Rpc {
     void onRespondTimeout(int int_id);
 
     int  allocIntId();
+    void eraseTobeRespond(int int_id);  //! 已回复，不再需要监测回复超时
 
   private:
     IdType id_type_;
@@ -113,8 +113,16 @@ class Rpc {
 
     int int_id_alloc_ = 0;
 
-    std::unordered_map<int, RequestCallback> request_callback_;
-    std::unordered_set<int> tobe_respond_;          //!< 待回复的请求
+    using TimeoutToken = eventx::TimeoutMonitor<int>::Token;
+
+    //! 已发出待回复的请求
+    struct RequestItem {
+        RequestCallback cb;
+        TimeoutToken timeout_token; //!< 收到回复时用它将请求从 request_timeout_ 中移除
+    };
+
+    std::unordered_map<int, RequestItem> request_callback_;
+    std::unordered_map<int, TimeoutToken> tobe_respond_;    //!< 待回复的请求
     eventx::TimeoutMonitor<int> request_timeout_;   //!< 请求超时监测
     eventx::TimeoutMonitor<int> respond_timeout_;   //!< 回复超时监测
 
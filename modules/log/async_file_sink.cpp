@@ -37,10 +37,7 @@ using namespace std;
 AsyncFileSink::AsyncFileSink()
 {
     AsyncSink::Config cfg;
-    cfg.buff_size = 10240;
-    cfg.buff_min_num = 2;
-    cfg.buff_max_num = 20;
-    cfg.interval  = 100;
+    cfg.interval = 100;
 
     setConfig(cfg);
     pid_ = ::getpid();
@@ -48,6 +45,8 @@ AsyncFileSink::AsyncFileSink()
 
 AsyncFileSink::~AsyncFileSink()
 {
+    //! 先注销，以免析构期间还有线程在直接输出
+    disable();
     if (pid_ != 0)
         cleanup();
 }
@@ -157,3 +157,42 @@ TEST(AsyncFileSink, Benchmark)
     ch.cleanup();
 }
 
+
+//! 多个线程同时打印日志，统计从开始打印到全部写入文件的吞吐量
+TEST(AsyncFileSink, MultiThreadBenchmark)
+{
+    const int kTotalLogs = 200000;
+    std::string tmp(30, 'x');
+
+    for (int thread_num : {1, 4, 16}) {
+        AsyncFileSink ch;
+        ch.setFilePath("/tmp/tbox");
+        ch.setFilePrefix("bench");
+        ch.setFileMaxSize(100 << 20);
+        ch.enable();
+
+        auto start_ts = chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_num; ++t) {
+            threads.emplace_back(
+                [&] {
+                    for (int i = 0; i < kTotalLogs / thread_num; ++i)
+                        LogInfo("%d %s", i, tmp.c_str());
+                }
+            );
+        }
+        for (auto &t : threads)
+            t.join();
+
+        auto produce_cost = chrono::steady_clock::now() - start_ts;
+        ch.cleanup();
+        auto total_cost = chrono::steady_clock::now() - start_ts;
+
+        auto produce_us = chrono::duration_cast<chrono::microseconds>(produce_cost).count();
+        auto total_us = chrono::duration_cast<chrono::microseconds>(total_cost).count();
+        cout << "threads: " << thread_num
+             << ", produce: " << kTotalLogs * 1000000ll / produce_us << " /s"
+             << ", total: " << kTotalLogs * 1000000ll / total_us << " /s" << endl;
+    }
+}
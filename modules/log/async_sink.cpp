@@ -24,70 +24,400 @@
 #include <iostream>
 #include <chrono>
 
+#include "log_ring.h"
+
 namespace tbox {
 namespace log {
 
+namespace {
+
+std::atomic<uint64_t> _sink_uid_alloc(0);
+
+//! 本线程在各 AsyncSink 中的缓冲
+struct ThreadRings {
+    struct Entry {
+        uint64_t sink_uid;
+        std::shared_ptr<LogRing> ring;
+    };
+    std::vector<Entry> entries;
+
+    ~ThreadRings();
+};
+
+thread_local ThreadRings _thread_rings;
+thread_local bool _thread_rings_destroyed = false;
+
+ThreadRings::~ThreadRings()
+{
+    //! 线程退出了，通知各后台线程读完后回收
+    for (auto &entry : entries)
+        entry.ring->setProducerExited();
+    _thread_rings_destroyed = true;
+}
+
+//! 比较两条日志的先后
+inline bool IsEarlier(const LogContent &a, const LogContent &b)
+{
+    return a.timestamp.sec < b.timestamp.sec ||
+           (a.timestamp.sec == b.timestamp.sec && a.timestamp.usec < b.timestamp.usec);
+}
+
+}
+
+AsyncSink::AsyncSink() { }
+
+AsyncSink::~AsyncSink()
+{
+    //! 派生类已析构，无法再输出，只能停止后台线程，再从日志前端注销
+    stopBackEnd(false);
+    disable();
+}
+
 void AsyncSink::cleanup()
 {
-    if (is_pipe_inited_)
-        async_pipe_.cleanup();
+    stopBackEnd(true);
 }
 
 void AsyncSink::onEnable()
 {
-    if (!async_pipe_.initialize(cfg_))
+    if (is_running_)
         return;
 
-    using namespace std::placeholders;
-    async_pipe_.setCallback(std::bind(&AsyncSink::onLogBackEndReadPipe, this, _1, _2));
-    is_pipe_inited_ = true;
+    {
+        std::lock_guard<std::mutex> lk(sync_mutex_);
+        is_sync_allowed_ = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        rings_.clear();
+    }
+
+    uid_ = ++_sink_uid_alloc;
+    is_stopping_ = false;
+    is_running_ = true;
+    backend_thread_ = std::thread(&AsyncSink::threadFunc, this);
 }
 
 void AsyncSink::onDisable()
 {
-    async_pipe_.cleanup();
-    is_pipe_inited_ = false;
+    stopBackEnd(true);
+}
+
+void AsyncSink::stopBackEnd(bool is_drain)
+{
+    //! 持锁直到读完缓冲，其间改为直接输出的线程都要等着，以保持先后顺序
+    std::lock_guard<std::mutex> sync_lk(sync_mutex_);
+    if (!is_drain)
+        is_sync_allowed_ = false;
+
+    if (!is_running_)
+        return;
+
+    is_running_ = false;
+
+    //! 唤醒因缓冲满而等待的前端，它们会改为直接输出
+    {
+        std::lock_guard<std::mutex> lk(space_mutex_);
+    }
+    space_cv_.notify_all();
+
+    //! 等正在写缓冲的前端写完，很快就结束，让出CPU即可
+    while (writing_num_ != 0)
+        std::this_thread::yield();
+
+    {
+        std::lock_guard<std::mutex> lk(backend_mutex_);
+        is_stopping_ = true;
+    }
+    backend_cv_.notify_one();
+    backend_thread_.join();
+
+    if (is_drain)
+        drainRings();
+
+    std::lock_guard<std::mutex> lk(rings_mutex_);
+    rings_.clear();
+    read_buffs_.clear();
+    is_sync_allowed_ = is_drain;
+}
+
+size_t AsyncSink::ringSize() const
+{
+    if (cfg_.buff_size != 0)
+        return cfg_.buff_size * std::max<size_t>(cfg_.buff_max_num, 1);
+    return cfg_.ring_size;
+}
+
+LogRing* AsyncSink::getThreadRing()
+{
+    if (_thread_rings_destroyed)
+        return nullptr;
+
+    auto &entries = _thread_rings.entries;
+    for (auto &entry : entries) {
+        if (entry.sink_uid == uid_)
+            return entry.ring.get();
+    }
+
+    //! 顺便清理已停止的 AsyncSink 所遗留的缓冲，这时只剩本线程还在引用
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const ThreadRings::Entry &entry) { return entry.ring.use_count() == 1; }),
+                  entries.end());
+
+    auto ring = std::make_shared<LogRing>(ringSize());
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        rings_.push_back(ring);
+    }
+    entries.push_back(ThreadRings::Entry{uid_, ring});
+    return ring.get();
+}
+
+void AsyncSink::wakeBackEnd()
+{
+    if (!is_wake_requested_.exchange(true)) {
+        std::lock_guard<std::mutex> lk(backend_mutex_);
+        backend_cv_.notify_one();
+    }
+}
+
+void AsyncSink::notifySpaceFreed()
+{
+    ++drain_seq_;
+    if (blocked_num_ != 0) {
+        std::lock_guard<std::mutex> lk(space_mutex_);
+        space_cv_.notify_all();
+    }
 }
 
 void AsyncSink::onLogFrontEnd(const LogContent *content)
 {
-    async_pipe_.append(content, sizeof(LogContent));
-    if (content->text_len != 0)
-        async_pipe_.append(content->text_ptr, content->text_len);
+    ++writing_num_;
+    bool is_written = is_running_ && writeRing(content);
+    --writing_num_;
+
+    if (!is_written)
+        writeSync(*content);
+}
+
+/**
+ * 将日志写入本线程的缓冲
+ *
+ * \return 后台线程已停止，须直接输出时返回 false；写入或按策略丢弃都返回 true
+ */
+bool AsyncSink::writeRing(const LogContent *content)
+{
+    auto ring = getThreadRing();
+    if (ring == nullptr)
+        return true;
+
+    //! 编码后的参数放不进缓冲，只能在这里格式化了
+    LogContent eager_content;
+    std::vector<char> eager_text;
+    if (content->args_len > ring->maxTextLen()) {
+        eager_content = *content;
+        eager_text.resize(LogFormatArgs(content->args_ptr, content->args_len, nullptr, 0) + 1);
+        eager_content.text_len = LogFormatArgs(content->args_ptr, content->args_len, eager_text.data(), eager_text.size());
+        eager_content.text_ptr = eager_text.data();
+        eager_content.args_len = 0;
+        eager_content.args_ptr = nullptr;
+        content = &eager_content;
+    }
+
+    for (;;) {
+        //! 先取序号再写，以免错过写失败之后的那一轮读取
+        uint64_t seq = drain_seq_;
+        if (ring->write(*content))
+            break;
+
+        if (cfg_.overflow_policy == OverflowPolicy::kDropNewest) {
+            ++dropped_count_;
+            wakeBackEnd();
+            return true;
+        }
+
+        //! 等后台线程读走
+        ++blocked_num_;
+        wakeBackEnd();
+        {
+            std::unique_lock<std::mutex> lk(space_mutex_);
+            space_cv_.wait(lk, [this, seq] { return drain_seq_ != seq || !is_running_; });
+        }
+        --blocked_num_;
+
+        if (!is_running_)
+            return false;
+    }
+
+    //! 超过一半就提前唤醒后台线程，以免写满
+    if (ring->usedSize() > ring->capacity() / 2)
+        wakeBackEnd();
+
+    return true;
 }
 
-void AsyncSink::onLogBackEndReadPipe(const void *data_ptr, size_t data_size)
+//! 后台线程已停止，由打印日志的线程直接输出
+void AsyncSink::writeSync(const LogContent &content)
+{
+    std::lock_guard<std::mutex> lk(sync_mutex_);
+    if (!is_sync_allowed_)
+        return;
+
+    LogContent sync_content = content;
+    if (sync_content.args_len > 0)
+        formatText(sync_content, content.args_ptr);
+
+    onLogBackEnd(sync_content);
+    flush();
+}
+
+void AsyncSink::threadFunc()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(backend_mutex_);
+            backend_cv_.wait_for(lk, std::chrono::milliseconds(cfg_.interval),
+                [this] { return is_stopping_ || is_wake_requested_; });
+        }
+
+        if (is_stopping_)
+            break;
+
+        is_wake_requested_ = false;
+        drainRings();
+    }
+}
+
+/**
+ * 读出各缓冲中的日志，按时间顺序合并后输出
+ *
+ * 每个缓冲中的日志本身就是有序的，所以每次只需比较各缓冲中最早的那条
+ */
+void AsyncSink::drainRings()
 {
     auto start_ts = std::chrono::steady_clock::now();
 
-    buffer_.append(data_ptr, data_size);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        rings = rings_;
+    }
+
+    if (read_buffs_.size() < rings.size())
+        read_buffs_.resize(rings.size());
+
+    for (size_t i = 0; i < rings.size(); ++i)
+        rings[i]->readAll(read_buffs_[i]);
+    notifySpaceFreed();
 
     bool is_need_flush = false;
-    while (buffer_.readableSize() >= sizeof(LogContent)) {
-        LogContent content;
-        ::memcpy(&content, buffer_.readableBegin(), sizeof(content));
+    for (;;) {
+        util::Buffer *earliest_buff = nullptr;
+        LogContent earliest_content;
 
-        auto frame_size = sizeof(LogContent) + content.text_len;
-        if (frame_size > buffer_.readableSize())  //! 总结长度不够
-            break;
+        for (size_t i = 0; i < rings.size(); ++i) {
+            auto &buff = read_buffs_[i];
+            if (buff.readableSize() < sizeof(LogContent))
+                continue;
+
+            LogContent content;
+            ::memcpy(&content, buff.readableBegin(), sizeof(content));
+            if (earliest_buff == nullptr || IsEarlier(content, earliest_content)) {
+                earliest_buff = &buff;
+                earliest_content = content;
+            }
+        }
 
-        buffer_.hasRead(sizeof(content));
+        if (earliest_buff == nullptr)
+            break;
 
-        content.text_ptr = reinterpret_cast<const char*>(buffer_.readableBegin());
-        onLogBackEnd(content);
+        earliest_buff->hasRead(sizeof(LogContent));
+        if (earliest_content.args_len > 0) {
+            uint32_t args_len = earliest_content.args_len;
+            formatText(earliest_content, earliest_buff->readableBegin());
+            onLogBackEnd(earliest_content);
+            earliest_buff->hasRead(args_len);
+        } else {
+            earliest_content.text_ptr = reinterpret_cast<const char*>(earliest_buff->readableBegin());
+            onLogBackEnd(earliest_content);
+            earliest_buff->hasRead(earliest_content.text_len);
+        }
+        is_need_flush = true;
+    }
 
+    if (dropped_count_ != reported_dropped_count_) {
+        reportDropped();
         is_need_flush = true;
-        buffer_.hasRead(content.text_len);
     }
 
     if (is_need_flush)
         flush();
 
+    //! 回收线程已退出，且已读完的缓冲
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        for (size_t i = 0; i < rings_.size(); ) {
+            if (rings_[i]->isProducerExited() && rings_[i]->usedSize() == 0) {
+                rings_.erase(rings_.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
     auto time_cost = std::chrono::steady_clock::now() - start_ts;
     if (time_cost > std::chrono::milliseconds(500))
         std::cerr << timestamp_str_ << " NOTICE: log sink cost > 500 ms, " << time_cost.count() / 1000 << " us" << std::endl;
 }
 
+//! 将丢弃的条数作为一条日志输出，以免丢得无声无息
+void AsyncSink::reportDropped()
+{
+    uint64_t dropped_count = dropped_count_;
+    char text[64];
+    int text_len = ::snprintf(text, sizeof(text), "%llu logs dropped, ring full",
+                              static_cast<unsigned long long>(dropped_count - reported_dropped_count_));
+    reported_dropped_count_ = dropped_count;
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+
+    LogContent content;
+    ::memset(&content, 0, sizeof(content));
+    content.timestamp.sec = static_cast<uint32_t>(usec / 1000000);
+    content.timestamp.usec = static_cast<uint32_t>(usec % 1000000);
+    content.module_id = "tbox.log";
+    content.level = LOG_LEVEL_WARN;
+    content.text_len = text_len;
+    content.text_ptr = text;
+    onLogBackEnd(content);
+}
+
+//! 将编码后的参数格式化到 text_buff_ 中，与前端立即格式化一样受 LogGetMaxLength() 限制
+void AsyncSink::formatText(LogContent &content, const void *args_ptr)
+{
+    size_t max_len = LogGetMaxLength();
+    if (text_buff_.size() < 1024)
+        text_buff_.resize(1024);
+
+    uint32_t len = LogFormatArgs(args_ptr, content.args_len, text_buff_.data(), text_buff_.size());
+    if (len >= text_buff_.size() && max_len >= text_buff_.size()) {
+        text_buff_.resize(std::min<size_t>(len, max_len) + 1);
+        LogFormatArgs(args_ptr, content.args_len, text_buff_.data(), text_buff_.size());
+    }
+
+    if (len > max_len) {
+        len = max_len;
+        content.text_trunc = true;
+    }
+
+    content.text_len = std::min<size_t>(len, text_buff_.size() - 1);
+    content.text_ptr = text_buff_.data();
+    content.args_len = 0;
+    content.args_ptr = nullptr;
+}
+
 void AsyncSink::onLogBackEnd(const LogContent &content)
 {
     char buff[1024];
@@ -23,26 +23,65 @@
 #include "sink.h"
 
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 
-#include <tbox/util/async_pipe.h>
 #include <tbox/util/buffer.h>
 
 namespace tbox {
 namespace log {
 
+class LogRing;
+
+/**
+ * 异步日志通道
+ *
+ * 每个打印日志的线程都有自己的环形缓冲（LogRing），前端只是将日志写入其中，不加锁。
+ * 后台线程定时将各缓冲中的日志按时间顺序合并，再格式化输出。
+ * 开启延迟格式化后，连日志正文的 vsnprintf() 也交由后台线程完成，前端只拷贝编码后的参数。
+ * cleanup() 之后仍在注册中的，后续日志由打印日志的线程直接输出，不会丢失。
+ */
 class AsyncSink : public Sink {
   public:
-    using Config = util::AsyncPipe::Config;
+    AsyncSink();
+    virtual ~AsyncSink() override;
+
+    //! 缓冲满时的处理策略
+    enum class OverflowPolicy {
+        kBlock,         //!< 等待后台线程腾出空间，不丢日志
+        kDropNewest,    //!< 丢弃当前这条日志，并计数
+    };
+
+    struct Config {
+        size_t ring_size = 64 << 10;    //!< 每个线程的缓冲大小，默认64KB
+        size_t interval = 1000;         //!< 后台处理间隔，单位ms，默认1秒
+        OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+        bool deferred_format = true;    //!< 是否由后台线程格式化日志正文，在 enable() 之前设置
+
+        /**
+         * 以下为旧版基于 AsyncPipe 的配置，已废弃，仅为兼容而保留
+         * buff_size 不为0时，以 buff_size * buff_max_num 作为每个线程的缓冲大小，buff_min_num 不再起作用
+         */
+        size_t buff_size = 0;
+        size_t buff_min_num = 0;
+        size_t buff_max_num = 0;
+    };
 
     void setConfig(const Config &cfg) { cfg_ = cfg; }
     void cleanup();
 
+    //! 因缓冲满而被丢弃的日志条数
+    uint64_t droppedCount() const { return dropped_count_; }
+
   protected:
     virtual void onEnable() override;
     virtual void onDisable() override;
 
     virtual void onLogFrontEnd(const LogContent *content) override;
-    void onLogBackEndReadPipe(const void *data_ptr, size_t data_size);
+    virtual bool isDeferredFormatSupported() const override { return cfg_.deferred_format; }
     void onLogBackEnd(const LogContent &content);
 
     void append(const char *str, size_t len);
@@ -51,15 +90,50 @@ class AsyncSink : public Sink {
     virtual void endline() = 0;
     virtual void flush() = 0;
 
+  private:
+    size_t ringSize() const;
+    LogRing* getThreadRing();
+    bool writeRing(const LogContent *content);
+    void writeSync(const LogContent &content);
+    void wakeBackEnd();
+    void notifySpaceFreed();
+    void stopBackEnd(bool is_drain);
+
+    void threadFunc();
+    void drainRings();
+    void reportDropped();
+    void formatText(LogContent &content, const void *args_ptr);
+
   protected:
     std::vector<char> cache_;
 
   private:
     Config cfg_;
-    util::AsyncPipe async_pipe_;
-    bool is_pipe_inited_ = false;
+    std::atomic<uint64_t> uid_{0};  //!< 每次启动都不同，供各线程识别自己的缓冲是否属于本次启动
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::vector<util::Buffer> read_buffs_;  //!< 后台线程读出各缓冲的数据
+    std::vector<char> text_buff_;           //!< 后台线程格式化日志正文用
+
+    std::thread backend_thread_;
+    std::mutex backend_mutex_;
+    std::condition_variable backend_cv_;
+    std::atomic<bool> is_running_{false};
+    std::atomic<bool> is_stopping_{false};
+    std::atomic<bool> is_wake_requested_{false};
+
+    std::mutex space_mutex_;                //!< 缓冲满时，kBlock 策略的前端在 space_cv_ 上等待
+    std::condition_variable space_cv_;
+    std::atomic<uint64_t> drain_seq_{0};    //!< 后台线程每读一轮加1，等待的前端据此判断有无腾出空间
+    std::atomic<size_t> blocked_num_{0};
+    std::atomic<size_t> writing_num_{0};    //!< 正在写缓冲的前端数，停止时要等它们写完
+
+    std::mutex sync_mutex_;         //!< 后台线程停止后，各线程直接输出，用它串行化
+    bool is_sync_allowed_ = false;  //!< 是否允许直接输出。析构时派生类已不存在，不能输出
 
-    util::Buffer buffer_;
+    std::atomic<uint64_t> dropped_count_{0};
+    uint64_t reported_dropped_count_ = 0;
 };
 
 }
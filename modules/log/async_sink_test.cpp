@@ -24,6 +24,8 @@
 #include <iostream>
 #include <chrono>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
 #include "async_sink.h"
 
@@ -151,3 +153,191 @@ TEST(AsyncSink, Benchmark_Empty)
     cout << "count in sec: " << counter/10 << endl;
 }
 
+
+//! 缓冲满时丢弃新日志，并计数
+TEST(AsyncSink, DropNewest)
+{
+    EmptyTestAsyncSink ch;
+    AsyncSink::Config cfg;
+    cfg.ring_size = 4096;
+    cfg.interval = 10000;   //! 后台线程在测试期间基本不会读，以便写满
+    cfg.overflow_policy = AsyncSink::OverflowPolicy::kDropNewest;
+    ch.setConfig(cfg);
+    ch.enable();
+
+    std::string tmp(100, 'x');
+    for (int i = 0; i < 1000; ++i)
+        LogInfo("%d %s", i, tmp.c_str());
+
+    EXPECT_GT(ch.droppedCount(), 0u);
+    ch.cleanup();
+}
+
+//! 缓冲满时等待，所有日志都应被输出，且同一线程的日志保持顺序
+TEST(AsyncSink, BlockWhenFull)
+{
+    class CountAsyncSink : public AsyncSink {
+      public:
+        int line_count = 0;
+        bool is_ordered = true;
+      protected:
+        virtual void endline() override {
+            //! 正文紧跟在函数名之后
+            cache_.push_back('\0');
+            int index = std::atoi(::strstr(cache_.data(), "() ") + 3);
+            if (index != line_count)
+                is_ordered = false;
+            ++line_count;
+            cache_.clear();
+        }
+        virtual void flush() override { }
+    };
+
+    CountAsyncSink ch;
+    AsyncSink::Config cfg;
+    cfg.ring_size = 4096;
+    cfg.interval = 10000;
+    cfg.overflow_policy = AsyncSink::OverflowPolicy::kBlock;
+    ch.setConfig(cfg);
+    ch.enable();
+
+    std::string tmp(100, 'x');
+    for (int i = 0; i < 1000; ++i)
+        LogInfo("%d %s", i, tmp.c_str());
+
+    ch.cleanup();
+    EXPECT_EQ(ch.droppedCount(), 0u);
+    EXPECT_EQ(ch.line_count, 1000);
+    EXPECT_TRUE(ch.is_ordered);
+}
+
+//! 旧版配置项仍可使用，以 buff_size * buff_max_num 作为缓冲大小
+TEST(AsyncSink, DeprecatedBuffConfig)
+{
+    EmptyTestAsyncSink ch;
+    AsyncSink::Config cfg;
+    cfg.buff_size = 1024;
+    cfg.buff_min_num = 2;
+    cfg.buff_max_num = 4;
+    cfg.interval = 10000;
+    cfg.overflow_policy = AsyncSink::OverflowPolicy::kDropNewest;
+    ch.setConfig(cfg);
+    ch.enable();
+
+    std::string tmp(100, 'x');
+    for (int i = 0; i < 1000; ++i)
+        LogInfo("%d %s", i, tmp.c_str());
+
+    EXPECT_GT(ch.droppedCount(), 0u);
+    ch.cleanup();
+}
+
+namespace {
+//! 记录各行中函数名之后的部分
+class CaptureAsyncSink : public AsyncSink {
+  public:
+    std::vector<std::string> lines;
+  protected:
+    virtual void endline() override {
+        std::string line(cache_.begin(), cache_.end());
+        auto pos = line.find("() ");
+        lines.push_back(pos == std::string::npos ? line : line.substr(pos + 3));
+        cache_.clear();
+    }
+    virtual void flush() override { }
+};
+
+void PrintVariousLogs()
+{
+    int value = 0;
+    const char *null_str = nullptr;
+    LogInfo("%s, %d, %f", "hello", 123456, 12.345);
+    LogInfo("[%-6d] [%08.3f] [%*s] [%.*s]", -12, 3.14159, 8, "right", 3, "abcdef");
+    LogInfo("%lld %llu %zu %x %c %%", -1ll, ~0ull, sizeof(value), 0xbeefu, 'Z');
+    LogInfo("%p %s", static_cast<void*>(&value), null_str);
+    LogInfo("%m");  //! 不支持延迟格式化，应退而立即格式化
+    LogInfo("no args");
+}
+}
+
+//! 延迟格式化与立即格式化的输出应完全一致
+TEST(AsyncSink, DeferredFormat)
+{
+    CaptureAsyncSink deferred_ch;
+    deferred_ch.enable();
+    PrintVariousLogs();
+    deferred_ch.disable();
+
+    CaptureAsyncSink eager_ch;
+    AsyncSink::Config cfg;
+    cfg.deferred_format = false;
+    eager_ch.setConfig(cfg);
+    eager_ch.enable();
+    PrintVariousLogs();
+    eager_ch.disable();
+
+    ASSERT_EQ(deferred_ch.lines.size(), 6u);
+    EXPECT_EQ(deferred_ch.lines, eager_ch.lines);
+}
+
+TEST(AsyncSink, DeferredFormatTruncate)
+{
+    auto origin_len = LogSetMaxLength(100);
+
+    CaptureAsyncSink ch;
+    ch.enable();
+
+    std::string tmp(200, 'x');
+    LogInfo("%s", tmp.c_str());
+    ch.cleanup();
+    LogSetMaxLength(origin_len);
+
+    ASSERT_EQ(ch.lines.size(), 1u);
+    EXPECT_EQ(ch.lines[0].substr(0, 101), std::string(100, 'x') + " ");
+    EXPECT_NE(ch.lines[0].find("(TRUNCATED)"), std::string::npos);
+}
+
+//! 对比打印线程上每条日志的耗时
+TEST(AsyncSink, FrontEndLatencyBenchmark)
+{
+    const int kLogNum = 20000;
+    std::string tmp(30, 'x');
+
+    for (bool deferred : { false, true }) {
+        EmptyTestAsyncSink ch;
+        AsyncSink::Config cfg;
+        cfg.ring_size = 8 << 20;    //! 足够大，不会因等待后台线程而影响测量
+        cfg.deferred_format = deferred;
+        ch.setConfig(cfg);
+        ch.enable();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kLogNum; ++i)
+            LogInfo("%d %s %f %lu", i, tmp.c_str(), i * 0.5, 1234567890ul);
+        auto cost = std::chrono::steady_clock::now() - start;
+
+        ch.cleanup();
+        cout << (deferred ? "deferred" : "eager") << ": "
+             << std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count() / kLogNum
+             << " ns/log" << endl;
+    }
+}
+
+//! cleanup() 之后仍在注册中，日志由打印线程直接输出，不丢失
+TEST(AsyncSink, LogAfterCleanup)
+{
+    CaptureAsyncSink ch;
+    ch.enable();
+    LogInfo("before %d", 1);
+    ch.cleanup();
+
+    LogInfo("after %d", 2);
+    LogInfo("after");
+    ch.disable();
+    LogInfo("disabled");
+
+    ASSERT_EQ(ch.lines.size(), 3u);
+    EXPECT_EQ(ch.lines[0].substr(0, 9), "before 1 ");
+    EXPECT_EQ(ch.lines[1].substr(0, 8), "after 2 ");
+    EXPECT_EQ(ch.lines[2].substr(0, 6), "after ");
+}
@@ -27,10 +27,7 @@ namespace log {
 AsyncStdoutSink::AsyncStdoutSink()
 {
     AsyncSink::Config cfg;
-    cfg.buff_size = 10240;
-    cfg.buff_min_num = 2;
-    cfg.buff_max_num = 20;
-    cfg.interval  = 100;
+    cfg.interval = 100;
 
     setConfig(cfg);
 }
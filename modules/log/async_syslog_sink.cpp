@@ -26,10 +26,7 @@ namespace log {
 AsyncSyslogSink::AsyncSyslogSink()
 {
     AsyncSink::Config cfg;
-    cfg.buff_size = 10240;
-    cfg.buff_min_num = 2;
-    cfg.buff_max_num = 20;
-    cfg.interval  = 100;
+    cfg.interval = 100;
 
     setConfig(cfg);
 }
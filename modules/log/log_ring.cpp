@@ -0,0 +1,117 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "log_ring.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace tbox {
+namespace log {
+
+namespace {
+size_t RoundUpPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+}
+
+LogRing::LogRing(size_t capacity)
+    : capacity_(RoundUpPowerOfTwo(std::max(capacity, sizeof(LogContent) * 2)))
+    , mask_(capacity_ - 1)
+{
+    data_ = new uint8_t [capacity_];
+}
+
+LogRing::~LogRing()
+{
+    delete [] data_;
+}
+
+void LogRing::copyIn(size_t pos, const void *data_ptr, size_t data_size)
+{
+    size_t index = pos & mask_;
+    size_t first_size = std::min(data_size, capacity_ - index);
+    ::memcpy(data_ + index, data_ptr, first_size);
+    if (first_size < data_size)
+        ::memcpy(data_, static_cast<const uint8_t*>(data_ptr) + first_size, data_size - first_size);
+}
+
+bool LogRing::write(const LogContent &content)
+{
+    LogContent header = content;
+    if (header.text_len > maxTextLen()) {
+        header.text_len = maxTextLen();
+        header.text_trunc = true;
+    }
+    header.text_ptr = nullptr;
+    header.args_ptr = nullptr;
+
+    const void *payload_ptr = content.text_ptr;
+    size_t payload_size = header.text_len;
+    if (content.args_len > 0) {
+        payload_ptr = content.args_ptr;
+        payload_size = content.args_len;
+    }
+
+    size_t record_size = sizeof(header) + payload_size;
+    size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+
+    if (write_pos + record_size - cached_read_pos_ > capacity_) {
+        cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+        if (write_pos + record_size - cached_read_pos_ > capacity_)
+            return false;
+    }
+
+    copyIn(write_pos, &header, sizeof(header));
+    if (payload_size > 0)
+        copyIn(write_pos + sizeof(header), payload_ptr, payload_size);
+
+    write_pos_.store(write_pos + record_size, std::memory_order_release);
+    return true;
+}
+
+size_t LogRing::readAll(util::Buffer &buff)
+{
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size_t data_size = write_pos - read_pos;
+    if (data_size == 0)
+        return 0;
+
+    size_t index = read_pos & mask_;
+    size_t first_size = std::min(data_size, capacity_ - index);
+    buff.append(data_ + index, first_size);
+    if (first_size < data_size)
+        buff.append(data_, data_size - first_size);
+
+    read_pos_.store(write_pos, std::memory_order_release);
+    return data_size;
+}
+
+size_t LogRing::usedSize() const
+{
+    return write_pos_.load(std::memory_order_relaxed) - read_pos_.load(std::memory_order_relaxed);
+}
+
+}
+}
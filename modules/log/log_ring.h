@@ -0,0 +1,91 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_LOG_RING_H_20251018
+#define TBOX_LOG_RING_H_20251018
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include <tbox/base/defines.h>
+#include <tbox/base/log_impl.h>
+#include <tbox/util/buffer.h>
+
+namespace tbox {
+namespace log {
+
+/**
+ * 日志环形缓冲，单生产者单消费者，无锁
+ *
+ * 每个打印日志的线程各自持有一个，作为生产者写入；后台线程作为消费者读出。
+ * 每条记录由 LogContent 与紧随其后的正文组成，其中的 text_ptr 与 args_ptr 无意义。
+ * 延迟格式化的日志（args_len 不为0）紧随其后的是编码后的参数，而不是正文。
+ */
+class LogRing {
+  public:
+    //! capacity 会向上取整为2的幂
+    explicit LogRing(size_t capacity);
+    ~LogRing();
+
+    NONCOPYABLE(LogRing);
+    IMMOVABLE(LogRing);
+
+  public:
+    /**
+     * 写入一条日志，仅由生产者线程调用
+     *
+     * 正文超出 maxTextLen() 时会被截断，编码后的参数不能截断，须由调用者保证不超出
+     * \return 空间不足时返回 false，不写入
+     */
+    bool write(const LogContent &content);
+
+    //! 读出所有已写入的记录并追加到 buff 中，仅由消费者线程调用。返回读出的字节数
+    size_t readAll(util::Buffer &buff);
+
+    inline size_t capacity() const { return capacity_; }
+    inline size_t maxTextLen() const { return capacity_ - sizeof(LogContent); }
+    //! 已写入未读出的字节数
+    size_t usedSize() const;
+
+    //! 生产者线程是否已退出，由后台线程用于回收
+    inline bool isProducerExited() const { return is_producer_exited_.load(std::memory_order_acquire); }
+    inline void setProducerExited() { is_producer_exited_.store(true, std::memory_order_release); }
+
+  private:
+    void copyIn(size_t pos, const void *data_ptr, size_t data_size);
+
+  private:
+    uint8_t *data_;
+    size_t capacity_;
+    size_t mask_;
+
+    //! 读写位置单调递增，取模得到下标。中间填充隔开，避免伪共享
+    std::atomic<size_t> write_pos_{0};
+    size_t cached_read_pos_ = 0;    //!< 生产者缓存的 read_pos_，减少跨核读取
+    char padding_[64];
+    std::atomic<size_t> read_pos_{0};
+
+    std::atomic<bool> is_producer_exited_{false};
+};
+
+}
+}
+
+#endif //TBOX_LOG_RING_H_20251018
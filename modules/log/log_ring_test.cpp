@@ -0,0 +1,121 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+#include "log_ring.h"
+
+using namespace tbox;
+using namespace tbox::log;
+
+namespace {
+LogContent MakeContent(const std::string &text, uint32_t usec = 0)
+{
+    LogContent content;
+    ::memset(&content, 0, sizeof(content));
+    content.timestamp.usec = usec;
+    content.level = LOG_LEVEL_INFO;
+    content.text_len = text.size();
+    content.text_ptr = text.data();
+    return content;
+}
+
+//! 从 buff 中取出一条记录的正文
+std::string FetchText(util::Buffer &buff, LogContent &content)
+{
+    ::memcpy(&content, buff.readableBegin(), sizeof(content));
+    buff.hasRead(sizeof(content));
+    std::string text(reinterpret_cast<const char*>(buff.readableBegin()), content.text_len);
+    buff.hasRead(content.text_len);
+    return text;
+}
+}
+
+TEST(LogRing, WriteAndRead)
+{
+    LogRing ring(1000);
+    EXPECT_EQ(ring.capacity(), 1024u);
+
+    EXPECT_TRUE(ring.write(MakeContent("hello", 1)));
+    EXPECT_TRUE(ring.write(MakeContent("", 2)));
+    EXPECT_TRUE(ring.write(MakeContent("world", 3)));
+
+    util::Buffer buff;
+    EXPECT_EQ(ring.readAll(buff), 3 * sizeof(LogContent) + 10);
+    EXPECT_EQ(ring.usedSize(), 0u);
+
+    LogContent content;
+    EXPECT_EQ(FetchText(buff, content), "hello");
+    EXPECT_EQ(content.timestamp.usec, 1u);
+    EXPECT_EQ(FetchText(buff, content), "");
+    EXPECT_EQ(content.timestamp.usec, 2u);
+    EXPECT_EQ(FetchText(buff, content), "world");
+    EXPECT_EQ(content.timestamp.usec, 3u);
+    EXPECT_EQ(buff.readableSize(), 0u);
+}
+
+//! 写满后应写入失败，读出后又能继续写，且跨越缓冲末尾的记录完整
+TEST(LogRing, FullAndWrapAround)
+{
+    LogRing ring(1024);
+    std::string text(100, 'a');
+
+    int write_count = 0;
+    while (ring.write(MakeContent(text)))
+        ++write_count;
+    EXPECT_GT(write_count, 0);
+    EXPECT_LE(ring.usedSize(), ring.capacity());
+
+    util::Buffer buff;
+    for (int round = 0; round < 10; ++round) {
+        buff.hasReadAll();
+        ring.readAll(buff);
+
+        std::string round_text(100, 'b' + round);
+        int count = 0;
+        while (count < write_count && ring.write(MakeContent(round_text)))
+            ++count;
+        EXPECT_EQ(count, write_count);
+
+        buff.hasReadAll();
+        ring.readAll(buff);
+        for (int i = 0; i < count; ++i) {
+            LogContent content;
+            EXPECT_EQ(FetchText(buff, content), round_text);
+        }
+        EXPECT_EQ(buff.readableSize(), 0u);
+    }
+}
+
+//! 超过容量的正文应被截断
+TEST(LogRing, Truncate)
+{
+    LogRing ring(256);
+    std::string text(1000, 'x');
+    EXPECT_TRUE(ring.write(MakeContent(text)));
+
+    util::Buffer buff;
+    ring.readAll(buff);
+
+    LogContent content;
+    EXPECT_EQ(FetchText(buff, content), text.substr(0, ring.maxTextLen()));
+    EXPECT_TRUE(content.text_trunc);
+}
@@ -35,22 +35,34 @@ Sink::~Sink()
 
 void Sink::setLevel(int level)
 {
-    std::lock_guard<std::mutex> _lk(lock_);
-    default_level_ = level;
+    {
+        std::lock_guard<std::mutex> _lk(lock_);
+        default_level_ = level;
+    }
+    LogLevelChanged();
 }
 
 void Sink::setLevel(const std::string &module, int level)
 {
-    std::lock_guard<std::mutex> _lk(lock_);
-    if (module.empty())
-        default_level_ = level;
-    else
-        modules_level_[module] = level;
+    {
+        std::lock_guard<std::mutex> _lk(lock_);
+        if (module.empty())
+            default_level_ = level;
+        else
+            modules_level_[module] = level;
+        has_modules_level_ = !modules_level_.empty();
+    }
+    LogLevelChanged();
 }
 
 void Sink::unsetLevel(const std::string &module)
 {
-    modules_level_.erase(module);
+    {
+        std::lock_guard<std::mutex> _lk(lock_);
+        modules_level_.erase(module);
+        has_modules_level_ = !modules_level_.empty();
+    }
+    LogLevelChanged();
 }
 
 void Sink::enableColor(bool enable)
@@ -64,6 +76,9 @@ bool Sink::enable()
     if (output_id_ == 0) {
         onEnable();
         output_id_ = LogAddPrintfFunc(HandleLog, this);
+        LogSetLevelFunc(output_id_, HandleGetLevel);
+        if (isDeferredFormatSupported())
+            LogSetDeferredFormat(output_id_, true);
         return true;
     }
     return false;
@@ -78,14 +93,24 @@ void Sink::disable()
     }
 }
 
-bool Sink::filter(int level, const std::string &module)
+bool Sink::filter(int level, const char *module)
+{
+    if (!has_modules_level_)
+        return level <= default_level_;
+    return level <= getLevel(module);
+}
+
+int Sink::getLevel(const std::string &module)
 {
+    if (!has_modules_level_)
+        return default_level_;
+
     std::lock_guard<std::mutex> _lk(lock_);
     auto iter = modules_level_.find(module);
     if (iter != modules_level_.end())
-        return level <= iter->second;
+        return iter->second;
     else
-        return level <= default_level_;
+        return default_level_;
 }
 
 void Sink::HandleLog(const LogContent *content, void *ptr)
@@ -94,6 +119,13 @@ void Sink::HandleLog(const LogContent *content, void *ptr)
     pthis->handleLog(content);
 }
 
+//! 供日志前端预过滤用，返回本通道对该模块所输出的最高等级
+int Sink::HandleGetLevel(const char *module_id, void *ptr)
+{
+    Sink *pthis = static_cast<Sink*>(ptr);
+    return pthis->getLevel(module_id);
+}
+
 void Sink::handleLog(const LogContent *content)
 {
     if (!filter(content->level, content->module_id))
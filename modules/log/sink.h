@@ -23,6 +23,7 @@
 #include <map>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <tbox/base/log.h>
 #include <tbox/base/log_impl.h>
 
@@ -50,11 +51,15 @@ class Sink {
     virtual void onDisable() { }
 
     virtual void onLogFrontEnd(const LogContent *content) = 0;
+    //! 能否处理延迟格式化的日志，见 LogSetDeferredFormat()
+    virtual bool isDeferredFormatSupported() const { return false; }
 
     void handleLog(const LogContent *content);
 
     static void HandleLog(const LogContent *content, void *ptr);
-    bool filter(int level, const std::string &module);
+    static int HandleGetLevel(const char *module_id, void *ptr);
+    bool filter(int level, const char *module);
+    int getLevel(const std::string &module);
 
     void updateTimestampStr(uint32_t sec);
 
@@ -67,7 +72,9 @@ class Sink {
 
     uint32_t output_id_ = 0;
     std::map<std::string, int> modules_level_;
-    int default_level_ = LOG_LEVEL_MAX;
+    //! 下面两个在 lock_ 外也会读，使得没有按模块设置等级时，过滤不用加锁
+    std::atomic<bool> has_modules_level_{false};
+    std::atomic<int> default_level_{LOG_LEVEL_MAX};
 
     uint32_t timestamp_sec_ = 0;
 };
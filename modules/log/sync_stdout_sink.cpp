@@ -27,6 +27,7 @@ namespace log {
 
 void SyncStdoutSink::onLogFrontEnd(const LogContent *content)
 {
+    std::lock_guard<std::mutex> lg(print_lock_);
     updateTimestampStr(content->timestamp.sec);
 
     //! 开启色彩，显示日志等级
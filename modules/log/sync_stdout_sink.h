@@ -20,6 +20,7 @@
 #ifndef TBOX_LOG_SYNC_STDOUT_SINK_H_20231006
 #define TBOX_LOG_SYNC_STDOUT_SINK_H_20231006
 
+#include <mutex>
 #include "sink.h"
 
 namespace tbox {
@@ -28,6 +29,9 @@ namespace log {
 class SyncStdoutSink : public Sink {
   protected:
     virtual void onLogFrontEnd(const LogContent *content) override;
+
+  private:
+    std::mutex print_lock_;  //!< 多线程会同时打印，防止各行内容交错
 };
 
 }
@@ -175,3 +175,45 @@ TEST(SyncStdoutSink, Benchmark)
     cout << "count in sec: " << counter/10 << endl;
 }
 
+
+//! 被过滤掉的日志，其参数不应被求值；等级变更后应立即生效
+TEST(SyncStdoutSink, LevelPrefilter)
+{
+    SyncStdoutSink ch;
+    ch.enable();
+    ch.setLevel(LOG_LEVEL_INFO);
+
+    int count = 0;
+    LogDbg("%d", ++count);
+    EXPECT_EQ(count, 0);
+    LogInfo("%d", ++count);
+    EXPECT_EQ(count, 1);
+
+    ch.setLevel(LOG_MODULE_ID, LOG_LEVEL_DEBUG);
+    LogDbg("%d", ++count);
+    EXPECT_EQ(count, 2);
+
+    ch.unsetLevel(LOG_MODULE_ID);
+    LogDbg("%d", ++count);
+    EXPECT_EQ(count, 2);
+
+    ch.disable();
+    LogInfo("%d", ++count);
+    EXPECT_EQ(count, 2);
+}
+
+TEST(SyncStdoutSink, SuppressedLogBenchmark)
+{
+    SyncStdoutSink ch;
+    ch.enable();
+    ch.setLevel(LOG_LEVEL_INFO);
+
+    const int kTimes = 10000000;
+    auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        LogDbg("suppressed %d", i);
+    auto cost = std::chrono::steady_clock::now() - start_time;
+
+    auto ns_per_log = std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count() / double(kTimes);
+    cout << "suppressed LogDbg: " << ns_per_log << " ns" << endl;
+}
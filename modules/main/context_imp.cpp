@@ -171,6 +171,12 @@ bool ContextImp::initialize(const char* proc_name, const Json &cfg, Module *modu
 
 bool ContextImp::initLoop(const Json &js)
 {
+    std::string timer_engine;
+    if (util::json::GetField(js, "timer_engine", timer_engine)) {
+        if (!sp_loop_->setTimerEngine(timer_engine))
+            LogWarn("in cfg.loop, timer_engine '%s' is invalid", timer_engine.c_str());
+    }
+
     if (util::json::HasObjectField(js, "water_line")) {
         auto &js_water_line = js["water_line"];
         auto &water_line = sp_loop_->water_line();
@@ -22,6 +22,7 @@
 #include <sstream>
 #include <tbox/base/json.hpp>
 #include <tbox/base/catch_throw.h>
+#include <tbox/base/fast_clock.h>
 #include <tbox/terminal/session.h>
 #include <tbox/terminal/helper.h>
 #include <tbox/util/fs.h>
@@ -60,6 +61,15 @@ bool Log::initialize(const char *proc_name, Context &ctx, const Json &cfg)
             LogSetMaxLength(static_cast<size_t>(max_len));
         }
 
+        std::string clock_source_str;
+        if (util::json::GetField(js_log, "clock_source", clock_source_str)) {
+            ClockSource clock_source;
+            if (!ClockSourceFromString(clock_source_str, clock_source))
+                LogWarn("in cfg.log, clock_source '%s' is invalid", clock_source_str.c_str());
+            else if (!SetClockSource(clock_source))
+                LogWarn("in cfg.log, clock_source '%s' is not supported", clock_source_str.c_str());
+        }
+
         //! STDOUT
         if (util::json::HasObjectField(js_log, "stdout")) {
             installStdoutSink();
@@ -262,6 +272,20 @@ void Log::initShell()
         terminal::AddFuncNode(*shell_, log_node, "max_len", profile);
     }
 
+    {
+        terminal::StringFuncNodeProfile profile;
+        profile.set_func = \
+            [] (const std::string &name) {
+                ClockSource clock_source;
+                return ClockSourceFromString(name, clock_source) && SetClockSource(clock_source);
+            };
+        profile.get_func = [] { return ClockSourceToString(GetClockSource()); };
+        profile.usage = "Usage: clock_source        # get clock source\r\n"
+                        "       clock_source <name> # set clock source, name: system, coarse, tsc\r\n";
+        profile.help = "get or set clock source of log timestamp";
+        terminal::AddFuncNode(*shell_, log_node, "clock_source", profile);
+    }
+
     {
         auto func_node = shell_->createFuncNode(
             [this] (const Session &s, const Args &a) {
@@ -58,6 +58,7 @@ struct Runtime {
     ContextImp ctx;
     Module apps;
     Json js_conf;
+    Trace trace;
 
     util::PidFile pid_file;
     int exit_wait_sec = 1;
@@ -127,9 +128,9 @@ bool Start(int argc, char **argv)
     auto &ctx = _runtime->ctx;
     auto &apps = _runtime->apps;
     auto &js_conf = _runtime->js_conf;
+    auto &trace = _runtime->trace;
 
     Args args(js_conf);
-    Trace trace;
 
     log.fillDefaultConfig(js_conf);
     ctx.fillDefaultConfig(js_conf);
@@ -188,6 +189,7 @@ bool Start(int argc, char **argv)
         } else {
             LogErr("Apps init fail");
         }
+        trace.cleanup();
         ctx.cleanup();
     } else {
         LogErr("Context init fail");
@@ -218,6 +220,7 @@ void Stop()
     _runtime->thread.join();
 
     _runtime->apps.cleanup();  //! cleanup所有应用
+    _runtime->trace.cleanup();
     _runtime->ctx.cleanup();
 
     End();
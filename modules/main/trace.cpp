@@ -21,12 +21,15 @@
 #include <iostream>
 #include <sstream>
 #include <tbox/base/log.h>
+#include <tbox/base/defines.h>
 #include <tbox/base/json.hpp>
 #include <tbox/base/catch_throw.h>
 #include <tbox/terminal/session.h>
 #include <tbox/terminal/helper.h>
 #include <tbox/util/json.h>
 #include <tbox/trace/sink.h>
+#include <tbox/base/recorder.h>
+#include <tbox/base/fast_clock.h>
 
 namespace tbox {
 namespace main {
@@ -40,13 +43,24 @@ void Trace::fillDefaultConfig(Json &cfg) const
 {
   "enable": false,
   "max_size": 1024,
-  "sync_enable": false
+  "sync_enable": false,
+  "sampling": {
+    "every_n": 1,
+    "min_duration_us": 0
+  },
+  "counter_interval_ms": 1000
 }
 )"_json;
 }
 
+Trace::~Trace()
+{
+    cleanup();
+}
+
 bool Trace::initialize(Context &ctx, const Json &cfg)
 {
+    ctx_ = &ctx;
     initShell(*ctx.terminal());
 
     if (util::json::HasObjectField(cfg, "trace")) {
@@ -73,8 +87,21 @@ bool Trace::initialize(Context &ctx, const Json &cfg)
         if (!path_prefix.empty())
             sink.setPathPrefix(path_prefix);
 
+        if (util::json::HasObjectField(js_trace, "sampling")) {
+            auto &js_sampling = js_trace.at("sampling");
+            uint32_t every_n = 1, min_duration_us = 0;
+            trace::GetRecordSampling(every_n, min_duration_us);
+            util::json::GetField(js_sampling, "every_n", every_n);
+            util::json::GetField(js_sampling, "min_duration_us", min_duration_us);
+            trace::SetRecordSampling(every_n, min_duration_us);
+        }
+
+        int counter_interval_ms = 0;
+        if (util::json::GetField(js_trace, "counter_interval_ms", counter_interval_ms))
+            setCounterInterval(counter_interval_ms);
+
         if (is_enable)
-            sink.enable();
+            enableSink();
 
         if (util::json::HasObjectField(js_trace, "filter")) {
             auto &js_filter = js_trace.at("filter");
@@ -107,6 +134,88 @@ bool Trace::initialize(Context &ctx, const Json &cfg)
     return true;
 }
 
+void Trace::cleanup()
+{
+    CHECK_DELETE_RESET_OBJ(sp_counter_timer_);
+    counter_interval_ms_ = 0;
+}
+
+bool Trace::setCounterInterval(int interval_ms)
+{
+    if (ctx_ == nullptr || interval_ms < 0)
+        return false;
+
+    counter_interval_ms_ = interval_ms;
+    updateCounterTimer();
+    return true;
+}
+
+bool Trace::enableSink()
+{
+    bool is_succ = trace::Sink::GetInstance().enable();
+    updateCounterTimer();
+    return is_succ;
+}
+
+void Trace::disableSink()
+{
+    trace::Sink::GetInstance().disable();
+    updateCounterTimer();
+}
+
+//! 只在 trace 开启且采样周期不为0时才有定时器，关闭时不占用事件循环
+void Trace::updateCounterTimer()
+{
+    bool is_need = ctx_ != nullptr && counter_interval_ms_ > 0 &&
+                   trace::Sink::GetInstance().isEnabled();
+    CHECK_DELETE_RESET_OBJ(sp_counter_timer_);
+    if (!is_need)
+        return;
+
+    last_loop_stat_ = ctx_->loop()->getStat();
+
+    sp_counter_timer_ = ctx_->loop()->newTimerEvent("main::Trace::counter_timer");
+    sp_counter_timer_->initialize(std::chrono::milliseconds(counter_interval_ms_), event::Event::Mode::kPersist);
+    sp_counter_timer_->setCallback([this] { commitCounters(); });
+    sp_counter_timer_->enable();
+}
+
+void Trace::commitCounters()
+{
+    auto &sink = trace::Sink::GetInstance();
+    if (!sink.isEnabled())
+        return;
+
+    auto now_us = GetSystemClockMicroseconds();
+
+    //! 事件循环的统计是累积值，这里取与上次采样的差值；中途被 resetStat() 过，则直接取当前值
+    auto loop_stat = ctx_->loop()->getStat();
+    auto last_loop_stat = last_loop_stat_;
+    if (loop_stat.loop_count < last_loop_stat.loop_count)
+        last_loop_stat = event::Stat();
+    last_loop_stat_ = loop_stat;
+
+    uint64_t loop_count = loop_stat.loop_count - last_loop_stat.loop_count;
+    uint64_t loop_cost_us = loop_stat.loop_acc_cost_us - last_loop_stat.loop_acc_cost_us;
+
+    sink.commitCounter("loop.loop_count", now_us, loop_count);
+    sink.commitCounter("loop.loop_avg_cost_us", now_us, loop_count > 0 ? loop_cost_us / loop_count : 0);
+    sink.commitCounter("loop.loop_peak_cost_us", now_us, loop_stat.loop_peak_cost_us);
+    sink.commitCounter("loop.run_in_loop_peak_num", now_us, loop_stat.run_in_loop_peak_num);
+    sink.commitCounter("loop.run_next_peak_num", now_us, loop_stat.run_next_peak_num);
+
+    auto snapshot = ctx_->thread_pool()->snapshot();
+    size_t undo_task_num = 0;
+    for (auto num : snapshot.undo_task_num)
+        undo_task_num += num;
+
+    sink.commitCounter("thread_pool.thread_num", now_us, snapshot.thread_num);
+    sink.commitCounter("thread_pool.idle_thread_num", now_us, snapshot.idle_thread_num);
+    sink.commitCounter("thread_pool.doing_task_num", now_us, snapshot.doing_task_num);
+    sink.commitCounter("thread_pool.undo_task_num", now_us, undo_task_num);
+    sink.commitCounter("thread_pool.undo_task_peak_num", now_us, snapshot.undo_task_peak_num);
+}
+
 void Trace::initShell(TerminalNodes &term)
 {
     auto trace_node = term.createDirNode("This is trace directory");
@@ -116,11 +225,11 @@ void Trace::initShell(TerminalNodes &term)
         terminal::BooleanFuncNodeProfile profile;
         profile.get_func = [] { return trace::Sink::GetInstance().isEnabled(); };
         profile.set_func = \
-            [] (bool is_enable) {
+            [this] (bool is_enable) {
                 if (is_enable)
-                    return trace::Sink::GetInstance().enable();
+                    return enableSink();
                 else
-                    trace::Sink::GetInstance().disable();
+                    disableSink();
                 return true;
             };
         profile.usage = \
@@ -171,6 +280,62 @@ void Trace::initShell(TerminalNodes &term)
         terminal::AddFuncNode(term, trace_node, "set_record_max_size", profile);
     }
 
+    {
+        terminal::IntegerFuncNodeProfile profile;
+        profile.get_func = [] {
+            uint32_t every_n = 1, min_duration_us = 0;
+            trace::GetRecordSampling(every_n, min_duration_us);
+            return static_cast<int>(every_n);
+        };
+        profile.set_func = \
+            [] (int every_n) {
+                uint32_t origin_every_n = 1, min_duration_us = 0;
+                trace::GetRecordSampling(origin_every_n, min_duration_us);
+                trace::SetRecordSampling(every_n, min_duration_us);
+                return true;
+            };
+        profile.min_value = 1;
+        profile.usage = \
+            "Usage: sampling_every_n      # print current value\r\n"
+            "       sampling_every_n <n>  # record 1 in n at each call site, >=1\r\n";
+        profile.help = "print or set sampling rate of recorders";
+        terminal::AddFuncNode(term, trace_node, "sampling_every_n", profile);
+    }
+
+    {
+        terminal::IntegerFuncNodeProfile profile;
+        profile.get_func = [] {
+            uint32_t every_n = 1, min_duration_us = 0;
+            trace::GetRecordSampling(every_n, min_duration_us);
+            return static_cast<int>(min_duration_us);
+        };
+        profile.set_func = \
+            [] (int min_duration_us) {
+                uint32_t every_n = 1, origin_min_duration_us = 0;
+                trace::GetRecordSampling(every_n, origin_min_duration_us);
+                trace::SetRecordSampling(every_n, min_duration_us);
+                return true;
+            };
+        profile.min_value = 0;
+        profile.usage = \
+            "Usage: sampling_min_duration       # print current value\r\n"
+            "       sampling_min_duration <us>  # only commit records not shorter than it\r\n";
+        profile.help = "print or set min duration of committed records";
+        terminal::AddFuncNode(term, trace_node, "sampling_min_duration", profile);
+    }
+
+    {
+        terminal::IntegerFuncNodeProfile profile;
+        profile.get_func = [this] { return counter_interval_ms_; };
+        profile.set_func = [this] (int interval_ms) { return setCounterInterval(interval_ms); };
+        profile.min_value = 0;
+        profile.usage = \
+            "Usage: counter_interval       # print current value\r\n"
+            "       counter_interval <ms>  # sample loop and thread pool counters every <ms>, 0 to stop\r\n";
+        profile.help = "print or set counter sampling interval";
+        terminal::AddFuncNode(term, trace_node, "counter_interval", profile);
+    }
+
     {
         terminal::StringFuncNodeProfile profile;
         profile.get_func = [] () { return trace::Sink::GetInstance().getCurrRecordFilename(); };
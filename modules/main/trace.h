@@ -21,18 +21,42 @@
 #define TBOX_MAIN_TRACE_H_20240607
 
 #include <tbox/base/json_fwd.h>
+#include <tbox/event/stat.h>
+#include <tbox/event/timer_event.h>
 #include "context.h"
 
 namespace tbox {
 namespace main {
 
+/**
+ * 配置 trace::Sink，并定时将事件循环与线程池的状态作为计数器提交，
+ * 以便在时间线上与函数耗时记录一起查看
+ *
+ * 采样定时器只在通过本模块（配置或终端）开启 trace 时创建，关闭时销毁
+ */
 class Trace {
   public:
+    ~Trace();
+
     void fillDefaultConfig(Json &cfg) const;
     bool initialize(Context &ctx, const Json &cfg);
+    void cleanup();
 
   protected:
     void initShell(terminal::TerminalNodes &term);
+
+    bool enableSink();
+    void disableSink();
+
+    bool setCounterInterval(int interval_ms);
+    void updateCounterTimer();
+    void commitCounters();
+
+  private:
+    Context *ctx_ = nullptr;
+    event::TimerEvent *sp_counter_timer_ = nullptr;
+    int counter_interval_ms_ = 0;   //!< 计数器采样周期，为0表示不采样
+    event::Stat last_loop_stat_;    //!< 上次采样时的事件循环统计，用于计算区间内的增量
 };
 
 }
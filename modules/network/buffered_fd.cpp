@@ -20,6 +20,11 @@
 #include "buffered_fd.h"
 
 #include <cstring>
+#include <algorithm>
+#include <climits>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/wrapped_recorder.h>
@@ -31,6 +36,19 @@ namespace network {
 
 using namespace std::placeholders;
 
+namespace {
+const size_t kAsyncReadSize = 16 << 10;  //!< 每次 asyncRead() 最多读取的字节数
+const int kMaxWriteIovNum = 64;         //!< 每次 writev() 最多的块数
+const size_t kFileChunkSize = 64 << 10; //!< sendfile() 不可用时，每次从文件读出的字节数
+
+//! 只对 socket 使用异步IO，它在内核中由就绪通知驱动，不会占用 io_uring 的工作线程
+bool IsSocket(int fd)
+{
+    struct stat st;
+    return ::fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+}
+
 BufferedFd::BufferedFd(event::Loop *wp_loop) :
     wp_loop_(wp_loop),
     send_buff_(0), recv_buff_(0)
@@ -43,6 +61,11 @@ BufferedFd::~BufferedFd()
     if (state_ == State::kRunning)
         disable();
 
+    if (write_io_id_ != 0) {
+        wp_loop_->cancelAsyncIo(write_io_id_);
+        write_io_id_ = 0;
+    }
+
     CHECK_DELETE_RESET_OBJ(sp_write_event_);
     CHECK_DELETE_RESET_OBJ(sp_read_event_);
 }
@@ -65,6 +88,11 @@ bool BufferedFd::initialize(Fd fd, short events)
     }
 
     fd_ = fd;
+    use_async_io_ = wp_loop_->isAsyncIoSupported() && IsSocket(fd_.get());
+    /**
+     * 异步IO模式下也保持非阻塞，fd 可能还被别处直接读写。
+     * 未就绪时引擎会收到 EAGAIN，由它等就绪后重新提交
+     */
     fd_.setNonBlock(true);
 
     CHECK_DELETE_RESET_OBJ(sp_write_event_);
@@ -72,13 +100,15 @@ bool BufferedFd::initialize(Fd fd, short events)
 
     if (events & kReadOnly) {
         sp_read_event_ = wp_loop_->newFdEvent("BufferedFd::sp_read_event_");
-        sp_read_event_->initialize(fd_.get(), event::FdEvent::kReadEvent, event::Event::Mode::kPersist);
+        sp_read_event_->initialize(fd_.get(), event::FdEvent::kReadEvent | event::FdEvent::kEdgeTriggered,
+                                   event::Event::Mode::kPersist);
         sp_read_event_->setCallback(std::bind(&BufferedFd::onReadCallback, this, _1));
     }
 
     if (events & kWriteOnly) {
         sp_write_event_ = wp_loop_->newFdEvent("BufferedFd::sp_write_event_");
-        sp_write_event_->initialize(fd_.get(), event::FdEvent::kWriteEvent, event::Event::Mode::kPersist);
+        sp_write_event_->initialize(fd_.get(), event::FdEvent::kWriteEvent | event::FdEvent::kEdgeTriggered,
+                                    event::Event::Mode::kPersist);
         sp_write_event_->setCallback(std::bind(&BufferedFd::onWriteCallback, this, _1));
     }
 
@@ -103,11 +133,20 @@ bool BufferedFd::enable()
         return false;
     }
 
+    state_ = State::kRunning;
+
+    if (use_async_io_) {
+        if (sp_read_event_ != nullptr)
+            startAsyncRead();
+        //! disable() 时没有撤消写请求，可能还没完成
+        if (write_io_id_ == 0 && hasPendingData())
+            startAsyncWrite();
+        return true;
+    }
+
     if (sp_read_event_ != nullptr)
         sp_read_event_->enable();
 
-    state_ = State::kRunning;
-
     return true;
 }
 
@@ -127,48 +166,262 @@ bool BufferedFd::disable()
     if (sp_write_event_ != nullptr)
         sp_write_event_->disable();
 
+    //! 撤消后引擎仍持有缓冲直到内核完成，这里不能再使用，要放弃掉
+    if (read_io_id_ != 0) {
+        wp_loop_->cancelAsyncIo(read_io_id_);
+        read_io_id_ = 0;
+        sp_async_recv_buff_.reset();
+    }
+
+    /**
+     * 已提交的写请求不撤消，让它写完，完成后不再继续。
+     * 因为撤消之后就无从得知内核实际写出了多少，再 enable() 时就无法接着发送
+     */
+
     state_ = State::kInited;
 
     return true;
 }
 
 bool BufferedFd::send(const void *data_ptr, size_t data_size)
+{
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(data_ptr);
+    iov.iov_len  = data_size;
+    return sendv(&iov, 1);
+}
+
+bool BufferedFd::sendv(const struct iovec *iov, int iovcnt)
 {
     if (sp_write_event_ == nullptr) {
         LogWarn("send is disabled");
         return false;
     }
 
-    //! 如果当前没有 enable() 或者发送缓冲区中还有没有发送完成的数据
-    if ((state_ != State::kRunning) || (send_buff_.readableSize() > 0)) {
-        //! 则新的数据就直接放到发送缓冲区
-        send_buff_.append(data_ptr, data_size);
-    } else {
-        //! 否则尝试发送
-        ssize_t wsize = fd_.write(data_ptr, data_size);
+    size_t total_size = 0;
+    for (int i = 0; i < iovcnt; ++i)
+        total_size += iov[i].iov_len;
+
+    if (total_size == 0)
+        return true;
+
+    if (use_async_io_) {
+        for (int i = 0; i < iovcnt; ++i)
+            appendPendingData(iov[i].iov_base, iov[i].iov_len);
+        if (state_ == State::kRunning && write_io_id_ == 0 && hasPendingData())
+            startAsyncWrite();
+        return true;
+    }
+
+    size_t skip_size = 0;  //!< 已发送掉的字节数
+
+    //! 如果当前已 enable() 且没有未发送完成的数据，则尝试直接发送
+    if ((state_ == State::kRunning) && !hasPendingData()) {
+        //! 超出 IOV_MAX 的部分放到待发送队列中
+        ssize_t wsize = fd_.writev(iov, std::min(iovcnt, IOV_MAX));
         if (wsize >= 0) {   //! 如果发送正常
-            //! 如果没有发送完，还有剩余的数据
-            if (static_cast<size_t>(wsize) < data_size) {
-                //! 则将剩余的数据放入到缓冲区
-                const uint8_t* p_remain = static_cast<const uint8_t*>(data_ptr) + wsize;
-                send_buff_.append(p_remain, (data_size - wsize));
-            }
-            sp_write_event_->enable();  //! 等待可写事件
+            skip_size = wsize;
+        } else if (errno != EAGAIN) {   //! 出了错，且不是文件操作繁忙
+            LogWarn("send fail, drop data. errno:%d, %s", errno, strerror(errno));
+            return true;
+        }
+        sp_write_event_->enable();  //! 等待可写事件
+    }
 
-        } else {    //! 否则就是出了错
-            if (errno == EAGAIN) {  //! 文件操作繁忙
-                send_buff_.append(data_ptr, data_size);
-                sp_write_event_->enable();  //! 等待可写事件
-            } else {
-                LogWarn("send fail, drop data. errno:%d, %s", errno, strerror(errno));
-                //!TODO
-            }
+    //! 将没有发送完的数据放入到待发送队列
+    for (int i = 0; i < iovcnt; ++i) {
+        size_t len = iov[i].iov_len;
+        if (skip_size >= len) {
+            skip_size -= len;
+            continue;
         }
+        appendPendingData(static_cast<const uint8_t*>(iov[i].iov_base) + skip_size, len - skip_size);
+        skip_size = 0;
     }
 
     return true;
 }
 
+bool BufferedFd::send(SharedData data)
+{
+    if (sp_write_event_ == nullptr) {
+        LogWarn("send is disabled");
+        return false;
+    }
+
+    if (data == nullptr || data->empty())
+        return true;
+
+    size_t offset = 0;
+    //! 异步IO模式下，内存块由 startAsyncWrite() 直接提交，不拷贝
+    if (!use_async_io_ && (state_ == State::kRunning) && !hasPendingData()) {
+        ssize_t wsize = fd_.write(data->data(), data->size());
+        if (wsize >= 0) {
+            offset = wsize;
+        } else if (errno != EAGAIN) {
+            LogWarn("send fail, drop data. errno:%d, %s", errno, strerror(errno));
+            return true;
+        }
+        sp_write_event_->enable();
+    }
+
+    //! 没发送完的，持有引用，等可写时再发送
+    size_t size = data->size();
+    if (offset < size)
+        send_slices_.push_back(Slice{std::move(data), Fd(), 0, size, offset});
+
+    if (use_async_io_ && state_ == State::kRunning && write_io_id_ == 0)
+        startAsyncWrite();
+
+    return true;
+}
+
+bool BufferedFd::sendFile(Fd file, off_t offset, size_t size)
+{
+    if (sp_write_event_ == nullptr) {
+        LogWarn("send is disabled");
+        return false;
+    }
+
+    if (file.isNull()) {
+        LogWarn("file is null");
+        return false;
+    }
+
+    if (size == 0)
+        return true;
+
+    //! 文件块总是先入队，由 writePendingData() 或 startAsyncWrite() 按序发送
+    send_slices_.push_back(Slice{nullptr, std::move(file), offset, size, 0});
+
+    if (state_ == State::kRunning) {
+        if (use_async_io_) {
+            if (write_io_id_ == 0)
+                startAsyncWrite();
+        } else {
+            sp_write_event_->enable();
+        }
+    }
+
+    return true;
+}
+
+void BufferedFd::appendPendingData(const void *data_ptr, size_t data_size)
+{
+    if (send_slices_.empty())
+        send_buff_.append(data_ptr, data_size);
+    else    //! 为保证顺序，要排在已有的 send_slices_ 之后
+        send_slices_.push_back(Slice{std::make_shared<std::string>(static_cast<const char*>(data_ptr), data_size),
+                                     Fd(), 0, data_size, 0});
+}
+
+void BufferedFd::consumePendingData(size_t size)
+{
+    size_t buff_size = std::min(size, send_buff_.readableSize());
+    send_buff_.hasRead(buff_size);
+    size -= buff_size;
+
+    while (size > 0 && !send_slices_.empty()) {
+        auto &slice = send_slices_.front();
+        size_t remain_size = slice.size - slice.offset;
+        if (size < remain_size) {
+            slice.offset += size;
+            break;
+        }
+        size -= remain_size;
+        send_slices_.pop_front();
+    }
+}
+
+/**
+ * 用 writev() 一次发送 send_buff_ 与 send_slices_ 中的数据，遇到文件块为止
+ * 文件块排在最前面时，则用 sendfile() 发送
+ */
+ssize_t BufferedFd::writePendingData()
+{
+    struct iovec iov[kMaxWriteIovNum];
+    int iovcnt = 0;
+
+    if (send_buff_.readableSize() > 0) {
+        iov[0].iov_base = send_buff_.readableBegin();
+        iov[0].iov_len  = send_buff_.readableSize();
+        ++iovcnt;
+    }
+
+    if (iovcnt == 0 && !send_slices_.front().file.isNull())
+        return writeFileSlice();
+
+    for (auto &slice : send_slices_) {
+        if (iovcnt >= kMaxWriteIovNum || !slice.file.isNull())
+            break;
+        iov[iovcnt].iov_base = const_cast<char*>(slice.data->data()) + slice.offset;
+        iov[iovcnt].iov_len  = slice.data->size() - slice.offset;
+        ++iovcnt;
+    }
+
+    ssize_t wsize = fd_.writev(iov, iovcnt);
+    if (wsize > 0)
+        consumePendingData(wsize);
+    return wsize;
+}
+
+ssize_t BufferedFd::writeFileSlice()
+{
+    auto &slice = send_slices_.front();
+    off_t file_offset = slice.file_offset + slice.offset;
+    size_t remain_size = slice.size - slice.offset;
+
+    ssize_t wsize = ::sendfile(fd_.get(), slice.file.get(), &file_offset, remain_size);
+    if (wsize < 0 && (errno == EINVAL || errno == ENOSYS)) {
+        //! 目标 fd 不支持 sendfile() 时，退而读出再写
+        char buff[kFileChunkSize];
+        ssize_t rsize = ::pread(slice.file.get(), buff, std::min(remain_size, sizeof(buff)), file_offset);
+        wsize = (rsize > 0) ? fd_.write(buff, rsize) : rsize;
+    }
+
+    if (wsize == 0) {
+        //! 文件比预期的短，已读到了末尾，无法再发送
+        LogWarn("file is shorter than expected, remain:%zu", remain_size);
+        errno = ENODATA;
+        return -1;
+    }
+
+    if (wsize > 0)
+        consumePendingData(wsize);
+    return wsize;
+}
+
+/**
+ * 异步IO模式下，send_buff_ 发送完了，将下一个块的数据装入 send_buff_
+ * 文件块每次只装入 kFileChunkSize，以限制内存占用
+ */
+bool BufferedFd::loadSliceToSendBuff()
+{
+    auto &slice = send_slices_.front();
+    size_t remain_size = slice.size - slice.offset;
+
+    if (slice.file.isNull()) {
+        send_buff_.append(slice.data->data() + slice.offset, remain_size);
+        send_slices_.pop_front();
+        return true;
+    }
+
+    size_t load_size = std::min(remain_size, kFileChunkSize);
+    send_buff_.ensureWritableSize(load_size);
+    ssize_t rsize = ::pread(slice.file.get(), send_buff_.writableBegin(), load_size, slice.file_offset + slice.offset);
+    if (rsize <= 0) {
+        LogWarn("read file fail, rsize:%zd, errno:%d, %s", rsize, errno, strerror(errno));
+        send_slices_.pop_front();
+        return false;
+    }
+
+    send_buff_.hasWritten(rsize);
+    slice.offset += rsize;
+    if (slice.offset >= slice.size)
+        send_slices_.pop_front();
+    return true;
+}
+
 void BufferedFd::shrinkRecvBuffer()
 {
     recv_buff_.shrink();
@@ -179,6 +432,15 @@ void BufferedFd::shrinkSendBuffer()
     send_buff_.shrink();
 }
 
+bool BufferedFd::isSending() const
+{
+    if (hasPendingData() || write_io_id_ != 0)
+        return true;
+
+    //! 数据已全部写出，可写事件到来时才回调 send_complete_cb
+    return sp_write_event_ != nullptr && sp_write_event_->isEnabled();
+}
+
 void BufferedFd::onReadCallback(short)
 {
     RECORD_SCOPE();
@@ -210,37 +472,57 @@ void BufferedFd::onReadCallback(short)
             rbuf[0].iov_base = recv_buff_.writableBegin();
             rbuf[0].iov_len  = writable_size;
         } while ((rsize = fd_.readv(rbuf, 2)) > 0);
+        int read_errno = errno;
 
-        //! 如果有绑定接收者，则应将数据直接转发给接收者
-        if (wp_receiver_ != nullptr) {
-            wp_receiver_->send(recv_buff_.readableBegin(), recv_buff_.readableSize());
-            recv_buff_.hasReadAll();
+        handleReceivedData();
 
-        } else if (recv_buff_.readableSize() >= receive_threshold_) {
-            if (receive_cb_) {
-                ++cb_level_;
-                receive_cb_(recv_buff_);
-                --cb_level_;
-            } else {
-                LogWarn("receive_cb_ is not set");
-                recv_buff_.hasReadAll();    //! 丢弃数据，防止堆积
-            }
+        /**
+         * 边沿触发时，读完之后不会再有事件通知，所以如果最后一次读到了0或出了错，
+         * 要在这里一并处理，不能等下一次回调。除非上面的回调中已经 disable() 了
+         */
+        if ((rsize == 0 || read_errno != EAGAIN) && state_ == State::kRunning)
+            onReadEndOrError(rsize, read_errno);
+
+    } else {
+        onReadEndOrError(rsize, errno);
+    }
+}
+
+void BufferedFd::handleReceivedData()
+{
+    //! 如果有绑定接收者，则应将数据直接转发给接收者
+    if (wp_receiver_ != nullptr) {
+        wp_receiver_->send(recv_buff_.readableBegin(), recv_buff_.readableSize());
+        recv_buff_.hasReadAll();
+
+    } else if (recv_buff_.readableSize() >= receive_threshold_) {
+        if (receive_cb_) {
+            ++cb_level_;
+            receive_cb_(recv_buff_);
+            --cb_level_;
+        } else {
+            LogWarn("receive_cb_ is not set");
+            recv_buff_.hasReadAll();    //! 丢弃数据，防止堆积
         }
+    }
+}
 
-    } else if (rsize == 0) {    //! 读到0字节数据，说明fd_已不可读了
+void BufferedFd::onReadEndOrError(ssize_t rsize, int read_errno)
+{
+    if (rsize == 0) {    //! 读到0字节数据，说明fd_已不可读了
         if (read_zero_cb_) {
             ++cb_level_;
             read_zero_cb_();
             --cb_level_;
         }
     } else {    //! 读出错了
-        if (errno != EAGAIN) {
+        if (read_errno != EAGAIN) {
             if (read_error_cb_) {
                 ++cb_level_;
-                read_error_cb_(errno);
+                read_error_cb_(read_errno);
                 --cb_level_;
             } else
-                LogWarn("read error, rsize:%d, errno:%d, %s", rsize, errno, strerror(errno));
+                LogWarn("read error, rsize:%d, errno:%d, %s", rsize, read_errno, strerror(read_errno));
         }
     }
 }
@@ -249,7 +531,7 @@ void BufferedFd::onWriteCallback(short)
 {
     RECORD_SCOPE();
     //! 如果发送缓冲中已无数据要发送了，那就关闭可写事件
-    if (send_buff_.readableSize() == 0) {
+    if (!hasPendingData()) {
         sp_write_event_->disable();
 
         if (send_complete_cb_) {
@@ -260,17 +542,151 @@ void BufferedFd::onWriteCallback(short)
         return;
     }
 
-    //! 下面是有数据要发送的
-    ssize_t wsize = fd_.write(send_buff_.readableBegin(), send_buff_.readableSize());
-    if (wsize >= 0) {
-        send_buff_.hasRead(wsize);
-    } else {
+    //! 下面是有数据要发送的，一直写到写完或 EAGAIN 为止，以适应边沿触发
+    while (hasPendingData()) {
+        ssize_t wsize = writePendingData();
+        if (wsize > 0)
+            continue;
+
+        if (wsize == 0 || errno == EAGAIN)
+            return; //! 等待下一次可写事件
+
         if (write_error_cb_) {
             ++cb_level_;
             write_error_cb_(errno);
             --cb_level_;
         } else
             LogWarn("write error, wsize:%d, errno:%d, %s", wsize, errno, strerror(errno));
+        return;
+    }
+
+    //! 边沿触发时，写完了不会再有可写事件，所以要在这里就关闭可写事件并通知
+    sp_write_event_->disable();
+
+    if (send_complete_cb_) {
+        ++cb_level_;
+        send_complete_cb_();
+        --cb_level_;
+    }
+}
+
+void BufferedFd::startAsyncRead()
+{
+    if (sp_async_recv_buff_ == nullptr)
+        sp_async_recv_buff_ = std::make_shared<Buffer>(kAsyncReadSize);
+
+    //! 此时 buff 总是空的，容量不足时直接换成新的，不用 ensureWritableSize() 那样翻倍
+    auto &buff = *sp_async_recv_buff_;
+    if (buff.writableSize() < kAsyncReadSize) {
+        Buffer tmp(kAsyncReadSize);
+        buff.swap(tmp);
+    }
+    read_io_id_ = wp_loop_->asyncRead(fd_.get(), buff.writableBegin(), buff.writableSize(), sp_async_recv_buff_,
+                                      std::bind(&BufferedFd::onAsyncRead, this, _1));
+    if (read_io_id_ == 0)
+        LogWarn("async read fail, fd:%d", fd_.get());
+}
+
+void BufferedFd::startAsyncWrite()
+{
+    if (sp_async_send_buff_ == nullptr)
+        sp_async_send_buff_ = std::make_shared<Buffer>(0);
+
+    //! 上次没有写完的，要先写完
+    auto &buff = *sp_async_send_buff_;
+    if (buff.readableSize() == 0 && send_buff_.readableSize() == 0 && send_slices_.front().file.isNull()) {
+        //! 排在最前的是内存块，直接提交，由引擎持有引用，免去拷贝
+        auto &slice = send_slices_.front();
+        write_io_id_ = wp_loop_->asyncWrite(fd_.get(), slice.data->data() + slice.offset, slice.size - slice.offset,
+                                            std::const_pointer_cast<std::string>(slice.data),
+                                            std::bind(&BufferedFd::onAsyncWrite, this, _1));
+        if (write_io_id_ == 0)
+            LogWarn("async write fail, fd:%d", fd_.get());
+        else
+            is_async_writing_slice_ = true;
+        return;
+    }
+
+    if (buff.readableSize() == 0) {
+        if (send_buff_.readableSize() == 0) {
+            if (!loadSliceToSendBuff()) {
+                onAsyncWrite(-EIO);
+                return;
+            }
+        }
+        //! 待发送的数据整个交换过来，免去拷贝，之后 send() 的数据继续追加到 send_buff_ 中
+        buff.swap(send_buff_);
+    }
+
+    write_io_id_ = wp_loop_->asyncWrite(fd_.get(), buff.readableBegin(), buff.readableSize(), sp_async_send_buff_,
+                                        std::bind(&BufferedFd::onAsyncWrite, this, _1));
+    if (write_io_id_ == 0)
+        LogWarn("async write fail, fd:%d", fd_.get());
+}
+
+void BufferedFd::onAsyncRead(ssize_t rsize)
+{
+    RECORD_SCOPE();
+    read_io_id_ = 0;
+
+    if (rsize > 0) {
+        auto &buff = *sp_async_recv_buff_;
+        buff.hasWritten(rsize);
+        //! recv_buff_ 中没有残留数据时，直接交换，免去拷贝
+        if (recv_buff_.readableSize() == 0) {
+            recv_buff_.swap(buff);
+        } else {
+            recv_buff_.append(buff.readableBegin(), buff.readableSize());
+            buff.hasReadAll();
+        }
+        handleReceivedData();
+
+        //! 回调中可能已经 disable() 了
+        if (state_ == State::kRunning && read_io_id_ == 0)
+            startAsyncRead();
+
+    } else {
+        onReadEndOrError(rsize, -rsize);
+    }
+}
+
+void BufferedFd::onAsyncWrite(ssize_t wsize)
+{
+    RECORD_SCOPE();
+    write_io_id_ = 0;
+
+    bool is_slice = is_async_writing_slice_;
+    is_async_writing_slice_ = false;
+
+    if (wsize < 0) {
+        if (write_error_cb_) {
+            ++cb_level_;
+            write_error_cb_(-wsize);
+            --cb_level_;
+        } else
+            LogWarn("write error, errno:%d, %s", -wsize, strerror(-wsize));
+        return;
+    }
+
+    if (is_slice) {
+        auto &slice = send_slices_.front();
+        slice.offset += wsize;
+        if (slice.offset >= slice.size)
+            send_slices_.pop_front();
+    } else {
+        sp_async_send_buff_->hasRead(wsize);
+    }
+
+    if (hasPendingData()) {
+        if (state_ == State::kRunning)
+            startAsyncWrite();
+        return;
+    }
+
+    if (send_complete_cb_) {
+        ++cb_level_;
+        send_complete_cb_();
+        --cb_level_;
     }
 }
 
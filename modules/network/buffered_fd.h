@@ -20,7 +20,12 @@
 #ifndef TBOX_NETWORK_BUFFERED_FD_H_20171030
 #define TBOX_NETWORK_BUFFERED_FD_H_20171030
 
+#include <deque>
+#include <memory>
+#include <string>
 #include <functional>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <tbox/event/forward.h>
 #include <tbox/base/defines.h>
 #include <tbox/util/fd.h>
@@ -72,6 +77,25 @@ class BufferedFd : public ByteStream {
     //! 实现 ByteStream 的接口
     virtual void setReceiveCallback(const ReceiveCallback &func, size_t threshold) override;
     virtual bool send(const void *data_ptr, size_t data_size) override;
+
+    //! 分散发送多块数据，如头部与正文，免去先拼接。未能立即发送的部分会被拷贝
+    bool sendv(const struct iovec *iov, int iovcnt);
+
+    /**
+     * 以引用计数的方式交出数据，发送完成前一直持有，全程不拷贝
+     * 如：send(std::make_shared<std::string>(std::move(body)))
+     */
+    using SharedData = std::shared_ptr<const std::string>;
+    bool send(SharedData data);
+
+    /**
+     * 发送文件中 [offset, offset + size) 区间的内容
+     *
+     * 由 sendfile() 直接从文件发往 fd，不经过用户态缓冲，按可写事件分批发送。
+     * 发送完成前一直持有 file 的引用。file 必须是普通文件
+     */
+    bool sendFile(Fd file, off_t offset, size_t size);
+
     virtual void bind(ByteStream *receiver) override { wp_receiver_ = receiver; }
     virtual void unbind() override { wp_receiver_ = nullptr; }
     virtual Buffer* getReceiveBuffer() { return &recv_buff_; }
@@ -80,6 +104,12 @@ class BufferedFd : public ByteStream {
     bool enable();
     bool disable();
 
+    /**
+     * 是否还有发送未完成，未完成的最终会回调 send_complete_cb 或 write_error_cb
+     * 注意：直接发送出错时数据被丢弃，不会有任何回调，此时返回 false
+     */
+    bool isSending() const;
+
     //! 缩减缓冲，防止长期占用大空间内存
     void shrinkRecvBuffer();
     void shrinkSendBuffer();
@@ -89,7 +119,25 @@ class BufferedFd : public ByteStream {
 
   private:
     void onReadCallback(short);
+    void onReadEndOrError(ssize_t rsize, int read_errno);
     void onWriteCallback(short);
+    void handleReceivedData();
+
+    inline bool hasPendingData() const {
+        return send_buff_.readableSize() > 0 || !send_slices_.empty() ||
+               (sp_async_send_buff_ != nullptr && sp_async_send_buff_->readableSize() > 0);
+    }
+    void appendPendingData(const void *data_ptr, size_t data_size);
+    void consumePendingData(size_t size);
+    ssize_t writePendingData();
+    ssize_t writeFileSlice();
+    bool loadSliceToSendBuff();
+
+    //! 引擎支持异步IO时（如 io_uring），用提交读写请求代替可读可写事件
+    void startAsyncRead();
+    void startAsyncWrite();
+    void onAsyncRead(ssize_t rsize);
+    void onAsyncWrite(ssize_t wsize);
 
   private:
     event::Loop *wp_loop_ = nullptr;    //! 事件驱动
@@ -100,9 +148,34 @@ class BufferedFd : public ByteStream {
     event::FdEvent *sp_read_event_  = nullptr;
     event::FdEvent *sp_write_event_ = nullptr;
 
+    bool use_async_io_ = false;
+    uint64_t read_io_id_ = 0;   //!< 未完成的 asyncRead() 请求
+    uint64_t write_io_id_ = 0;  //!< 未完成的 asyncWrite() 请求
+    bool is_async_writing_slice_ = false;   //!< 正在写的是 send_slices_ 的第一块，而不是 sp_async_send_buff_
+
+    /**
+     * 待发送的数据，send_buff_ 中的都排在 send_slices_ 之前
+     * send_slices_ 非空时，再需要拷贝的数据也作为新的一块追加到 send_slices_ 中
+     * 块可以是内存数据，也可以是文件区间（file 非空）
+     */
+    struct Slice {
+        SharedData data;
+        Fd file;
+        off_t file_offset;  //!< 文件区间的起始位置
+        size_t size;        //!< 块的总字节数
+        size_t offset;      //!< 已发送的字节数
+    };
     Buffer send_buff_;
+    std::deque<Slice> send_slices_;
     Buffer recv_buff_;
 
+    /**
+     * 异步IO模式下，内核直接读写的缓冲，提交时由引擎共同持有，见 Loop::asyncRead()
+     * 完成后与 recv_buff_、send_buff_ 交换，免去拷贝
+     */
+    std::shared_ptr<Buffer> sp_async_recv_buff_;
+    std::shared_ptr<Buffer> sp_async_send_buff_;    //!< 正在发送的数据，排在 send_buff_ 之前
+
     ReceiveCallback         receive_cb_;
     SendCompleteCallback    send_complete_cb_;
     ReadZeroCallback        read_zero_cb_;
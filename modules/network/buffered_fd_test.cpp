@@ -23,6 +23,9 @@
 #include <tbox/network/buffered_fd.h>
 
 #include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <fcntl.h>
 #include <iostream>
 
 using namespace std;
@@ -212,3 +215,255 @@ TEST(BufferedFd, sendComplete_HugeData)
     delete write_buff_fd;
     delete sp_loop;
 }
+
+//! 测试 sendv() 与 send(SharedData) 混合发送大数据时，接收端的数据顺序是否正确
+TEST(BufferedFd, sendv_and_SharedData)
+{
+    Loop* sp_loop = Loop::New();
+    ASSERT_TRUE(sp_loop);
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe(fds), 0);
+
+    std::string recv_data;
+
+    BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+    read_buff_fd->initialize(fds[0]);
+    read_buff_fd->setReceiveCallback(
+        [&] (Buffer &buff) {
+            recv_data.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+    read_buff_fd->enable();
+
+    bool is_send_completed = false;
+    BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+    write_buff_fd->initialize(fds[1]);
+    write_buff_fd->setSendCompleteCallback([&] { is_send_completed = true; });
+    write_buff_fd->enable();
+
+    //! 每一段都足够大，使得管道写满，后面的数据都要进入待发送队列
+    std::string expect_data;
+    for (int i = 0; i < 8; ++i) {
+        std::string head(100, 'a' + i);
+        std::string body(256 << 10, 'A' + i);
+        expect_data += head + body;
+
+        if (i % 2 == 0) {
+            struct iovec iov[2] = {
+                { const_cast<char*>(head.data()), head.size() },
+                { const_cast<char*>(body.data()), body.size() },
+            };
+            EXPECT_TRUE(write_buff_fd->sendv(iov, 2));
+        } else {
+            EXPECT_TRUE(write_buff_fd->send(head.data(), head.size()));
+            EXPECT_TRUE(write_buff_fd->send(std::make_shared<const std::string>(std::move(body))));
+        }
+    }
+
+    sp_loop->exitLoop(std::chrono::seconds(1));
+    sp_loop->runLoop();
+
+    EXPECT_TRUE(is_send_completed);
+    EXPECT_EQ(recv_data.size(), expect_data.size());
+    EXPECT_TRUE(recv_data == expect_data);
+
+    CHECK_CLOSE_RESET_FD(fds[0]);
+    CHECK_CLOSE_RESET_FD(fds[1]);
+    delete read_buff_fd;
+    delete write_buff_fd;
+    delete sp_loop;
+}
+
+//! 测试 sendFile() 与普通数据混合发送时，接收端收到的内容与顺序是否正确
+TEST(BufferedFd, sendFile)
+{
+    Loop* sp_loop = Loop::New();
+    ASSERT_TRUE(sp_loop);
+
+    //! 准备一个 1MB 的文件
+    char file_path[] = "/tmp/tbox_buffered_fd_test_XXXXXX";
+    int file_fd = ::mkstemp(file_path);
+    ASSERT_GE(file_fd, 0);
+    ::unlink(file_path);
+
+    std::string file_data;
+    for (int i = 0; i < (1 << 20); ++i)
+        file_data.push_back(static_cast<char>(i * 7));
+    ASSERT_EQ(::write(file_fd, file_data.data(), file_data.size()), static_cast<ssize_t>(file_data.size()));
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(pipe(fds), 0);
+
+    std::string recv_data;
+    BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+    read_buff_fd->initialize(fds[0]);
+    read_buff_fd->setReceiveCallback(
+        [&] (Buffer &buff) {
+            recv_data.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+    read_buff_fd->enable();
+
+    bool is_send_completed = false;
+    BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+    write_buff_fd->initialize(fds[1]);
+    write_buff_fd->setSendCompleteCallback([&] { is_send_completed = true; });
+    write_buff_fd->enable();
+
+    Fd file(file_fd);
+    EXPECT_TRUE(write_buff_fd->send("head:", 5));
+    EXPECT_TRUE(write_buff_fd->sendFile(file, 0, file_data.size()));
+    EXPECT_TRUE(write_buff_fd->send(":middle:", 8));
+    EXPECT_TRUE(write_buff_fd->sendFile(file, 100, 1000));
+    EXPECT_TRUE(write_buff_fd->send(":tail", 5));
+
+    std::string expect_data = "head:" + file_data + ":middle:" + file_data.substr(100, 1000) + ":tail";
+
+    sp_loop->exitLoop(std::chrono::seconds(1));
+    sp_loop->runLoop();
+
+    EXPECT_TRUE(is_send_completed);
+    EXPECT_EQ(recv_data.size(), expect_data.size());
+    EXPECT_TRUE(recv_data == expect_data);
+
+    CHECK_CLOSE_RESET_FD(fds[0]);
+    CHECK_CLOSE_RESET_FD(fds[1]);
+    delete read_buff_fd;
+    delete write_buff_fd;
+    delete sp_loop;
+}
+
+/**
+ * io_uring 引擎下，socket 用异步读写：
+ * 发送大量数据，中途 disable() 再 enable() 一次，接收端收到的内容与顺序应不变
+ */
+TEST(BufferedFd, asyncIo)
+{
+    Loop* sp_loop = Loop::New("io_uring");
+    ASSERT_TRUE(sp_loop);
+
+    if (!sp_loop->isAsyncIoSupported()) {
+        cout << "io_uring is not supported, skip" << endl;
+        delete sp_loop;
+        return;
+    }
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    std::string recv_data;
+    BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+    read_buff_fd->initialize(fds[0]);
+    read_buff_fd->setReceiveCallback(
+        [&] (Buffer &buff) {
+            recv_data.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+    read_buff_fd->enable();
+    EXPECT_TRUE(read_buff_fd->fd().isNonBlock());   //! 异步IO模式下也保持非阻塞
+
+    bool is_send_completed = false;
+    BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+    write_buff_fd->initialize(fds[1]);
+    write_buff_fd->setSendCompleteCallback([&] { is_send_completed = true; });
+    write_buff_fd->enable();
+
+    std::string expect_data;
+    for (int i = 0; i < 100000; ++i) {
+        auto str = std::to_string(i) + ',';
+        write_buff_fd->send(str.data(), str.size());
+        expect_data += str;
+        //! 穿插着以引用计数的方式发送，顺序也应不变
+        if (i % 10000 == 0) {
+            auto data = std::make_shared<std::string>(1000, 'a' + i / 10000);
+            expect_data += *data;
+            write_buff_fd->send(std::move(data));
+        }
+    }
+
+    sp_loop->runNext(
+        [&] {
+            write_buff_fd->disable();
+            write_buff_fd->send("end", 3);
+            write_buff_fd->enable();
+        }
+    );
+    expect_data += "end";
+
+    sp_loop->exitLoop(std::chrono::seconds(1));
+    sp_loop->runLoop();
+
+    EXPECT_TRUE(is_send_completed);
+    EXPECT_EQ(recv_data.size(), expect_data.size());
+    EXPECT_TRUE(recv_data == expect_data);
+
+    delete read_buff_fd;
+    delete write_buff_fd;
+    delete sp_loop;
+    CHECK_CLOSE_RESET_FD(fds[0]);
+    CHECK_CLOSE_RESET_FD(fds[1]);
+}
+
+/**
+ * 发送0字节数据，不应该有任何影响，之后的数据照常发送
+ */
+TEST(BufferedFd, sendEmpty)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+        Loop* sp_loop = Loop::New(e);
+        ASSERT_TRUE(sp_loop);
+
+        int fds[2] = { 0 };
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+        std::string recv_data;
+        BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+        read_buff_fd->initialize(fds[0]);
+        read_buff_fd->setReceiveCallback(
+            [&] (Buffer &buff) {
+                recv_data.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+        read_buff_fd->enable();
+
+        bool is_send_completed = false;
+        BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+        write_buff_fd->initialize(fds[1]);
+        write_buff_fd->setSendCompleteCallback([&] { is_send_completed = true; });
+        write_buff_fd->enable();
+
+        struct iovec iov[2];
+        iov[0].iov_base = nullptr;
+        iov[0].iov_len  = 0;
+        iov[1].iov_base = nullptr;
+        iov[1].iov_len  = 0;
+
+        EXPECT_TRUE(write_buff_fd->send("", 0));
+        EXPECT_TRUE(write_buff_fd->sendv(iov, 2));
+        EXPECT_TRUE(write_buff_fd->sendv(iov, 0));
+        EXPECT_TRUE(write_buff_fd->send(std::make_shared<std::string>()));
+        EXPECT_FALSE(write_buff_fd->isSending());
+
+        EXPECT_TRUE(write_buff_fd->send("abc", 3));
+        EXPECT_TRUE(write_buff_fd->send("", 0));
+
+        sp_loop->exitLoop(std::chrono::milliseconds(100));
+        sp_loop->runLoop();
+
+        EXPECT_TRUE(is_send_completed);
+        EXPECT_EQ(recv_data, "abc");
+
+        delete read_buff_fd;
+        delete write_buff_fd;
+        delete sp_loop;
+        CHECK_CLOSE_RESET_FD(fds[0]);
+        CHECK_CLOSE_RESET_FD(fds[1]);
+    }
+}
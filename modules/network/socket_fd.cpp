@@ -81,8 +81,12 @@ int SocketFd::listen(int backlog)
 int SocketFd::accept(struct sockaddr *addr, socklen_t *addrlen)
 {
     int ret = ::accept(get(), addr, addrlen);
-    if (ret < 0)
+    //! 非阻塞的监听socket上没有待处理的连接时，返回EAGAIN是正常的
+    if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        int saved_errno = errno;
         LogDbg("fail, errno:%d, %s", errno, strerror(errno));
+        errno = saved_errno;
+    }
     return ret;
 }
 
@@ -158,6 +162,17 @@ bool SocketFd::setReuseAddress(bool enable)
     return setSocketOpt(SOL_SOCKET, SO_REUSEADDR, enable);
 }
 
+bool SocketFd::setReusePort(bool enable)
+{
+#ifdef SO_REUSEPORT
+    return setSocketOpt(SOL_SOCKET, SO_REUSEPORT, enable);
+#else
+    LogWarn("SO_REUSEPORT is not supported");
+    (void)enable;
+    return false;
+#endif
+}
+
 bool SocketFd::setBroadcast(bool enable)
 {
     return setSocketOpt(SOL_SOCKET, SO_BROADCAST, enable);
@@ -65,6 +65,7 @@ class SocketFd : public util::Fd {
     bool setSocketOpt(int level, int optname, const void *optval, socklen_t optlen);
 
     bool setReuseAddress(bool enable);  //! 设置可重用地址
+    bool setReusePort(bool enable);     //! 设置允许多个socket绑定同一端口，由内核分配连接
     bool setBroadcast(bool enable);     //! 设置是否允许广播
     bool setKeepalive(bool enable);     //! 设置是否开启保活
 
@@ -21,6 +21,7 @@
 
 #include <sys/un.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <cstring>
 
@@ -43,7 +44,6 @@ TcpAcceptor::TcpAcceptor(event::Loop *wp_loop) :
 
 TcpAcceptor::~TcpAcceptor()
 {
-    TBOX_ASSERT(cb_level_ == 0);
     if (sp_read_ev_ != nullptr)
         cleanup();
 }
@@ -73,12 +73,40 @@ bool TcpAcceptor::initialize(const SockAddr &bind_addr, int listen_backlog)
     }
 
     sock_fd_ = std::move(sock_fd);
+    is_sock_owner_ = true;
+    initReadEvent();
+
+    return true;
+}
+
+bool TcpAcceptor::initialize(const SockAddr &bind_addr, SocketFd listening_sock)
+{
+    if (listening_sock.isNull()) {
+        LogErr("listening socket is null");
+        return false;
+    }
+
+    bind_addr_ = bind_addr;
+    sock_fd_ = listening_sock;
+    is_sock_owner_ = false;
+    initReadEvent();
+
+    return true;
+}
+
+void TcpAcceptor::initReadEvent()
+{
     CHECK_DELETE_RESET_OBJ(sp_read_ev_);
     sp_read_ev_ = wp_loop_->newFdEvent("TcpAcceptor::sp_read_ev_");
-    sp_read_ev_->initialize(sock_fd_.get(), event::FdEvent::kReadEvent, event::Event::Mode::kPersist);
+    //! 使用边沿触发，每次都 accept() 到 EAGAIN 为止；多个Loop共享同一监听socket时，只唤醒其中一个
+    sp_read_ev_->initialize(sock_fd_.get(),
+                            event::FdEvent::kReadEvent | event::FdEvent::kEdgeTriggered | event::FdEvent::kExclusive,
+                            event::Event::Mode::kPersist);
     sp_read_ev_->setCallback(std::bind(&TcpAcceptor::onSocketRead, this, std::placeholders::_1));
+    use_async_io_ = wp_loop_->isAsyncIoSupported();
 
-    return true;
+    if (reserve_fd_ < 0)
+        reserve_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
 }
 
 SocketFd TcpAcceptor::createSocket(SockAddr::Type addr_type)
@@ -98,6 +126,8 @@ int TcpAcceptor::bindAddress(SocketFd sock_fd, const SockAddr &bind_addr)
 {
     if (bind_addr.type() == SockAddr::Type::kIPv4) {
         sock_fd.setReuseAddress(true);
+        if (is_reuse_port_)
+            sock_fd.setReusePort(true);
 
         struct sockaddr_in sock_addr;
         socklen_t len = bind_addr.toSockAddr(sock_addr);
@@ -118,25 +148,65 @@ int TcpAcceptor::bindAddress(SocketFd sock_fd, const SockAddr &bind_addr)
 
 bool TcpAcceptor::start()
 {
-    if (sp_read_ev_ != nullptr)
-        return sp_read_ev_->enable();
-    return false;
+    if (sp_read_ev_ == nullptr)
+        return false;
+
+    if (use_async_io_) {
+        is_accepting_ = true;
+        if (accept_io_id_ == 0)
+            startAsyncAccept();
+        return accept_io_id_ != 0;
+    }
+
+    return sp_read_ev_->enable();
 }
 
 bool TcpAcceptor::stop()
 {
-    if (sp_read_ev_ != nullptr)
-        return sp_read_ev_->disable();
-    return false;
+    if (sp_read_ev_ == nullptr)
+        return false;
+
+    is_accepting_ = false;
+    if (accept_io_id_ != 0) {
+        wp_loop_->cancelAsyncIo(accept_io_id_);
+        accept_io_id_ = 0;
+    }
+
+    if (sp_retry_ev_ != nullptr)
+        sp_retry_ev_->disable();
+
+    return sp_read_ev_->disable();
 }
 
 void TcpAcceptor::cleanup()
 {
-    CHECK_DELETE_RESET_OBJ(sp_read_ev_);
-    sock_fd_.close();
+    stop();
+
+    if (cb_level_ > 0) {
+        //! 正处于 sp_read_ev_ 或 sp_retry_ev_ 的回调之中，不能立即删除，推迟到下一轮
+        auto read_ev = sp_read_ev_;
+        auto retry_ev = sp_retry_ev_;
+        wp_loop_->runNext([read_ev, retry_ev] { delete read_ev; delete retry_ev; }, "TcpAcceptor::cleanup");
+        sp_read_ev_ = nullptr;
+        sp_retry_ev_ = nullptr;
+    } else {
+        CHECK_DELETE_RESET_OBJ(sp_read_ev_);
+        CHECK_DELETE_RESET_OBJ(sp_retry_ev_);
+    }
+
+    if (reserve_fd_ >= 0) {
+        ::close(reserve_fd_);
+        reserve_fd_ = -1;
+    }
+
+    //! 共享的监听socket由创建者关闭
+    if (is_sock_owner_)
+        sock_fd_.close();
+    else
+        sock_fd_.reset();
 
     //! 对于Unix Domain的Socket在退出的时候要删除对应的socket文件
-    if (bind_addr_.type() == SockAddr::Type::kLocal) {
+    if (is_sock_owner_ && bind_addr_.type() == SockAddr::Type::kLocal) {
         auto socket_file = bind_addr_.toString();
         util::fs::RemoveFile(socket_file);
     }
@@ -144,34 +214,144 @@ void TcpAcceptor::cleanup()
 
 void TcpAcceptor::onSocketRead(short events)
 {
-    if (events & event::FdEvent::kReadEvent)
-        onClientConnected();
+    if (events & event::FdEvent::kReadEvent) {
+        //! 将积压的连接全部取完。回调中可能会 stop() 甚至删除本对象，此时要停下来
+        LifetimeTag::Watcher w = ltt_;
+        while (onClientConnected() && w && sp_read_ev_ != nullptr && sp_read_ev_->isEnabled());
+    }
 }
 
-void TcpAcceptor::onClientConnected()
+bool TcpAcceptor::onClientConnected()
 {
     RECORD_SCOPE();
     struct sockaddr addr;
     socklen_t addr_len = sizeof(addr);
     SocketFd peer_sock = sock_fd_.accept(&addr, &addr_len);
     if (peer_sock.isNull()) {
-        LogNotice("accept fail");
-        return;
+        int err = errno;
+        if (err == EMFILE || err == ENFILE)
+            err = dropPendingConnection();
+
+        //! 对端已放弃的连接直接跳过，继续取下一个
+        if (err == 0 || err == ECONNABORTED || err == EINTR)
+            return true;
+
+        if (err != EAGAIN && err != EWOULDBLOCK) {
+            LogNotice("accept fail, errno:%d, %s", err, strerror(err));
+            //! 边沿触发下不会再有通知，积压的连接要等延时后再取
+            startRetryTimer();
+        }
+        return false;
     }
 
     SockAddr peer_addr(addr, addr_len);
+    handleNewConnection(peer_sock, peer_addr);
+    return true;
+}
+
+void TcpAcceptor::startAsyncAccept()
+{
+    accept_io_id_ = wp_loop_->asyncAccept(sock_fd_.get(), std::bind(&TcpAcceptor::onAsyncAccept, this, std::placeholders::_1));
+    if (accept_io_id_ == 0)
+        LogWarn("async accept fail");
+}
+
+void TcpAcceptor::onAsyncAccept(int peer_fd)
+{
+    RECORD_SCOPE();
+    accept_io_id_ = 0;
+
+    if (peer_fd >= 0) {
+        SocketFd peer_sock(peer_fd);
+        struct sockaddr addr;
+        socklen_t addr_len = sizeof(addr);
+        ::getpeername(peer_fd, &addr, &addr_len);
+
+        LifetimeTag::Watcher w = ltt_;
+        handleNewConnection(peer_sock, SockAddr(addr, addr_len));
+        if (!w) //! 回调中删除了本对象
+            return;
+
+    } else {
+        int err = -peer_fd;
+        if (err == EMFILE || err == ENFILE)
+            err = dropPendingConnection();
+
+        if (err != 0 && err != ECONNABORTED && err != EINTR && err != EAGAIN) {
+            LogNotice("accept fail, errno:%d, %s", err, strerror(err));
+            //! 立即重新提交多半还是同样的错误，会形成忙循环，延时后再试
+            if (is_accepting_)
+                startRetryTimer();
+            return;
+        }
+    }
+
+    //! 回调中可能会 stop()，此时就不要再继续了
+    if (is_accepting_ && accept_io_id_ == 0)
+        startAsyncAccept();
+}
+
+void TcpAcceptor::handleNewConnection(SocketFd peer_sock, const SockAddr &peer_addr)
+{
     LogInfo("%s accepted new connection: %s", bind_addr_.toString().c_str(), peer_addr.toString().c_str());
 
     if (new_conn_cb_) {
         auto sp_connection = new TcpConnection(wp_loop_, peer_sock, peer_addr);
         sp_connection->enable();
+        LifetimeTag::Watcher w = ltt_;
         ++cb_level_;
         new_conn_cb_(sp_connection);
-        --cb_level_;
+        if (w)
+            --cb_level_;
     } else {
         LogWarn("%s need connect cb", bind_addr_.toString().c_str());
     }
 }
 
+/**
+ * 进程的文件描述符用完之后，accept() 会一直返回 EMFILE，而积压的连接仍在。边沿触发下
+ * 不会再有通知，这些连接将一直积压着。所以这里先关掉预留的fd腾出一个位置，把连接取出来
+ * 立即关闭，让对端尽快知道失败，然后再把预留的fd占回来。
+ *
+ * 返回 0 表示成功丢弃了一个连接，否则返回 errno
+ */
+int TcpAcceptor::dropPendingConnection()
+{
+    if (reserve_fd_ < 0)
+        return EMFILE;
+
+    ::close(reserve_fd_);
+    int peer_fd = ::accept(sock_fd_.get(), nullptr, nullptr);
+    int err = (peer_fd < 0) ? errno : 0;
+    if (peer_fd >= 0)
+        ::close(peer_fd);
+    reserve_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    if (err == 0)
+        LogWarn("%s fd exhausted, drop a pending connection", bind_addr_.toString().c_str());
+    return err;
+}
+
+void TcpAcceptor::startRetryTimer()
+{
+    if (sp_retry_ev_ == nullptr) {
+        sp_retry_ev_ = wp_loop_->newTimerEvent("TcpAcceptor::sp_retry_ev_");
+        sp_retry_ev_->initialize(std::chrono::milliseconds(100), event::Event::Mode::kOneshot);
+        sp_retry_ev_->setCallback(std::bind(&TcpAcceptor::onRetryTimeout, this));
+    }
+    sp_retry_ev_->enable();
+}
+
+void TcpAcceptor::onRetryTimeout()
+{
+    if (use_async_io_) {
+        if (is_accepting_ && accept_io_id_ == 0)
+            startAsyncAccept();
+
+    } else if (sp_read_ev_ != nullptr && sp_read_ev_->isEnabled()) {
+        onSocketRead(event::FdEvent::kReadEvent);
+    }
+}
+
 }
 }
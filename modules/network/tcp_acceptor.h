@@ -22,8 +22,10 @@
 
 #include <functional>
 #include <tbox/base/defines.h>
+#include <tbox/base/lifetime_tag.hpp>
 #include <tbox/event/loop.h>
 #include <tbox/event/fd_event.h>
+#include <tbox/event/timer_event.h>
 
 #include "sockaddr.h"
 #include "socket_fd.h"
@@ -43,7 +45,18 @@ class TcpAcceptor {
 
   public:
     bool initialize(const SockAddr &bind_addr, int listen_backlog);
+    /**
+     * 使用其它 TcpAcceptor 已在监听的socket，用于多个Loop共享同一个监听socket
+     * 退出时不会删除 Unix Domain 的socket文件，由创建者删除
+     */
+    bool initialize(const SockAddr &bind_addr, SocketFd listening_sock);
 
+    //! 设置 SO_REUSEPORT，需要在 initialize() 之前设置，仅对 IPv4 有效
+    void setReusePort(bool enable) { is_reuse_port_ = enable; }
+
+    SocketFd socketFd() const { return sock_fd_; }
+
+    //! 回调中可以 stop()、cleanup()，也可以直接 delete 本对象
     using NewConnectionCallback = std::function<void (TcpConnection*)>;
     void setNewConnectionCallback(const NewConnectionCallback &cb) { new_conn_cb_ = cb; }
 
@@ -57,7 +70,14 @@ class TcpAcceptor {
     virtual int bindAddress(SocketFd sock_fd, const SockAddr &bind_addr);
 
     void onSocketRead(short events);    //! 处理新的连接请求
-    void onClientConnected();
+    bool onClientConnected();
+    void initReadEvent();
+    void onAsyncAccept(int peer_fd);    //! 引擎支持异步IO时，用 asyncAccept() 代替可读事件
+    void startAsyncAccept();
+    void handleNewConnection(SocketFd peer_sock, const SockAddr &peer_addr);
+    int  dropPendingConnection();       //! 文件描述符耗尽时，丢弃一个积压的连接
+    void startRetryTimer();
+    void onRetryTimeout();
 
   private:
     event::Loop *wp_loop_ = nullptr;
@@ -66,9 +86,18 @@ class TcpAcceptor {
     NewConnectionCallback new_conn_cb_;
 
     SocketFd sock_fd_;
+    bool is_reuse_port_ = false;
+    bool is_sock_owner_ = true;    //!< socket 是否由自己创建
     event::FdEvent *sp_read_ev_ = nullptr;
+    event::TimerEvent *sp_retry_ev_ = nullptr;  //!< accept() 出错后延时重试的定时器
+    int reserve_fd_ = -1;   //!< 预留的fd，文件描述符耗尽时腾出来接收并关闭积压的连接
+
+    bool use_async_io_ = false;
+    bool is_accepting_ = false;
+    event::Loop::AsyncIoId accept_io_id_ = 0;
 
     int cb_level_ = 0;
+    LifetimeTag ltt_;
 };
 
 }
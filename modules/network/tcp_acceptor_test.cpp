@@ -0,0 +1,166 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <vector>
+#include <cstring>
+
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/event/loop.h>
+
+#include "tcp_acceptor.h"
+#include "tcp_connection.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+
+namespace {
+
+int ConnectTo(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//! 检查连接是否已被对端关闭
+bool IsClosedByPeer(int fd)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 1000) != 1)
+        return false;
+    char ch;
+    return read(fd, &ch, 1) <= 0;
+}
+
+}
+
+//! 有多个积压的连接时，在回调中删除 TcpAcceptor，不应再访问已释放的对象
+TEST(TcpAcceptor, DeleteInCallback)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    auto acceptor = new TcpAcceptor(sp_loop);
+    ASSERT_TRUE(acceptor->initialize(SockAddr::FromString("127.0.0.1:22200"), 16));
+
+    int cb_count = 0;
+    acceptor->setNewConnectionCallback(
+        [&] (TcpConnection *conn) {
+            ++cb_count;
+            delete conn;
+            delete acceptor;
+            acceptor = nullptr;
+        }
+    );
+    ASSERT_TRUE(acceptor->start());
+
+    std::vector<int> fds;
+    for (int i = 0; i < 3; ++i) {
+        int fd = ConnectTo(22200);
+        ASSERT_GE(fd, 0);
+        fds.push_back(fd);
+    }
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(cb_count, 1);
+    EXPECT_EQ(acceptor, nullptr);
+
+    for (int fd : fds)
+        close(fd);
+}
+
+//! 文件描述符耗尽时，积压的连接要被取出关闭，不能一直卡着；fd恢复后能正常接受新连接
+TEST(TcpAcceptor, FdExhausted)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    TcpAcceptor acceptor(sp_loop);
+    ASSERT_TRUE(acceptor.initialize(SockAddr::FromString("127.0.0.1:22201"), 16));
+
+    int cb_count = 0;
+    acceptor.setNewConnectionCallback(
+        [&] (TcpConnection *conn) {
+            ++cb_count;
+            delete conn;
+        }
+    );
+    ASSERT_TRUE(acceptor.start());
+
+    std::vector<int> client_fds;
+    for (int i = 0; i < 3; ++i) {
+        int fd = ConnectTo(22201);
+        ASSERT_GE(fd, 0);
+        client_fds.push_back(fd);
+    }
+
+    //! 调低上限，再将fd占满
+    struct rlimit old_limit;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &old_limit), 0);
+    struct rlimit new_limit = old_limit;
+    new_limit.rlim_cur = 256;
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &new_limit), 0);
+
+    std::vector<int> hold_fds;
+    for (;;) {
+        int fd = dup(0);
+        if (fd < 0)
+            break;
+        hold_fds.push_back(fd);
+    }
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    for (int fd : hold_fds)
+        close(fd);
+    setrlimit(RLIMIT_NOFILE, &old_limit);
+
+    EXPECT_EQ(cb_count, 0);
+    for (int fd : client_fds) {
+        EXPECT_TRUE(IsClosedByPeer(fd));
+        close(fd);
+    }
+
+    int fd = ConnectTo(22201);
+    ASSERT_GE(fd, 0);
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+    EXPECT_EQ(cb_count, 1);
+    close(fd);
+}
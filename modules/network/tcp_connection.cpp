@@ -132,6 +132,27 @@ bool TcpConnection::send(const void *data_ptr, size_t data_size)
     return false;
 }
 
+bool TcpConnection::sendv(const struct iovec *iov, int iovcnt)
+{
+    if (sp_buffered_fd_ != nullptr)
+        return sp_buffered_fd_->sendv(iov, iovcnt);
+    return false;
+}
+
+bool TcpConnection::send(BufferedFd::SharedData data)
+{
+    if (sp_buffered_fd_ != nullptr)
+        return sp_buffered_fd_->send(std::move(data));
+    return false;
+}
+
+bool TcpConnection::sendFile(Fd file, off_t offset, size_t size)
+{
+    if (sp_buffered_fd_ != nullptr)
+        return sp_buffered_fd_->sendFile(std::move(file), offset, size);
+    return false;
+}
+
 Buffer* TcpConnection::getReceiveBuffer()
 {
     if (sp_buffered_fd_ != nullptr)
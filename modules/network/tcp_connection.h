@@ -63,6 +63,11 @@ class TcpConnection : public ByteStream {
     virtual void bind(ByteStream *receiver) override;
     virtual void unbind() override;
     virtual bool send(const void *data_ptr, size_t data_size) override;
+
+    //! 见 BufferedFd::sendv(), BufferedFd::send(SharedData) 与 BufferedFd::sendFile()
+    bool sendv(const struct iovec *iov, int iovcnt);
+    bool send(BufferedFd::SharedData data);
+    bool sendFile(Fd file, off_t offset, size_t size);
     virtual Buffer* getReceiveBuffer() override;
 
   protected:
@@ -20,11 +20,17 @@
 #include "tcp_server.h"
 
 #include <limits>
+#include <future>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
 
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/cabinet.hpp>
 #include <tbox/base/wrapped_recorder.h>
+#include <tbox/eventx/loop_thread.h>
 
 #include "tcp_acceptor.h"
 #include "tcp_connection.h"
@@ -41,6 +47,17 @@ using TcpConns = cabinet::Cabinet<TcpConnection>;
 
 //! 私有数据
 struct TcpServer::Data {
+    /**
+     * 分片，每个分片有自己的Loop、TcpAcceptor与连接容器，仅在自己的Loop线程中访问
+     * 单Loop模式下只有 main_shard，使用构造时传入的Loop
+     */
+    struct Shard {
+        event::Loop *wp_loop = nullptr;
+        eventx::LoopThread *sp_loop_thread = nullptr;   //!< 仅多Reactor模式下有
+        TcpAcceptor *sp_acceptor = nullptr;
+        TcpConns conns;     //!< TcpConnection 容器
+    };
+
     event::Loop *wp_loop = nullptr;
 
     ConnectedCallback       connected_cb;
@@ -49,11 +66,82 @@ struct TcpServer::Data {
     size_t                  receive_threshold = 0;
     SendCompleteCallback    send_complete_cb;
 
-    TcpAcceptor *sp_acceptor = nullptr;
-    TcpConns conns;     //!< TcpConnection 容器
+    Shard main_shard;
+    std::vector<Shard*> shards;
 
     State state = State::kNone;
-    int cb_level = 0;
+    std::atomic_int cb_level{0};
+
+    /**
+     * 各分片的 Cabinet 各自分配 Token，为保证全局唯一，将分片序号编入 pos 中：
+     *   全局 pos = 分片内 pos * 分片数 + 分片序号
+     * 单Loop模式下，两者是相同的
+     */
+    ConnToken toGlobalToken(size_t shard_index, const ConnToken &local) const {
+        return ConnToken(local.id(), local.pos() * shards.size() + shard_index);
+    }
+
+    Shard* findShard(const ConnToken &client, ConnToken &local) const {
+        auto shard_num = shards.size();
+        if (client.isNull() || shard_num == 0)
+            return nullptr;
+
+        local = ConnToken(client.id(), client.pos() / shard_num);
+        return shards[client.pos() % shard_num];
+    }
+
+    TcpConnection* findConn(const ConnToken &client) const {
+        ConnToken local;
+        auto shard = findShard(client, local);
+        return shard != nullptr ? shard->conns.at(local) : nullptr;
+    }
+
+    static bool IsInShardThread(Shard *shard) {
+        return shard->sp_loop_thread == nullptr || shard->wp_loop->isInLoopThread();
+    }
+
+    /**
+     * 在分片的Loop线程中执行 func，并等待其完成
+     * 调用者不能是其它分片的Loop线程，否则两个分片相互等待就会死锁，见 isInShardThread()
+     */
+    static void RunInShard(Shard *shard, const std::function<void()> &func) {
+        if (IsInShardThread(shard)) {
+            func();
+            return;
+        }
+
+        std::promise<void> done;
+        shard->wp_loop->runInLoop([&] { func(); done.set_value(); }, "TcpServer::RunInShard");
+        done.get_future().wait();
+    }
+
+    /**
+     * 检查是否在多Reactor模式的分片Loop线程中，即各回调中
+     * start(), stop(), cleanup() 要等待各分片执行完，不能在这些线程中调用
+     */
+    bool isInShardThread(const char *func_name) const {
+        for (auto shard : shards) {
+            if (shard->sp_loop_thread != nullptr && shard->wp_loop->isInLoopThread()) {
+                LogErr("%s() can't be called in shard loop thread", func_name);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! 释放多Reactor模式创建的分片，监听socket的创建者是第一个，最后释放
+    void destroyShards() {
+        for (auto iter = shards.rbegin(); iter != shards.rend(); ++iter) {
+            auto shard = *iter;
+            if (shard == &main_shard)
+                continue;
+
+            RunInShard(shard, [shard] { CHECK_DELETE_RESET_OBJ(shard->sp_acceptor); });
+            CHECK_DELETE_RESET_OBJ(shard->sp_loop_thread);
+            delete shard;
+        }
+        shards.clear();
+    }
 };
 
 TcpServer::TcpServer(event::Loop *wp_loop) :
@@ -62,7 +150,8 @@ TcpServer::TcpServer(event::Loop *wp_loop) :
     TBOX_ASSERT(d_ != nullptr);
 
     d_->wp_loop = wp_loop;
-    d_->sp_acceptor = new TcpAcceptor(wp_loop);
+    d_->main_shard.wp_loop = wp_loop;
+    d_->main_shard.sp_acceptor = new TcpAcceptor(wp_loop);
 }
 
 TcpServer::~TcpServer()
@@ -70,7 +159,7 @@ TcpServer::~TcpServer()
     TBOX_ASSERT(d_->cb_level == 0);
 
     cleanup();
-    CHECK_DELETE_RESET_OBJ(d_->sp_acceptor);
+    CHECK_DELETE_RESET_OBJ(d_->main_shard.sp_acceptor);
 
     delete d_;
 }
@@ -80,8 +169,10 @@ bool TcpServer::initialize(const SockAddr &bind_addr, int listen_backlog)
     if (d_->state != State::kNone)
         return false;
 
-    if (d_->sp_acceptor->initialize(bind_addr, listen_backlog)) {
-        d_->sp_acceptor->setNewConnectionCallback(std::bind(&TcpServer::onTcpConnected, this, _1));
+    auto acceptor = d_->main_shard.sp_acceptor;
+    if (acceptor->initialize(bind_addr, listen_backlog)) {
+        acceptor->setNewConnectionCallback(std::bind(&TcpServer::onTcpConnected, this, 0, _1));
+        d_->shards.push_back(&d_->main_shard);
         d_->state = State::kInited;
         return true;
     }
@@ -89,6 +180,55 @@ bool TcpServer::initialize(const SockAddr &bind_addr, int listen_backlog)
     return false;
 }
 
+bool TcpServer::initialize(const SockAddr &bind_addr, int listen_backlog, int loop_num)
+{
+    if (d_->state != State::kNone)
+        return false;
+
+    if (loop_num < 1) {
+        LogWarn("loop_num:%d is invalid", loop_num);
+        return false;
+    }
+
+    bool is_reuse_port = bind_addr.type() == SockAddr::Type::kIPv4;
+    SocketFd listening_sock;
+
+    for (int i = 0; i < loop_num; ++i) {
+        auto shard = new Data::Shard;
+        shard->sp_loop_thread = new eventx::LoopThread(true, "tcp_server");
+        shard->wp_loop = shard->sp_loop_thread->loop();
+        d_->shards.push_back(shard);
+
+        //! TcpAcceptor 要在其Loop线程中创建与初始化
+        bool is_succ = false;
+        Data::RunInShard(shard,
+            [&] {
+                auto acceptor = new TcpAcceptor(shard->wp_loop);
+                shard->sp_acceptor = acceptor;
+
+                if (is_reuse_port || i == 0) {
+                    acceptor->setReusePort(is_reuse_port);
+                    is_succ = acceptor->initialize(bind_addr, listen_backlog);
+                    listening_sock = acceptor->socketFd();
+                } else {
+                    is_succ = acceptor->initialize(bind_addr, listening_sock);
+                }
+
+                acceptor->setNewConnectionCallback(std::bind(&TcpServer::onTcpConnected, this, i, _1));
+            }
+        );
+
+        if (!is_succ) {
+            LogErr("initialize acceptor %d fail", i);
+            d_->destroyShards();
+            return false;
+        }
+    }
+
+    d_->state = State::kInited;
+    return true;
+}
+
 void TcpServer::setConnectedCallback(const ConnectedCallback &cb)
 {
     d_->connected_cb = cb;
@@ -112,41 +252,59 @@ void TcpServer::setSendCompleteCallback(const SendCompleteCallback &cb)
 
 bool TcpServer::start()
 {
-    if (d_->state != State::kInited)
+    if (d_->state != State::kInited || d_->isInShardThread("start"))
         return false;
 
-    if (d_->sp_acceptor->start()) {
+    bool is_succ = true;
+    for (auto shard : d_->shards)
+        Data::RunInShard(shard, [&] { is_succ = shard->sp_acceptor->start() && is_succ; });
+
+    if (is_succ) {
         d_->state = State::kRunning;
         return true;
     }
+
+    for (auto shard : d_->shards)
+        Data::RunInShard(shard, [shard] { shard->sp_acceptor->stop(); });
     return false;
 }
 
 void TcpServer::stop()
 {
-    if (d_->state != State::kRunning)
+    if (d_->state != State::kRunning || d_->isInShardThread("stop"))
         return;
 
-    d_->conns.foreach(
-        [](TcpConnection *conn) {
-            conn->disconnect();
-            delete conn;
-        }
-    );
-    d_->conns.clear();
+    for (auto shard : d_->shards) {
+        Data::RunInShard(shard,
+            [shard] {
+                shard->conns.foreach(
+                    [](TcpConnection *conn) {
+                        conn->disconnect();
+                        delete conn;
+                    }
+                );
+                shard->conns.clear();
+                shard->sp_acceptor->stop();
+            }
+        );
+    }
 
-    d_->sp_acceptor->stop();
     d_->state = State::kInited;
 }
 
 void TcpServer::cleanup()
 {
-    if (d_->state <= State::kNone)
+    if (d_->state <= State::kNone || d_->isInShardThread("cleanup"))
         return;
 
     stop();
 
-    d_->sp_acceptor->cleanup();
+    if (!d_->shards.empty() && d_->shards.front() == &d_->main_shard) {
+        d_->main_shard.sp_acceptor->cleanup();
+        d_->shards.clear();
+    } else {
+        d_->destroyShards();
+    }
 
     d_->connected_cb = nullptr;
     d_->disconnected_cb = nullptr;
@@ -159,18 +317,125 @@ void TcpServer::cleanup()
 
 bool TcpServer::send(const ConnToken &client, const void *data_ptr, size_t data_size)
 {
-    auto conn = d_->conns.at(client);
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return false;
+
+    //! 跨线程时拷贝一份，转交给连接所属的线程发送
+    if (!Data::IsInShardThread(shard))
+        return send(client, std::make_shared<std::string>(static_cast<const char*>(data_ptr), data_size));
+
+    auto conn = shard->conns.at(local);
     if (conn != nullptr)
         return conn->send(data_ptr, data_size);
     return false;
 }
 
+bool TcpServer::sendv(const ConnToken &client, const struct iovec *iov, int iovcnt)
+{
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return false;
+
+    if (!Data::IsInShardThread(shard)) {
+        //! 跨线程时数据的生命期无法保证，只能拼接拷贝
+        auto data = std::make_shared<std::string>();
+        for (int i = 0; i < iovcnt; ++i)
+            data->append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+        return send(client, std::move(data));
+    }
+
+    auto conn = shard->conns.at(local);
+    if (conn != nullptr)
+        return conn->sendv(iov, iovcnt);
+    return false;
+}
+
+bool TcpServer::send(const ConnToken &client, std::shared_ptr<const std::string> data)
+{
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return false;
+
+    if (!Data::IsInShardThread(shard)) {
+        shard->wp_loop->runInLoop(
+            [shard, local, data] {
+                auto conn = shard->conns.at(local);
+                if (conn != nullptr)
+                    conn->send(data);
+            },
+            "TcpServer::send"
+        );
+        return true;
+    }
+
+    auto conn = shard->conns.at(local);
+    if (conn != nullptr)
+        return conn->send(std::move(data));
+    return false;
+}
+
+bool TcpServer::sendFile(const ConnToken &client, Fd file, off_t offset, size_t size)
+{
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return false;
+
+    if (!Data::IsInShardThread(shard)) {
+        //! Fd 的引用计数不是线程安全的，所以 dup() 一个新的交给连接所属的线程
+        int file_fd = ::dup(file.get());
+        if (file_fd < 0) {
+            LogWarn("dup fail, errno:%d, %s", errno, strerror(errno));
+            return false;
+        }
+
+        shard->wp_loop->runInLoop(
+            [shard, local, file_fd, offset, size] {
+                Fd file(file_fd);
+                auto conn = shard->conns.at(local);
+                if (conn != nullptr)
+                    conn->sendFile(file, offset, size);
+            },
+            "TcpServer::sendFile"
+        );
+        return true;
+    }
+
+    auto conn = shard->conns.at(local);
+    if (conn != nullptr)
+        return conn->sendFile(std::move(file), offset, size);
+    return false;
+}
+
 bool TcpServer::disconnect(const ConnToken &client)
 {
-    auto conn = d_->conns.free(client);
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return false;
+
+    if (!Data::IsInShardThread(shard)) {
+        shard->wp_loop->runInLoop(
+            [shard, local] {
+                auto conn = shard->conns.free(local);
+                if (conn != nullptr) {
+                    conn->disconnect();
+                    delete conn;
+                }
+            },
+            "TcpServer::disconnect"
+        );
+        return true;
+    }
+
+    auto conn = shard->conns.free(local);
     if (conn != nullptr) {
         conn->disconnect();
-        d_->wp_loop->runNext([conn] { delete conn; }, "TcpServer::disconnect, delete");
+        shard->wp_loop->runNext([conn] { delete conn; }, "TcpServer::disconnect, delete");
         return true;
     }
     return false;
@@ -178,7 +443,24 @@ bool TcpServer::disconnect(const ConnToken &client)
 
 bool TcpServer::shutdown(const ConnToken &client, int howto)
 {
-    auto conn = d_->conns.at(client);
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return false;
+
+    if (!Data::IsInShardThread(shard)) {
+        shard->wp_loop->runInLoop(
+            [shard, local, howto] {
+                auto conn = shard->conns.at(local);
+                if (conn != nullptr)
+                    conn->shutdown(howto);
+            },
+            "TcpServer::shutdown"
+        );
+        return true;
+    }
+
+    auto conn = shard->conns.at(local);
     if (conn != nullptr)
         return conn->shutdown(howto);
     return false;
@@ -186,12 +468,12 @@ bool TcpServer::shutdown(const ConnToken &client, int howto)
 
 bool TcpServer::isClientValid(const ConnToken &client) const
 {
-    return d_->conns.at(client) != nullptr;
+    return d_->findConn(client) != nullptr;
 }
 
 SockAddr TcpServer::getClientAddress(const ConnToken &client) const
 {
-    auto conn = d_->conns.at(client);
+    auto conn = d_->findConn(client);
     if (conn != nullptr)
         return conn->peerAddr();
     return SockAddr();
@@ -199,14 +481,34 @@ SockAddr TcpServer::getClientAddress(const ConnToken &client) const
 
 void TcpServer::setContext(const ConnToken &client, void* context, ContextDeleter &&deleter)
 {
-    auto conn = d_->conns.at(client);
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return;
+
+    if (!Data::IsInShardThread(shard)) {
+        ContextDeleter context_deleter(std::move(deleter));
+        shard->wp_loop->runInLoop(
+            [shard, local, context, context_deleter] {
+                auto conn = shard->conns.at(local);
+                if (conn != nullptr)
+                    conn->setContext(context, ContextDeleter(context_deleter));
+                else if (context_deleter) //! 连接已经断开了，调用者无从得知，由这里释放
+                    context_deleter(context);
+            },
+            "TcpServer::setContext"
+        );
+        return;
+    }
+
+    auto conn = shard->conns.at(local);
     if (conn != nullptr)
         conn->setContext(context, std::move(deleter));
 }
 
 void* TcpServer::getContext(const ConnToken &client) const
 {
-    auto conn = d_->conns.at(client);
+    auto conn = d_->findConn(client);
     if (conn != nullptr)
         return conn->getContext();
     return nullptr;
@@ -214,7 +516,7 @@ void* TcpServer::getContext(const ConnToken &client) const
 
 Buffer* TcpServer::getClientReceiveBuffer(const ConnToken &client)
 {
-    auto conn = d_->conns.at(client);
+    auto conn = d_->findConn(client);
     if (conn != nullptr)
         return conn->getReceiveBuffer();
     return nullptr;
@@ -227,7 +529,12 @@ TcpServer::State TcpServer::state() const
 
 TcpConnection* TcpServer::detachConnection(const ConnToken &client)
 {
-    auto conn = d_->conns.free(client);
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    if (shard == nullptr)
+        return nullptr;
+
+    auto conn = shard->conns.free(local);
     if (conn != nullptr) {
         conn->setReceiveCallback(nullptr, 0);
         conn->setDisconnectedCallback(nullptr);
@@ -236,10 +543,11 @@ TcpConnection* TcpServer::detachConnection(const ConnToken &client)
     return conn;
 }
 
-void TcpServer::onTcpConnected(TcpConnection *new_conn)
+void TcpServer::onTcpConnected(size_t shard_index, TcpConnection *new_conn)
 {
     RECORD_SCOPE();
-    ConnToken client = d_->conns.alloc(new_conn);
+    auto shard = d_->shards.at(shard_index);
+    ConnToken client = d_->toGlobalToken(shard_index, shard->conns.alloc(new_conn));
     new_conn->setReceiveCallback(std::bind(&TcpServer::onTcpReceived, this, client, _1), d_->receive_threshold);
     new_conn->setDisconnectedCallback(std::bind(&TcpServer::onTcpDisconnected, this, client));
     new_conn->setSendCompleteCallback(std::bind(&TcpServer::onTcpSendCompleted, this, client));
@@ -258,8 +566,10 @@ void TcpServer::onTcpDisconnected(const ConnToken &client)
         d_->disconnected_cb(client);
     --d_->cb_level;
 
-    TcpConnection *conn = d_->conns.free(client);
-    d_->wp_loop->runNext(
+    ConnToken local;
+    auto shard = d_->findShard(client, local);
+    TcpConnection *conn = shard->conns.free(local);
+    shard->wp_loop->runNext(
         [conn] { CHECK_DELETE_OBJ(conn); },
         "TcpServer::onTcpDisconnected, delete conn"
     );
@@ -20,10 +20,15 @@
 #ifndef TBOX_NETWORK_TCP_SERVER_H_20180412
 #define TBOX_NETWORK_TCP_SERVER_H_20180412
 
+#include <memory>
+#include <string>
+#include <sys/uio.h>
+
 #include <tbox/base/defines.h>
 #include <tbox/base/cabinet_token.h>
 #include <tbox/event/loop.h>
 #include <tbox/util/buffer.h>
+#include <tbox/util/fd.h>
 
 #include "sockaddr.h"
 
@@ -54,6 +59,21 @@ class TcpServer {
 
     //! 设置绑定地址与backlog
     bool initialize(const SockAddr &bind_addr, int listen_backlog);
+    /**
+     * 设置绑定地址与backlog，并启用多Reactor模式
+     *
+     * 创建 loop_num 个 LoopThread，每个都有自己的 TcpAcceptor，并处理自己接受的连接。
+     * 对于 IPv4 地址，每个 TcpAcceptor 都有自己的 SO_REUSEPORT 监听socket，由内核分配连接；
+     * 其它地址则共享同一个监听socket。构造时传入的 Loop 在此模式下不使用。
+     *
+     * 注意：
+     * 1. 各回调都在连接所属的线程中执行，会并发，需要使用者自行保证线程安全；
+     * 2. send(), sendv(), sendFile(), disconnect(), shutdown(), setContext() 可在任意线程中调用，
+     *    不在连接所属的线程时会转交过去执行，此时返回 true 只表示已转交；
+     * 3. 其它针对某个连接的函数只能在该连接的回调中，或所属的线程中调用；
+     * 4. start(), stop(), cleanup() 会等待各线程执行完，不能在回调中调用，否则失败返回。
+     */
+    bool initialize(const SockAddr &bind_addr, int listen_backlog, int loop_num);
 
     using ConnectedCallback     = std::function<void(const ConnToken &)>;
     using DisconnectedCallback  = std::function<void(const ConnToken &)>;
@@ -75,6 +95,12 @@ class TcpServer {
 
     //! 向指定客户端发送数据
     bool send(const ConnToken &client, const void *data_ptr, size_t data_size);
+    //! 向指定客户端分散发送多块数据，免去先拼接
+    bool sendv(const ConnToken &client, const struct iovec *iov, int iovcnt);
+    //! 向指定客户端发送共享的数据，发送完成前一直持有，不拷贝
+    bool send(const ConnToken &client, std::shared_ptr<const std::string> data);
+    //! 向指定客户端发送文件中 [offset, offset + size) 区间的内容，见 BufferedFd::sendFile()
+    bool sendFile(const ConnToken &client, util::Fd file, off_t offset, size_t size);
     //! 断开指定客户端的连接
     bool disconnect(const ConnToken &client);
     //! 半关闭
@@ -98,7 +124,7 @@ class TcpServer {
     TcpConnection* detachConnection(const ConnToken &client);
 
   protected:
-    void onTcpConnected(TcpConnection *new_conn);
+    void onTcpConnected(size_t shard_index, TcpConnection *new_conn);
     void onTcpDisconnected(const ConnToken &client);
     void onTcpReceived(const ConnToken &client, Buffer &buff);
     void onTcpSendCompleted(const ConnToken &client);
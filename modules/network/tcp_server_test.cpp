@@ -0,0 +1,241 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/event/loop.h>
+
+#include "tcp_server.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+
+namespace {
+
+int ConnectTo(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//! 发送 data 并读回同样长度的数据
+std::string RoundTrip(int fd, const std::string &data)
+{
+    if (write(fd, data.data(), data.size()) != (ssize_t)data.size())
+        return "";
+
+    std::string recv_str;
+    char buff[256];
+    while (recv_str.size() < data.size()) {
+        ssize_t rsize = read(fd, buff, sizeof(buff));
+        if (rsize <= 0)
+            break;
+        recv_str.append(buff, rsize);
+    }
+    return recv_str;
+}
+
+void SetupEchoServer(TcpServer &server)
+{
+    server.setReceiveCallback(
+        [&server] (const TcpServer::ConnToken &client, Buffer &buff) {
+            server.send(client, buff.readableBegin(), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+}
+
+}
+
+TEST(TcpServer, MultiLoopEcho)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    TcpServer server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString("127.0.0.1:22100"), 64, 4));
+    SetupEchoServer(server);
+
+    std::mutex lock;
+    std::set<TcpServer::ConnToken> tokens;
+    server.setConnectedCallback(
+        [&] (const TcpServer::ConnToken &client) {
+            std::lock_guard<std::mutex> g(lock);
+            tokens.insert(client);
+        }
+    );
+    ASSERT_TRUE(server.start());
+
+    const int kClientNum = 16;
+    int fds[kClientNum];
+    for (int i = 0; i < kClientNum; ++i) {
+        fds[i] = ConnectTo(22100);
+        ASSERT_GE(fds[i], 0);
+    }
+
+    for (int i = 0; i < kClientNum; ++i) {
+        std::string msg = "hello " + std::to_string(i);
+        EXPECT_EQ(RoundTrip(fds[i], msg), msg);
+    }
+
+    //! 所有连接的 Token 各不相同
+    {
+        std::lock_guard<std::mutex> g(lock);
+        EXPECT_EQ(tokens.size(), size_t(kClientNum));
+    }
+
+    for (int i = 0; i < kClientNum; ++i)
+        close(fds[i]);
+
+    server.cleanup();
+    EXPECT_EQ(server.state(), TcpServer::State::kNone);
+}
+
+//! 在其它线程中操作连接，应转交到连接所属的线程中执行
+TEST(TcpServer, MultiLoopRouteFromOtherThread)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    TcpServer server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString("127.0.0.1:22101"), 64, 2));
+
+    std::atomic<bool> is_connected(false);
+    TcpServer::ConnToken token;
+    server.setConnectedCallback(
+        [&] (const TcpServer::ConnToken &client) {
+            token = client;
+            is_connected = true;
+        }
+    );
+    ASSERT_TRUE(server.start());
+
+    int fd = ConnectTo(22101);
+    ASSERT_GE(fd, 0);
+    SetScopeExitAction([fd] { close(fd); });
+
+    for (int i = 0; i < 100 && !is_connected; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(is_connected);
+
+    int context = 0;
+    server.setContext(token, &context, [] (void *p) { *static_cast<int*>(p) = 1; });
+    EXPECT_TRUE(server.send(token, "hi", 2));
+
+    char buff[8] = { 0 };
+    EXPECT_EQ(read(fd, buff, sizeof(buff)), 2);
+    EXPECT_STREQ(buff, "hi");
+
+    EXPECT_TRUE(server.disconnect(token));
+    EXPECT_EQ(read(fd, buff, sizeof(buff)), 0);
+    EXPECT_EQ(context, 1);  //! 断开时，上下文被释放
+
+    //! 连接已不存在了，转交过去的上下文也要被释放
+    std::atomic<int> late_context(0);
+    server.setContext(token, &late_context, [] (void *p) { *static_cast<std::atomic<int>*>(p) = 1; });
+    for (int i = 0; i < 100 && late_context == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(late_context, 1);
+
+    server.cleanup();
+}
+
+//! 在分片线程的回调中调用 stop() 要等待各分片，会死锁，应直接失败返回
+TEST(TcpServer, MultiLoopStopInCallback)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    TcpServer server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString("127.0.0.1:22102"), 64, 2));
+
+    std::atomic<bool> is_connected(false);
+    std::atomic<bool> is_still_running(false);
+    server.setConnectedCallback(
+        [&] (const TcpServer::ConnToken &) {
+            server.stop();
+            is_still_running = server.state() == TcpServer::State::kRunning;
+            is_connected = true;
+        }
+    );
+    ASSERT_TRUE(server.start());
+
+    int fd = ConnectTo(22102);
+    ASSERT_GE(fd, 0);
+    SetScopeExitAction([fd] { close(fd); });
+
+    for (int i = 0; i < 100 && !is_connected; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_TRUE(is_connected);
+    EXPECT_TRUE(is_still_running);
+
+    server.cleanup();
+    EXPECT_EQ(server.state(), TcpServer::State::kNone);
+}
+
+//! Unix Domain Socket 不支持 SO_REUSEPORT，各Loop共享同一个监听socket
+TEST(TcpServer, MultiLoopLocalSocket)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    const char *sock_path = "/tmp/tbox_tcp_server_test.sock";
+
+    TcpServer server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString(sock_path), 64, 3));
+    SetupEchoServer(server);
+    ASSERT_TRUE(server.start());
+
+    for (int i = 0; i < 6; ++i) {
+        int fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_LOCAL;
+        strcpy(addr.sun_path, sock_path);
+        ASSERT_EQ(connect(fd, (struct sockaddr*)&addr, sizeof(addr)), 0);
+        EXPECT_EQ(RoundTrip(fd, "abc"), "abc");
+        close(fd);
+    }
+
+    server.cleanup();
+    EXPECT_NE(access(sock_path, F_OK), 0);
+}
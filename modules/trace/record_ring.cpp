@@ -0,0 +1,89 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "record_ring.h"
+
+#include <algorithm>
+
+namespace tbox {
+namespace trace {
+
+namespace {
+size_t RoundUpPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+}
+
+RecordRing::RecordRing(size_t capacity, long thread_id)
+    : capacity_(RoundUpPowerOfTwo(std::max<size_t>(capacity, 2)))
+    , mask_(capacity_ - 1)
+    , thread_id_(thread_id)
+{
+    records_ = new Record [capacity_];
+}
+
+RecordRing::~RecordRing()
+{
+    delete [] records_;
+}
+
+bool RecordRing::push(const Record &record)
+{
+    size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+
+    if (write_pos - cached_read_pos_ >= capacity_) {
+        cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+        if (write_pos - cached_read_pos_ >= capacity_)
+            return false;
+    }
+
+    records_[write_pos & mask_] = record;
+    write_pos_.store(write_pos + 1, std::memory_order_release);
+    return true;
+}
+
+size_t RecordRing::readAll(std::vector<Record> &out)
+{
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size_t num = write_pos - read_pos;
+    if (num == 0)
+        return 0;
+
+    size_t index = read_pos & mask_;
+    size_t first_num = std::min(num, capacity_ - index);
+    out.insert(out.end(), records_ + index, records_ + index + first_num);
+    if (first_num < num)
+        out.insert(out.end(), records_, records_ + (num - first_num));
+
+    read_pos_.store(write_pos, std::memory_order_release);
+    return num;
+}
+
+size_t RecordRing::size() const
+{
+    return write_pos_.load(std::memory_order_relaxed) - read_pos_.load(std::memory_order_relaxed);
+}
+
+}
+}
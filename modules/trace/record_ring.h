@@ -0,0 +1,89 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_TRACE_RECORD_RING_H_20251018
+#define TBOX_TRACE_RECORD_RING_H_20251018
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace trace {
+
+//! 一条记录，name 与 module 只保存指针
+struct Record {
+    const char *name;
+    const char *module;
+    uint32_t line;
+    bool is_event;          //!< 是否为 RECORD_EVENT() 的瞬时事件，否则为时长片段
+    uint64_t end_ts_us;
+    uint64_t duration_us;
+};
+
+/**
+ * 记录环形缓冲，单生产者单消费者，无锁
+ *
+ * 每个提交记录的线程各自持有一个，后台线程读出
+ */
+class RecordRing {
+  public:
+    //! capacity 为记录条数，会向上取整为2的幂
+    RecordRing(size_t capacity, long thread_id);
+    ~RecordRing();
+
+    NONCOPYABLE(RecordRing);
+    IMMOVABLE(RecordRing);
+
+  public:
+    //! 写入一条记录，仅由生产者线程调用。满了返回 false
+    bool push(const Record &record);
+
+    //! 读出所有记录并追加到 out 中，仅由消费者线程调用。返回读出的条数
+    size_t readAll(std::vector<Record> &out);
+
+    inline size_t capacity() const { return capacity_; }
+    size_t size() const;
+
+    inline long threadId() const { return thread_id_; }
+
+    inline bool isProducerExited() const { return is_producer_exited_.load(std::memory_order_acquire); }
+    inline void setProducerExited() { is_producer_exited_.store(true, std::memory_order_release); }
+
+  private:
+    Record *records_;
+    size_t capacity_;
+    size_t mask_;
+    long thread_id_;
+
+    std::atomic<size_t> write_pos_{0};
+    size_t cached_read_pos_ = 0;    //!< 生产者缓存的 read_pos_
+    char padding_[64];              //!< 隔开读写位置，避免伪共享
+    std::atomic<size_t> read_pos_{0};
+
+    std::atomic<bool> is_producer_exited_{false};
+};
+
+}
+}
+
+#endif //TBOX_TRACE_RECORD_RING_H_20251018
@@ -26,15 +26,19 @@
 #include <vector>
 #include <sstream>
 #include <chrono>
+#include <algorithm>
+#include <cinttypes>
 
-#include <sys/syscall.h>
 #include <tbox/base/defines.h>
+#include <tbox/base/fast_clock.h>
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/util/fs.h>
 #include <tbox/util/string.h>
 #include <tbox/util/scalable_integer.h>
 
+#include "record_ring.h"
+
 namespace tbox {
 namespace trace {
 
@@ -44,9 +48,33 @@ void CommitRecordFunc(const char *name, const char *module, uint32_t line,
     Sink::GetInstance().commitRecord(name, module, line, end_timepoint_us, duration_us);
 }
 
+void CommitEventFunc(const char *name, const char *module, uint32_t line, uint64_t timepoint_us)
+{
+    Sink::GetInstance().commitEvent(name, module, line, timepoint_us);
+}
+
 #define ENDLINE "\n"
 
 namespace {
+
+//! 本线程的缓冲
+struct ThreadRing {
+    uint64_t sink_uid = 0;
+    std::shared_ptr<RecordRing> ring;
+
+    ~ThreadRing() {
+        //! 线程退出了，通知后台线程读完后回收
+        if (ring)
+            ring->setProducerExited();
+        is_destroyed = true;
+    }
+
+    static thread_local bool is_destroyed;
+};
+
+thread_local ThreadRing _thread_ring;
+thread_local bool ThreadRing::is_destroyed = false;
+
 std::string GetLocalDateTimeStr()
 {
     char timestamp[16]; //! 固定长度16B，"20220414_071023"
@@ -79,10 +107,14 @@ bool Sink::setPathPrefix(const std::string &path_prefix)
     }
 
     dir_path_ = striped_path_prefix + '.' + GetLocalDateTimeStr() + '.' + std::to_string(::getpid());
+    version_filename_ = dir_path_ + "/version.txt";
     name_list_filename_ = dir_path_ + "/names.txt";
     module_list_filename_ = dir_path_ + "/modules.txt";
     thread_list_filename_ = dir_path_ + "/threads.txt";
+    counter_list_filename_ = dir_path_ + "/counters.txt";
+    counter_filename_ = dir_path_ + "/counters.bin";
     CHECK_CLOSE_RESET_FD(curr_record_fd_);
+    CHECK_CLOSE_RESET_FD(counter_fd_);
 
     return true;
 }
@@ -91,6 +123,7 @@ void Sink::setFileSyncEnable(bool is_enable)
 {
     is_file_sync_enabled_ = is_enable;
     CHECK_CLOSE_RESET_FD(curr_record_fd_);
+    CHECK_CLOSE_RESET_FD(counter_fd_);
 }
 
 bool Sink::enable()
@@ -103,16 +136,10 @@ bool Sink::enable()
         return false;
     }
 
-    using namespace std::placeholders;
-
-    util::AsyncPipe::Config config;
-    config.buff_size = 10240;
-    config.buff_min_num = 2;
-    config.buff_max_num = 20;
-    config.interval = 1000;
-
-    async_pipe_.initialize(config);
-    async_pipe_.setCallback(std::bind(&Sink::onBackendRecvData, this, _1, _2));
+    static std::atomic<uint64_t> _uid_alloc(0);
+    uid_ = ++_uid_alloc;
+    is_stopping_ = false;
+    backend_thread_ = std::thread(&Sink::threadFunc, this);
     is_enabled_ = true;
 
     return true;
@@ -122,16 +149,39 @@ void Sink::disable()
 {
     if (is_enabled_) {
         is_enabled_ = false;
-        async_pipe_.cleanup();
+        stopBackEnd();
         CHECK_CLOSE_RESET_FD(curr_record_fd_);
-        buffer_.hasReadAll();
+        CHECK_CLOSE_RESET_FD(counter_fd_);
     }
 }
 
+void Sink::stopBackEnd()
+{
+    {
+        std::lock_guard<std::mutex> lk(backend_mutex_);
+        is_stopping_ = true;
+    }
+    backend_cv_.notify_one();
+    backend_thread_.join();
+
+    //! 此后各线程会因 is_enabled_ 为 false 而不再写入，读出剩余的记录
+    drainRings();
+
+    std::lock_guard<std::mutex> lk(rings_mutex_);
+    rings_.clear();
+}
+
+void Sink::setFilterStrategy(FilterStrategy strategy)
+{
+    filter_strategy_ = strategy;
+    ++filter_version_;
+}
+
 void Sink::setFilterExemptSet(const ExemptSet &exempt_set)
 {
     std::unique_lock<std::mutex> lk(lock_);
     filter_exempt_set_ = exempt_set;
+    ++filter_version_;
 }
 
 Sink::ExemptSet Sink::getFilterExemptSet() const
@@ -151,95 +201,213 @@ bool Sink::isFilterPassed(const std::string &module) const
         return is_in_exempt_set;
 }
 
-void Sink::commitRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us)
+RecordRing* Sink::getThreadRing()
 {
-    if (!is_enabled_)
-        return;
+    if (ThreadRing::is_destroyed)
+        return nullptr;
+
+    if (_thread_ring.sink_uid == uid_ && _thread_ring.ring)
+        return _thread_ring.ring.get();
+
+    //! 原来的缓冲属于上一次使能，已被后台放弃，换一个新的
+    auto ring = std::make_shared<RecordRing>(thread_buffer_size_, GetCurrentThreadId());
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        rings_.push_back(ring);
+    }
+    _thread_ring.sink_uid = uid_;
+    _thread_ring.ring = ring;
+    return ring.get();
+}
 
-    auto start_ts = std::chrono::steady_clock::now();
+void Sink::wakeBackEnd()
+{
+    if (!is_wake_requested_.exchange(true)) {
+        std::lock_guard<std::mutex> lk(backend_mutex_);
+        backend_cv_.notify_one();
+    }
+}
 
-    RecordHeader header = {
-        .thread_id = ::syscall(SYS_gettid),
+void Sink::commitRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us)
+{
+    Record record = {
+        .name = name,
+        .module = module,
+        .line = line,
+        .is_event = false,
         .end_ts_us = end_timepoint_us,
         .duration_us = duration_us,
+    };
+    pushRecord(record);
+}
+
+void Sink::commitEvent(const char *name, const char *module, uint32_t line, uint64_t timepoint_us)
+{
+    Record record = {
+        .name = name,
+        .module = module,
         .line = line,
-        .name_size = ::strlen(name) + 1,
-        .module_size = ::strlen(module) + 1
+        .is_event = true,
+        .end_ts_us = timepoint_us,
+        .duration_us = 0,
     };
+    pushRecord(record);
+}
 
-    async_pipe_.appendLock();
-    async_pipe_.appendLockless(&header, sizeof(header));
-    async_pipe_.appendLockless(name, header.name_size);
-    async_pipe_.appendLockless(module, header.module_size);
-    async_pipe_.appendUnlock();
+void Sink::pushRecord(const Record &record)
+{
+    if (!is_enabled_)
+        return;
 
-    auto time_cost = std::chrono::steady_clock::now() - start_ts;
-    if (time_cost > std::chrono::milliseconds(100))
-        LogNotice("trace commit cost > 100 ms, %lu us, %s at L%d", time_cost.count() / 1000, name, line);
+    auto ring = getThreadRing();
+    if (ring == nullptr)
+        return;
+
+    //! 不能因为记录而阻塞业务，满了就丢弃
+    if (!ring->push(record)) {
+        ++dropped_count_;
+        wakeBackEnd();
+        return;
+    }
+
+    //! 超过一半就提前唤醒后台线程，以免写满
+    if (ring->size() > ring->capacity() / 2)
+        wakeBackEnd();
 }
 
-void Sink::onBackendRecvData(const void *data, size_t size)
+void Sink::commitCounter(const std::string &name, uint64_t timepoint_us, int64_t value)
 {
-    auto start_ts = std::chrono::steady_clock::now();
-
-    if (!checkAndCreateRecordFile() ||
-        !checkAndWriteNames() ||
-        !checkAndWriteModules() ||
-        !checkAndWriteThreads())
+    if (!is_enabled_)
         return;
 
-    buffer_.append(data, size);
-    std::vector<uint8_t> write_cache;
+    std::lock_guard<std::mutex> lk(counters_mutex_);
+    //! 后台线程迟迟不处理时，不能无限堆积
+    if (pending_counters_.size() >= kMaxPendingCounterNum) {
+        ++dropped_count_;
+        return;
+    }
+    pending_counters_.push_back(Counter{name, timepoint_us, value});
+}
 
-    while (buffer_.readableSize() > sizeof(RecordHeader)) {
-        RecordHeader header;
-        ::memcpy(&header, buffer_.readableBegin(), sizeof(header));
-        //! Q: 为什么不直接引用，像这样 auto *phead = static_cast<const RecordHeader*>(buffer_.readableBegin())
-        //     而是要先copy到header再使用？
-        //! A: 因为直接指针引用会有对齐的问题。
-
-        auto packet_size = header.name_size + header.module_size + sizeof(header);
-        //! 如果长度不够，就跳过，等下一次
-        if (packet_size > buffer_.readableSize()) {
-            TBOX_ASSERT(packet_size < 1024); //! 正常不应该超过1K的，如果真超过了就是Bug
-            break;
+void Sink::threadFunc()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(backend_mutex_);
+            backend_cv_.wait_for(lk, std::chrono::seconds(1),
+                [this] { return is_stopping_ || is_wake_requested_; });
+            if (is_stopping_)
+                break;
         }
 
-        buffer_.hasRead(sizeof(header));
+        is_wake_requested_ = false;
+        drainRings();
+    }
+}
 
-        const char *name = reinterpret_cast<const char*>(buffer_.readableBegin());
-        const char *module = name + header.name_size;
-        onBackendRecvRecord(header, name, module, write_cache);
+/**
+ * 读出各缓冲中的记录，按结束时间合并后编码写入文件
+ *
+ * 每个缓冲中的记录本身就是有序的，所以每次只需比较各缓冲中最早的那条
+ */
+void Sink::drainRings()
+{
+    auto start_ts = FastSteadyClock::now();
 
-        buffer_.hasRead(header.name_size + header.module_size);
+    std::vector<std::shared_ptr<RecordRing>> rings;
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        rings = rings_;
     }
 
-    if (!write_cache.empty()) {
+    struct Batch {
+        std::vector<Record> records;
+        size_t read_index;
+        Index thread_index;
+    };
+    std::vector<Batch> batches(rings.size());
+
+    size_t total_num = 0;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        total_num += rings[i]->readAll(batches[i].records);
+        batches[i].read_index = 0;
+    }
 
-        auto wsize = ::write(curr_record_fd_, write_cache.data(), write_cache.size());
-        if (wsize != static_cast<ssize_t>(write_cache.size())) {
-            LogErrno(errno, "write record file '%s' fail", curr_record_filename_.c_str());
+    if (total_num > 0) {
+        if (!checkAndCreateRecordFile() ||
+            !checkAndWriteVersion() ||
+            !checkAndWriteNames() ||
+            !checkAndWriteModules() ||
+            !checkAndWriteThreads())
             return;
+
+        for (size_t i = 0; i < rings.size(); ++i) {
+            if (!batches[i].records.empty())
+                batches[i].thread_index = allocThreadIndex(rings[i]->threadId());
         }
 
-        total_write_size_ += wsize;
-        if (total_write_size_ >= record_file_max_size_)
-            CHECK_CLOSE_RESET_FD(curr_record_fd_);
+        std::vector<uint8_t> write_cache;
+        write_cache.reserve(total_num * 8);
+
+        for (;;) {
+            Batch *earliest = nullptr;
+            for (auto &batch : batches) {
+                if (batch.read_index < batch.records.size() &&
+                    (earliest == nullptr ||
+                     batch.records[batch.read_index].end_ts_us < earliest->records[earliest->read_index].end_ts_us))
+                    earliest = &batch;
+            }
+
+            if (earliest == nullptr)
+                break;
+
+            onBackendRecvRecord(earliest->records[earliest->read_index], earliest->thread_index, write_cache);
+            ++earliest->read_index;
+        }
+
+        if (!write_cache.empty()) {
+            auto wsize = ::write(curr_record_fd_, write_cache.data(), write_cache.size());
+            if (wsize != static_cast<ssize_t>(write_cache.size())) {
+                LogErrno(errno, "write record file '%s' fail", curr_record_filename_.c_str());
+                return;
+            }
+
+            total_write_size_ += wsize;
+            if (total_write_size_ >= record_file_max_size_)
+                CHECK_CLOSE_RESET_FD(curr_record_fd_);
+        }
     }
 
-    auto time_cost = std::chrono::steady_clock::now() - start_ts;
+    drainCounters();
+
+    uint64_t dropped_count = dropped_count_;
+    if (dropped_count != reported_dropped_count_) {
+        LogWarn("%" PRIu64 " trace records dropped, buffer full", dropped_count - reported_dropped_count_);
+        reported_dropped_count_ = dropped_count;
+    }
+
+    //! 回收线程已退出，且已读完的缓冲
+    {
+        std::lock_guard<std::mutex> lk(rings_mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                    [](const std::shared_ptr<RecordRing> &ring) {
+                                        return ring->isProducerExited() && ring->size() == 0;
+                                    }),
+                     rings_.end());
+    }
+
+    auto time_cost = FastSteadyClock::now() - start_ts;
     if (time_cost > std::chrono::milliseconds(100))
         LogNotice("trace sink cost > 100 ms, %lu us", time_cost.count() / 1000);
 }
 
-void Sink::onBackendRecvRecord(const RecordHeader &record, const char *name, const char *module, std::vector<uint8_t> &write_cache)
+void Sink::onBackendRecvRecord(const Record &record, Index thread_index, std::vector<uint8_t> &write_cache)
 {
-    if (!isFilterPassed(module))
+    Index module_index = 0;
+    if (!getModuleIndex(record.module, module_index))
         return;
 
-    auto thread_index = allocThreadIndex(record.thread_id);
-    auto name_index = allocNameIndex(name, record.line);
-    auto module_index = allocModuleIndex(module);
+    auto name_index = getNameIndex(record.name, record.line);
     auto time_diff = record.end_ts_us - last_timepoint_us_;
 
     constexpr size_t kBufferSize = 40;
@@ -247,15 +415,16 @@ void Sink::onBackendRecvRecord(const RecordHeader &record, const char *name, con
     size_t  data_size = 0;
 
     data_size += util::DumpScalableInteger(time_diff, (buffer + data_size), (kBufferSize - data_size));
-    data_size += util::DumpScalableInteger(record.duration_us, (buffer + data_size), (kBufferSize - data_size));
+    //! 时长左移一位，最低位标记记录的类型
+    uint64_t duration_kind = (record.duration_us << 1) | (record.is_event ? 1 : 0);
+    data_size += util::DumpScalableInteger(duration_kind, (buffer + data_size), (kBufferSize - data_size));
     data_size += util::DumpScalableInteger(thread_index, (buffer + data_size), (kBufferSize - data_size));
     data_size += util::DumpScalableInteger(name_index, (buffer + data_size), (kBufferSize - data_size));
     data_size += util::DumpScalableInteger(module_index, (buffer + data_size), (kBufferSize - data_size));
 
     last_timepoint_us_ = record.end_ts_us;
 
-    std::back_insert_iterator<std::vector<uint8_t>>  back_insert_iter(write_cache);
-    std::copy(buffer, buffer + data_size, back_insert_iter);
+    write_cache.insert(write_cache.end(), buffer, buffer + data_size);
 }
 
 bool Sink::checkAndCreateRecordFile()
@@ -302,6 +471,109 @@ bool Sink::checkAndCreateRecordFile()
     return true;
 }
 
+/**
+ * 将暂存的计数器采样编码写入 counters.bin
+ *
+ * 每个采样是3个可变长整数：与上一个采样的时间差、计数器编号、ZigZag 编码后的采样值
+ */
+void Sink::drainCounters()
+{
+    std::vector<Counter> counters;
+    {
+        std::lock_guard<std::mutex> lk(counters_mutex_);
+        counters.swap(pending_counters_);
+    }
+
+    if (counters.empty())
+        return;
+
+    if (!checkAndOpenCounterFile() || !checkAndWriteCounterNames())
+        return;
+
+    std::vector<uint8_t> write_cache;
+    write_cache.reserve(counters.size() * 8);
+
+    for (auto &counter : counters) {
+        auto counter_index = allocCounterIndex(counter.name);
+        auto time_diff = counter.timepoint_us - last_counter_timepoint_us_;
+        //! 负数的补码很大，先 ZigZag 编码，使绝对值小的数编码也短
+        auto value = (static_cast<uint64_t>(counter.value) << 1) ^ static_cast<uint64_t>(counter.value >> 63);
+
+        constexpr size_t kBufferSize = 30;
+        uint8_t buffer[kBufferSize];
+        size_t  data_size = 0;
+
+        data_size += util::DumpScalableInteger(time_diff, (buffer + data_size), (kBufferSize - data_size));
+        data_size += util::DumpScalableInteger(counter_index, (buffer + data_size), (kBufferSize - data_size));
+        data_size += util::DumpScalableInteger(value, (buffer + data_size), (kBufferSize - data_size));
+
+        last_counter_timepoint_us_ = counter.timepoint_us;
+        write_cache.insert(write_cache.end(), buffer, buffer + data_size);
+    }
+
+    auto wsize = ::write(counter_fd_, write_cache.data(), write_cache.size());
+    if (wsize != static_cast<ssize_t>(write_cache.size()))
+        LogErrno(errno, "write counter file '%s' fail", counter_filename_.c_str());
+}
+
+bool Sink::checkAndOpenCounterFile()
+{
+    if (counter_fd_ >= 0) {
+        if (util::fs::IsFileExist(counter_filename_))
+            return true;
+        CHECK_CLOSE_RESET_FD(counter_fd_);
+    }
+
+    if (!util::fs::MakeDirectory(dir_path_, false)) {
+        LogErrno(errno, "create directory '%s' fail", dir_path_.c_str());
+        return false;
+    }
+
+    int flags = O_CREAT | O_WRONLY | O_APPEND;
+    if (is_file_sync_enabled_)
+        flags |= O_DSYNC;
+
+    //! 新的文件从头开始计算时间差；已存在的，如切换了同步模式而重新打开的，则接着写
+    bool is_new_file = !util::fs::IsFileExist(counter_filename_);
+    counter_fd_ = ::open(counter_filename_.c_str(), flags, S_IRUSR | S_IWUSR);
+    if (counter_fd_ < 0) {
+        LogErrno(errno, "open counter file '%s' fail", counter_filename_.c_str());
+        return false;
+    }
+
+    if (is_new_file)
+        last_counter_timepoint_us_ = 0;
+    return true;
+}
+
+bool Sink::checkAndWriteCounterNames()
+{
+    //! 如果文件不存在了，则重写所有的计数器名列表
+    if (!util::fs::IsFileExist(counter_list_filename_)) {
+        std::vector<std::string> counter_vec(counter_to_index_map_.size());
+        for (auto &item : counter_to_index_map_)
+            counter_vec[item.second] = item.first;
+
+        std::ostringstream oss;
+        for (auto &counter : counter_vec)
+            oss << counter << ENDLINE;
+
+        return util::fs::WriteStringToTextFile(counter_list_filename_, oss.str(), is_file_sync_enabled_);
+    }
+
+    return true;
+}
+
+bool Sink::checkAndWriteVersion()
+{
+    if (!util::fs::IsFileExist(version_filename_)) {
+        std::string content = std::to_string(kRecordFormatVersion) + ENDLINE;
+        return util::fs::WriteStringToTextFile(version_filename_, content, is_file_sync_enabled_);
+    }
+
+    return true;
+}
+
 bool Sink::checkAndWriteNames()
 {
     //! 如果文件不存在了，则重写所有的名称列表
@@ -356,6 +628,42 @@ bool Sink::checkAndWriteThreads()
     return true;
 }
 
+Sink::Index Sink::getNameIndex(const char *name, uint32_t line)
+{
+    NameKey key = { name, line };
+    auto iter = name_ptr_cache_.find(key);
+    if (iter != name_ptr_cache_.end())
+        return iter->second;
+
+    //! 不同的指针也可能指向相同的内容，如各编译单元中的同一个内联函数，所以要按内容分配
+    auto index = allocNameIndex(name, line);
+    name_ptr_cache_[key] = index;
+    return index;
+}
+
+bool Sink::getModuleIndex(const char *module, Index &index)
+{
+    uint32_t filter_version = filter_version_;
+    auto iter = module_ptr_cache_.find(module);
+    if (iter == module_ptr_cache_.end()) {
+        //! 版本号故意设为不一致，使之在下面被更新
+        ModuleCache cache = { filter_version + 1, false, kInvalidIndex };
+        iter = module_ptr_cache_.emplace(module, cache).first;
+    }
+
+    auto &cache = iter->second;
+    if (cache.filter_version != filter_version) {
+        cache.filter_version = filter_version;
+        cache.is_passed = isFilterPassed(module);
+        //! 被过滤掉的模块不分配编号，与以往一致
+        if (cache.is_passed && cache.index == kInvalidIndex)
+            cache.index = allocModuleIndex(module);
+    }
+
+    index = cache.index;
+    return cache.is_passed;
+}
+
 Sink::Index Sink::allocNameIndex(const std::string &name, uint32_t line)
 {
     std::string content = name + " at L" + std::to_string(line);
@@ -396,5 +704,18 @@ Sink::Index Sink::allocThreadIndex(long thread_id)
     return new_index;
 }
 
+Sink::Index Sink::allocCounterIndex(const std::string &name)
+{
+    auto iter = counter_to_index_map_.find(name);
+    if (iter != counter_to_index_map_.end())
+        return iter->second;
+
+    auto new_index = next_counter_index_++;
+    counter_to_index_map_[name] = new_index;
+
+    util::fs::AppendStringToTextFile(counter_list_filename_, name + ENDLINE, is_file_sync_enabled_);
+    return new_index;
+}
+
 }
 }
@@ -23,17 +23,35 @@
 #include <atomic>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <limits>
 #include <mutex>
 #include <set>
 #include <vector>
-
-#include <tbox/util/async_pipe.h>
-#include <tbox/util/buffer.h>
+#include <memory>
+#include <thread>
+#include <condition_variable>
 
 namespace tbox {
 namespace trace {
 
+class RecordRing;
+struct Record;
+
+/**
+ * 记录文件的格式版本，写在目录下的 version.txt 中
+ *   1: 没有 version.txt，每条记录的第二个字段为 duration_us
+ *   2: 第二个字段为 (duration_us << 1) | is_event
+ */
+constexpr int kRecordFormatVersion = 2;
+
+/**
+ * 记录的落盘通道
+ *
+ * 每个提交记录的线程各有一个无锁的环形缓冲，前端只是将记录写入其中。
+ * 后台线程定时读出各缓冲，按时间合并后编码写入文件。
+ * 名称与模块按指针缓存其编号，每个调用点只需在首次出现时查找一次。
+ */
 class Sink {
 
   public:
@@ -46,9 +64,12 @@ class Sink {
      *       其名称中 "20240525_123300" 为时间戳，"7723" 为进程号。
      *       目录结构:
      *       .
+     *       |-- version.txt  # 记录文件的格式版本，见 kRecordFormatVersion
      *       |-- names.txt    # 函数名列表
      *       |-- modules.txt  # 模块名列表
      *       |-- threads.txt  # 线程名列表
+     *       |-- counters.txt # 计数器名列表
+     *       |-- counters.bin # 计数器采样文件
      *       `-- records      # 记录文件目录，其下存在一个或多个记录文件
      *           `-- 20240530_041046.bin
      */
@@ -72,6 +93,11 @@ class Sink {
 
     bool isEnabled() const { return is_enabled_; }
 
+    //! 设置每个线程的缓冲能存放的记录条数，在 enable() 之前设置
+    void setThreadBufferSize(size_t record_num) { thread_buffer_size_ = record_num; }
+    //! 因缓冲满而被丢弃的记录条数
+    uint64_t droppedCount() const { return dropped_count_; }
+
     //! 过滤策略
     enum class FilterStrategy {
         kPermit,  //! 允许
@@ -79,7 +105,7 @@ class Sink {
     };
     using ExemptSet = std::set<std::string>;
     //! 设置与获取过滤策略，默认允许或是拒绝
-    void setFilterStrategy(FilterStrategy strategy) { filter_strategy_ = strategy; }
+    void setFilterStrategy(FilterStrategy strategy);
     FilterStrategy getFilterStrategy() const { return filter_strategy_; }
     //! 设置与获取豁免集合
     void setFilterExemptSet(const ExemptSet &exempt_set);
@@ -88,6 +114,9 @@ class Sink {
     /**
      * \brief 提交记录
      *
+     * 只保存 name 与 module 的指针，不做拷贝，所以必须是字符串字面量或生命期足够长的字符串，
+     * 且同一地址上的内容不能改变。
+     *
      * \param name          名称，通常指函数名或事件名，或函数名+文件名+行号
      * \param line          行号
      * \param end_ts        记录结束的时间点，单位: us
@@ -95,53 +124,108 @@ class Sink {
      */
     void commitRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us);
 
+    /**
+     * \brief 提交瞬时事件，如 RECORD_EVENT() 的记录
+     *
+     * 与时长片段分开标记，即使时长为0的片段也不会被当成事件。参数要求同 commitRecord()
+     *
+     * \param timepoint_us  事件发生的时间点，单位: us
+     */
+    void commitEvent(const char *name, const char *module, uint32_t line, uint64_t timepoint_us);
+
+    /**
+     * \brief 提交计数器采样值
+     *
+     * 用于记录随时间变化的数值，如事件循环的负载、线程池中等待的任务数等，在时间线上显示为曲线。
+     * 采样频率通常很低，所以不走各线程的缓冲，而是加锁暂存，由后台线程写入 counters.bin。
+     *
+     * \param name         计数器名称，如 "loop.loop_count"
+     * \param timepoint_us 采样的时间点，单位: us
+     * \param value        采样值
+     */
+    void commitCounter(const std::string &name, uint64_t timepoint_us, int64_t value);
+
   protected:
     ~Sink();
 
-    struct RecordHeader {
-        long thread_id;
-        uint64_t end_ts_us;
-        uint64_t duration_us;
-        uint32_t line;
-        size_t name_size;
-        size_t module_size;
-    };
-
     using Index = uint64_t;
+    static constexpr Index kInvalidIndex = std::numeric_limits<Index>::max();
+    static constexpr size_t kMaxPendingCounterNum = 4096;
 
-    void onBackendRecvData(const void *data, size_t size);
-    void onBackendRecvRecord(const RecordHeader &record, const char *name, const char *module,
-                             std::vector<uint8_t> &write_cache);
+    void pushRecord(const Record &record);
+    RecordRing* getThreadRing();
+    void wakeBackEnd();
+    void stopBackEnd();
 
+    void threadFunc();
+    void drainRings();
+    void onBackendRecvRecord(const Record &record, Index thread_index, std::vector<uint8_t> &write_cache);
+
+    bool checkAndWriteVersion();
     bool checkAndWriteNames();
     bool checkAndWriteModules();
     bool checkAndWriteThreads();
     bool checkAndCreateRecordFile();
 
+    void drainCounters();
+    bool checkAndOpenCounterFile();
+    bool checkAndWriteCounterNames();
+    Index allocCounterIndex(const std::string &name);
+
     bool isFilterPassed(const std::string &module) const;
 
     Index allocNameIndex(const std::string &name, uint32_t line);
     Index allocModuleIndex(const std::string &module);
     Index allocThreadIndex(long thread_id);
 
+    //! 按指针查找编号，未命中时再按内容分配
+    Index getNameIndex(const char *name, uint32_t line);
+    bool getModuleIndex(const char *module, Index &index);
+
   private:
     std::string dir_path_;
     size_t record_file_max_size_ = std::numeric_limits<size_t>::max();
+    std::string version_filename_;
     std::string name_list_filename_;
     std::string module_list_filename_;
     std::string thread_list_filename_;
+    std::string counter_list_filename_;
+    std::string counter_filename_;
     bool is_file_sync_enabled_ = false;
 
     std::atomic_bool is_enabled_{false};
 
-    util::AsyncPipe async_pipe_;
+    size_t thread_buffer_size_ = 4096;
+    std::atomic<uint64_t> uid_{0};  //!< 每次使能都不同，供各线程识别自己的缓冲是否仍有效
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<RecordRing>> rings_;
+
+    std::thread backend_thread_;
+    std::mutex backend_mutex_;
+    std::condition_variable backend_cv_;
+    bool is_stopping_ = false;
+    std::atomic<bool> is_wake_requested_{false};
+
+    std::atomic<uint64_t> dropped_count_{0};
+    uint64_t reported_dropped_count_ = 0;
+
+    //! 待写入的计数器采样
+    struct Counter {
+        std::string name;
+        uint64_t timepoint_us;
+        int64_t value;
+    };
+    std::mutex counters_mutex_;
+    std::vector<Counter> pending_counters_;
 
     //! 下面的成员变量，由后端线程读写
-    util::Buffer buffer_;
     std::string curr_record_filename_;  //! 当前记录文件的全名
     int curr_record_fd_ = -1;       //! 当前记录文件描述符
     size_t total_write_size_ = 0;   //! 当前记录文件已写入数据量
     uint64_t last_timepoint_us_ = 0; //! 当前记录文件的上一条记录的时间戳(us)
+    int counter_fd_ = -1;           //! 计数器采样文件描述符
+    uint64_t last_counter_timepoint_us_ = 0; //! 上一个计数器采样的时间戳(us)
 
     //! 名称编码
     std::map<std::string, Index> name_to_index_map_;
@@ -152,11 +236,35 @@ class Sink {
     //! 线程号编码
     std::map<long, Index> thread_to_index_map_;
     int next_thread_index_ = 0;
+    //! 计数器名编码
+    std::map<std::string, Index> counter_to_index_map_;
+    uint32_t next_counter_index_ = 0;
+
+    //! 按指针缓存的编号
+    struct NameKey {
+        const char *name;
+        uint32_t line;
+        bool operator == (const NameKey &other) const { return name == other.name && line == other.line; }
+    };
+    struct NameKeyHash {
+        size_t operator () (const NameKey &key) const {
+            return std::hash<const void*>()(key.name) ^ (static_cast<size_t>(key.line) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+    std::unordered_map<NameKey, Index, NameKeyHash> name_ptr_cache_;
+
+    struct ModuleCache {
+        uint32_t filter_version;
+        bool is_passed;
+        Index index;
+    };
+    std::unordered_map<const char*, ModuleCache> module_ptr_cache_;
 
     //! 过滤相关变量
     mutable std::mutex lock_;
     FilterStrategy filter_strategy_ = FilterStrategy::kPermit;  //! 默认允许
     ExemptSet filter_exempt_set_;
+    std::atomic<uint32_t> filter_version_{0};   //!< 过滤设置每变更一次加1，使 module_ptr_cache_ 中的结果失效
 };
 
 }
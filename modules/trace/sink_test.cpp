@@ -20,13 +20,20 @@
 #include <gtest/gtest.h>
 
 #include <sys/syscall.h>
+#include <array>
 #include <thread>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
 
 #include <tbox/base/log.h>
 #include <tbox/base/log_output.h>
 #include <tbox/util/fs.h>
 #include <tbox/util/string.h>
 #include <tbox/util/timestamp.h>
+#include <tbox/util/scalable_integer.h>
+
+#include <tbox/base/recorder.h>
 
 #include "sink.h"
 
@@ -50,6 +57,7 @@ TEST(Sink, Base) {
   std::string name_list_filename = path + "/names.txt";
   std::string thread_list_filename = path + "/threads.txt";
   std::string module_list_filename = path + "/modules.txt";
+  std::string version_filename = path + "/version.txt";
   std::string record_filename = ts.getCurrRecordFilename();
 
   ASSERT_TRUE(util::fs::IsFileExist(name_list_filename));
@@ -57,6 +65,12 @@ TEST(Sink, Base) {
   ASSERT_TRUE(util::fs::IsFileExist(module_list_filename));
   ASSERT_TRUE(util::fs::IsFileExist(record_filename));
 
+  {
+    std::string version_content;
+    ASSERT_TRUE(util::fs::ReadStringFromTextFile(version_filename, version_content));
+    EXPECT_EQ(version_content, std::to_string(kRecordFormatVersion) + "\n");
+  }
+
   {
     std::string name_list_content;
     ASSERT_TRUE(util::fs::ReadStringFromTextFile(name_list_filename, name_list_content));
@@ -82,13 +96,66 @@ TEST(Sink, Base) {
     std::string first_record_content;
     ASSERT_TRUE(util::fs::ReadBinaryFromFile(record_filename, first_record_content));
     auto first_record_content_hex = util::string::RawDataToHexStr(first_record_content.data(), first_record_content.size());
-    std::string target_content = "64 0a 00 00 00 01 01 00 01 00 63 0a 00 00 01 01 64 00 02 01";
+    std::string target_content = "64 14 00 00 00 01 02 00 01 00 63 14 00 00 01 01 80 48 00 02 01";
     EXPECT_EQ(first_record_content_hex, target_content);
   }
 
   util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
 }
 
+//! 从记录文件中读出所有记录的各字段
+std::vector<std::array<uint64_t, 5>> ReadRecordFields(const std::string &record_filename)
+{
+  std::string content;
+  util::fs::ReadBinaryFromFile(record_filename, content);
+
+  std::vector<std::array<uint64_t, 5>> records;
+  const uint8_t *p = reinterpret_cast<const uint8_t*>(content.data());
+  size_t remain = content.size();
+  while (remain > 0) {
+    std::array<uint64_t, 5> values;
+    for (auto &value : values) {
+      size_t size = util::ParseScalableInteger(p, remain, value);
+      if (size == 0)
+        return records;
+      p += size;
+      remain -= size;
+    }
+    records.push_back(values);
+  }
+  return records;
+}
+
+//! 从记录文件中读出所有记录的线程编号
+std::vector<uint64_t> ReadThreadIndexes(const std::string &record_filename)
+{
+  std::vector<uint64_t> thread_indexes;
+  for (auto &values : ReadRecordFields(record_filename))
+    thread_indexes.push_back(values[2]);
+  return thread_indexes;
+}
+
+//! 瞬时事件与时长为0的片段，在记录中以类型标记区分
+TEST(Sink, EventKind) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.enable();
+  ts.commitRecord("void a()", "a", 1, 100, 0);
+  ts.commitEvent("void a()", "a", 2, 101);
+  ts.commitRecord("void a()", "a", 3, 102, 5);
+  ts.disable();
+
+  //! 每条记录的第2个整数为 (duration_us << 1) | is_event
+  std::vector<uint64_t> duration_kinds;
+  for (auto &values : ReadRecordFields(ts.getCurrRecordFilename()))
+    duration_kinds.push_back(values[1]);
+  EXPECT_EQ(duration_kinds, std::vector<uint64_t>({0, 1, 10}));
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
 TEST(Sink, MultiThread) {
   std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
 
@@ -96,9 +163,10 @@ TEST(Sink, MultiThread) {
   ts.setPathPrefix(path_prefix);
   ts.enable();
 
-  auto test_func = [&ts] (const std::string name) {
+  //! 名称只保存指针，必须是生命期足够长的字符串
+  auto test_func = [&ts] (const char *name) {
     for (int i = 0; i < 1000; ++i) {
-      ts.commitRecord(name.c_str(), "A", 100, util::GetUtcMicroseconds(), 10);
+      ts.commitRecord(name, "A", 100, util::GetUtcMicroseconds(), 10);
     }
   };
 
@@ -108,9 +176,240 @@ TEST(Sink, MultiThread) {
   t.join();
   ts.disable();
 
-  //!TODO: 检查记录和条数是否有2000条
+  auto thread_indexes = ReadThreadIndexes(ts.getCurrRecordFilename());
+  EXPECT_EQ(thread_indexes.size(), 2000u);
+  EXPECT_EQ(std::count(thread_indexes.begin(), thread_indexes.end(), 0u), 1000);
+  EXPECT_EQ(std::count(thread_indexes.begin(), thread_indexes.end(), 1u), 1000);
+
   util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
 }
 
+//! 过滤设置变更后，按指针缓存的过滤结果要随之更新
+TEST(Sink, FilterChange) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+
+  ts.setFilterExemptSet({"filter_b"});
+  ts.enable();
+  ts.commitRecord("void a()", "filter_a", 1, 100, 1);
+  ts.commitRecord("void b()", "filter_b", 1, 101, 1);
+  ts.disable();
+  EXPECT_EQ(ReadThreadIndexes(ts.getCurrRecordFilename()).size(), 1u);
+
+  ts.setFilterExemptSet({});
+  ts.enable();
+  ts.commitRecord("void a()", "filter_a", 1, 102, 1);
+  ts.commitRecord("void b()", "filter_b", 1, 103, 1);
+  ts.disable();
+  EXPECT_EQ(ReadThreadIndexes(ts.getCurrRecordFilename()).size(), 2u);
+
+  std::string module_list_content;
+  ASSERT_TRUE(util::fs::ReadStringFromTextFile(ts.getDirPath() + "/modules.txt", module_list_content));
+  EXPECT_NE(module_list_content.find("filter_b\n"), std::string::npos);
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+//! 缓冲满时丢弃记录，而不是阻塞
+TEST(Sink, DropWhenFull) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setThreadBufferSize(16);
+  ts.enable();
+
+  auto origin_dropped = ts.droppedCount();
+  for (int i = 0; i < 10000; ++i)
+    ts.commitRecord("void a()", "a", 1, i, 1);
+  ts.disable();
+  ts.setThreadBufferSize(4096);
+
+  auto written = ReadThreadIndexes(ts.getCurrRecordFilename()).size();
+  EXPECT_EQ(written + (ts.droppedCount() - origin_dropped), 10000u);
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, Counter) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+
+  ts.commitCounter("counter_a", 50, 1);  //! 未使能，应被忽略
+  ts.enable();
+  ts.commitCounter("counter_a", 100, 5);
+  ts.commitCounter("counter_b", 150, -3);
+  ts.commitCounter("counter_a", 200, 0);
+  ts.disable();
+
+  std::string path = ts.getDirPath();
+
+  std::string counter_list_content;
+  ASSERT_TRUE(util::fs::ReadStringFromTextFile(path + "/counters.txt", counter_list_content));
+  EXPECT_EQ(counter_list_content, "counter_a\ncounter_b\n");
+
+  //! 时间差、编号、ZigZag 编码的值
+  std::string counter_content;
+  ASSERT_TRUE(util::fs::ReadBinaryFromFile(path + "/counters.bin", counter_content));
+  auto counter_content_hex = util::string::RawDataToHexStr(counter_content.data(), counter_content.size());
+  EXPECT_EQ(counter_content_hex, "64 00 0a 32 01 05 32 00 00");
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+//! 测量前端提交与后台落盘的吞吐量
+TEST(Sink, Benchmark) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+  const char *kNames[] = { "void a()", "void b(int)", "int c(std::string)", "bool d()" };
+  const int kRecordNum = 1 << 20;
+
+  for (int thread_num : { 1, 4 }) {
+    //! 缓冲足以容纳全部记录，使测得的是后台的处理能力，而非丢弃的速度
+    const int kRecordNumPerThread = kRecordNum / thread_num;
+    auto &ts = Sink::GetInstance();
+    ts.setPathPrefix(path_prefix);
+    ts.setThreadBufferSize(kRecordNumPerThread);
+    ts.enable();
+
+    auto origin_dropped = ts.droppedCount();
+    auto start = std::chrono::steady_clock::now();
+
+    auto test_func = [&ts, &kNames, kRecordNumPerThread] {
+      uint64_t ts_us = util::GetUtcMicroseconds();
+      for (int i = 0; i < kRecordNumPerThread; ++i)
+        ts.commitRecord(kNames[i & 3], "bench", 10 + (i & 3), ts_us + i, 1);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; ++i)
+      threads.emplace_back(test_func);
+    for (auto &t : threads)
+      t.join();
+
+    auto commit_cost = std::chrono::steady_clock::now() - start;
+    ts.disable();
+    auto total_cost = std::chrono::steady_clock::now() - start;
+    ts.setThreadBufferSize(4096);
+
+    uint64_t total_num = static_cast<uint64_t>(kRecordNumPerThread) * thread_num;
+    uint64_t dropped = ts.droppedCount() - origin_dropped;
+    auto commit_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(commit_cost).count();
+    auto total_us = std::chrono::duration_cast<std::chrono::microseconds>(total_cost).count();
+
+    std::cout << thread_num << " thread(s): commit " << commit_ns / static_cast<int64_t>(total_num) << " ns/record"
+              << ", end-to-end " << (total_num - dropped) * 1000000 / total_us << " records/s"
+              << ", dropped " << dropped << std::endl;
+
+    util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+  }
+}
+
+namespace {
+void SampledFunc() { RECORD_SCOPE(); }
+
+//! 约1us的工作量，代表一次典型的事件回调
+__attribute__((noinline)) uint64_t BusyWork()
+{
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < 2000; ++i)
+    sum = sum + i;
+  return sum;
+}
+
+__attribute__((noinline)) uint64_t TracedBusyWork()
+{
+  RECORD_SCOPE();
+  return BusyWork();
+}
+}
+
+TEST(Recorder, SampleEveryN) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.enable();
+
+  SetRecordSampling(10, 0);
+  for (int i = 0; i < 1000; ++i)
+    SampledFunc();
+  SetRecordSampling(1, 0);
+
+  ts.disable();
+  EXPECT_EQ(ReadThreadIndexes(ts.getCurrRecordFilename()).size(), 100u);
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Recorder, SampleMinDuration) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.enable();
+
+  SetRecordSampling(1, 1000);
+  for (int i = 0; i < 100; ++i)
+    SampledFunc();
+  {
+    RECORD_SCOPE();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  SetRecordSampling(1, 0);
+
+  ts.disable();
+  EXPECT_EQ(ReadThreadIndexes(ts.getCurrRecordFilename()).size(), 1u);
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+//! 测量开启 trace 时，RECORD_SCOPE() 在各采样设置下带来的开销
+TEST(Recorder, SamplingBenchmark) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+  auto &ts = Sink::GetInstance();
+  const int kLoopNum = 100000;
+
+  //! 交替测量多轮取最小值，以减小干扰
+  auto measure = [&] (uint64_t (*func)()) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kLoopNum; ++i)
+      func();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()) / kLoopNum;
+  };
+
+  struct {
+    const char *name;
+    uint32_t every_n;
+    uint32_t min_duration_us;
+  } cases[] = {
+    { "every call", 1, 0 },
+    { "1 in 100", 100, 0 },
+    { ">= 100 us", 1, 100 },
+  };
+
+  for (auto &c : cases) {
+    ts.setPathPrefix(path_prefix);
+    ts.setThreadBufferSize(1 << 20);
+    ts.enable();
+    SetRecordSampling(c.every_n, c.min_duration_us);
+
+    double base_ns = 1e9, traced_ns = 1e9;
+    for (int round = 0; round < 5; ++round) {
+      base_ns = std::min(base_ns, measure(BusyWork));
+      traced_ns = std::min(traced_ns, measure(TracedBusyWork));
+    }
+
+    SetRecordSampling(1, 0);
+    ts.disable();
+    ts.setThreadBufferSize(4096);
+
+    std::cout << c.name << ": work " << base_ns << " ns, with recorder " << traced_ns
+              << " ns, overhead " << (traced_ns - base_ns) * 100.0 / base_ns << "%" << std::endl;
+    util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+  }
+}
+
 }
 }
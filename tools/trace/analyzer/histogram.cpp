@@ -0,0 +1,106 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "histogram.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace tbox {
+namespace trace {
+
+namespace {
+constexpr int kSubBucketBits = 5;
+constexpr size_t kSubBucketNum = 1 << kSubBucketBits;   //!< 每段的桶数
+constexpr size_t kLinearNum = kSubBucketNum * 2;        //!< [0, 64) 每个值一个桶
+}
+
+size_t Histogram::ToIndex(uint64_t value)
+{
+    if (value < kLinearNum)
+        return value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits;
+    return kLinearNum + (msb - kSubBucketBits - 1) * kSubBucketNum + ((value >> shift) - kSubBucketNum);
+}
+
+uint64_t Histogram::IndexLowerBound(size_t index)
+{
+    if (index < kLinearNum)
+        return index;
+
+    size_t segment = (index - kLinearNum) / kSubBucketNum;
+    size_t sub = (index - kLinearNum) % kSubBucketNum;
+    int shift = segment + 1;
+    return static_cast<uint64_t>(kSubBucketNum + sub) << shift;
+}
+
+uint64_t Histogram::IndexUpperBound(size_t index)
+{
+    if (index < kLinearNum)
+        return index;
+
+    size_t segment = (index - kLinearNum) / kSubBucketNum;
+    return IndexLowerBound(index) + ((1ull << (segment + 1)) - 1);
+}
+
+void Histogram::add(uint64_t value)
+{
+    size_t index = ToIndex(value);
+    if (index >= buckets_.size())
+        buckets_.resize(index + 1, 0);
+
+    ++buckets_[index];
+    ++count_;
+}
+
+void Histogram::merge(const Histogram &other)
+{
+    if (other.buckets_.size() > buckets_.size())
+        buckets_.resize(other.buckets_.size(), 0);
+
+    for (size_t i = 0; i < other.buckets_.size(); ++i)
+        buckets_[i] += other.buckets_[i];
+
+    count_ += other.count_;
+}
+
+uint64_t Histogram::percentile(double ratio) const
+{
+    if (count_ == 0)
+        return 0;
+
+    ratio = std::min(std::max(ratio, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(ratio * count_)));
+
+    uint64_t acc = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        acc += buckets_[i];
+        if (acc >= rank) {
+            uint64_t lower = IndexLowerBound(i);
+            return lower + (IndexUpperBound(i) - lower) / 2;
+        }
+    }
+
+    return IndexUpperBound(buckets_.size() - 1);
+}
+
+}
+}
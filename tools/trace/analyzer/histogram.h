@@ -0,0 +1,65 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_TRACE_ANALYZER_HISTOGRAM_H_20251018
+#define TBOX_TRACE_ANALYZER_HISTOGRAM_H_20251018
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace tbox {
+namespace trace {
+
+/**
+ * 对数分桶的直方图，用于统计时长的分位数
+ *
+ * 小于64的值每个值一个桶，是精确的；更大的值按2的幂次分段，每段再均分成32个桶，
+ * 相对误差不超过 1/32。桶的划分是固定的，所以多个直方图可以直接逐桶相加合并，
+ * 便于各线程分别统计后再汇总。
+ */
+class Histogram {
+  public:
+    void add(uint64_t value);
+    void merge(const Histogram &other);
+
+    uint64_t count() const { return count_; }
+
+    /**
+     * \brief   获取分位数
+     *
+     * \param   ratio   分位，范围 [0, 1]，如 0.99 表示 p99
+     *
+     * \return  该分位所在桶的中值，直方图为空时返回0
+     */
+    uint64_t percentile(double ratio) const;
+
+  private:
+    static size_t ToIndex(uint64_t value);
+    static uint64_t IndexLowerBound(size_t index);
+    static uint64_t IndexUpperBound(size_t index);
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_TRACE_ANALYZER_HISTOGRAM_H_20251018
@@ -18,14 +18,22 @@
  * of the source tree.
  */
 #include <iostream>
+#include <fstream>
 #include <limits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <cstdio>
 
 #include <tbox/util/fs.h>
-#include <tbox/util/string.h>
-#include <tbox/util/buffer.h>
 #include <tbox/util/scalable_integer.h>
+#include <tbox/trace/sink.h>
 
 #include "writer.h"
+#include "record_file.h"
+#include "histogram.h"
 
 using namespace std;
 using namespace tbox;
@@ -34,119 +42,202 @@ using namespace tbox;
 struct Stat {
     uint64_t  name_index = 0;
     uint64_t  module_index = 0;
+    bool      is_event = false;     //! 是否为瞬时事件
 
     size_t    times = 0;            //! 次数
     uint64_t  dur_acc_us = 0;       //! 累积时长
     uint64_t  dur_min_us = std::numeric_limits<uint64_t>::max(); //! 最小时长
     uint64_t  dur_max_us = 0;       //! 最大时长
     uint64_t  dur_max_ts_us = 0;    //! 最大时长的时间点
+    size_t    dur_max_chunk = 0;    //! 最大时长所在的块，解码时 dur_max_ts_us 是相对该块的
 
     uint64_t  dur_avg_us = 0;       //! 平均时长
     uint64_t  dur_warn_line_us = 0; //! 警告水位线
 
     uint64_t  dur_warn_count = 0;   //! 超过警告水位线次数
+
+    trace::Histogram dur_hist;      //! 时长分布
 };
 
 using StringVec = std::vector<std::string>;
 using StatVec = std::vector<Stat>;
 
-//! start_time_us, duration_us, name_index, module_index, thread_index
-using RecordHandleFunc = std::function<void(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t)>;
+//! 待解码的块
+struct Chunk {
+    size_t file_index = 0;
+    trace::RecordFile::Chunk range;
+    uint64_t base_end_ts_us = 0;    //! 该块之前最后一条记录的结束时间
+    uint64_t end_diff_sum_us = 0;   //! 该块中所有记录 end_diff_us 之和
+};
+
+//! 一个块转换出的视图数据
+struct ChunkView {
+    std::string events;
+    size_t record_num = 0;
+    uint64_t begin_ts_us = std::numeric_limits<uint64_t>::max();
+    uint64_t end_ts_us = 0;
+
+    void add(const std::string &name, const std::string &module, uint64_t pid, uint64_t tid,
+             uint64_t start_ts_us, uint64_t duration_us, bool is_event) {
+        trace::Writer::AppendRecorder(events, name, module, pid, tid, start_ts_us, duration_us, is_event);
+        updateRange(start_ts_us, start_ts_us + duration_us);
+    }
+
+    void addCounter(const std::string &name, uint64_t pid, uint64_t ts_us, int64_t value) {
+        trace::Writer::AppendCounter(events, name, pid, ts_us, value);
+        updateRange(ts_us, ts_us);
+    }
+
+    void updateRange(uint64_t begin, uint64_t end) {
+        ++record_num;
+        begin_ts_us = std::min(begin_ts_us, begin);
+        end_ts_us = std::max(end_ts_us, end);
+    }
+};
+
+/**
+ * 时间线上的轨道
+ *
+ * 每个线程一条轨道，tid 取真实的线程号；超出警告线的与最大时长的记录另各占一条轨道。
+ * 轨道的名称以元数据的形式写在每个视图文件的开头。
+ */
+struct Tracks {
+    uint64_t pid = 0;
+    std::vector<uint64_t> thread_tids;
+    uint64_t warn_tid = 0;
+    uint64_t max_tid = 0;
+    std::string metadata;
+};
+
+//! 每块的记录文件数据大小，也决定了索引视图中每个分块文件的大小
+constexpr size_t kChunkSize = 1 << 20;
 
 void PrintUsage(const char *proc_name)
 {
     std::cout
       << "This is cpp-tbox trace analyze tool." << std::endl
       << "It reads record files from the specified directory, and generates view.json and stat.txt in this directory." << std::endl
+      << "It also splits the view into chunk files under view/, indexed by time in view_index.json," << std::endl
+      << "so that a viewer can load only the chunks within a time window." << std::endl
+      << "The views are in Chrome trace event format, with one track per thread and counter tracks," << std::endl
+      << "which can be opened by chrome://tracing or https://ui.perfetto.dev" << std::endl
       << std::endl
-      << "Usage: " << proc_name << " <dir_path>" << std::endl
-      << "Exp  : " << proc_name << " /some/where/my_proc.20240531_032237.114" << std::endl;
+      << "Usage: " << proc_name << " <dir_path> [thread_num]" << std::endl
+      << "Exp  : " << proc_name << " /some/where/my_proc.20240531_032237.114" << std::endl
+      << "       " << proc_name << " /some/where/my_proc.20240531_032237.114 4" << std::endl;
 }
 
-//! 从Buffer中提取5个uint64_t的数值
-bool PickRecord(util::Buffer &buffer, uint64_t &end_diff_us, uint64_t &duration_us,
-                uint64_t &thread_index, uint64_t &name_index, uint64_t &module_index)
+//! 用 thread_num 个线程并行执行 func(index, worker_index)，index 取 [0, num)
+void ParallelFor(size_t num, size_t thread_num, const std::function<void(size_t, size_t)> &func)
 {
-    uint8_t *buffer_begin = buffer.readableBegin();
-    size_t   buffer_size  = buffer.readableSize();
+    std::atomic<size_t> next_index(0);
+    auto worker = [&] (size_t worker_index) {
+        for (;;) {
+            size_t index = next_index++;
+            if (index >= num)
+                break;
+            func(index, worker_index);
+        }
+    };
 
-    size_t  parse_size = 0;
-    size_t  data_size = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_num; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), end_diff_us);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+    for (auto &t : threads)
+        t.join();
+}
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), duration_us);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+/**
+ * 读取记录文件的格式版本
+ * 没有 version.txt 的是旧版本1，按旧格式解码；比本工具新的版本无法解码，拒绝
+ */
+bool ReadFormatVersion(const std::string &dir_path, int &format_version)
+{
+    std::string version_filename = dir_path + "/version.txt";
+    if (!util::fs::IsFileExist(version_filename)) {
+        std::cerr << "Warn: No version.txt, decode as format version 1" << std::endl;
+        format_version = 1;
+        return true;
+    }
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), thread_index);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+    StringVec lines;
+    std::string content;
+    if (util::fs::ReadAllLinesFromTextFile(version_filename, lines) && !lines.empty())
+        content = lines.front();
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), name_index);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+    try {
+        format_version = std::stoi(content);
+    } catch (const std::exception &) { }
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), module_index);
-    if (parse_size == 0)
+    if (format_version < 1 || format_version > trace::kRecordFormatVersion) {
+        std::cerr << "Err: Unsupported format version '" << content
+                  << "' in version.txt, max supported: " << trace::kRecordFormatVersion << std::endl;
         return false;
-    data_size += parse_size;
-
-    buffer.hasRead(data_size);
+    }
     return true;
 }
 
-//! 读取指定的记录文件
-void ReadRecordFile(const std::string &filename, const RecordHandleFunc &func)
+//! 打开目录下所有的记录文件，并切块
+bool OpenAllRecordFiles(const std::string &records_dir, int format_version,
+                        std::vector<std::unique_ptr<trace::RecordFile>> &files, std::vector<Chunk> &chunks)
 {
-    std::ifstream ifs(filename, std::ifstream::binary);
-    if (!ifs) {
-        std::cerr << "Err: Read '" << filename << "' fail!" << std::endl;
-        return;
+    StringVec record_file_vec;
+    if (!util::fs::ListDirectory(records_dir, record_file_vec)) {
+      std::cerr << "Err: List '" << records_dir << "' fail!" << std::endl;
+      return false;
     }
 
-    uint64_t last_end_ts_us = 0;
-    util::Buffer buffer;
-
-    while (true) {
-        char tmp[1024];
-        auto rsize = ifs.readsome(tmp, sizeof(tmp));
-        if (rsize == 0)
-            break;
-
-        buffer.append(tmp, rsize);
-
-        while (buffer.readableSize() >= 4) {
-            uint64_t end_diff_us, duration_us, thread_index, name_index, module_index;
-            if (!PickRecord(buffer, end_diff_us, duration_us, thread_index, name_index, module_index))
-                break;
-
-            uint64_t end_ts_us = last_end_ts_us + end_diff_us;
-            uint64_t start_ts_us = end_ts_us - duration_us;
-            last_end_ts_us = end_ts_us;
+    for (auto record_file : record_file_vec) {
+        auto filename = records_dir + '/' + record_file;
+        std::unique_ptr<trace::RecordFile> file(new trace::RecordFile);
+        if (!file->open(filename, format_version)) {
+            std::cerr << "Err: Read '" << filename << "' fail!" << std::endl;
+            continue;
+        }
 
-            func(start_ts_us, duration_us, name_index, module_index, thread_index);
+        std::vector<trace::RecordFile::Chunk> ranges;
+        file->split(kChunkSize, ranges);
+        for (auto &range : ranges) {
+            Chunk chunk;
+            chunk.file_index = files.size();
+            chunk.range = range;
+            chunks.push_back(chunk);
         }
+        files.push_back(std::move(file));
     }
+    return true;
 }
 
-//! 读取目录下所有的记录文件
-void ReadAllRecordFiles(const std::string &records_dir, const RecordHandleFunc &func)
+//! 合并各线程的统计数据
+void MergeStats(const std::vector<StatVec> &worker_stat_vecs, const std::vector<Chunk> &chunks, StatVec &stat_vec)
 {
-    StringVec record_file_vec;
-    if (!util::fs::ListDirectory(records_dir, record_file_vec)) {
-      std::cerr << "Err: List '" << records_dir << "' fail!" << std::endl;
-      return;
+    for (auto &worker_stat_vec : worker_stat_vecs) {
+        for (size_t i = 0; i < stat_vec.size(); ++i) {
+            auto &src = worker_stat_vec.at(i);
+            auto &dst = stat_vec.at(i);
+            if (src.times == 0)
+                continue;
+
+            bool is_first = dst.times == 0;
+            dst.name_index = src.name_index;
+            dst.module_index = src.module_index;
+            dst.is_event = src.is_event;
+            dst.times += src.times;
+            dst.dur_acc_us += src.dur_acc_us;
+            dst.dur_min_us = std::min(dst.dur_min_us, src.dur_min_us);
+            //! 最大时长相同时，取最早的那次
+            uint64_t dur_max_ts_us = src.dur_max_ts_us + chunks.at(src.dur_max_chunk).base_end_ts_us;
+            if (is_first || dst.dur_max_us < src.dur_max_us ||
+                (dst.dur_max_us == src.dur_max_us && dst.dur_max_ts_us > dur_max_ts_us)) {
+                dst.dur_max_us = src.dur_max_us;
+                dst.dur_max_ts_us = dur_max_ts_us;
+            }
+            dst.dur_warn_count += src.dur_warn_count;
+            dst.dur_hist.merge(src.dur_hist);
+        }
     }
-
-    for (auto record_file : record_file_vec)
-        ReadRecordFile(records_dir + '/' + record_file, func);
 }
 
 //! 导出统计数据到文件
@@ -169,6 +260,9 @@ void DumpStatToFile(const StringVec &name_vec, const StatVec &stat_vec, const st
             << "times            : " << stat.times << std::endl
             << "dur_min_us       : " << stat.dur_min_us << " us" << std::endl
             << "dur_avg_us       : " << stat.dur_avg_us << " us" << std::endl
+            << "dur_p50_us       : " << stat.dur_hist.percentile(0.50) << " us" << std::endl
+            << "dur_p90_us       : " << stat.dur_hist.percentile(0.90) << " us" << std::endl
+            << "dur_p99_us       : " << stat.dur_hist.percentile(0.99) << " us" << std::endl
             << "dur_max_us       : " << stat.dur_max_us << " us" << std::endl
             << "dur_max_at_us    : " << stat.dur_max_ts_us << " us" << std::endl
             << "dur_warn_line_us : " << stat.dur_warn_line_us << " us" << std::endl
@@ -177,6 +271,134 @@ void DumpStatToFile(const StringVec &name_vec, const StatVec &stat_vec, const st
     }
 }
 
+/**
+ * 根据目录名与 threads.txt 确定各轨道
+ *
+ * 目录名形如 my_proc.20240531_032237.114，其中 "my_proc" 为进程名，"114" 为进程号
+ */
+void InitTracks(const std::string &dir_path, const StringVec &thread_vec, Tracks &tracks)
+{
+    auto dir_name = util::fs::Basename(dir_path);
+    auto proc_name = dir_name.substr(0, dir_name.find('.'));
+    auto pid_str = dir_name.substr(dir_name.rfind('.') + 1);
+    try {
+        tracks.pid = std::stoull(pid_str);
+    } catch (const std::exception &) {
+        tracks.pid = 0;
+    }
+
+    uint64_t max_tid = 0;
+    for (size_t i = 0; i < thread_vec.size(); ++i) {
+        uint64_t tid = i;
+        try {
+            tid = std::stoull(thread_vec[i]);
+        } catch (const std::exception &) { }
+        tracks.thread_tids.push_back(tid);
+        max_tid = std::max(max_tid, tid);
+    }
+    tracks.warn_tid = max_tid + 1;
+    tracks.max_tid = max_tid + 2;
+
+    trace::Writer::AppendProcessName(tracks.metadata, tracks.pid, proc_name);
+    for (size_t i = 0; i < thread_vec.size(); ++i)
+        trace::Writer::AppendThreadName(tracks.metadata, tracks.pid, tracks.thread_tids[i], thread_vec[i]);
+    trace::Writer::AppendThreadName(tracks.metadata, tracks.pid, tracks.warn_tid, "WARN");
+    trace::Writer::AppendThreadName(tracks.metadata, tracks.pid, tracks.max_tid, "MAX");
+}
+
+/**
+ * 读取计数器采样
+ *
+ * counters.bin 中每个采样是3个可变长整数：与上一个采样的时间差、计数器编号、ZigZag 编码后的采样值
+ */
+void ReadCounters(const std::string &dir_path, uint64_t pid, ChunkView &view)
+{
+    StringVec counter_vec;
+    std::string content;
+    if (!util::fs::ReadAllLinesFromTextFile(dir_path + "/counters.txt", counter_vec) ||
+        !util::fs::ReadBinaryFromFile(dir_path + "/counters.bin", content))
+        return;
+
+    const uint8_t *ptr = reinterpret_cast<const uint8_t*>(content.data());
+    size_t remain = content.size();
+    uint64_t last_ts_us = 0;
+
+    while (remain > 0) {
+        uint64_t values[3];
+        for (auto &value : values) {
+            auto parse_size = util::ParseScalableInteger(ptr, remain, value);
+            if (parse_size == 0)
+                return;
+            ptr += parse_size;
+            remain -= parse_size;
+        }
+
+        uint64_t ts_us = last_ts_us + values[0];
+        last_ts_us = ts_us;
+        if (values[1] >= counter_vec.size())
+            continue;
+
+        int64_t value = static_cast<int64_t>(values[2] >> 1) ^ -static_cast<int64_t>(values[2] & 1);
+        view.addCounter(counter_vec[values[1]], pid, ts_us, value);
+    }
+}
+
+//! 将分块视图写成一个独立的 trace 文件
+bool WriteChunkViewFile(const std::string &filename, const Tracks &tracks, const ChunkView &view)
+{
+    trace::Writer writer;
+    if (!writer.open(filename))
+        return false;
+
+    writer.writeHeader();
+    writer.writeEvents(tracks.metadata);
+    writer.writeEvents(view.events);
+    writer.writeFooter();
+    return true;
+}
+
+/**
+ * 索引文件，格式如下：
+ * {"chunks":[
+ * {"file":"view/000000.json","begin_ts_us":xxx,"end_ts_us":xxx,"records":xxx},
+ * ...
+ * ]}
+ * 查看某个时间段时，只需要加载与之有交集的分块文件
+ */
+class IndexWriter {
+  public:
+    bool open(const std::string &filename) {
+        ofs_.open(filename);
+        if (!ofs_)
+            return false;
+        ofs_ << R"({"chunks":[)" << '\n';
+        return true;
+    }
+
+    void add(const std::string &chunk_filename, const ChunkView &view) {
+        if (view.record_num == 0)
+            return;
+
+        if (chunk_num_ > 0)
+            ofs_ << ",\n";
+        ++chunk_num_;
+
+        ofs_ << R"({"file":")" << chunk_filename
+             << R"(","begin_ts_us":)" << view.begin_ts_us
+             << R"(,"end_ts_us":)" << view.end_ts_us
+             << R"(,"records":)" << view.record_num << '}';
+    }
+
+    void close() {
+        ofs_ << "\n]}" << std::endl;
+        ofs_.close();
+    }
+
+  private:
+    std::ofstream ofs_;
+    size_t chunk_num_ = 0;
+};
+
 int main(int argc, char **argv)
 {
     if (argc <= 1) {
@@ -190,15 +412,26 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    std::string view_filename = dir_path + "/view.json";
-    std::string stat_filename = dir_path + "/stat.txt";
+    size_t thread_num = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 2) {
+        try {
+            thread_num = std::max(1, std::stoi(argv[2]));
+        } catch (const std::exception &) {
+            std::cerr << "Err: invalid thread_num '" << argv[2] << "'" << std::endl;
+            return 0;
+        }
+    }
 
-    std::cout << "Info: Generating " << view_filename << std::endl;
-    trace::Writer writer;
-    if (!writer.open(view_filename)) {
-        std::cerr << "Err: Create '" << view_filename << "' fail!" << std::endl;
+    auto start_time = std::chrono::steady_clock::now();
+
+    int format_version = 0;
+    if (!ReadFormatVersion(dir_path, format_version))
         return 0;
-    }
+
+    std::string view_filename = dir_path + "/view.json";
+    std::string stat_filename = dir_path + "/stat.txt";
+    std::string index_filename = dir_path + "/view_index.json";
+    std::string chunk_dir = "view";
 
     //! 从 threads.txt, names.txt, modules.txt 文件中导入数据
     std::string names_filename = dir_path + "/names.txt";
@@ -213,73 +446,189 @@ int main(int argc, char **argv)
     if (!util::fs::ReadAllLinesFromTextFile(threads_filename, thread_vec))
         std::cerr << "Warn: Load threads.txt fail!" << std::endl;
 
-    std::vector<Stat> stat_vec(name_vec.size());
-    std::string records_dir = dir_path + "/records";
+    Tracks tracks;
+    InitTracks(dir_path, thread_vec, tracks);
+
+    std::vector<std::unique_ptr<trace::RecordFile>> files;
+    std::vector<Chunk> chunks;
+    OpenAllRecordFiles(dir_path + "/records", format_version, files, chunks);
+
+    //! 索引值超出范围的记录，是残缺的，忽略
+    auto is_record_valid = [&] (const trace::Record &record) {
+        return record.name_index < name_vec.size() &&
+               record.module_index < module_vec.size() &&
+               record.thread_index < thread_vec.size();
+    };
+
+    //! 第一次遍历，各线程分别统计，块内的时间先按相对于块开头计算
+    std::vector<StatVec> worker_stat_vecs(thread_num, StatVec(name_vec.size()));
+    std::vector<size_t> worker_invalid_nums(thread_num, 0);
+    ParallelFor(chunks.size(), thread_num,
+        [&] (size_t chunk_index, size_t worker_index) {
+            auto &chunk = chunks.at(chunk_index);
+            auto &stat_vec = worker_stat_vecs.at(worker_index);
+            auto &invalid_num = worker_invalid_nums.at(worker_index);
+
+            chunk.end_diff_sum_us = files.at(chunk.file_index)->decode(chunk.range, 0,
+                [&] (const trace::Record &record) {
+                    if (!is_record_valid(record)) {
+                        ++invalid_num;
+                        return;
+                    }
+
+                    auto &stat = stat_vec[record.name_index];
+                    stat.name_index = record.name_index;
+                    stat.module_index = record.module_index;
+                    stat.is_event = record.is_event;
+                    ++stat.times;
+                    stat.dur_acc_us += record.duration_us;
+                    if (stat.dur_max_us < record.duration_us || stat.times == 1) {
+                        stat.dur_max_us = record.duration_us;
+                        stat.dur_max_ts_us = record.start_ts_us;
+                        stat.dur_max_chunk = chunk_index;
+                    }
+
+                    if (stat.dur_min_us > record.duration_us)
+                        stat.dur_min_us = record.duration_us;
+
+                    stat.dur_hist.add(record.duration_us);
+                }
+            );
+        }
+    );
 
-    writer.writeHeader();
+    //! 推算各块的起始时间
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        auto &prev = chunks.at(i - 1);
+        auto &curr = chunks.at(i);
+        if (curr.file_index == prev.file_index)
+            curr.base_end_ts_us = prev.base_end_ts_us + prev.end_diff_sum_us;
+    }
 
-    //! 第一次遍历记录文件
-    ReadAllRecordFiles(records_dir,
-        [&] (uint64_t start_ts_us, uint64_t duration_us, uint64_t name_index, uint64_t module_index, uint64_t thread_index) {
-            auto &name = name_vec.at(name_index);
-            auto &module = module_vec.at(module_index);
-            auto &thread = thread_vec.at(thread_index);
-
-            writer.writeRecorder(name, module, thread, start_ts_us, duration_us);
-
-            auto &stat = stat_vec.at(name_index);
-            stat.name_index = name_index;
-            stat.module_index = module_index;
-            ++stat.times;
-            stat.dur_acc_us += duration_us;
-            if (stat.dur_max_us < duration_us) {
-                stat.dur_max_us = duration_us;
-                stat.dur_max_ts_us = start_ts_us;
-            }
+    StatVec stat_vec(name_vec.size());
+    MergeStats(worker_stat_vecs, chunks, stat_vec);
 
-            if (stat.dur_min_us > duration_us) {
-                stat.dur_min_us = duration_us;
-            }
-        }
-    );
+    size_t invalid_num = 0;
+    for (auto num : worker_invalid_nums)
+        invalid_num += num;
+    if (invalid_num > 0)
+        std::cerr << "Warn: " << invalid_num << " records with invalid index are ignored" << std::endl;
 
     //! 处理统计数据
+    size_t record_num = 0;
     for (auto &stat : stat_vec) {
         if (stat.times > 0) {
             stat.dur_avg_us = stat.dur_acc_us / stat.times;
             stat.dur_warn_line_us = (stat.dur_avg_us + stat.dur_max_us) / 2;
         }
+        record_num += stat.times;
     }
 
-    //! 第二次遍历记录文件，标出超出警告线的
-    ReadAllRecordFiles(records_dir,
-        [&] (uint64_t start_ts_us, uint64_t duration_us, uint64_t name_index, uint64_t module_index, uint64_t) {
-            auto &stat = stat_vec.at(name_index);
-            if (duration_us < stat.dur_warn_line_us)
-                return;
+    std::cout << "Info: Generating " << view_filename << std::endl;
+    trace::Writer writer;
+    if (!writer.open(view_filename)) {
+        std::cerr << "Err: Create '" << view_filename << "' fail!" << std::endl;
+        return 0;
+    }
+
+    std::cout << "Info: Generating " << index_filename << std::endl;
+    util::fs::RemoveDirectory(dir_path + '/' + chunk_dir);
+    util::fs::MakeDirectory(dir_path + '/' + chunk_dir);
+    IndexWriter index_writer;
+    if (!index_writer.open(index_filename)) {
+        std::cerr << "Err: Create '" << index_filename << "' fail!" << std::endl;
+        return 0;
+    }
+
+    writer.writeHeader();
+    writer.writeEvents(tracks.metadata);
+
+    //! 第二次遍历记录文件，生成视图，并标出超出警告线的
+    //! 每次并行转换 thread_num 块，再按顺序写入，以限制内存占用
+    std::vector<StatVec> worker_warn_vecs(thread_num, StatVec(name_vec.size()));
+    for (size_t batch_begin = 0; batch_begin < chunks.size(); batch_begin += thread_num) {
+        size_t batch_size = std::min(thread_num, chunks.size() - batch_begin);
+        std::vector<ChunkView> views(batch_size);
+
+        ParallelFor(batch_size, thread_num,
+            [&] (size_t batch_index, size_t worker_index) {
+                auto &chunk = chunks.at(batch_begin + batch_index);
+                auto &view = views.at(batch_index);
+                auto &warn_vec = worker_warn_vecs.at(worker_index);
+
+                files.at(chunk.file_index)->decode(chunk.range, chunk.base_end_ts_us,
+                    [&] (const trace::Record &record) {
+                        if (!is_record_valid(record))
+                            return;
+
+                        auto &name = name_vec[record.name_index];
+                        auto &module = module_vec[record.module_index];
+                        auto tid = tracks.thread_tids[record.thread_index];
+
+                        view.add(name, module, tracks.pid, tid, record.start_ts_us, record.duration_us, record.is_event);
+
+                        //! 瞬时事件没有时长，不参与警告线
+                        auto &stat = stat_vec[record.name_index];
+                        if (record.is_event || record.duration_us < stat.dur_warn_line_us)
+                            return;
+
+                        ++warn_vec[record.name_index].dur_warn_count;
+                        view.add(name, module, tracks.pid, tracks.warn_tid, record.start_ts_us, record.duration_us, false);
+                    }
+                );
+            }
+        );
 
-            auto &name = name_vec.at(name_index);
-            auto &module = module_vec.at(module_index);
+        for (size_t i = 0; i < batch_size; ++i) {
+            auto &view = views.at(i);
+            writer.writeEvents(view.events);
 
-            ++stat.dur_warn_count;
-            writer.writeRecorder(name, module, "WARN", start_ts_us, duration_us);
+            char tmp[32];
+            ::snprintf(tmp, sizeof(tmp), "%06zu.json", batch_begin + i);
+            auto chunk_filename = chunk_dir + '/' + tmp;
+            if (view.record_num > 0 && WriteChunkViewFile(dir_path + '/' + chunk_filename, tracks, view))
+                index_writer.add(chunk_filename, view);
         }
-    );
+    }
+
+    for (auto &warn_vec : worker_warn_vecs) {
+        for (size_t i = 0; i < stat_vec.size(); ++i)
+            stat_vec.at(i).dur_warn_count += warn_vec.at(i).dur_warn_count;
+    }
 
-    //! 标记出最大时间点
+    //! 标记出最大时间点，瞬时事件没有时长，不标记
+    ChunkView max_view;
     for (auto &stat : stat_vec) {
+        if (stat.times == 0 || stat.is_event)
+            continue;
         auto &name = name_vec.at(stat.name_index);
         auto &module = module_vec.at(stat.module_index);
-        writer.writeRecorder(name, module, "MAX", stat.dur_max_ts_us, stat.dur_max_us);
+        max_view.add(name, module, tracks.pid, tracks.max_tid, stat.dur_max_ts_us, stat.dur_max_us, false);
     }
+    writer.writeEvents(max_view.events);
 
+    //! 计数器采样，如事件循环与线程池的状态
+    ChunkView counter_view;
+    ReadCounters(dir_path, tracks.pid, counter_view);
+    writer.writeEvents(counter_view.events);
     writer.writeFooter();
 
+    auto max_filename = chunk_dir + "/max.json";
+    if (max_view.record_num > 0 && WriteChunkViewFile(dir_path + '/' + max_filename, tracks, max_view))
+        index_writer.add(max_filename, max_view);
+
+    auto counter_filename = chunk_dir + "/counters.json";
+    if (counter_view.record_num > 0 && WriteChunkViewFile(dir_path + '/' + counter_filename, tracks, counter_view))
+        index_writer.add(counter_filename, counter_view);
+    index_writer.close();
+
     //! 输出统计到 stat.txt
     std::cout << "Info: Generating " << stat_filename << std::endl;
     DumpStatToFile(name_vec, stat_vec, stat_filename);
 
+    auto cost_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Info: " << record_num << " records in " << files.size() << " files, "
+              << chunks.size() << " chunks, " << thread_num << " threads, cost " << cost_ms << " ms" << std::endl;
     std::cout << "Info: Success." << std::endl;
     return 0;
 }
-
@@ -0,0 +1,146 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "record_file.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <tbox/util/scalable_integer.h>
+
+namespace tbox {
+namespace trace {
+
+namespace {
+constexpr size_t kFieldNumPerRecord = 5;
+
+inline bool IsLastByteOfInteger(uint8_t value) { return (value & 0x80) == 0; }
+}
+
+RecordFile::~RecordFile()
+{
+    close();
+}
+
+bool RecordFile::open(const std::string &filename, int format_version)
+{
+    close();
+    format_version_ = format_version;
+
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void *ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        ::madvise(ptr, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<uint8_t*>(ptr);
+    }
+
+    ::close(fd);
+    return true;
+}
+
+void RecordFile::close()
+{
+    if (data_ != nullptr) {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+    }
+    size_ = 0;
+}
+
+void RecordFile::split(size_t chunk_size, std::vector<Chunk> &chunks) const
+{
+    if (size_ == 0)
+        return;
+
+    if (chunk_size == 0)
+        chunk_size = size_;
+
+    size_t pos = 0;
+    size_t integer_num = 0; //! [0, pos) 中完整的整数个数
+
+    chunks.push_back(Chunk{0, size_});
+
+    while (pos + chunk_size < size_) {
+        size_t next_pos = pos + chunk_size;
+        for (size_t i = pos; i < next_pos; ++i)
+            integer_num += IsLastByteOfInteger(data_[i]);
+
+        //! 向后移到下一条记录的开头
+        while (next_pos < size_ &&
+               !((integer_num % kFieldNumPerRecord) == 0 && IsLastByteOfInteger(data_[next_pos - 1]))) {
+            integer_num += IsLastByteOfInteger(data_[next_pos]);
+            ++next_pos;
+        }
+
+        if (next_pos >= size_)
+            break;
+
+        chunks.back().end = next_pos;
+        chunks.push_back(Chunk{next_pos, size_});
+        pos = next_pos;
+    }
+}
+
+bool RecordFile::pickRecord(const uint8_t *&ptr, const uint8_t *end,
+                            uint64_t &end_diff_us, Record &record) const
+{
+    uint64_t duration_kind = 0;
+    uint64_t *fields[kFieldNumPerRecord] = {
+        &end_diff_us, &duration_kind, &record.thread_index,
+        &record.name_index, &record.module_index
+    };
+
+    const uint8_t *curr = ptr;
+    for (auto field : fields) {
+        auto parse_size = util::ParseScalableInteger(curr, end - curr, *field);
+        if (parse_size == 0)
+            return false;
+        curr += parse_size;
+    }
+
+    if (format_version_ >= 2) {
+        record.duration_us = duration_kind >> 1;
+        record.is_event = (duration_kind & 1) != 0;
+    } else {
+        record.duration_us = duration_kind;
+        record.is_event = false;
+    }
+    ptr = curr;
+    return true;
+}
+
+}
+}
@@ -0,0 +1,129 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2025 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_TRACE_ANALYZER_RECORD_FILE_H_20251018
+#define TBOX_TRACE_ANALYZER_RECORD_FILE_H_20251018
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tbox {
+namespace trace {
+
+//! 一条解码后的记录
+struct Record {
+    uint64_t start_ts_us;
+    uint64_t duration_us;
+    bool     is_event;      //!< 是否为 RECORD_EVENT() 的瞬时事件，否则为时长片段
+    uint64_t thread_index;
+    uint64_t name_index;
+    uint64_t module_index;
+};
+
+/**
+ * 以 mmap 方式打开的记录文件
+ *
+ * 记录文件由一条条记录首尾相接而成，每条记录是5个可变长整数：
+ * end_diff_us, duration_kind, thread_index, name_index, module_index
+ * 其中 end_diff_us 是与上一条记录结束时间的差值，文件中第一条记录的差值相对于0；
+ * duration_kind 为 (duration_us << 1) | is_event。
+ * 格式版本1的文件中，第二个字段就是 duration_us，没有瞬时事件，见 kRecordFormatVersion。
+ *
+ * 为了能并行解码，将文件切成若干块（Chunk），每块都从一条记录的开头开始。
+ * 可变长整数的每个字节中，只有最后一个字节的最高位为0，所以数一数前面有多少个
+ * 这样的字节，就知道某个位置处于第几个整数，不必从头解码。
+ */
+class RecordFile {
+  public:
+    RecordFile() = default;
+    ~RecordFile();
+
+    RecordFile(const RecordFile &) = delete;
+    RecordFile& operator = (const RecordFile &) = delete;
+
+    //! format_version 为目录下 version.txt 中的版本号，没有该文件的为1
+    bool open(const std::string &filename, int format_version);
+    void close();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    //! 文件中的一块，[begin, end) 为字节偏移
+    struct Chunk {
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * \brief   将文件切成约 chunk_size 字节大小的块，每块都从记录的开头开始
+     *
+     * \param   chunk_size  每块的期望大小
+     * \param   chunks      输出的块，按文件中的先后顺序排列
+     */
+    void split(size_t chunk_size, std::vector<Chunk> &chunks) const;
+
+    /**
+     * \brief   解码一块中的所有记录
+     *
+     * \param   chunk           要解码的块
+     * \param   base_end_ts_us  该块之前最后一条记录的结束时间，首块为0
+     * \param   func            每解出一条记录就回调一次
+     *
+     * \return  该块中最后一条记录的结束时间
+     *
+     * \note    如果 base_end_ts_us 传0，得到的时间就是相对于块的起始时间，
+     *          返回值即为该块内所有 end_diff_us 之和，用于推算后面各块的 base_end_ts_us
+     */
+    template <typename Func>
+    uint64_t decode(const Chunk &chunk, uint64_t base_end_ts_us, Func &&func) const;
+
+  private:
+    bool pickRecord(const uint8_t *&ptr, const uint8_t *end,
+                    uint64_t &end_diff_us, Record &record) const;
+
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    int format_version_ = 0;
+};
+
+template <typename Func>
+uint64_t RecordFile::decode(const Chunk &chunk, uint64_t base_end_ts_us, Func &&func) const
+{
+    const uint8_t *ptr = data_ + chunk.begin;
+    const uint8_t *end = data_ + chunk.end;
+
+    uint64_t last_end_ts_us = base_end_ts_us;
+    uint64_t end_diff_us = 0;
+    Record record;
+
+    while (pickRecord(ptr, end, end_diff_us, record)) {
+        uint64_t end_ts_us = last_end_ts_us + end_diff_us;
+        record.start_ts_us = end_ts_us - record.duration_us;
+        last_end_ts_us = end_ts_us;
+        func(record);
+    }
+
+    return last_end_ts_us;
+}
+
+}
+}
+
+#endif //TBOX_TRACE_ANALYZER_RECORD_FILE_H_20251018
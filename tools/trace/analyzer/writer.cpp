@@ -40,30 +40,98 @@ bool Writer::writeHeader()
     return true;
 }
 
-bool Writer::writeRecorder(const std::string &name, const std::string &module,
-                           const std::string &tid, uint64_t start_ts_us, uint64_t duration_us)
+bool Writer::writeEvents(const std::string &events)
 {
     if (!ofs_.is_open())
         return false;
 
+    if (events.empty())
+        return true;
+
     if (!is_first_record_)
-        ofs_ << ',' << std::endl;
+        ofs_ << ",\n";
     is_first_record_ = false;
 
-    ofs_  << R"({"name":")" << name
-          << R"(","cat":")" << module
-          << R"(","pid":"","tid":")"
-          << tid << R"(","ts":)" << start_ts_us << ',';
+    //! 不逐条 flush()，否则记录多时会非常慢
+    ofs_.write(events.data(), events.size());
+    return true;
+}
+
+namespace {
+//! 各事件之间以 ",\n" 分隔
+void AppendSeparator(std::string &out)
+{
+    if (!out.empty())
+        out += ",\n";
+}
+}
+
+void Writer::AppendRecorder(std::string &out, const std::string &name, const std::string &module,
+                            uint64_t pid, uint64_t tid, uint64_t start_ts_us, uint64_t duration_us,
+                            bool is_event)
+{
+    AppendSeparator(out);
 
-    if (duration_us != 0)
-        ofs_ << R"("ph":"X","dur":)" << duration_us;
-    else
-        ofs_ << R"("ph":"I")";
+    out += R"({"name":")";
+    out += name;
+    out += R"(","cat":")";
+    out += module;
+    out += R"(","pid":)";
+    out += std::to_string(pid);
+    out += R"(,"tid":)";
+    out += std::to_string(tid);
+    out += R"(,"ts":)";
+    out += std::to_string(start_ts_us);
+    out += ',';
 
-    ofs_ << "}";
-    ofs_.flush();
+    if (is_event) {
+        out += R"("ph":"i","s":"t")";
+    } else {
+        out += R"("ph":"X","dur":)";
+        out += std::to_string(duration_us);
+    }
 
-    return true;
+    out += '}';
+}
+
+void Writer::AppendCounter(std::string &out, const std::string &name, uint64_t pid,
+                           uint64_t ts_us, int64_t value)
+{
+    AppendSeparator(out);
+
+    out += R"({"name":")";
+    out += name;
+    out += R"(","ph":"C","pid":)";
+    out += std::to_string(pid);
+    out += R"(,"ts":)";
+    out += std::to_string(ts_us);
+    out += R"(,"args":{"value":)";
+    out += std::to_string(value);
+    out += "}}";
+}
+
+void Writer::AppendProcessName(std::string &out, uint64_t pid, const std::string &name)
+{
+    AppendSeparator(out);
+
+    out += R"({"name":"process_name","ph":"M","pid":)";
+    out += std::to_string(pid);
+    out += R"(,"args":{"name":")";
+    out += name;
+    out += R"("}})";
+}
+
+void Writer::AppendThreadName(std::string &out, uint64_t pid, uint64_t tid, const std::string &name)
+{
+    AppendSeparator(out);
+
+    out += R"({"name":"thread_name","ph":"M","pid":)";
+    out += std::to_string(pid);
+    out += R"(,"tid":)";
+    out += std::to_string(tid);
+    out += R"(,"args":{"name":")";
+    out += name;
+    out += R"("}})";
 }
 
 bool Writer::writeFooter()
@@ -27,15 +27,32 @@
 namespace tbox {
 namespace trace {
 
+/**
+ * 以 Chrome trace event 的 JSON 格式写出，可直接由 chrome://tracing 或 ui.perfetto.dev 打开
+ *
+ * 各事件可先由多个线程分别用 AppendXXX() 格式化好，再用 writeEvents() 按顺序写入，边转换边写出，
+ * 不必将整个视图都放在内存中。
+ */
 class Writer {
  public:
   bool open(const std::string &filename);
 
   bool writeHeader();
-  bool writeRecorder(const std::string &name, const std::string &module,
-                     const std::string &tid, uint64_t start_ts_us, uint64_t duration_us);
+  //! 写入由 AppendXXX() 预先格式化好的多个事件
+  bool writeEvents(const std::string &events);
   bool writeFooter();
 
+  //! 追加一个时长片段，is_event 为 true 时则为瞬时事件，如 RECORD_EVENT() 的记录
+  static void AppendRecorder(std::string &out, const std::string &name, const std::string &module,
+                             uint64_t pid, uint64_t tid, uint64_t start_ts_us, uint64_t duration_us,
+                             bool is_event);
+  //! 追加一个计数器采样，同名的采样在时间线上显示为一条曲线
+  static void AppendCounter(std::string &out, const std::string &name, uint64_t pid,
+                            uint64_t ts_us, int64_t value);
+  //! 追加进程名、线程名元数据，使每个线程都显示为一条有名称的轨道
+  static void AppendProcessName(std::string &out, uint64_t pid, const std::string &name);
+  static void AppendThreadName(std::string &out, uint64_t pid, uint64_t tid, const std::string &name);
+
  private:
   std::ofstream ofs_;
   bool is_first_record_ = true;